@@ -1,18 +1,31 @@
 #version 330 core
 
 in vec2 texCoord;
+in vec4 tint;
 
 uniform sampler2D textureMap;
+uniform int textureActive;
 
 out vec4 color;
 
 void main() {
- 
+
+	// Untextured particles are soft round dots
+	if (textureActive == 0) {
+		float falloff = 1.0 - length(texCoord * 2.0 - 1.0);
+		if (falloff <= 0.0) {
+			discard;
+		}
+
+		color = vec4(tint.rgb, tint.a * falloff);
+		return;
+	}
+
 	vec4 colorTemp = texture(textureMap, texCoord);
 
 	if (colorTemp.r >= 0.9 && colorTemp.g >= 0.9 && colorTemp.b >= 0.9) {
 		discard;
 	}
 
-	color = colorTemp;
+	color = colorTemp * tint;
 }
@@ -1,19 +1,26 @@
 #version 330 core
 
+// Corner of the shared quad in [-1, 1]
 layout(location = 0) in vec4 vertPos;
-layout(location = 1) in vec2 vertTex;
+
+// Per particle world position and half size, and color (alpha fades out with age)
+layout(location = 2) in vec4 particlePosSize;
+layout(location = 3) in vec4 particleColor;
 
 uniform mat4 P;
-uniform mat4 M;
 uniform mat4 V;
 out vec2 texCoord;
+out vec4 tint;
 
 void main() {
 
-	// Set the position of the vertex in homogeneous space
-	gl_Position = P * (V * M * vec4(0.0, 0.0, 0.0, 1.0) + vec4(vertPos.xy, 0.0, 1.0));
+	// Expand the quad in view space so it always faces the camera
+	vec4 center = V * vec4(particlePosSize.xyz, 1.0);
+	gl_Position = P * (center + vec4(vertPos.xy * particlePosSize.w, 0.0, 0.0));
 
 	// texture coordinates
 	vec2 vertTemp = vec2(vertPos.x, -vertPos.y) * 0.5 + 0.5;
 	texCoord = vertTemp;
+
+	tint = particleColor;
 }
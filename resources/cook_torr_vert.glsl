@@ -14,10 +14,14 @@ uniform mat4 tiM;
 // Push the position in camera space and normal in world space
 // to the fragment shader
 out vec3 positionInCamSpace;
+out vec3 positionInWorldSpace;
 out vec3 normalInWorldSpace;
 out vec3 positionInLightSpace;
 out vec2 texCoord;
 
+// Must match the depth of the pre-pass exactly (see "shadowPass_vert.glsl")
+invariant gl_Position;
+
 void main() {
 
 	// Set the position of the vertex in homogeneous space
@@ -25,6 +29,8 @@ void main() {
 
 	positionInLightSpace = (lightP * lightV * M * vertPos).xyz;
 
+	positionInWorldSpace = (M * vertPos).xyz;
+
 	// Calculate the position of the vertex in camera/view space
 	positionInCamSpace = (V * M * vertPos).xyz;
 
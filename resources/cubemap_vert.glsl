@@ -10,7 +10,10 @@ out vec3 vTexCoord;
 
 void main() {
 
-  gl_Position = P * V * M * vec4(vertPos.xyz, 1.0);
+  // V has no translation, so the sky is always around the camera. Depth is kept at the far plane (z = w) so
+  // that only the pixels left uncovered by the rest of the scene pass the depth test
+  vec4 pos = P * V * M * vec4(vertPos.xyz, 1.0);
+  gl_Position = pos.xyww;
 
   vTexCoord = vertPos;  
 
@@ -0,0 +1,55 @@
+#version 330 core
+
+layout(location = 0) in vec4 vertPos;
+layout(location = 1) in vec3 vertNor;
+layout(location = 2) in vec2 vertTex;
+
+// Chunk of the debris mesh the vertex belongs to
+layout(location = 3) in uint debrisChunk;
+
+// Per instance data written by "DebrisSystem.cpp", |debrisStride| texels per instance starting at |debrisOffset|:
+// the columns of the model matrix without it's translation, the columns of it's inverse transpose and then the
+// world position of every chunk
+uniform samplerBuffer debrisData;
+uniform int debrisOffset;
+uniform int debrisStride;
+
+uniform mat4 P;
+uniform mat4 V;
+uniform mat4 lightV;
+uniform mat4 lightP;
+
+// Push the position in camera space and normal in world space
+// to the fragment shader
+out vec3 positionInCamSpace;
+out vec3 positionInWorldSpace;
+out vec3 normalInWorldSpace;
+out vec3 positionInLightSpace;
+out vec2 texCoord;
+
+void main() {
+	int base = debrisOffset + gl_InstanceID * debrisStride;
+
+	mat3 M = mat3(texelFetch(debrisData, base).xyz, texelFetch(debrisData, base + 1).xyz,
+		texelFetch(debrisData, base + 2).xyz);
+	mat3 tiM = mat3(texelFetch(debrisData, base + 3).xyz, texelFetch(debrisData, base + 4).xyz,
+		texelFetch(debrisData, base + 5).xyz);
+	vec3 chunkPosition = texelFetch(debrisData, base + 6 + int(debrisChunk)).xyz;
+
+	vec4 worldPosition = vec4(chunkPosition + M * vertPos.xyz, 1.0);
+	positionInWorldSpace = worldPosition.xyz;
+
+	// Set the position of the vertex in homogeneous space
+	gl_Position = P * V * worldPosition;
+
+	positionInLightSpace = (lightP * lightV * worldPosition).xyz;
+
+	// Calculate the position of the vertex in camera/view space
+	positionInCamSpace = (V * worldPosition).xyz;
+
+	// Calculate the normal of the vertex in world space
+	normalInWorldSpace = normalize(tiM * normalize(vertNor));
+
+	// texture coordinates
+	texCoord = vertTex;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertPos;
+layout(location = 1) in vec3 vertColor;
+
+uniform mat4 P;
+uniform mat4 V;
+
+out vec3 lineColor;
+
+void main() {
+	gl_Position = P * V * vec4(vertPos, 1.0);
+	lineColor = vertColor;
+}
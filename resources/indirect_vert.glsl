@@ -0,0 +1,79 @@
+#version 430 core
+
+layout(location = 0) in vec4 vertPos;
+layout(location = 1) in vec3 vertNor;
+layout(location = 2) in vec2 vertTex;
+
+// Index of the current draw, an instanced attribute offset by the base instance of each indirect command
+layout(location = 3) in uint drawID;
+
+// Structures match those CPU side in "StaticBatchRenderer.h"
+struct DrawData {
+	mat4 M;
+	mat4 tiM;
+	uint materialIndex;
+};
+
+struct MaterialData {
+	vec4 ambient;
+	vec4 diffuse;
+	// Shininess is stored in w
+	vec4 specular;
+};
+
+layout(std430, binding = 0) readonly buffer DrawBuffer {
+	DrawData draws[];
+};
+
+layout(std430, binding = 1) readonly buffer MaterialBuffer {
+	MaterialData materials[];
+};
+
+uniform mat4 P;
+uniform mat4 V;
+uniform mat4 lightV;
+uniform mat4 lightP;
+
+// Push the position in camera space and normal in world space
+// to the fragment shader
+out vec3 positionInCamSpace;
+out vec3 positionInWorldSpace;
+out vec3 normalInWorldSpace;
+out vec3 positionInLightSpace;
+out vec2 texCoord;
+
+// Material of the draw, replaces the material uniforms of the fragment shader
+flat out vec3 MatAmb;
+flat out vec3 MatDif;
+flat out vec3 MatSpc;
+flat out float MatShiny;
+
+// Must match the depth of the pre-pass exactly (see "shadowPass_vert.glsl")
+invariant gl_Position;
+
+void main() {
+	mat4 M = draws[drawID].M;
+	mat4 tiM = draws[drawID].tiM;
+
+	// Set the position of the vertex in homogeneous space
+	gl_Position = P * V * M * vertPos;
+
+	positionInLightSpace = (lightP * lightV * M * vertPos).xyz;
+
+	positionInWorldSpace = (M * vertPos).xyz;
+
+	// Calculate the position of the vertex in camera/view space
+	positionInCamSpace = (V * M * vertPos).xyz;
+
+	// Calculate the normal of the vertex in world space
+	normalInWorldSpace = normalize((tiM * vec4(normalize(vertNor), 0.0)).xyz);
+
+	// texture coordinates
+	texCoord = vertTex;
+
+	MaterialData material = materials[draws[drawID].materialIndex];
+	MatAmb = material.ambient.rgb;
+	MatDif = material.diffuse.rgb;
+	MatSpc = material.specular.rgb;
+	MatShiny = material.specular.w;
+}
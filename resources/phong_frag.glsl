@@ -1,37 +1,79 @@
 #version 330 core
-uniform sampler2D shadowMapTex;
+uniform sampler2DShadow shadowMapTex;
 uniform sampler2D textureMap;
 
-#define MAX_POINT_LIGHTS 10
 #define MAX_DIRECTION_LIGHTS 10
 #define MAX_AREA_LIGHTS 10
 
-// Structure matches that CPU side in "ShaderManager.h" minus the light type
+// Programs built without a variant (see |ShaderVariant| in "ShaderManager.h") check for a texture at runtime and
+// are always shadowed, variants only define the features they need
+#ifndef SHADER_VARIANT
+#define SHADOWED
+#define TEXTURE_CHECK
+#endif
+
+// Shadow map comparisons per fragment for PCF filtering, taken on a square grid of 1, 4, 9 or 16 taps. Each tap
+// is bilinearly filtered by the hardware, variants with VARIANCE_SHADOWS read the filtered moments instead
+#ifndef PCF_TAPS
+#define PCF_TAPS 9
+#endif
+
+#if PCF_TAPS >= 16
+#define PCF_GRID 4
+#elif PCF_TAPS >= 9
+#define PCF_GRID 3
+#elif PCF_TAPS >= 4
+#define PCF_GRID 2
+#else
+#define PCF_GRID 1
+#endif
+
+// Structure matches that CPU side in "ClusteredLighting.h", only xyz is used
 struct Light {
-	vec3 location;
-	vec3 color;
-	vec3 orientation;
+	vec4 location;
+	vec4 color;
+	vec4 orientation;
 };
 
 uniform vec3 lightPos;
 uniform vec3 lightClr;
 
-// TODO(rgarmsen2295): Implement support for point lights
-//uniform Light pointLights[MAX_POINT_LIGHTS];
-//uniform int numPointLights;
+// Directional lights, uploaded once per frame by "ClusteredLighting.cpp"
+layout(std140) uniform DirectionalLights {
+	int numDirectionLights;
+	Light directionLights[MAX_DIRECTION_LIGHTS];
+};
+
+// Point lights, two texels per light: world position and radius, then color
+uniform samplerBuffer pointLights;
 
-// Currently accepts up to a max of 10 direction lights
-uniform Light directionLights[MAX_DIRECTION_LIGHTS];
-uniform int numDirectionLights;
+// Offset and count of each cluster's lights in |clusterLightIndices|
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+
+// View and projection of the camera the clusters were built for, the cluster counts along x, y and z and the
+// depth range the exponentially spaced slices cover
+uniform mat4 clusterV;
+uniform mat4 clusterP;
+uniform ivec3 clusterDims;
+uniform vec2 clusterDepthRange;
 
 // TODO(rgarmsen2295): Implement support for area lights
 //uniform Light areaLights[MAX_AREA_LIGHTS];
 //uniform int numAreaLights;
 
+#ifdef INDIRECT_DRAW
+// Material of the current draw, passed on by "indirect_vert.glsl"
+flat in vec3 MatAmb;
+flat in vec3 MatDif;
+flat in vec3 MatSpc;
+flat in float MatShiny;
+#else
 uniform vec3 MatAmb;
 uniform vec3 MatDif;
 uniform vec3 MatSpc;
 uniform float MatShiny;
+#endif
 
 uniform mat4 M;
 uniform mat4 V;
@@ -41,36 +83,19 @@ uniform int textureActive;
 uniform vec2 shadowMapSize;
 uniform float PCFkernelRadius = 4.0;
 
-//Poisson Disc for PCF filtering
-const vec2 poission[25] = vec2[25](
-   vec2(-0.978698, -0.0884121),
-   vec2(-0.841121, 0.521165),
-   vec2(-0.717460, -0.50322),
-   vec2(-0.702933, 0.903134),
-   vec2(-0.663198, 0.15482),
-   vec2(-0.495102, -0.232887),
-   vec2(-0.364238, -0.961791),
-   vec2(-0.345866, -0.564379),
-   vec2(-0.325663, 0.64037),
-   vec2(-0.182714, 0.321329),
-   vec2(-0.142613, -0.0227363),
-   vec2(-0.0564287, -0.36729),
-   vec2(-0.0185858, 0.918882),
-   vec2(0.0381787, -0.728996),
-   vec2(0.16599, 0.093112),
-   vec2(0.253639, 0.719535),
-   vec2(0.369549, -0.655019),
-   vec2(0.423627, 0.429975),
-   vec2(0.530747, -0.364971),
-   vec2(0.566027, -0.940489),
-   vec2(0.639332, 0.0284127),
-   vec2(0.652089, 0.669668),
-   vec2(0.773797, 0.345012),
-   vec2(0.968871, 0.840449),
-   vec2(0.991882, -0.657338)
-);
+#ifdef VARIANCE_SHADOWS
+// Blurred and mipmapped exponential moments of the shadow map, written by "shadowMoments_frag.glsl"
+uniform sampler2D shadowMomentsTex;
+
+// Exponents of the positive and negative depth warp, must match "shadowMoments_frag.glsl"
+const vec2 evsmExponents = vec2(40.0, 5.0);
+
+// Part of the Chebyshev bound cut off to hide light bleeding where shadows overlap
+const float lightBleedingReduction = 0.2;
+#endif
 
 in vec3 positionInCamSpace;
+in vec3 positionInWorldSpace;
 in vec3 normalInWorldSpace;
 in vec3 positionInLightSpace;
 in vec2 texCoord;
@@ -78,111 +103,162 @@ in vec2 texCoord;
 
 out vec4 color;
 
+// Calculates the specular/diffuse color a light shining along |lightDir| (towards the light) adds
+vec3 shadeLight(vec3 lightDir, vec3 lightColor, vec3 fragNormal, vec3 view) {
+	// How close are the object normal and the light's direction?
+	float lightNormalDot = max(dot(lightDir, fragNormal), 0.0);
+
+	// Calculate diffuse component from light
+	float diffuseValue = max(lightNormalDot, 0.0);
+	vec3 diffuse = diffuseValue * MatDif * lightColor;
+
+	// Calculate specular component from light
+	vec3 reflect = reflect(-lightDir, fragNormal);
+
+	float specularValue = 0.0;
+
+	// Don't want specular when the light vector is > 180 from the normal
+	// (object is looking the wrong way)
+	if (lightNormalDot > 0.0) {
+
+		// How close are we to looking straight at the reflection vector?
+		float specWeight = max(dot(reflect, view), 0.0);
+
+		float shiny = MatShiny;
+		if(MatShiny == 0.0) {
+			shiny = 1.0;
+		}
+		// Get shiny with it
+		specularValue = pow(specWeight, shiny);
+	}
+	vec3 specular = specularValue * MatSpc * lightColor;
+
+	return diffuse + specular;
+}
+
 // Calculates the total color (specular/diffuse) from directional lights
-// Loops through up to |MAX_DIRECTIONAL_LIGHTS| with a soft cap set by |numDirectionLights|
+// Loops through up to |MAX_DIRECTIONAL_LIGHTS| with a soft cap set by |numDirectionLights|, variants loop over
+// exactly |NUM_DIR_LIGHTS| so the loop can be unrolled
 vec3 dirLightColor(vec3 fragNormal, vec3 view) {
 	vec3 dirLightColor = vec3(0.0);
 
-	// Calculate ambient color
-	vec3 ambient = MatAmb;
+#ifdef NUM_DIR_LIGHTS
+	for (int i = 0; i < NUM_DIR_LIGHTS; ++i) {
+#else
+	for (int i = 0; i < numDirectionLights; ++i) {
+#endif
+		dirLightColor += shadeLight(normalize(-directionLights[i].orientation.xyz), directionLights[i].color.rgb,
+			fragNormal, view);
+	}
 
+	return dirLightColor;
+}
 
-	for (int i = 0; i < numDirectionLights; ++i) {
-		vec3 lightColor = directionLights[i].color;
-		vec3 lightDir = normalize(-directionLights[i].orientation);
+// Returns the index of the cluster the fragment falls into
+int findCluster() {
+	vec4 positionInClusterSpace = clusterV * vec4(positionInWorldSpace, 1.0);
+	vec4 clipPosition = clusterP * positionInClusterSpace;
+	vec2 screenPosition = clipPosition.xy / max(clipPosition.w, 0.0001) * 0.5 + 0.5;
+	ivec2 tile = clamp(ivec2(screenPosition * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
 
-		// How close are the object normal and the light's direction?
-		float lightNormalDot = max(dot(lightDir, fragNormal), 0.0);
+	float depth = max(-positionInClusterSpace.z, clusterDepthRange.x);
+	int slice = int(log(depth / clusterDepthRange.x) / log(clusterDepthRange.y / clusterDepthRange.x) * float(clusterDims.z));
+	slice = clamp(slice, 0, clusterDims.z - 1);
 
-		// Calculate diffuse component from light
-		float diffuseValue = max(lightNormalDot, 0.0);
-		//vec3 diffuse = diffuseValue * MatDif * lightColor;
+	return (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+}
 
-        vec3 diffuse = vec3(0.0);
-        diffuse = diffuseValue * MatDif * lightColor;
+// Calculates the total color (specular/diffuse) from point lights
+// Only loops through the lights assigned to the fragment's cluster
+vec3 pointLightColor(vec3 fragNormal, vec3 view) {
+	vec3 pointLightColor = vec3(0.0);
 
+	uvec2 lightRange = texelFetch(clusterGrid, findCluster()).xy;
+	for (uint i = 0u; i < lightRange.y; ++i) {
+		int light = int(texelFetch(clusterLightIndices, int(lightRange.x + i)).r);
+		vec4 positionAndRadius = texelFetch(pointLights, 2 * light);
+		vec3 lightColor = texelFetch(pointLights, 2 * light + 1).rgb;
 
-		// Calculate specular component from light
-		vec3 reflect = reflect(-lightDir, fragNormal);
+		vec3 toLight = positionAndRadius.xyz - positionInWorldSpace;
+		float lightDistance = length(toLight);
 
-		float specularValue = 0.0;
+		// Inverse square falloff, windowed to reach zero at the light's radius
+		float window = clamp(1.0 - pow(lightDistance / positionAndRadius.w, 4.0), 0.0, 1.0);
+		float attenuation = window * window / (lightDistance * lightDistance + 1.0);
 
-		// Don't want specular when the light vector is > 180 from the normal
-		// (object is looking the wrong way)
-		if (lightNormalDot > 0.0) {
+		pointLightColor += attenuation * shadeLight(toLight / max(lightDistance, 0.0001), lightColor, fragNormal, view);
+	}
 
-			// How close are we to looking straight at the reflection vector?
-			float specWeight = max(dot(reflect, view), 0.0);
+	return pointLightColor;
+}
 
-            float shiny = MatShiny;
-            if(MatShiny == 0.0) {
-                shiny = 1.0;
-            }
-			// Get shiny with it
-			specularValue = pow(specWeight, shiny);
-		}
-		vec3 specular = specularValue * MatSpc * lightColor;
+#ifdef VARIANCE_SHADOWS
+// Upper bound on the fraction of the filter region lit at the given (warped) depth
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance) {
+	if (depth <= moments.x) {
+		return 1.0;
+	}
+
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float depthDelta = depth - moments.x;
+	float upperBound = variance / (variance + depthDelta * depthDelta);
+
+	return clamp((upperBound - lightBleedingReduction) / (1.0 - lightBleedingReduction), 0.0, 1.0);
+}
+
+float shadowFactor() {
 
-		// Add light color to total directional color
-		dirLightColor += diffuse + specular;
+	// transform to texture space
+	vec3 shifted = (positionInLightSpace + 1.0) / 2.0;
 
+	// fragments outside of the shadow map are lit
+	if (any(lessThan(shifted.xy, vec2(0.0))) || any(greaterThan(shifted.xy, vec2(1.0)))) {
+		return 1.0;
 	}
 
-    dirLightColor += ambient;
+	// warp the depth the same way the moments were
+	float depth = shifted.z * 2.0 - 1.0;
+	vec2 warpedDepth = vec2(exp(evsmExponents.x * depth), -exp(-evsmExponents.y * depth));
 
-    if(textureActive == 1) {
-        // lookup texture
-        vec3 texColor = texture(textureMap, texCoord).xyz;
-        dirLightColor *= texColor;
-     }
+	// the variance has to be clamped relative to the warp's slope at the depth
+	vec2 depthScale = 0.0001 * evsmExponents * warpedDepth;
+	vec2 minVariance = depthScale * depthScale;
 
-	return dirLightColor;
-}
+	vec4 moments = texture(shadowMomentsTex, shifted.xy);
+	float litFactor = min(chebyshevUpperBound(moments.xy, warpedDepth.x, minVariance.x),
+		chebyshevUpperBound(moments.zw, warpedDepth.y, minVariance.y));
 
-// Credit for rand function goes to:
-// http://byteblacksmith.com/improvements-to-the-canonical-one-liner-glsl-rand-for-opengl-es-2-0/
-highp float rand(vec2 co)
-{
-    highp float a = 12.9898;
-    highp float b = 78.233;
-    highp float c = 43758.5453;
-    highp float dt= dot(co.xy ,vec2(a,b));
-    highp float sn= mod(dt,3.14);
-    return fract(sin(sn) * c);
+	return (1.0 - litFactor) * 0.5 + litFactor * 1.0;
 }
-
+#else
 float shadowFactor() {
 
-    // transform to texture spacde
+	// transform to texture space
 	vec3 shifted = (positionInLightSpace + 1.0) / 2.0;
-	// PCF samples and shaded fragment count
-	float samples = 9.0;
-	float shadedFrags = 0.0;
-
-    for (int i = 0; i < samples; i++) {
-        // generate random index for possion disc
-        int index = int(25.0*rand(gl_FragCoord.xy))%25;
-        // get poisson disc value and scale it
-        vec2 offset = vec2(poission[i].x * (PCFkernelRadius / shadowMapSize.x), poission[i].y * (PCFkernelRadius / shadowMapSize.y));
-        // apply poisson offset
-    	vec3 shiftedOffsetted = vec3(shifted.x + offset.x, shifted.y + offset.y, shifted.z);
-
-        // fragment still in shadow map?
-    	if(shiftedOffsetted.x <= 1.0 && shiftedOffsetted.x >= 0.0 && shiftedOffsetted.y <= 1.0 && shiftedOffsetted.y >= 0.0) {
-    	    // get current and sampled shadow map depth
-            float curDepth = shifted.z;
-            float smValue = texture(shadowMapTex, shiftedOffsetted.xy).r;
-            // if sampled depth is smaller, fragment is shaded
-            if((smValue + 0.001) < curDepth) {
-                shadedFrags++;
-            }
-        }
-    }
-
-    // calculate shadow factor
-	float PCFfactor = shadedFrags / samples;
-	return PCFfactor * 0.5 + (1.0 -PCFfactor) * 1.0;
+
+	// spread the grid over the kernel radius, every tap compares against 2x2 texels. Taps outside of the
+	// shadow map read the border depth (1.0) and are lit
+#if PCF_GRID > 1
+	vec2 spacing = (2.0 * PCFkernelRadius / float(PCF_GRID - 1)) / shadowMapSize;
+#else
+	vec2 spacing = vec2(0.0);
+#endif
+	float litFrags = 0.0;
+
+	for (int y = 0; y < PCF_GRID; y++) {
+		for (int x = 0; x < PCF_GRID; x++) {
+			vec2 offset = (vec2(x, y) - 0.5 * float(PCF_GRID - 1)) * spacing;
+
+			// compared with the bias used against acne, 1.0 if the fragment is closer than the occluder
+			litFrags += texture(shadowMapTex, vec3(shifted.xy + offset, shifted.z - 0.001));
+		}
+	}
+
+	// calculate shadow factor
+	float PCFfactor = 1.0 - litFrags / float(PCF_GRID * PCF_GRID);
+	return PCFfactor * 0.5 + (1.0 - PCFfactor) * 1.0;
 }
+#endif
 
 void main() {
 
@@ -194,16 +270,29 @@ void main() {
 	vec3 view = normalize(-positionInCamSpace);
 
 	// Calculate total specular/diffuse color contributions from all light types
-	// TODO(rgarmsen2295): vec3 pointLightColor = pointLightColor();
 	vec3 directionalLightColor = dirLightColor(fragNormalInWorldSpace, view);
+	vec3 pointLightsColor = pointLightColor(fragNormalInWorldSpace, view);
 	// TODO(rgarmsen2295): vec3 areaLightColor = areaLightColor();
 
-
-	// Shadow Mapping, calculate shadow Factor
+	// Shadow Mapping, calculate shadow Factor, the shadow map only covers the sun
+#ifdef SHADOWED
     float shadowFactor = shadowFactor();
+#else
+    float shadowFactor = 1.0;
+#endif
 
+	vec3 totalColor = shadowFactor * (directionalLightColor + MatAmb) + pointLightsColor;
 
+#if defined(TEXTURED)
+	totalColor *= texture(textureMap, texCoord).xyz;
+#elif defined(TEXTURE_CHECK)
+    if(textureActive == 1) {
+        // lookup texture
+        vec3 texColor = texture(textureMap, texCoord).xyz;
+        totalColor *= texColor;
+     }
+#endif
 
 	// Calculate the total color
-	color = shadowFactor * vec4(directionalLightColor, 1.0);
-}
\ No newline at end of file
+	color = vec4(totalColor, 1.0);
+}
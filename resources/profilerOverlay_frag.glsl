@@ -0,0 +1,9 @@
+#version 330 core
+
+uniform vec3 overlayColor;
+
+out vec4 color;
+
+void main() {
+	color = vec4(overlayColor, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Left, bottom, right and top of the rectangle in normalized device coordinates
+uniform vec4 overlayRect;
+
+void main() {
+	// Corners of a triangle strip, no vertex buffer needed
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+	gl_Position = vec4(mix(overlayRect.xy, overlayRect.zw, corner), 0.0, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+// Moments to blur and the direction to blur them in, one texel along x or y
+uniform sampler2D blurSource;
+uniform vec2 blurDirection;
+
+// Weights of a 9 texel gaussian, folded into 5 bilinear fetches
+const float weights[3] = float[3](0.2270270270, 0.3162162162, 0.0702702703);
+const float offsets[3] = float[3](0.0, 1.3846153846, 3.2307692308);
+
+in vec2 texCoord;
+
+out vec4 moments;
+
+void main() {
+	moments = texture(blurSource, texCoord) * weights[0];
+
+	for (int i = 1; i < 3; i++) {
+		moments += texture(blurSource, texCoord + blurDirection * offsets[i]) * weights[i];
+		moments += texture(blurSource, texCoord - blurDirection * offsets[i]) * weights[i];
+	}
+}
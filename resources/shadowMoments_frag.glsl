@@ -0,0 +1,29 @@
+#version 330 core
+
+// Shadow map depth, read without comparison
+uniform sampler2D shadowDepthTex;
+
+// Shadow map texels per moments texel along each axis
+uniform int momentsDownsample;
+
+// Exponents of the positive and negative depth warp, must match the mesh fragment shaders
+const vec2 evsmExponents = vec2(40.0, 5.0);
+
+out vec4 moments;
+
+void main() {
+	ivec2 base = ivec2(gl_FragCoord.xy) * momentsDownsample;
+	moments = vec4(0.0);
+
+	// average the moments of every depth covered by the texel, warping before averaging keeps them filterable
+	for (int y = 0; y < momentsDownsample; y++) {
+		for (int x = 0; x < momentsDownsample; x++) {
+			float depth = texelFetch(shadowDepthTex, base + ivec2(x, y), 0).r * 2.0 - 1.0;
+			vec2 warpedDepth = vec2(exp(evsmExponents.x * depth), -exp(-evsmExponents.y * depth));
+
+			moments += vec4(warpedDepth.x, warpedDepth.x * warpedDepth.x, warpedDepth.y, warpedDepth.y * warpedDepth.y);
+		}
+	}
+
+	moments /= float(momentsDownsample * momentsDownsample);
+}
@@ -1,14 +1,17 @@
 #version  330 core
 
-layout(location = 0) in vec3 vertPos;
+layout(location = 0) in vec4 vertPos;
 
 uniform mat4 lightP;
 uniform mat4 lightV;
 uniform mat4 M;
 
+// Also renders the depth pre-pass, which the mesh shaders' depth has to match exactly
+invariant gl_Position;
+
 void main() {
 
   /* transform into light space */
-  gl_Position = lightP * lightV * M * vec4(vertPos.xyz, 1.0);
+  gl_Position = lightP * lightV * M * vertPos;
 
 }
@@ -0,0 +1,260 @@
+#include "AsyncLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "TextureManager.h"
+
+AsyncLoader& AsyncLoader::instance() {
+   static AsyncLoader *instance = new AsyncLoader();
+   return *instance;
+}
+
+AsyncLoader::AsyncLoader()
+   : stopping_(false),
+   numPending_(0),
+   nextPixelBuffer_(0),
+   persistentMapping_(false),
+   pixelBuffersCreated_(false) {
+   // Leave one core to the GL thread
+   unsigned int numWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+   for (unsigned int i = 0; i < numWorkers; ++i) {
+      workers_.push_back(std::thread(&AsyncLoader::workerLoop, this));
+   }
+}
+
+AsyncLoader::~AsyncLoader() {
+   {
+      std::lock_guard<std::mutex> lock(jobMutex_);
+      stopping_ = true;
+   }
+   jobAvailable_.notify_all();
+
+   for (std::thread& worker : workers_) {
+      worker.join();
+   }
+
+   if (pixelBuffersCreated_) {
+      for (PixelBuffer& buffer : pixelBuffers_) {
+         if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+         }
+         glDeleteBuffers(1, &buffer.id);
+      }
+   }
+}
+
+std::future<void> AsyncLoader::submit(std::function<void()> job) {
+   std::packaged_task<void()> task(job);
+   std::future<void> result = task.get_future();
+
+   {
+      std::lock_guard<std::mutex> lock(jobMutex_);
+      jobs_.push_back(std::move(task));
+   }
+   jobAvailable_.notify_one();
+
+   return result;
+}
+
+void AsyncLoader::loadTexture(std::shared_ptr<Texture> texture) {
+   texture->createPlaceholder();
+   ++numPending_;
+
+   std::string path = texture->getPath();
+   submit([this, texture, path]() {
+      PendingUpload upload;
+      upload.texture = texture;
+
+      // A texture that fails to decode is still queued without data, so that |update| reports it and it stops
+      // counting as pending
+      try {
+         upload.data = Texture::decode(path);
+      } catch (...) {
+         upload.data.reset();
+      }
+
+      std::lock_guard<std::mutex> lock(uploadMutex_);
+      uploads_.push_back(std::move(upload));
+   });
+}
+
+void AsyncLoader::update(double budget) {
+   if (!pixelBuffersCreated_) {
+      createPixelBuffers();
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   while (true) {
+      PendingUpload upload;
+      {
+         std::lock_guard<std::mutex> lock(uploadMutex_);
+         if (uploads_.empty()) {
+            break;
+         }
+
+         upload = std::move(uploads_.front());
+         uploads_.pop_front();
+      }
+
+      if (!upload.data) {
+         // The placeholder stays
+         std::cerr << "Could not load texture " << upload.texture->getPath() << std::endl;
+         --numPending_;
+         continue;
+      }
+
+      if (!uploadThroughPixelBuffer(upload)) {
+         // All pixel buffers are still being read, try again next frame
+         std::lock_guard<std::mutex> lock(uploadMutex_);
+         uploads_.push_front(std::move(upload));
+         break;
+      }
+
+      --numPending_;
+      TextureManager::instance().onTextureLoaded(*upload.texture);
+
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() >= budget) {
+         break;
+      }
+   }
+}
+
+void AsyncLoader::finish() {
+   while (numPending_ > 0) {
+      update(1.0);
+      std::this_thread::yield();
+   }
+}
+
+unsigned int AsyncLoader::getNumPending() const {
+   return numPending_;
+}
+
+unsigned int AsyncLoader::getNumWorkers() const {
+   return workers_.size();
+}
+
+void AsyncLoader::workerLoop() {
+   while (true) {
+      std::packaged_task<void()> job;
+      {
+         std::unique_lock<std::mutex> lock(jobMutex_);
+         jobAvailable_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+
+         if (stopping_) {
+            return;
+         }
+
+         job = std::move(jobs_.front());
+         jobs_.pop_front();
+      }
+
+      job();
+   }
+}
+
+void AsyncLoader::createPixelBuffers() {
+   persistentMapping_ = GLEW_ARB_buffer_storage;
+
+   for (PixelBuffer& buffer : pixelBuffers_) {
+      buffer.id = 0;
+      buffer.size = 0;
+      buffer.mapped = nullptr;
+      buffer.fence = 0;
+
+      allocatePixelBuffer(buffer, PIXEL_BUFFER_SIZE);
+   }
+
+   pixelBuffersCreated_ = true;
+}
+
+void AsyncLoader::allocatePixelBuffer(PixelBuffer& buffer, size_t size) {
+   // Immutable storage can't be resized, so persistent buffers are replaced
+   if (persistentMapping_ && buffer.id != 0) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glDeleteBuffers(1, &buffer.id);
+      buffer.id = 0;
+      buffer.mapped = nullptr;
+   }
+
+   if (buffer.id == 0) {
+      glGenBuffers(1, &buffer.id);
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+
+   if (persistentMapping_) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+      buffer.mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+   } else {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+   }
+
+   buffer.size = size;
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+AsyncLoader::PixelBuffer* AsyncLoader::acquirePixelBuffer(size_t size) {
+   PixelBuffer& buffer = pixelBuffers_[nextPixelBuffer_];
+
+   if (buffer.fence) {
+      GLenum status = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (status == GL_TIMEOUT_EXPIRED) {
+         return nullptr;
+      }
+
+      glDeleteSync(buffer.fence);
+      buffer.fence = 0;
+   }
+
+   if (buffer.size < size) {
+      allocatePixelBuffer(buffer, size);
+   }
+
+   nextPixelBuffer_ = (nextPixelBuffer_ + 1) % NUM_PIXEL_BUFFERS;
+   return &buffer;
+}
+
+bool AsyncLoader::uploadThroughPixelBuffer(PendingUpload& upload) {
+   size_t size = upload.data->getSize();
+
+   PixelBuffer* buffer = acquirePixelBuffer(size);
+   if (buffer == nullptr) {
+      return false;
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->id);
+
+   if (!persistentMapping_) {
+      // Invalidating lets the driver hand out fresh memory instead of waiting for the previous upload
+      buffer->mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+   }
+
+   if (buffer->mapped == nullptr) {
+      // Mapping failed, upload straight from memory instead
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      upload.texture->upload(*upload.data);
+      return true;
+   }
+
+   upload.data->copyTo(buffer->mapped);
+
+   if (!persistentMapping_) {
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      buffer->mapped = nullptr;
+   }
+
+   upload.texture->upload(*upload.data, true, 0);
+   buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   return true;
+}
@@ -0,0 +1,112 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Texture.h"
+
+/*
+ * Moves resource loading off the GL thread. File reads, image decoding and mesh processing run on a pool of
+ * worker threads; the finished textures are uploaded by |update| on the GL thread through a ring of pixel buffer
+ * objects, never spending more than a time budget per frame. Textures show a placeholder until then.
+ *
+ * Pixel buffers are persistently mapped when ARB_buffer_storage is available and mapped per upload otherwise.
+ * A fence guards each buffer so it's only rewritten once the GPU consumed the previous upload.
+ */
+class AsyncLoader {
+public:
+
+   // Default time in seconds |update| may spend uploading per frame
+   static constexpr double DEFAULT_UPLOAD_BUDGET = 0.002;
+
+   // Number of pixel buffers uploads rotate through
+   static constexpr unsigned int NUM_PIXEL_BUFFERS = 4;
+
+   // Initial size of each pixel buffer, they grow to fit larger textures
+   static constexpr size_t PIXEL_BUFFER_SIZE = 4 * 1024 * 1024;
+
+   static AsyncLoader& instance();
+
+   ~AsyncLoader();
+
+   // Runs the job on a worker thread. The future becomes ready once it finished
+   std::future<void> submit(std::function<void()> job);
+
+   // Decodes the texture's file (see |Texture::getPath|) on a worker thread and uploads it in a later |update|.
+   // Must be called on the GL thread, the texture shows a placeholder until the upload
+   void loadTexture(std::shared_ptr<Texture> texture);
+
+   // Uploads finished textures until the budget in seconds is spent, at least one per call.
+   // Must be called on the GL thread, once per frame
+   void update(double budget = DEFAULT_UPLOAD_BUDGET);
+
+   // Blocks until every queued texture is uploaded
+   void finish();
+
+   // Returns the number of textures that are being decoded or waiting for their upload
+   unsigned int getNumPending() const;
+
+   unsigned int getNumWorkers() const;
+
+private:
+   AsyncLoader();
+
+   struct PendingUpload {
+      std::shared_ptr<Texture> texture;
+      std::unique_ptr<TextureData> data;
+   };
+
+   struct PixelBuffer {
+      GLuint id;
+      size_t size;
+
+      // Only set while mapped, always for persistently mapped buffers
+      unsigned char* mapped;
+
+      // Signaled once the GPU finished reading the last upload
+      GLsync fence;
+   };
+
+   std::vector<std::thread> workers_;
+   std::deque<std::packaged_task<void()>> jobs_;
+   std::mutex jobMutex_;
+   std::condition_variable jobAvailable_;
+   bool stopping_;
+
+   // Decoded textures waiting for |update|
+   std::deque<PendingUpload> uploads_;
+   std::mutex uploadMutex_;
+
+   std::atomic<unsigned int> numPending_;
+
+   PixelBuffer pixelBuffers_[NUM_PIXEL_BUFFERS];
+   unsigned int nextPixelBuffer_;
+   bool persistentMapping_;
+   bool pixelBuffersCreated_;
+
+   void workerLoop();
+
+   void createPixelBuffers();
+
+   // (Re)creates the storage of the buffer with at least the given size
+   void allocatePixelBuffer(PixelBuffer& buffer, size_t size);
+
+   // Returns the next buffer if the GPU is done with it, grown to the given size. |nullptr| if it's still in use
+   PixelBuffer* acquirePixelBuffer(size_t size);
+
+   // Copies the data into a pixel buffer and uploads the texture from it. Returns false if no buffer was free
+   bool uploadThroughPixelBuffer(PendingUpload& upload);
+};
+
+#endif
@@ -9,6 +9,10 @@ BoundingBox::BoundingBox()
 		objBoxPoints[i] = glm::vec3(0.0f, 0.0f, 0.0f);
 		boxPoints[i] = objBoxPoints[i];
 	}
+
+	for (int i = 0; i < NUM_CULL_CACHE_SLOTS; ++i) {
+		lastCulledPlane_[i] = 0;
+	}
 }
 
 BoundingBox::BoundingBox(glm::vec3& min, glm::vec3& max)
@@ -24,6 +28,10 @@ BoundingBox::BoundingBox(glm::vec3& min, glm::vec3& max)
 	objBoxPoints[5] = boxPoints[5] = glm::vec3(max_.x, min_.y, max_.z);
 	objBoxPoints[6] = boxPoints[6] = glm::vec3(max_.x, min_.y, min_.z);
 	objBoxPoints[7] = boxPoints[7] = glm::vec3(min_.x, max_.y, max_.z);
+
+	for (int i = 0; i < NUM_CULL_CACHE_SLOTS; ++i) {
+		lastCulledPlane_[i] = 0;
+	}
 }
 
 /* 
@@ -57,7 +65,7 @@ glm::vec3 BoundingBox::calcReflNormal(BoundingBox& other) {
    return glm::normalize(normal);
 }
 
-void BoundingBox::update(glm::mat4& transform) {
+void BoundingBox::update(const glm::mat4& transform) {
 	float minX, minY, minZ;
 	float maxX, maxY, maxZ;
 
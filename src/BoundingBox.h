@@ -30,6 +30,13 @@ public:
 	// Array of all the points representing the current BoundingBox
 	glm::vec3 boxPoints[8];
 
+	// Number of frusta that keep a culling cache in each BoundingBox (see ViewFrustum::CullCacheSlot)
+	static constexpr int NUM_CULL_CACHE_SLOTS = 2;
+
+	// Index of the frustum plane that last rejected the box, per frustum. Tested first on the next
+	// cull since the same plane usually rejects the box again in the following frame
+	int lastCulledPlane_[NUM_CULL_CACHE_SLOTS];
+
 	BoundingBox();
 
 	BoundingBox(glm::vec3& min, glm::vec3& max);
@@ -43,7 +50,7 @@ public:
    glm::vec3 calcReflNormal(BoundingBox& other);
 
 	// Updates the bounding box min, max, and boxPoints based on the passed transform
-	void update(glm::mat4& transform);
+	void update(const glm::mat4& transform);
 };
 
 #endif
@@ -9,10 +9,6 @@ public:
 
 	~BunnyRenderComponent();
 
-	void draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V);
-
-	void renderShadow(std::shared_ptr<MatrixStack> M);
-
 private:
 
 };
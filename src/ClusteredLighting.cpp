@@ -0,0 +1,301 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <initializer_list>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CLUSTERED_LIGHTING_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "ShaderManager.h"
+
+ClusteredLighting::ClusteredLighting()
+   : clusterP_(0.0f),
+   clusterV_(1.0f),
+   farPlane_(0.0f),
+   directionalLightBufID_(0),
+   pointLightBufID_(0),
+   pointLightTexID_(0),
+   clusterGridBufID_(0),
+   clusterGridTexID_(0),
+   lightIndexBufID_(0),
+   lightIndexTexID_(0),
+   numPointLights_(0),
+   numDirectionalLights_(0),
+   numLightIndices_(0) {
+   clusterMinX_.assign(NUM_CLUSTERS, 0.0f);
+   clusterMinY_.assign(NUM_CLUSTERS, 0.0f);
+   clusterMinZ_.assign(NUM_CLUSTERS, 0.0f);
+   clusterMaxX_.assign(NUM_CLUSTERS, 0.0f);
+   clusterMaxY_.assign(NUM_CLUSTERS, 0.0f);
+   clusterMaxZ_.assign(NUM_CLUSTERS, 0.0f);
+
+   lightCounts_.assign(NUM_CLUSTERS, 0);
+   clusterRanges_.resize(NUM_CLUSTERS);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+   if (directionalLightBufID_ != 0) {
+      glDeleteBuffers(1, &directionalLightBufID_);
+      glDeleteTextures(1, &pointLightTexID_);
+      glDeleteBuffers(1, &pointLightBufID_);
+      glDeleteTextures(1, &clusterGridTexID_);
+      glDeleteBuffers(1, &clusterGridBufID_);
+      glDeleteTextures(1, &lightIndexTexID_);
+      glDeleteBuffers(1, &lightIndexBufID_);
+   }
+}
+
+void ClusteredLighting::update(const std::vector<Light>& pointLights, const std::vector<Light>& directionalLights,
+   const glm::mat4& P, const glm::mat4& V, float farPlane) {
+   if (directionalLightBufID_ == 0) {
+      init();
+   }
+
+   if (P != clusterP_ || farPlane != farPlane_) {
+      buildClusterBounds(P, farPlane);
+   }
+   clusterV_ = V;
+
+   // Directional lights
+   DirectionalLightBlock block = {};
+   block.numDirectionLights = std::min<int>(directionalLights.size(), MAX_DIRECTIONAL_LIGHTS);
+   numDirectionalLights_ = block.numDirectionLights;
+   for (int i = 0; i < block.numDirectionLights; ++i) {
+      const Light& light = directionalLights[i];
+      block.directionLights[i].position = glm::vec4(light.position, 0.0f);
+      block.directionLights[i].color = glm::vec4(light.color, 0.0f);
+      block.directionLights[i].orientation = glm::vec4(light.orientation, 0.0f);
+   }
+
+   glBindBuffer(GL_UNIFORM_BUFFER, directionalLightBufID_);
+   glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+   glBindBufferBase(GL_UNIFORM_BUFFER, DIRECTIONAL_LIGHTS_BINDING, directionalLightBufID_);
+
+   // Assign the point lights to clusters in view space
+   numPointLights_ = pointLights.size();
+   pointLightData_.clear();
+   assignments_.clear();
+
+   for (unsigned int i = 0; i < numPointLights_; ++i) {
+      const Light& light = pointLights[i];
+      pointLightData_.push_back(glm::vec4(light.position, light.radius));
+      pointLightData_.push_back(glm::vec4(light.color, 0.0f));
+
+      glm::vec3 center = glm::vec3(V * glm::vec4(light.position, 1.0f));
+      assignLight(i, center, light.radius);
+   }
+
+   if (assignments_.size() > MAX_LIGHT_INDICES) {
+      assignments_.resize(MAX_LIGHT_INDICES);
+   }
+
+   // Counting sort of the assignments by cluster
+   std::fill(lightCounts_.begin(), lightCounts_.end(), 0);
+   for (const std::pair<GLuint, GLuint>& assignment : assignments_) {
+      lightCounts_[assignment.first]++;
+   }
+
+   GLuint offset = 0;
+   for (int cluster = 0; cluster < NUM_CLUSTERS; ++cluster) {
+      clusterRanges_[cluster].offset = offset;
+      clusterRanges_[cluster].count = 0;
+      offset += lightCounts_[cluster];
+   }
+
+   lightIndices_.resize(assignments_.size());
+   for (const std::pair<GLuint, GLuint>& assignment : assignments_) {
+      ClusterRange& range = clusterRanges_[assignment.first];
+      lightIndices_[range.offset + range.count++] = assignment.second;
+   }
+   numLightIndices_ = lightIndices_.size();
+
+   // Orphan and refill the buffers
+   glBindBuffer(GL_TEXTURE_BUFFER, pointLightBufID_);
+   glBufferData(GL_TEXTURE_BUFFER, pointLightData_.size() * sizeof(glm::vec4), pointLightData_.data(),
+      GL_STREAM_DRAW);
+
+   glBindBuffer(GL_TEXTURE_BUFFER, clusterGridBufID_);
+   glBufferData(GL_TEXTURE_BUFFER, clusterRanges_.size() * sizeof(ClusterRange), clusterRanges_.data(),
+      GL_STREAM_DRAW);
+
+   glBindBuffer(GL_TEXTURE_BUFFER, lightIndexBufID_);
+   glBufferData(GL_TEXTURE_BUFFER, lightIndices_.size() * sizeof(GLuint), lightIndices_.data(), GL_STREAM_DRAW);
+
+   glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::bindBuffers() {
+   glActiveTexture(GL_TEXTURE0 + POINT_LIGHTS_TEXTURE_UNIT);
+   glBindTexture(GL_TEXTURE_BUFFER, pointLightTexID_);
+   glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+   glBindTexture(GL_TEXTURE_BUFFER, clusterGridTexID_);
+   glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHT_INDICES_TEXTURE_UNIT);
+   glBindTexture(GL_TEXTURE_BUFFER, lightIndexTexID_);
+   glActiveTexture(GL_TEXTURE0);
+}
+
+void ClusteredLighting::setUniforms(const std::shared_ptr<Program> program) {
+   glUniform1i(program->getUniform("pointLights"), POINT_LIGHTS_TEXTURE_UNIT);
+   glUniform1i(program->getUniform("clusterGrid"), CLUSTER_GRID_TEXTURE_UNIT);
+   glUniform1i(program->getUniform("clusterLightIndices"), CLUSTER_LIGHT_INDICES_TEXTURE_UNIT);
+
+   glUniformMatrix4fv(program->getUniform("clusterV"), 1, GL_FALSE, glm::value_ptr(clusterV_));
+   glUniformMatrix4fv(program->getUniform("clusterP"), 1, GL_FALSE, glm::value_ptr(clusterP_));
+   glUniform3i(program->getUniform("clusterDims"), CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+   glUniform2f(program->getUniform("clusterDepthRange"), FIRST_SLICE_DEPTH, farPlane_);
+}
+
+void ClusteredLighting::bindUniformBlocks(GLuint pid) {
+   GLuint blockIndex = glGetUniformBlockIndex(pid, "DirectionalLights");
+   if (blockIndex != GL_INVALID_INDEX) {
+      glUniformBlockBinding(pid, blockIndex, DIRECTIONAL_LIGHTS_BINDING);
+   }
+}
+
+unsigned int ClusteredLighting::getNumPointLights() const {
+   return numPointLights_;
+}
+
+unsigned int ClusteredLighting::getNumDirectionalLights() const {
+   return numDirectionalLights_;
+}
+
+unsigned int ClusteredLighting::getNumLightIndices() const {
+   return numLightIndices_;
+}
+
+void ClusteredLighting::init() {
+   glGenBuffers(1, &directionalLightBufID_);
+
+   glGenBuffers(1, &pointLightBufID_);
+   glGenBuffers(1, &clusterGridBufID_);
+   glGenBuffers(1, &lightIndexBufID_);
+   glGenTextures(1, &pointLightTexID_);
+   glGenTextures(1, &clusterGridTexID_);
+   glGenTextures(1, &lightIndexTexID_);
+
+   glBindTexture(GL_TEXTURE_BUFFER, pointLightTexID_);
+   glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pointLightBufID_);
+   glBindTexture(GL_TEXTURE_BUFFER, clusterGridTexID_);
+   glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, clusterGridBufID_);
+   glBindTexture(GL_TEXTURE_BUFFER, lightIndexTexID_);
+   glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, lightIndexBufID_);
+   glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::buildClusterBounds(const glm::mat4& P, float farPlane) {
+   clusterP_ = P;
+   farPlane_ = farPlane;
+
+   for (int z = 0; z < CLUSTERS_Z; ++z) {
+      float nearDepth = getSliceDepth(z);
+      float farDepth = getSliceDepth(z + 1);
+
+      for (int y = 0; y < CLUSTERS_Y; ++y) {
+         float ndcY[2] = { -1.0f + 2.0f * y / CLUSTERS_Y, -1.0f + 2.0f * (y + 1) / CLUSTERS_Y };
+
+         for (int x = 0; x < CLUSTERS_X; ++x) {
+            float ndcX[2] = { -1.0f + 2.0f * x / CLUSTERS_X, -1.0f + 2.0f * (x + 1) / CLUSTERS_X };
+
+            // Bounds of the tile's corners at both ends of the slice. With depth d = -z a view space point
+            // projects to ndc.x = (P[0][0] * x - P[2][0] * d) / d
+            glm::vec3 minimum(FLT_MAX);
+            glm::vec3 maximum(-FLT_MAX);
+            for (float depth : { nearDepth, farDepth }) {
+               for (int corner = 0; corner < 4; ++corner) {
+                  glm::vec3 point((ndcX[corner & 1] + P[2][0]) * depth / P[0][0],
+                     (ndcY[corner >> 1] + P[2][1]) * depth / P[1][1], -depth);
+                  minimum = glm::min(minimum, point);
+                  maximum = glm::max(maximum, point);
+               }
+            }
+
+            int cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+            clusterMinX_[cluster] = minimum.x;
+            clusterMinY_[cluster] = minimum.y;
+            clusterMinZ_[cluster] = minimum.z;
+            clusterMaxX_[cluster] = maximum.x;
+            clusterMaxY_[cluster] = maximum.y;
+            clusterMaxZ_[cluster] = maximum.z;
+         }
+      }
+   }
+}
+
+float ClusteredLighting::getSliceDepth(int slice) const {
+   // The first slice reaches all the way to the camera, matching the clamp in the shaders
+   if (slice == 0) {
+      return 0.0f;
+   }
+
+   return FIRST_SLICE_DEPTH * std::pow(farPlane_ / FIRST_SLICE_DEPTH, static_cast<float>(slice) / CLUSTERS_Z);
+}
+
+void ClusteredLighting::assignLight(GLuint light, const glm::vec3& center, float radius) {
+   float depth = -center.z;
+   if (depth + radius < 0.0f || depth - radius > farPlane_) {
+      return;
+   }
+
+   // Slices are stored one after another, so the slices the sphere's depth range overlaps are one contiguous range
+   float ratio = std::log(farPlane_ / FIRST_SLICE_DEPTH);
+   int firstSlice = 0;
+   if (depth - radius > FIRST_SLICE_DEPTH) {
+      firstSlice = static_cast<int>(std::log((depth - radius) / FIRST_SLICE_DEPTH) / ratio * CLUSTERS_Z);
+   }
+   int lastSlice = CLUSTERS_Z - 1;
+   if (depth + radius < farPlane_) {
+      lastSlice = std::max(0, static_cast<int>(std::log(std::max(depth + radius, FIRST_SLICE_DEPTH) /
+         FIRST_SLICE_DEPTH) / ratio * CLUSTERS_Z));
+   }
+   firstSlice = std::min(firstSlice, CLUSTERS_Z - 1);
+   lastSlice = std::min(lastSlice, CLUSTERS_Z - 1);
+
+   const int clustersPerSlice = CLUSTERS_X * CLUSTERS_Y;
+   int begin = firstSlice * clustersPerSlice;
+   int end = (lastSlice + 1) * clustersPerSlice;
+
+   // Squared distance from the sphere's center to each cluster's bounds
+#ifdef CLUSTERED_LIGHTING_SSE
+   const __m128 centerX = _mm_set1_ps(center.x);
+   const __m128 centerY = _mm_set1_ps(center.y);
+   const __m128 centerZ = _mm_set1_ps(center.z);
+   const __m128 radiusSquared = _mm_set1_ps(radius * radius);
+   const __m128 zero = _mm_setzero_ps();
+
+   for (int cluster = begin; cluster < end; cluster += 4) {
+      __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinX_[cluster]), centerX),
+         _mm_sub_ps(centerX, _mm_loadu_ps(&clusterMaxX_[cluster]))));
+      __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinY_[cluster]), centerY),
+         _mm_sub_ps(centerY, _mm_loadu_ps(&clusterMaxY_[cluster]))));
+      __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusterMinZ_[cluster]), centerZ),
+         _mm_sub_ps(centerZ, _mm_loadu_ps(&clusterMaxZ_[cluster]))));
+
+      __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+      int hits = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared));
+
+      for (int i = 0; hits != 0; ++i, hits >>= 1) {
+         if (hits & 1) {
+            assignments_.push_back(std::make_pair(cluster + i, light));
+         }
+      }
+   }
+#else
+   for (int cluster = begin; cluster < end; ++cluster) {
+      float dx = std::max(0.0f, std::max(clusterMinX_[cluster] - center.x, center.x - clusterMaxX_[cluster]));
+      float dy = std::max(0.0f, std::max(clusterMinY_[cluster] - center.y, center.y - clusterMaxY_[cluster]));
+      float dz = std::max(0.0f, std::max(clusterMinZ_[cluster] - center.z, center.z - clusterMaxZ_[cluster]));
+
+      if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+         assignments_.push_back(std::make_pair(cluster, light));
+      }
+   }
+#endif
+}
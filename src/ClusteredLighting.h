@@ -0,0 +1,147 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Program.h"
+
+struct Light;
+
+/*
+ * Clustered forward shading. The view frustum is split into a grid of clusters, tiled in screen space and sliced
+ * exponentially in depth, and every frame each point light is assigned to the clusters its sphere of influence
+ * touches (tested four clusters at a time with SSE). The mesh shaders look up the cluster of each fragment and
+ * only loop over it's lights, so the cost per fragment depends on the lights nearby rather than in the level.
+ *
+ * Point lights, the per cluster light ranges and the light index list are read from texture buffers; directional
+ * lights from a uniform block that is uploaded once per frame and shared by all programs.
+ */
+class ClusteredLighting {
+public:
+
+   // Number of clusters along the screen's x and y axes and the depth
+   static constexpr int CLUSTERS_X = 16;
+   static constexpr int CLUSTERS_Y = 9;
+   static constexpr int CLUSTERS_Z = 24;
+   static constexpr int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+   // Depth the first slice ends at, closer fragments all fall into the first slice
+   static constexpr float FIRST_SLICE_DEPTH = 1.0f;
+
+   // Maximum number of light indices over all clusters, further assignments are dropped
+   static constexpr unsigned int MAX_LIGHT_INDICES = 65536;
+
+   // Point lights without a radius in the level light up this far
+   static constexpr float DEFAULT_POINT_LIGHT_RADIUS = 10.0f;
+
+   // Maximum number of directional lights, must match MAX_DIRECTION_LIGHTS in the shaders
+   static constexpr int MAX_DIRECTIONAL_LIGHTS = 10;
+
+   // Uniform block binding of "DirectionalLights"
+   static constexpr GLuint DIRECTIONAL_LIGHTS_BINDING = 0;
+
+   // Texture units the buffers are bound to while drawing
+   static constexpr unsigned int POINT_LIGHTS_TEXTURE_UNIT = 4;
+   static constexpr unsigned int CLUSTER_GRID_TEXTURE_UNIT = 5;
+   static constexpr unsigned int CLUSTER_LIGHT_INDICES_TEXTURE_UNIT = 6;
+
+   ClusteredLighting();
+
+   ~ClusteredLighting();
+
+   // Assigns the point lights to the clusters of the given camera, whose slices end at |farPlane|, and uploads
+   // the clusters and all lights. Must be called once per frame before anything lit is drawn
+   void update(const std::vector<Light>& pointLights, const std::vector<Light>& directionalLights,
+      const glm::mat4& P, const glm::mat4& V, float farPlane);
+
+   // Binds the light and cluster buffers to their texture units. Needed once per frame, not per program
+   void bindBuffers();
+
+   // Uploads the cluster uniforms for the given program, which keeps them until the next frame
+   void setUniforms(const std::shared_ptr<Program> program);
+
+   // Connects the program's "DirectionalLights" block (if any) to |DIRECTIONAL_LIGHTS_BINDING|
+   static void bindUniformBlocks(GLuint pid);
+
+   unsigned int getNumPointLights() const;
+
+   // Returns the number of directional lights uploaded by the last |update|, at most |MAX_DIRECTIONAL_LIGHTS|
+   unsigned int getNumDirectionalLights() const;
+
+   // Returns the number of light indices over all clusters assigned by the last |update|
+   unsigned int getNumLightIndices() const;
+
+private:
+
+   // std140 layout of the "DirectionalLights" block, xyz used
+   struct DirectionalLightData {
+      glm::vec4 position;
+      glm::vec4 color;
+      glm::vec4 orientation;
+   };
+
+   struct DirectionalLightBlock {
+      GLint numDirectionLights;
+      GLint padding[3];
+      DirectionalLightData directionLights[MAX_DIRECTIONAL_LIGHTS];
+   };
+
+   // Offset and count of a cluster's lights in the index list
+   struct ClusterRange {
+      GLuint offset;
+      GLuint count;
+   };
+
+   // View space bounds of every cluster, recomputed when the projection changes
+   std::vector<float> clusterMinX_;
+   std::vector<float> clusterMinY_;
+   std::vector<float> clusterMinZ_;
+   std::vector<float> clusterMaxX_;
+   std::vector<float> clusterMaxY_;
+   std::vector<float> clusterMaxZ_;
+
+   glm::mat4 clusterP_;
+   glm::mat4 clusterV_;
+   float farPlane_;
+
+   GLuint directionalLightBufID_;
+   GLuint pointLightBufID_;
+   GLuint pointLightTexID_;
+   GLuint clusterGridBufID_;
+   GLuint clusterGridTexID_;
+   GLuint lightIndexBufID_;
+   GLuint lightIndexTexID_;
+
+   unsigned int numPointLights_;
+   unsigned int numDirectionalLights_;
+   unsigned int numLightIndices_;
+
+   // Per frame storage, kept as members so that it's reused between frames
+   std::vector<glm::vec4> pointLightData_;
+   std::vector<GLuint> lightCounts_;
+   std::vector<ClusterRange> clusterRanges_;
+   std::vector<GLuint> lightIndices_;
+
+   // (cluster, light) pairs found by the sphere tests, sorted into |lightIndices_| by cluster
+   std::vector<std::pair<GLuint, GLuint>> assignments_;
+
+   // Creates the buffers and their textures. Called by the first |update|
+   void init();
+
+   // Recomputes the view space bounds of the clusters for the given projection
+   void buildClusterBounds(const glm::mat4& P, float farPlane);
+
+   // Returns the depth the given slice starts at
+   float getSliceDepth(int slice) const;
+
+   // Appends the clusters touched by the sphere, given in view space, to |assignments_|
+   void assignLight(GLuint light, const glm::vec3& center, float radius);
+};
+
+#endif
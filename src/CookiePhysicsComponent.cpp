@@ -1,5 +1,6 @@
 #include "CookiePhysicsComponent.h"
 
+#include "DebugDraw.h"
 #include "GameManager.h"
 #include "MaterialManager.h"
 #include "GameObject.h"
@@ -53,6 +54,7 @@ void CookiePhysicsComponent::updatePhysics(float deltaTime) {
             MaterialManager materialManager = MaterialManager::instance();
 
             glm::vec3 normal = objBB->calcReflNormal(*cookieBB);
+            DebugDraw::instance().addContact(holder_->getPosition(), normal);
             holder_->direction = glm::reflect(holder_->direction, normal);
 
             newPosition = oldPosition + (holder_->velocity * holder_->direction * deltaTime);
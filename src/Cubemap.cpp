@@ -3,13 +3,18 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include "GLSL.h"
+#include "AsyncLoader.h"
 #include <iostream>
+#include <memory>
 
 Cubemap::Cubemap(std::string path, std::string fileExtension) :
+    tid_(0),
     path_(path),
     fileExtension_(fileExtension) {}
 
-Cubemap::~Cubemap() {}
+Cubemap::~Cubemap() {
+    glDeleteTextures(1, &tid_);
+}
 
 void Cubemap::loadCubemap() {
 
@@ -17,30 +22,41 @@ void Cubemap::loadCubemap() {
     glGenTextures(1, &tid_);
     glBindTexture(GL_TEXTURE_CUBE_MAP, tid_);
 
-    for (unsigned int i = 0; i < imgNames.size(); i++) {
+    if (!loadCookedFaces()) {
+        // decode all faces in parallel, only the uploads have to happen here
+        std::vector<std::unique_ptr<Image>> images(imgNames.size());
+        std::vector<std::future<void>> decoded;
+        for (unsigned int i = 0; i < imgNames.size(); i++) {
+            std::string facePath = getFacePath(i);
+            std::unique_ptr<Image>& faceImage = images[i];
+            decoded.push_back(AsyncLoader::instance().submit([facePath, &faceImage]() {
+                faceImage.reset(new Image(facePath));
+            }));
+        }
 
-        //TODO(nurgan) move to ResourceManager and handle loading from there
-        std::string imgPath = "../resources/" + path_ + imgNames[i] + "." + fileExtension_;
+        for (unsigned int i = 0; i < imgNames.size(); i++) {
 
-       Image* image = new Image(imgPath);
+            decoded[i].wait();
+            Image* image = images[i].get();
 
-        if(image->components == 3) {
-            // RGB texture
+            if(image->components == 3) {
+                // RGB texture
 
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGB, image->width,  image->height,
-                         0, GL_RGB, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
-        } else if (image->components == 4) {
-            // RBGA texture
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGBA, image->width,  image->height,
-                         0, GL_RGBA, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                             0, GL_RGB, image->width,  image->height,
+                             0, GL_RGB, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
+            } else if (image->components == 4) {
+                // RBGA texture
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                             0, GL_RGBA, image->width,  image->height,
+                             0, GL_RGBA, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
+            }
         }
 
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     }
 
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -50,6 +66,40 @@ void Cubemap::loadCubemap() {
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
+std::string Cubemap::getFacePath(unsigned int face) {
+    //TODO(nurgan) move to ResourceManager and handle loading from there
+    return "../resources/" + path_ + imgNames[face] + "." + fileExtension_;
+}
+
+bool Cubemap::loadCookedFaces() {
+    if (!Texture::isCompressionSupported()) {
+        return false;
+    }
+
+    // all faces have to be cooked, a cubemap can't mix compressed and uncompressed faces
+    std::vector<DDSImage> faces(imgNames.size());
+    for (unsigned int i = 0; i < imgNames.size(); i++) {
+        if (!faces[i].load(DDSImage::getCookedPath(getFacePath(i)))
+            || faces[i].format != faces[0].format
+            || faces[i].mipLevels.size() != faces[0].mipLevels.size()
+            || faces[i].getWidth() != faces[0].getWidth()) {
+            return false;
+        }
+    }
+
+    GLenum format = Texture::getCompressedFormat(faces[0].format);
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        for (size_t level = 0; level < faces[i].mipLevels.size(); ++level) {
+            const DDSImage::MipLevel& mip = faces[i].mipLevels[level];
+            glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, format, mip.width, mip.height, 0,
+                                   mip.data.size(), mip.data.data());
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, faces[0].mipLevels.size() - 1);
+
+    return true;
+}
+
 void Cubemap::bind()
 {
     glActiveTexture(GL_TEXTURE0);
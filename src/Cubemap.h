@@ -11,7 +11,9 @@
 #include <GL/glew.h>
 #include "GLSL.h"
 
+#include "DDSImage.h"
 #include "Image.h"
+#include "Texture.h"
 
 class Cubemap
 {
@@ -19,6 +21,7 @@ public:
 
     Cubemap(std::string path, std::string fileExtension);
     virtual ~Cubemap();
+    // loads the six faces, using their cooked ".dds" versions if all of them exist
     void loadCubemap();
     void bind();
     void unbind();
@@ -30,6 +33,12 @@ private:
 
     //filenames to be iterated
     std::vector<std::string> imgNames = {"posx", "negx", "posy", "negy", "posz", "negz" };
+
+    // returns the path of the source image of the given face
+    std::string getFacePath(unsigned int face);
+
+    // uploads the cooked faces to the bound cubemap, returns false if any of them is missing
+    bool loadCookedFaces();
 };
 
 #endif
@@ -0,0 +1,202 @@
+#include "DDSImage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+   const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+   const uint32_t FOURCC_DXT1 = 0x31545844;
+   const uint32_t FOURCC_DXT5 = 0x35545844;
+
+   const uint32_t DDSD_CAPS = 0x1;
+   const uint32_t DDSD_HEIGHT = 0x2;
+   const uint32_t DDSD_WIDTH = 0x4;
+   const uint32_t DDSD_PIXELFORMAT = 0x1000;
+   const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+   const uint32_t DDSD_LINEARSIZE = 0x80000;
+
+   const uint32_t DDPF_FOURCC = 0x4;
+
+   const uint32_t DDSCAPS_COMPLEX = 0x8;
+   const uint32_t DDSCAPS_TEXTURE = 0x1000;
+   const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+   // Layouts of DDS_PIXELFORMAT and DDS_HEADER, all fields are little endian
+   struct DDSPixelFormat {
+      uint32_t size;
+      uint32_t flags;
+      uint32_t fourCC;
+      uint32_t rgbBitCount;
+      uint32_t rBitMask;
+      uint32_t gBitMask;
+      uint32_t bBitMask;
+      uint32_t aBitMask;
+   };
+
+   struct DDSHeader {
+      uint32_t size;
+      uint32_t flags;
+      uint32_t height;
+      uint32_t width;
+      uint32_t pitchOrLinearSize;
+      uint32_t depth;
+      uint32_t mipMapCount;
+      uint32_t reserved1[11];
+      DDSPixelFormat pixelFormat;
+      uint32_t caps;
+      uint32_t caps2;
+      uint32_t caps3;
+      uint32_t caps4;
+      uint32_t reserved2;
+   };
+
+   static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+}
+
+DDSImage::DDSImage() :
+   format(TextureCompressor::Format::BC1) {}
+
+DDSImage DDSImage::compress(const unsigned char* rgba, int width, int height) {
+   DDSImage image;
+   image.format = TextureCompressor::hasAlpha(rgba, width, height) ? TextureCompressor::Format::BC3
+      : TextureCompressor::Format::BC1;
+
+   std::vector<unsigned char> level(rgba, rgba + 4 * width * height);
+   while (true) {
+      MipLevel mip;
+      mip.width = width;
+      mip.height = height;
+      mip.data = TextureCompressor::compress(level.data(), width, height, image.format);
+      image.mipLevels.push_back(std::move(mip));
+
+      if (width == 1 && height == 1) {
+         break;
+      }
+
+      level = TextureCompressor::downsample(level.data(), width, height);
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+   }
+
+   return image;
+}
+
+std::string DDSImage::getCookedPath(const std::string& sourcePath) {
+   size_t extension = sourcePath.find_last_of('.');
+   size_t directory = sourcePath.find_last_of("/\\");
+
+   if (extension == std::string::npos || (directory != std::string::npos && extension < directory)) {
+      return sourcePath + ".dds";
+   }
+
+   return sourcePath.substr(0, extension) + ".dds";
+}
+
+bool DDSImage::load(const std::string& path) {
+   std::ifstream file(path, std::ios::binary);
+   if (!file) {
+      return false;
+   }
+
+   std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+   if (contents.size() < sizeof(uint32_t) + sizeof(DDSHeader)) {
+      return false;
+   }
+
+   uint32_t magic;
+   DDSHeader header;
+   std::memcpy(&magic, contents.data(), sizeof(magic));
+   std::memcpy(&header, contents.data() + sizeof(magic), sizeof(header));
+
+   if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC)
+    || header.width == 0 || header.height == 0) {
+      return false;
+   }
+
+   if (header.pixelFormat.fourCC == FOURCC_DXT1) {
+      format = TextureCompressor::Format::BC1;
+   } else if (header.pixelFormat.fourCC == FOURCC_DXT5) {
+      format = TextureCompressor::Format::BC3;
+   } else {
+      return false;
+   }
+
+   unsigned int numLevels = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(1u, header.mipMapCount) : 1;
+   int width = header.width;
+   int height = header.height;
+   size_t offset = sizeof(magic) + sizeof(header);
+
+   mipLevels.clear();
+   for (unsigned int i = 0; i < numLevels; ++i) {
+      size_t size = TextureCompressor::getCompressedSize(format, width, height);
+      if (offset + size > contents.size()) {
+         mipLevels.clear();
+         return false;
+      }
+
+      MipLevel mip;
+      mip.width = width;
+      mip.height = height;
+      mip.data.assign(contents.begin() + offset, contents.begin() + offset + size);
+      mipLevels.push_back(std::move(mip));
+
+      offset += size;
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+   }
+
+   return true;
+}
+
+bool DDSImage::save(const std::string& path) const {
+   if (mipLevels.empty()) {
+      return false;
+   }
+
+   DDSHeader header;
+   std::memset(&header, 0, sizeof(header));
+   header.size = sizeof(DDSHeader);
+   header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+   header.height = getHeight();
+   header.width = getWidth();
+   header.pitchOrLinearSize = mipLevels[0].data.size();
+   header.mipMapCount = mipLevels.size();
+   header.pixelFormat.size = sizeof(DDSPixelFormat);
+   header.pixelFormat.flags = DDPF_FOURCC;
+   header.pixelFormat.fourCC = format == TextureCompressor::Format::BC1 ? FOURCC_DXT1 : FOURCC_DXT5;
+   header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+   std::ofstream file(path, std::ios::binary);
+   if (!file) {
+      return false;
+   }
+
+   file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   for (const MipLevel& mip : mipLevels) {
+      file.write(reinterpret_cast<const char*>(mip.data.data()), mip.data.size());
+   }
+
+   return static_cast<bool>(file);
+}
+
+size_t DDSImage::getDataSize() const {
+   size_t size = 0;
+   for (const MipLevel& mip : mipLevels) {
+      size += mip.data.size();
+   }
+
+   return size;
+}
+
+int DDSImage::getWidth() const {
+   return mipLevels.empty() ? 0 : mipLevels[0].width;
+}
+
+int DDSImage::getHeight() const {
+   return mipLevels.empty() ? 0 : mipLevels[0].height;
+}
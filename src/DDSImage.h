@@ -0,0 +1,51 @@
+#ifndef DDS_IMAGE_H
+#define DDS_IMAGE_H
+
+#include <string>
+#include <vector>
+
+#include "TextureCompressor.h"
+
+/*
+ * A block compressed image with it's full mip chain, stored in a DDS file with a DXT1 or DXT5 header.
+ * Textures are cooked into this format once by "tools/TextureCooker.cpp", so loading them is a plain file read
+ * followed by one glCompressedTexImage2D per level, without decoding or generating mipmaps at runtime.
+ */
+class DDSImage {
+public:
+
+   // One level of the mip chain, the first level is the full size image
+   struct MipLevel {
+      int width;
+      int height;
+      std::vector<unsigned char> data;
+   };
+
+   TextureCompressor::Format format;
+
+   std::vector<MipLevel> mipLevels;
+
+   DDSImage();
+
+   // Compresses the RGBA image and all it's mip levels. BC3 is used if the image has alpha, BC1 otherwise
+   static DDSImage compress(const unsigned char* rgba, int width, int height);
+
+   // Returns the path the cooked version of a source image is stored at, i.e. the same path with a ".dds"
+   // extension
+   static std::string getCookedPath(const std::string& sourcePath);
+
+   // Reads a DDS file written by |save|. Returns false if it doesn't exist or isn't a DXT1/DXT5 texture
+   bool load(const std::string& path);
+
+   // Writes the image as a DDS file, returns false if the file couldn't be written
+   bool save(const std::string& path) const;
+
+   // Returns the size in bytes of all mip levels
+   size_t getDataSize() const;
+
+   int getWidth() const;
+
+   int getHeight() const;
+};
+
+#endif
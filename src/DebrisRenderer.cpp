@@ -0,0 +1,101 @@
+#include "DebrisRenderer.h"
+
+#include "ShaderManager.h"
+
+namespace {
+
+   // Texels of the data buffer, enough for the chunk positions and matrices of all debris at once
+   const size_t DATA_TEXELS = DebrisSystem::CAPACITY + DebrisSystem::MAX_DEBRIS * DebrisSystem::MATRIX_TEXELS;
+}
+
+DebrisRenderer::DebrisRenderer()
+   : dataBufID_(0),
+   dataTexID_(0) {
+}
+
+DebrisRenderer::~DebrisRenderer() {
+   if (dataBufID_ != 0) {
+      glDeleteTextures(1, &dataTexID_);
+      glDeleteBuffers(1, &dataBufID_);
+   }
+}
+
+void DebrisRenderer::draw(const std::vector<DebrisSystem::DrawBatch>& batches, const std::vector<glm::vec4>& data,
+   const MatrixStack& P, const MatrixStack& V) {
+   if (batches.empty()) {
+      return;
+   }
+
+   if (dataBufID_ == 0) {
+      init();
+   }
+
+   // Orphan the buffer so the previous frame's draws don't have to finish first
+   glBindBuffer(GL_TEXTURE_BUFFER, dataBufID_);
+   glBufferData(GL_TEXTURE_BUFFER, DATA_TEXELS * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+   glBufferSubData(GL_TEXTURE_BUFFER, 0, data.size() * sizeof(glm::vec4), &data[0]);
+   glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+   glActiveTexture(GL_TEXTURE0 + DATA_TEXTURE_UNIT);
+   glBindTexture(GL_TEXTURE_BUFFER, dataTexID_);
+
+   ShaderManager& shaderManager = ShaderManager::instance();
+   ShaderVariant variant = shaderManager.getFrameVariant();
+   variant.features |= ShaderVariant::INSTANCED;
+
+   for (const DebrisSystem::DrawBatch& batch : batches) {
+      // Programs without a debris variant draw their debris with the default shader's
+      const std::string* shaderName = &batch.shaderName;
+      if (shaderManager.getDebrisShaderProgram(*shaderName) == nullptr) {
+         shaderName = &shaderManager.DefaultShader;
+      }
+      if (shaderManager.getDebrisShaderProgram(*shaderName) == nullptr) {
+         continue;
+      }
+
+      int numTexturedSubShapes = batch.shape->getNumTexturedSubShapes();
+
+      // Untextured and textured sub shapes are drawn with their own variant
+      for (bool textured : { false, true }) {
+         if ((textured ? numTexturedSubShapes : batch.shape->getNumSubShapes() - numTexturedSubShapes) == 0) {
+            continue;
+         }
+
+         ShaderVariant subShapeVariant = variant;
+         if (textured) {
+            subShapeVariant.features |= ShaderVariant::TEXTURED;
+         }
+
+         const std::shared_ptr<Program> shaderProgram = shaderManager.getShaderVariant(*shaderName,
+            subShapeVariant);
+         shaderManager.bindShader(shaderProgram->name);
+         shaderManager.bindFrameUniforms(shaderProgram, P, V);
+
+         glUniform1i(shaderProgram->getUniform("debrisData"), DATA_TEXTURE_UNIT);
+         glUniform1i(shaderProgram->getUniform("debrisOffset"), batch.dataOffset);
+         glUniform1i(shaderProgram->getUniform("debrisStride"), batch.stride);
+
+         batch.shape->drawDebris(shaderProgram, batch.material, batch.numInstances, batch.level,
+            textured ? Shape::SubShapes::TEXTURED : Shape::SubShapes::UNTEXTURED);
+      }
+   }
+
+   glActiveTexture(GL_TEXTURE0 + DATA_TEXTURE_UNIT);
+   glBindTexture(GL_TEXTURE_BUFFER, 0);
+   glActiveTexture(GL_TEXTURE0);
+
+   shaderManager.unbindShader();
+}
+
+void DebrisRenderer::init() {
+   glGenBuffers(1, &dataBufID_);
+   glBindBuffer(GL_TEXTURE_BUFFER, dataBufID_);
+   glBufferData(GL_TEXTURE_BUFFER, DATA_TEXELS * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+
+   glGenTextures(1, &dataTexID_);
+   glBindTexture(GL_TEXTURE_BUFFER, dataTexID_);
+   glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, dataBufID_);
+
+   glBindTexture(GL_TEXTURE_BUFFER, 0);
+   glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
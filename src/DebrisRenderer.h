@@ -0,0 +1,42 @@
+#ifndef DEBRIS_RENDERER_H
+#define DEBRIS_RENDERER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "DebrisSystem.h"
+#include "MatrixStack.h"
+
+/*
+ * Draws the debris of a frame as collected by |DebrisSystem::collect|, with one instanced draw per batch and sub
+ * shape. The per instance data is streamed into a texture buffer read by "debris_vert.glsl". Owned by the renderer,
+ * so the buffer is only ever touched by the thread drawing the frames.
+ */
+class DebrisRenderer {
+public:
+
+   // Texture unit the per instance data is bound to while drawing
+   static constexpr unsigned int DATA_TEXTURE_UNIT = 3;
+
+   DebrisRenderer();
+
+   ~DebrisRenderer();
+
+   // Draws the given batches and the per instance data they read
+   void draw(const std::vector<DebrisSystem::DrawBatch>& batches, const std::vector<glm::vec4>& data,
+      const MatrixStack& P, const MatrixStack& V);
+
+private:
+
+   GLuint dataBufID_;
+   GLuint dataTexID_;
+
+   // Creates the data buffer and it's texture. Called by the first |draw|
+   void init();
+};
+
+#endif
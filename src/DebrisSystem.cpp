@@ -0,0 +1,367 @@
+#include "DebrisSystem.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/rotate_vector.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DEBRIS_SYSTEM_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "RenderComponent.h"
+
+namespace {
+
+   // Returns a random float in [min, max]
+   float randomFloat(float min, float max) {
+      return min + (max - min) * (static_cast<float>(std::rand()) / RAND_MAX);
+   }
+
+   // Returns a random direction around |direction|, pushed towards |outwards| (away from the center of what broke)
+   glm::vec3 scatter(const glm::vec3& direction, const glm::vec3& outwards) {
+      // Axes to randomize the direction about
+      glm::vec3 vertRotAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+      glm::vec3 horRotAxis = glm::cross(direction, vertRotAxis);
+      if (glm::length(horRotAxis) < 0.001f) {
+         horRotAxis = glm::vec3(1.0f, 0.0f, 0.0f);
+      }
+
+      glm::vec3 dirHor = glm::rotate(direction, randomFloat(-M_PI / 4.0f, M_PI / 4.0f), vertRotAxis);
+      glm::vec3 dirVert = glm::rotate(direction, randomFloat(-M_PI / 12.0f, M_PI / 6.0f), horRotAxis);
+      glm::vec3 dir = glm::normalize(dirHor + dirVert);
+
+      if (glm::length(outwards) > 0.001f) {
+         dir = glm::normalize(dir + DebrisSystem::SPREAD * glm::normalize(outwards));
+      }
+
+      return dir;
+   }
+
+   // Returns the center of the chunk's bounds in model space
+   glm::vec3 getCenter(const Shape::DebrisChunk& chunk) {
+      return (chunk.min + chunk.max) * 0.5f;
+   }
+}
+
+DebrisSystem::DebrisSystem()
+   : firstChunk_(0),
+   numChunks_(0) {
+   positionX_.assign(CAPACITY, 0.0f);
+   positionY_.assign(CAPACITY, 0.0f);
+   positionZ_.assign(CAPACITY, 0.0f);
+   velocityX_.assign(CAPACITY, 0.0f);
+   velocityY_.assign(CAPACITY, 0.0f);
+   velocityZ_.assign(CAPACITY, 0.0f);
+   floorY_.assign(CAPACITY, 0.0f);
+}
+
+DebrisSystem::~DebrisSystem() {
+
+}
+
+void DebrisSystem::spawnDebris(std::shared_ptr<GameObject> obj, const glm::vec3& direction, float speed,
+   float verticalSpeed) {
+   RenderComponent* render = obj->getRenderComponent();
+   if (render == NULL || render->getShape() == nullptr) {
+      return;
+   }
+
+   // Every shape is split the first time one of it's objects breaks, all of them share the same chunks
+   std::shared_ptr<Shape> shape = render->getShape();
+   shape->initDebris(CHUNKS_PER_SUB_SHAPE, FINE_CHUNKS_PER_CHUNK);
+
+   const std::vector<Shape::DebrisChunk>& chunks = shape->getDebrisChunks(Shape::DEBRIS_COARSE);
+   if (chunks.empty() || chunks.size() > CAPACITY) {
+      return;
+   }
+
+   while (debris_.size() >= MAX_DEBRIS || numChunks_ + chunks.size() > CAPACITY) {
+      removeOldest();
+   }
+
+   Debris debris;
+   debris.shape = shape;
+   debris.shaderName = render->getShader();
+   debris.material = render->getMaterial();
+   debris.level = Shape::DEBRIS_COARSE;
+   debris.shattered = false;
+
+   // Chunks are placed in world space, so only the scale and rotation of the object are kept
+   debris.M = glm::mat3(obj->transform.getTransform());
+   debris.tiM = glm::mat3(obj->transform.getNormalMatrix());
+
+   debris.firstChunk = (firstChunk_ + numChunks_) % CAPACITY;
+   debris.numChunks = chunks.size();
+   debris.age = 0.0f;
+
+   const glm::vec3& position = obj->getPosition();
+
+   for (unsigned int n = 0; n < debris.numChunks; ++n) {
+      const Shape::DebrisChunk& chunk = chunks[n];
+
+      // A random direction around the hit, pushed away from the object's center
+      glm::vec3 velocity = speed * scatter(direction, debris.M * getCenter(chunk));
+      velocity.y += verticalSpeed;
+      placeChunk((debris.firstChunk + n) % CAPACITY, debris, chunk, position, velocity);
+   }
+
+   numChunks_ += debris.numChunks;
+   debris_.push_back(debris);
+}
+
+void DebrisSystem::shatter(const glm::vec3& min, const glm::vec3& max, const glm::vec3& direction, float speed) {
+   if (speed < MIN_SHATTER_SPEED) {
+      return;
+   }
+
+   // The pieces are appended to |debris_|, only the debris that was there before can be hit
+   size_t numDebris = debris_.size();
+   for (size_t d = 0; d < numDebris; ++d) {
+      if (numChunks_ > MAX_CHUNKS_TO_SHATTER || debris_.size() >= MAX_DEBRIS) {
+         return;
+      }
+
+      Debris& debris = debris_[d];
+      if (debris.level != Shape::DEBRIS_COARSE || debris.shattered || debris.age < MIN_SHATTER_AGE ||
+         !isHit(debris, min, max)) {
+         continue;
+      }
+
+      const std::vector<Shape::DebrisChunk>& chunks = debris.shape->getDebrisChunks(Shape::DEBRIS_COARSE);
+      const std::vector<Shape::DebrisChunk>& fineChunks = debris.shape->getDebrisChunks(Shape::DEBRIS_FINE);
+      if (fineChunks.empty() || numChunks_ + fineChunks.size() > CAPACITY) {
+         continue;
+      }
+
+      // The pieces start out where the chunk they were split from is, with a fresh lifetime
+      Debris pieces = debris;
+      pieces.level = Shape::DEBRIS_FINE;
+      pieces.firstChunk = (firstChunk_ + numChunks_) % CAPACITY;
+      pieces.numChunks = fineChunks.size();
+      pieces.age = 0.0f;
+
+      for (unsigned int n = 0; n < pieces.numChunks; ++n) {
+         const Shape::DebrisChunk& chunk = fineChunks[n];
+         unsigned int parent = (debris.firstChunk + chunk.parent) % CAPACITY;
+
+         glm::vec3 position(positionX_[parent], positionY_[parent], positionZ_[parent]);
+         glm::vec3 velocity(velocityX_[parent], velocityY_[parent], velocityZ_[parent]);
+
+         // Pushed away from the center of the chunk that broke
+         glm::vec3 outwards = debris.M * (getCenter(chunk) - getCenter(chunks[chunk.parent]));
+         velocity += speed * scatter(direction, outwards);
+
+         placeChunk((pieces.firstChunk + n) % CAPACITY, pieces, chunk, position, velocity);
+      }
+
+      debris.shattered = true;
+      numChunks_ += pieces.numChunks;
+      debris_.push_back(pieces);
+   }
+}
+
+void DebrisSystem::update(float deltaTime) {
+   if (debris_.empty()) {
+      return;
+   }
+
+   simulate(deltaTime);
+
+   for (Debris& debris : debris_) {
+      debris.age += deltaTime;
+
+      // Lowering the floor lets the resting chunks sink out of sight
+      if (debris.age > LIFETIME - SINK_TIME) {
+         for (unsigned int n = 0; n < debris.numChunks; ++n) {
+            floorY_[(debris.firstChunk + n) % CAPACITY] -= SINK_SPEED * deltaTime;
+         }
+      }
+   }
+
+   while (!debris_.empty() && debris_.front().age >= LIFETIME) {
+      removeOldest();
+   }
+}
+
+void DebrisSystem::simulate(float deltaTime) {
+   float friction = std::pow(GROUND_FRICTION, deltaTime);
+
+   // Dead slots are simulated too, it's cheaper than skipping them and they are overwritten when reused
+#ifdef DEBRIS_SYSTEM_SSE
+   const __m128 dt = _mm_set1_ps(deltaTime);
+   const __m128 dv = _mm_set1_ps(-GRAVITY * deltaTime);
+   const __m128 groundDamping = _mm_set1_ps(friction);
+   const __m128 one = _mm_set1_ps(1.0f);
+
+   for (unsigned int i = 0; i < CAPACITY; i += 4) {
+      __m128 vx = _mm_loadu_ps(&velocityX_[i]);
+      __m128 vy = _mm_add_ps(_mm_loadu_ps(&velocityY_[i]), dv);
+      __m128 vz = _mm_loadu_ps(&velocityZ_[i]);
+
+      __m128 px = _mm_add_ps(_mm_loadu_ps(&positionX_[i]), _mm_mul_ps(vx, dt));
+      __m128 py = _mm_add_ps(_mm_loadu_ps(&positionY_[i]), _mm_mul_ps(vy, dt));
+      __m128 pz = _mm_add_ps(_mm_loadu_ps(&positionZ_[i]), _mm_mul_ps(vz, dt));
+
+      // Chunks that hit the ground stop falling and slide to a halt
+      __m128 floor = _mm_loadu_ps(&floorY_[i]);
+      __m128 grounded = _mm_cmple_ps(py, floor);
+      py = _mm_max_ps(py, floor);
+      vy = _mm_andnot_ps(grounded, vy);
+
+      __m128 damping = _mm_or_ps(_mm_and_ps(grounded, groundDamping), _mm_andnot_ps(grounded, one));
+      vx = _mm_mul_ps(vx, damping);
+      vz = _mm_mul_ps(vz, damping);
+
+      _mm_storeu_ps(&positionX_[i], px);
+      _mm_storeu_ps(&positionY_[i], py);
+      _mm_storeu_ps(&positionZ_[i], pz);
+      _mm_storeu_ps(&velocityX_[i], vx);
+      _mm_storeu_ps(&velocityY_[i], vy);
+      _mm_storeu_ps(&velocityZ_[i], vz);
+   }
+#else
+   for (unsigned int i = 0; i < CAPACITY; ++i) {
+      velocityY_[i] -= GRAVITY * deltaTime;
+      positionX_[i] += velocityX_[i] * deltaTime;
+      positionY_[i] += velocityY_[i] * deltaTime;
+      positionZ_[i] += velocityZ_[i] * deltaTime;
+
+      // Chunks that hit the ground stop falling and slide to a halt
+      if (positionY_[i] <= floorY_[i]) {
+         positionY_[i] = floorY_[i];
+         velocityY_[i] = 0.0f;
+         velocityX_[i] *= friction;
+         velocityZ_[i] *= friction;
+      }
+   }
+#endif
+}
+
+void DebrisSystem::collect(std::vector<DrawBatch>& batches, std::vector<glm::vec4>& data) {
+   batches.clear();
+   data.clear();
+   if (debris_.empty()) {
+      return;
+   }
+
+   debrisBatches_.clear();
+   for (const Debris& debris : debris_) {
+      if (debris.shattered) {
+         continue;
+      }
+
+      unsigned int batch = getBatch(batches, debris);
+      batches[batch].numInstances++;
+      debrisBatches_.push_back(batch);
+   }
+
+   // Lay out the instances of each batch as one contiguous range
+   unsigned int dataSize = 0;
+   for (DrawBatch& batch : batches) {
+      batch.dataOffset = dataSize;
+      dataSize += batch.numInstances * batch.stride;
+
+      // Reused as the write position below
+      batch.numInstances = 0;
+   }
+   data.resize(dataSize);
+
+   unsigned int debrisIndex = 0;
+   for (const Debris& debris : debris_) {
+      if (debris.shattered) {
+         continue;
+      }
+
+      DrawBatch& batch = batches[debrisBatches_[debrisIndex++]];
+      glm::vec4* instance = &data[batch.dataOffset + batch.numInstances * batch.stride];
+      batch.numInstances++;
+
+      for (int column = 0; column < 3; ++column) {
+         *instance++ = glm::vec4(debris.M[column], 0.0f);
+      }
+      for (int column = 0; column < 3; ++column) {
+         *instance++ = glm::vec4(debris.tiM[column], 0.0f);
+      }
+
+      for (unsigned int n = 0; n < debris.numChunks; ++n) {
+         unsigned int i = (debris.firstChunk + n) % CAPACITY;
+         *instance++ = glm::vec4(positionX_[i], positionY_[i], positionZ_[i], 1.0f);
+      }
+   }
+}
+
+unsigned int DebrisSystem::getNumDebris() const {
+   return debris_.size();
+}
+
+unsigned int DebrisSystem::getNumChunks() const {
+   return numChunks_;
+}
+
+void DebrisSystem::removeOldest() {
+   const Debris& oldest = debris_.front();
+   firstChunk_ = (firstChunk_ + oldest.numChunks) % CAPACITY;
+   numChunks_ -= oldest.numChunks;
+   debris_.pop_front();
+}
+
+void DebrisSystem::placeChunk(unsigned int i, const Debris& debris, const Shape::DebrisChunk& chunk,
+   const glm::vec3& position, const glm::vec3& velocity) {
+   // Lowest point of the chunk's bounds relative to it's position
+   float chunkMinY = FLT_MAX;
+   for (int corner = 0; corner < 8; ++corner) {
+      glm::vec3 point((corner & 1) ? chunk.max.x : chunk.min.x, (corner & 2) ? chunk.max.y : chunk.min.y,
+         (corner & 4) ? chunk.max.z : chunk.min.z);
+      chunkMinY = std::min(chunkMinY, (debris.M * point).y);
+   }
+
+   positionX_[i] = position.x;
+   positionY_[i] = position.y;
+   positionZ_[i] = position.z;
+   velocityX_[i] = velocity.x;
+   velocityY_[i] = velocity.y;
+   velocityZ_[i] = velocity.z;
+   floorY_[i] = GROUND_HEIGHT - chunkMinY;
+}
+
+bool DebrisSystem::isHit(const Debris& debris, const glm::vec3& min, const glm::vec3& max) const {
+   const std::vector<Shape::DebrisChunk>& chunks = debris.shape->getDebrisChunks(debris.level);
+
+   for (unsigned int n = 0; n < debris.numChunks; ++n) {
+      unsigned int i = (debris.firstChunk + n) % CAPACITY;
+      glm::vec3 center = glm::vec3(positionX_[i], positionY_[i], positionZ_[i]) + debris.M * getCenter(chunks[n]);
+
+      if (center.x >= min.x && center.y >= min.y && center.z >= min.z &&
+         center.x <= max.x && center.y <= max.y && center.z <= max.z) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+unsigned int DebrisSystem::getBatch(std::vector<DrawBatch>& batches, const Debris& debris) {
+   for (unsigned int i = 0; i < batches.size(); ++i) {
+      const DrawBatch& batch = batches[i];
+      if (batch.shape == debris.shape && batch.level == debris.level && batch.shaderName == debris.shaderName &&
+         batch.material == debris.material) {
+         return i;
+      }
+   }
+
+   DrawBatch batch;
+   batch.shape = debris.shape;
+   batch.shaderName = debris.shaderName;
+   batch.material = debris.material;
+   batch.level = debris.level;
+   batch.numInstances = 0;
+   batch.dataOffset = 0;
+   batch.stride = MATRIX_TEXELS + debris.numChunks;
+   batches.push_back(batch);
+
+   return batches.size() - 1;
+}
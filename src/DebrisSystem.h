@@ -0,0 +1,172 @@
+#ifndef DEBRIS_SYSTEM_H
+#define DEBRIS_SYSTEM_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "GameObject.h"
+#include "Shape.h"
+
+/*
+ * Pieces of objects that were smashed, like fire hydrants hit by the player. The shape of a broken object is split
+ * into Voronoi chunks once (see |Shape::initDebris|) and every chunk flies off on it's own, sliding to a stop on
+ * the ground before the debris sinks away. Debris the player runs into again is replaced by the finer chunks its
+ * chunks were split into, unless the pool is already busy with lots of debris. Chunk positions and velocities of
+ * all debris live in one fixed capacity ring buffer stored as a structure of arrays and simulated four chunks at a
+ * time with SSE.
+ *
+ * All debris of the same shape, level, program and material is collected into one batch, which |DebrisRenderer|
+ * draws with one instanced draw per sub shape. The per instance matrices and chunk positions are read from a texture
+ * buffer (see "debris_vert.glsl").
+ */
+class DebrisSystem {
+public:
+
+   // Chunks of all debris, a multiple of the SIMD width. When full the oldest debris is removed
+   static constexpr unsigned int CAPACITY = 16384;
+
+   // Broken objects at once, keeps the per instance data within the guaranteed texture buffer size
+   static constexpr unsigned int MAX_DEBRIS = 1024;
+
+   // Voronoi cells each sub shape of a broken shape is split into
+   static constexpr int CHUNKS_PER_SUB_SHAPE = 6;
+
+   // Voronoi cells each of those chunks is split into when the debris breaks further
+   static constexpr int FINE_CHUNKS_PER_CHUNK = 4;
+
+   // Live chunks above which debris isn't broken further, so that pile-ups of many objects stay cheap
+   static constexpr unsigned int MAX_CHUNKS_TO_SHATTER = CAPACITY / 2;
+
+   // Speed something has to hit debris with to break it further
+   static constexpr float MIN_SHATTER_SPEED = 5.0f;
+
+   // Seconds debris has to be around before it can break further, so that whatever broke the object doesn't also
+   // shatter it's debris while still passing through
+   static constexpr float MIN_SHATTER_AGE = 1.0f;
+
+   // Seconds debris stays around, the last |SINK_TIME| of which it sinks into the ground
+   static constexpr float LIFETIME = 8.0f;
+   static constexpr float SINK_TIME = 1.5f;
+   static constexpr float SINK_SPEED = 0.5f;
+
+   // Downwards acceleration, same as the falling fire hydrants
+   static constexpr float GRAVITY = 10.0f;
+
+   // Height of the ground plane debris comes to rest on
+   static constexpr float GROUND_HEIGHT = 0.0f;
+
+   // Fraction of the horizontal speed chunks on the ground keep after one second
+   static constexpr float GROUND_FRICTION = 0.02f;
+
+   // How much the chunks spread away from the object's center compared to the direction they were hit in
+   static constexpr float SPREAD = 0.5f;
+
+   // Texels in front of the chunk positions of an instance, see "debris_vert.glsl"
+   static constexpr unsigned int MATRIX_TEXELS = 6;
+
+   // Debris drawn together with one instanced draw per sub shape
+   struct DrawBatch {
+      std::shared_ptr<Shape> shape;
+
+      // Program whose INSTANCED variants the debris is drawn with, falls back to the default shader if it has none
+      std::string shaderName;
+      std::shared_ptr<Material> material;
+      Shape::DebrisLevel level;
+
+      unsigned int numInstances;
+
+      // First texel of the batch in the data buffer and texels per instance
+      unsigned int dataOffset;
+      unsigned int stride;
+   };
+
+   DebrisSystem();
+
+   ~DebrisSystem();
+
+   // Breaks the object into the chunks of it's shape at it's current position and orientation. The chunks fly off
+   // around |direction| at |speed|, with the vertical speed of the object added. The object itself is left as is,
+   // the caller removes it from the world
+   void spawnDebris(std::shared_ptr<GameObject> obj, const glm::vec3& direction, float speed, float verticalSpeed);
+
+   // Breaks coarse debris with a chunk centered within the world space box given by |min| and |max| into it's finer
+   // chunks, which fly off around |direction| at |speed|. Does nothing below |MIN_SHATTER_SPEED| or while there are
+   // more than |MAX_CHUNKS_TO_SHATTER| chunks. Debris younger than |MIN_SHATTER_AGE| isn't hit
+   void shatter(const glm::vec3& min, const glm::vec3& max, const glm::vec3& direction, float speed);
+
+   // Advances all chunks and removes expired debris
+   void update(float deltaTime);
+
+   // Replaces |batches| and |data| with the batches of all live debris and the per instance data they read
+   void collect(std::vector<DrawBatch>& batches, std::vector<glm::vec4>& data);
+
+   // Returns the number of broken objects whose debris is still around
+   unsigned int getNumDebris() const;
+
+   // Returns the number of live chunks
+   unsigned int getNumChunks() const;
+
+private:
+
+   // One broken object. It's chunks are [firstChunk, firstChunk + shape's chunk count) modulo |CAPACITY|
+   struct Debris {
+      std::shared_ptr<Shape> shape;
+      std::string shaderName;
+      std::shared_ptr<Material> material;
+      Shape::DebrisLevel level;
+
+      // Set once the debris was replaced by it's finer chunks. It isn't drawn anymore, but keeps it's chunks until it
+      // expires so that debris still expires in order
+      bool shattered;
+
+      // Model matrix of the object without it's translation and it's inverse transpose
+      glm::mat3 M;
+      glm::mat3 tiM;
+
+      unsigned int firstChunk;
+      unsigned int numChunks;
+      float age;
+   };
+
+   // All debris lives equally long, so it expires in the order it was spawned
+   std::deque<Debris> debris_;
+
+   // Live chunks are [firstChunk_, firstChunk_ + numChunks_) modulo |CAPACITY|
+   std::vector<float> positionX_;
+   std::vector<float> positionY_;
+   std::vector<float> positionZ_;
+   std::vector<float> velocityX_;
+   std::vector<float> velocityY_;
+   std::vector<float> velocityZ_;
+
+   // Lowest height of the chunk's position that keeps all of it above the ground
+   std::vector<float> floorY_;
+
+   unsigned int firstChunk_;
+   unsigned int numChunks_;
+
+   // Batch of each debris in the last |collect|, kept as a member so that it's storage is reused between frames
+   std::vector<unsigned int> debrisBatches_;
+
+   // Removes the oldest debris
+   void removeOldest();
+
+   // Sets the position and velocity of the |i|th chunk slot, which holds the given chunk of |debris|
+   void placeChunk(unsigned int i, const Debris& debris, const Shape::DebrisChunk& chunk, const glm::vec3& position,
+      const glm::vec3& velocity);
+
+   // Returns true if the center of one of the debris' chunks is within the box given by |min| and |max|
+   bool isHit(const Debris& debris, const glm::vec3& min, const glm::vec3& max) const;
+
+   // Advances all chunks
+   void simulate(float deltaTime);
+
+   // Returns the index of the batch in |batches| the given debris is drawn with, adding the batch if needed
+   unsigned int getBatch(std::vector<DrawBatch>& batches, const Debris& debris);
+};
+
+#endif
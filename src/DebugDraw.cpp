@@ -0,0 +1,190 @@
+#include "DebugDraw.h"
+
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ShaderManager.h"
+
+DebugDraw& DebugDraw::instance() {
+   static DebugDraw *instance = new DebugDraw();
+   return *instance;
+}
+
+DebugDraw::DebugDraw()
+   : enabledCategories_(0),
+   vaoID_(0),
+   vertexBufID_(0),
+   numUploadedVertices_(0) {}
+
+DebugDraw::~DebugDraw() {
+   if (vaoID_ != 0) {
+      glDeleteVertexArrays(1, &vaoID_);
+      glDeleteBuffers(1, &vertexBufID_);
+   }
+}
+
+void DebugDraw::setEnabled(Category category, bool enabled) {
+   if (enabled) {
+      enabledCategories_ |= category;
+   } else {
+      enabledCategories_ &= ~category;
+   }
+}
+
+bool DebugDraw::isEnabled(Category category) {
+   return (enabledCategories_ & category) != 0;
+}
+
+void DebugDraw::addLine(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color, double duration) {
+   LineVertex fromVertex = {from, color};
+   LineVertex toVertex = {to, color};
+
+   if (duration > 0.0) {
+      timedVertices_.push_back(fromVertex);
+      timedVertices_.push_back(toVertex);
+      timedExpiry_.push_back(glfwGetTime() + duration);
+   } else {
+      vertices_.push_back(fromVertex);
+      vertices_.push_back(toVertex);
+   }
+}
+
+void DebugDraw::addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& color, double duration) {
+   glm::vec3 corners[8];
+   for (int i = 0; i < 8; ++i) {
+      corners[i] = glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+   }
+
+   // Every edge connects two corners differing in one bit
+   for (int i = 0; i < 8; ++i) {
+      for (int bit = 1; bit < 8; bit <<= 1) {
+         if (!(i & bit)) {
+            addLine(corners[i], corners[i | bit], color, duration);
+         }
+      }
+   }
+}
+
+void DebugDraw::addFrustum(const glm::mat4& viewProjection, const glm::vec3& color) {
+   glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+   // Corners of the clip space cube, in the same order as the corners of a box
+   glm::vec3 corners[8];
+   for (int i = 0; i < 8; ++i) {
+      glm::vec4 corner = inverseViewProjection * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f,
+         (i & 4) ? 1.0f : -1.0f, 1.0f);
+      corners[i] = glm::vec3(corner) / corner.w;
+   }
+
+   for (int i = 0; i < 8; ++i) {
+      for (int bit = 1; bit < 8; bit <<= 1) {
+         if (!(i & bit)) {
+            addLine(corners[i], corners[i | bit], color);
+         }
+      }
+   }
+}
+
+void DebugDraw::addContact(const glm::vec3& point, const glm::vec3& normal) {
+   if (!isEnabled(CONTACTS)) {
+      return;
+   }
+
+   addLine(point, point + normal * CONTACT_NORMAL_LENGTH, glm::vec3(1.0f, 0.0f, 1.0f), CONTACT_DURATION);
+}
+
+void DebugDraw::collectFrame(std::vector<LineVertex>& lines) {
+   lines.assign(vertices_.begin(), vertices_.end());
+   lines.insert(lines.end(), timedVertices_.begin(), timedVertices_.end());
+   if (lines.size() > MAX_VERTICES) {
+      lines.resize(MAX_VERTICES);
+   }
+
+   vertices_.clear();
+
+   // Drop expired lines, keeping the order of the rest
+   double now = glfwGetTime();
+   size_t numKept = 0;
+   for (size_t line = 0; line < timedExpiry_.size(); ++line) {
+      if (timedExpiry_[line] > now) {
+         timedExpiry_[numKept] = timedExpiry_[line];
+         timedVertices_[2 * numKept] = timedVertices_[2 * line];
+         timedVertices_[2 * numKept + 1] = timedVertices_[2 * line + 1];
+         numKept++;
+      }
+   }
+   timedExpiry_.resize(numKept);
+   timedVertices_.resize(2 * numKept);
+}
+
+void DebugDraw::upload(const std::vector<LineVertex>& lines) {
+   numUploadedVertices_ = 0;
+   if (lines.empty()) {
+      return;
+   }
+
+   if (vaoID_ == 0) {
+      init();
+   }
+
+   // Orphan and refill the buffer
+   glBindBuffer(GL_ARRAY_BUFFER, vertexBufID_);
+   glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(LineVertex), nullptr, GL_STREAM_DRAW);
+   glBufferSubData(GL_ARRAY_BUFFER, 0, lines.size() * sizeof(LineVertex), lines.data());
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   numUploadedVertices_ = lines.size();
+}
+
+void DebugDraw::draw(const glm::mat4& P, const glm::mat4& V) {
+   if (numUploadedVertices_ == 0) {
+      return;
+   }
+
+   ShaderManager& shaderManager = ShaderManager::instance();
+   if (!shaderManager.hasShaderProgram(SHADER_NAME)) {
+      return;
+   }
+
+   const std::shared_ptr<Program> shaderProgram = shaderManager.bindShader(SHADER_NAME);
+   glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P));
+   glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(V));
+
+   glBindVertexArray(vaoID_);
+   glDrawArrays(GL_LINES, 0, numUploadedVertices_);
+   glBindVertexArray(0);
+
+   shaderManager.unbindShader();
+}
+
+const char* DebugDraw::getCategoryName(Category category) {
+   switch (category) {
+   case BOUNDING_BOXES:
+      return "Bounding box";
+   case OCTREE:
+      return "Octree node";
+   case FRUSTA:
+      return "Frustum";
+   case CONTACTS:
+      return "Contact normal";
+   default:
+      return "Unknown";
+   }
+}
+
+void DebugDraw::init() {
+   glGenVertexArrays(1, &vaoID_);
+   glBindVertexArray(vaoID_);
+
+   glGenBuffers(1, &vertexBufID_);
+   glBindBuffer(GL_ARRAY_BUFFER, vertexBufID_);
+   glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(LineVertex), nullptr, GL_STREAM_DRAW);
+
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (const void *) 0);
+   glEnableVertexAttribArray(1);
+   glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (const void *) sizeof(glm::vec3));
+
+   glBindVertexArray(0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,104 @@
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/*
+ * Immediate mode debug drawing. Lines, boxes and frusta are added from anywhere during a simulation tick and
+ * collected into the frame's snapshot, which the render thread uploads into one streaming vertex buffer and draws
+ * with a single GL_LINES draw. What's drawn is picked per category at runtime, nothing is collected for disabled
+ * categories.
+ *
+ * Lines can be given a duration to outlive the frame they're added in, e.g. contacts found by a single physics
+ * step.
+ */
+class DebugDraw {
+public:
+
+   // Groups of debug lines, enabled individually
+   enum Category : unsigned int {
+      BOUNDING_BOXES = 1 << 0,
+      OCTREE = 1 << 1,
+      FRUSTA = 1 << 2,
+      CONTACTS = 1 << 3
+   };
+
+   // Program drawing the lines
+   static constexpr const char* SHADER_NAME = "debugLine";
+
+   // Maximum number of vertices drawn per frame, further lines are dropped
+   static constexpr unsigned int MAX_VERTICES = 1 << 18;
+
+   // Seconds a contact normal stays visible
+   static constexpr double CONTACT_DURATION = 0.5;
+
+   // Length of a contact normal in world units
+   static constexpr float CONTACT_NORMAL_LENGTH = 1.5f;
+
+   struct LineVertex {
+      glm::vec3 position;
+      glm::vec3 color;
+   };
+
+   static DebugDraw& instance();
+
+   ~DebugDraw();
+
+   void setEnabled(Category category, bool enabled);
+
+   bool isEnabled(Category category);
+
+   // Adds a line for the current frame, or the given number of seconds
+   void addLine(const glm::vec3& from, const glm::vec3& to, const glm::vec3& color, double duration = 0.0);
+
+   // Adds the edges of the axis aligned box
+   void addBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& color, double duration = 0.0);
+
+   // Adds the edges of the frustum of the given view projection
+   void addFrustum(const glm::mat4& viewProjection, const glm::vec3& color);
+
+   // Adds the normal of a contact at the given point, if contacts are enabled
+   void addContact(const glm::vec3& point, const glm::vec3& normal);
+
+   // Replaces the contents of |lines| with every line to draw this frame, then drops the lines of the current
+   // frame and those that expired
+   void collectFrame(std::vector<LineVertex>& lines);
+
+   // Uploads the given lines (as filled by |collectFrame|) for the following |draw| calls
+   void upload(const std::vector<LineVertex>& lines);
+
+   // Draws the uploaded lines with the given camera. May be called for several views in a frame
+   void draw(const glm::mat4& P, const glm::mat4& V);
+
+   // Returns a printable name of the category
+   static const char* getCategoryName(Category category);
+
+private:
+
+   unsigned int enabledCategories_;
+
+   // Lines of the current frame
+   std::vector<LineVertex> vertices_;
+
+   // Lines with a duration and the time each one expires at
+   std::vector<LineVertex> timedVertices_;
+   std::vector<double> timedExpiry_;
+
+   GLuint vaoID_;
+   GLuint vertexBufID_;
+
+   // Vertices uploaded by the last |upload|
+   size_t numUploadedVertices_;
+
+   DebugDraw();
+
+   // Creates the vertex buffer and array
+   void init();
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "FireHydrantPhysicsComponent.h"
 
+#include "DebugDraw.h"
 #include "GameManager.h"
 #include "GameObject.h"
 #include "AudioManager.h"
@@ -38,25 +39,6 @@ void FireHydrantPhysicsComponent::updatePhysics(float deltaTime) {
       holder_->setPosition(newPos);
    }
 
-   // All fracturing updating happens here
-   if (holder_->fracture) {
-      if (holder_->velocity == 0.0f) {
-         world.rmDynamicGameObject(holder_);
-      }
-
-      std::shared_ptr<std::vector<glm::vec3>> fractureDirections = holder_->getFragmentDirs();
-      std::shared_ptr<std::vector<glm::vec3>> fracturePositions = holder_->getFragmentPos();
-      int numFrags = fracturePositions->size();
-
-      for (int i = 0; i < numFrags; i++) {
-         glm::vec3 newFractPos = fracturePositions->at(i) + (holder_->velocity *
-            fractureDirections->at(i) * deltaTime);
-         
-         newFractPos += glm::vec3(0.0, yVelocity * deltaTime, 0.0);
-         fracturePositions->at(i) = newFractPos;
-      }
-   }
-
    std::vector<std::shared_ptr<GameObject>> objsHit = world.checkCollision(holder_);
    if (!objsHit.empty()) {
       std::shared_ptr<GameObject> objHit = objsHit[0];
@@ -75,21 +57,23 @@ void FireHydrantPhysicsComponent::updatePhysics(float deltaTime) {
          animated = true;
          animRotAxis = rotAxis;
 
-         // Initialize fracture variables if the player hits the object hard enough
-         if (objHit->velocity >= 10) {
-            holder_->fracture = true;
-            holder_->setFragmentDirs(holder_->getRenderComponent()->getShape()->calcFragmentDir(reactDir));
-         }
-
          // Play sound effect.
          AudioManager& audioManager = AudioManager::instance();
          audioManager.playEffect("FireHydrant Clank");
+
+         // Break the hydrant into debris if the player hits it hard enough
+         if (objHit->velocity >= 10) {
+            world.getDebrisSystem().spawnDebris(holder_, reactDir, holder_->velocity, yVelocity);
+            world.rmDynamicGameObject(holder_);
+            return;
+         }
       } else if (objTypeHit == GameObjectType::STATIC_OBJECT ||
                  objTypeHit == GameObjectType::DYNAMIC_OBJECT) {
          BoundingBox* objBB = objHit->getBoundingBox();
          BoundingBox* thisBB = holder_->getBoundingBox();
 
          glm::vec3 normal = objBB->calcReflNormal(*thisBB);
+         DebugDraw::instance().addContact(holder_->getPosition(), normal);
          holder_->direction = glm::reflect(holder_->direction, normal);
          animRotAxis = glm::cross(holder_->direction, glm::vec3(0, 1, 0));
 
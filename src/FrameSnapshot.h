@@ -0,0 +1,126 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "DebrisSystem.h"
+#include "DebugDraw.h"
+#include "Light.h"
+#include "MaterialManager.h"
+#include "ParticleSystem.h"
+#include "ShadowMap.h"
+#include "Shape.h"
+
+class Cubemap;
+
+// Everything needed to draw one object, copied out of it's GameObject when the snapshot is built
+struct RenderItem {
+   std::shared_ptr<Shape> shape;
+   std::shared_ptr<Material> material;
+   std::string shaderName;
+
+   // Model matrix and it's inverse transpose
+   glm::mat4 M;
+   glm::mat4 tiM;
+
+   glm::vec3 position;
+   glm::vec3 scale;
+
+   bool castsShadow;
+
+   // Whether the object lies within the area covered by the shadow map, objects outside of it can't be in shadow
+   bool receivesShadow;
+
+   // Index of the object in |FrameSnapshot::staticItems|, -1 for dynamic objects
+   int staticIndex;
+
+   // Sky texture of the skybox, |nullptr| for everything else
+   Cubemap* cubemap;
+};
+
+// Render options toggled at runtime. Every snapshot carries them, so they take effect with the frame they were
+// changed in
+struct RenderSettings {
+   bool staticShadowCaching = true;
+   ShadowMap::Filter shadowFilter = ShadowMap::Filter::PCF9;
+
+   // Draw the visible static objects with multi draw indirect (if supported)
+   bool indirectStatics = true;
+   bool depthPrePass = false;
+   bool overdrawCounter = false;
+   bool profiling = false;
+   bool profilerOverlay = false;
+
+   // Program the default shader points to, empty to keep the one the level set up
+   std::string defaultShader;
+};
+
+/*
+ * Copy of everything the renderer draws in one frame, built by the simulation at the end of a tick (see
+ * |GameWorld::buildFrameSnapshot|). Culling is already done, so the renderer only walks the lists and never
+ * touches a GameObject. Once published a snapshot isn't changed anymore until it's handed back to the simulation
+ * to be refilled (see |TripleBuffer|), the lists are cleared rather than freed so their storage is reused.
+ */
+struct FrameSnapshot {
+   RenderSettings settings;
+
+   // Size of the default framebuffer in pixels
+   int viewWidth = 0;
+   int viewHeight = 0;
+
+   // Camera
+   glm::mat4 P;
+   glm::mat4 V;
+   glm::vec3 eye;
+   glm::vec3 viewDirection;
+
+   // Far plane objects were culled at, lights only need to reach that far
+   float cullFarPlane = 0.0f;
+
+   // Light matrices of the shadow map. |shadowWindowVersion| changes whenever the area covered by the shadow map
+   // moved, which invalidates cached static shadows
+   glm::mat4 lightP;
+   glm::mat4 lightV;
+   unsigned long shadowWindowVersion = 0;
+
+   std::vector<Light> pointLights;
+   std::vector<Light> directionalLights;
+
+   // Every static object as of the last change to the static objects. Shared by all snapshots until then, so a
+   // different pointer means the static geometry changed
+   std::shared_ptr<const std::vector<RenderItem>> staticItems;
+
+   // Shadow casters inside of the light frustum, the static ones as indices into |staticItems|
+   std::vector<unsigned int> staticShadowCasters;
+   std::vector<RenderItem> dynamicShadowCasters;
+
+   // Objects inside of the view frustum that aren't occluded
+   std::vector<RenderItem> visibleItems;
+
+   // Delivery markers of the visible objects
+   std::vector<RenderItem> markerItems;
+
+   bool hasSkybox = false;
+   RenderItem skybox;
+
+   // Live particles of each type
+   std::vector<ParticleSystem::ParticleInstance> particles[ParticleSystem::NUM_PARTICLE_TYPES];
+
+   // Debris batches and the per instance data they read
+   std::vector<DebrisSystem::DrawBatch> debrisBatches;
+   std::vector<glm::vec4> debrisData;
+
+   // Lines of the enabled debug categories
+   std::vector<DebugDraw::LineVertex> debugLines;
+
+   // Top down view of the culling drawn into a corner of the window, if enabled
+   bool vfcViewport = false;
+   glm::mat4 vfcP;
+   glm::mat4 vfcV;
+};
+
+#endif
@@ -69,6 +69,8 @@ public:
     static constexpr float cullFarPlane = 100.0;
     static constexpr float camFarPlane = 300.0;
     static constexpr float nearPlane = 0.01;
+    // Vertical field of view of the camera (deg)
+    static constexpr float fieldOfView = 45.0;
 
 private:
 
@@ -1,6 +1,5 @@
-#include "BillboardPhysicsComponent.h"
-#include "BillboardRenderComponent.h"
 #include "GameObject.h"
+#include "FrameSnapshot.h"
 #include "GameManager.h"
 #include "AimRenderComponent.h"
 #include "MarkerPhysicsComponent.h"
@@ -23,7 +22,7 @@ GameObject::GameObject(GameObjectType objType,
 	type(objType),
 	toggleMovement(false),
       cookieDeliverable(deliverable),
-   fracture(false),
+	occluder(false),
 	orientAngle_(0),
 	yRotationAngle_(0),
 	render_(render),
@@ -176,20 +175,34 @@ void GameObject::update(double deltaTime) {
     }
 }
 
-void GameObject::draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V) {
-	if (render_ != NULL) {
-		render_->draw(P, M, V);
-        if(cookieDeliverable) {
-            std::shared_ptr<MatrixStack> M2 = std::make_shared<MatrixStack>();
-            arrow_->draw(P, M2, V);
-        }
+bool GameObject::getRenderItem(RenderItem& item) {
+	if (render_ == NULL || render_->getShape() == nullptr) {
+		return false;
 	}
+
+	item.shape = render_->getShape();
+	item.material = render_->getMaterial();
+	item.shaderName = render_->getShader();
+
+	item.M = transform.getTransform();
+	item.tiM = transform.getNormalMatrix();
+	item.position = position_;
+	item.scale = scale_;
+
+	item.castsShadow = render_->castsShadow();
+	item.receivesShadow = false;
+	item.staticIndex = -1;
+	item.cubemap = render_->getCubemap();
+
+	return true;
 }
 
-void GameObject::renderToShadowMap(std::shared_ptr <MatrixStack> M) {
-	if (render_ != NULL) {
-		render_->renderShadow(M);
-	}
+std::shared_ptr<GameObject> GameObject::getMarker() {
+	return cookieDeliverable ? arrow_ : nullptr;
+}
+
+bool GameObject::castsShadow() {
+	return render_ != NULL && render_->castsShadow();
 }
 
 void GameObject::performAction(double deltaTime, double totalTime) {
@@ -199,36 +212,10 @@ void GameObject::performAction(double deltaTime, double totalTime) {
 }
 
 void GameObject::spawnHitBillboardEffect(glm::vec3& positionOfHit) {
-	static bool areTexturesLoaded = false;
-	static std::shared_ptr<Texture> billboardTexture;
-
-	if (!areTexturesLoaded) {
-		billboardTexture = std::make_shared<Texture>();
-		billboardTexture->loadTexture("../resources/billboard/pow-text-stuff.jpg", "billboardTex");
-	}
-
 	GameManager& gameManager = GameManager::instance();
 	GameWorld& world = gameManager.getGameWorld();
 
-	MaterialManager& materialManager = MaterialManager::instance();
-	ShapeManager& shapeManager = ShapeManager::instance();
-	BillboardRenderComponent* billboardRenderComponent = new BillboardRenderComponent(
-		shapeManager.getShape("Cube"), "Billboard", materialManager.getMaterial("Bright Green"), billboardTexture);
-	BillboardPhysicsComponent* billboardPhysicsComponent = new BillboardPhysicsComponent();
-
-	std::shared_ptr<GameObject> billboardEffect = std::make_shared<GameObject>(GameObjectType::DYNAMIC_OBJECT,
-		positionOfHit,
-		glm::vec3(0.0f, 1.0f, 0.0f),
-		5.0f,
-		glm::vec3(1.0f),
-		nullptr,
-		billboardPhysicsComponent,
-		billboardRenderComponent,
-		nullptr
-		);
-	billboardEffect->initComponents();
-
-	world.addDynamicGameObject(billboardEffect);
+	world.getParticleSystem().spawnHitEffect(positionOfHit);
 }
 
 void GameObject::changeShader(const std::string& newShaderName) {
@@ -275,23 +262,3 @@ GameObjectType GameObject::stringToType(std::string type) {
 		return GameObjectType::STATIC_OBJECT;
 	}
 }
-
-void GameObject::setFragmentDirs(std::shared_ptr<std::vector<glm::vec3>> fragDirs) {
-   fragDirs_ = fragDirs;
-
-   // Initialize all fragments to the objects original position.
-   fragPos_ = std::make_shared<std::vector<glm::vec3>>();
-   int numFrags = fragDirs->size();
-
-   for (int i = 0; i < numFrags; i++) {
-      fragPos_->push_back(position_);
-   }
-}
-
-std::shared_ptr<std::vector<glm::vec3>> GameObject::getFragmentDirs() {
-   return fragDirs_;
-}
-
-std::shared_ptr<std::vector<glm::vec3>> GameObject::getFragmentPos() {
-   return fragPos_;
-}
@@ -17,6 +17,8 @@
 #include "ActionComponent.h"
 #include "MaterialManager.h"
 
+struct RenderItem;
+
 enum class GameObjectType { PLAYER, STATIC_OBJECT, DYNAMIC_OBJECT, FINISH_OBJECT };
 
 class GameObject : public std::enable_shared_from_this<GameObject> {
@@ -34,8 +36,8 @@ public:
 	// Can a Cookie be delivered to this object
 	bool cookieDeliverable;
 
-   // Object is being fractured
-   bool fracture;
+	// Object is large enough to hide others behind it and is used as an occluder for occlusion culling
+	bool occluder;
 
 	// Constructs a new GameObject using the given components.
 	// A NULL component will not be used
@@ -79,16 +81,20 @@ public:
 	// Performs any non-render related updates to the object
 	void update(double deltaTime);
 
-    // Performs any render/draw updates necessary for the object
-    void draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V);
+	// Fills |item| with what the renderer needs to draw the object as it is now (see |FrameSnapshot|).
+	// Returns false if the object isn't drawn
+	bool getRenderItem(RenderItem& item);
+
+	// Returns the delivery marker shown above the object, |nullptr| if it has none
+	std::shared_ptr<GameObject> getMarker();
 
-	// Renders the Object to the shadow map
-	void renderToShadowMap(std::shared_ptr<MatrixStack> M);
+	// Returns true if the object has a render component that casts a shadow
+	bool castsShadow();
 
     // Perform the any actions that are bound to the object, if any and if applicable at that moment
     void performAction(double deltaTime, double totalTime);
 
-	// Spawns a billboard effect indicating that the object was "hit" by another object
+	// Spawns a "POW" billboard and sparks (see |ParticleSystem|) indicating that the object was "hit" by another object
 	void spawnHitBillboardEffect(glm::vec3& positionOfHit);
 
 	// Changes the active shader for the object
@@ -102,16 +108,6 @@ public:
 
     static GameObjectType stringToType(std::string type);
 
-   // Sets the fragment direction vector usually from Shape.cpp this also
-   // initializes the starting position of each fragment.
-   void setFragmentDirs(std::shared_ptr<std::vector<glm::vec3>> fragDirs);
-
-   // Gets the fragment direction vector for the fractured object
-   std::shared_ptr<std::vector<glm::vec3>> getFragmentDirs();
-
-   // Gets the fragment position vector for the fractured object
-   std::shared_ptr<std::vector<glm::vec3>> getFragmentPos();
-
     // Returns the BoundingBox associated with the object if it exists, otherwise returns |NULL|
     // TRY TO AVOID USING THIS IF POSSIBLE, SHOULD BE REMOVED AT SOME POINT, BB LOGIC ONLY IN PHYSICSCOMPONENT
     BoundingBox* getBoundingBox();
@@ -148,12 +144,6 @@ private:
     // Arrow "Quest Marker" for deliverable palces
     std::shared_ptr<GameObject> arrow_;
 
-    // When an object is fractured this maintains the direction of each fragment
-    std::shared_ptr<std::vector<glm::vec3>> fragDirs_;
-
-    // The fractured objects current position.
-    std::shared_ptr<std::vector<glm::vec3>> fragPos_;
-
 };
 
 #endif
@@ -1,7 +1,9 @@
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include <algorithm>
 
 #include "CookieActionComponent.h"
+#include "DebugDraw.h"
 #include "GameManager.h"
 #include "GameWorld.h"
 #include "ViewFrustum.h"
@@ -11,7 +13,10 @@
 #include "WindowManager.h"
 
 GameWorld::GameWorld()
-	: updateCount(0),
+	: shadowFrustum_(ViewFrustum::SHADOW_CULL_CACHE),
+	shadowWindowVersion_(0),
+	occlusionCulling_(true),
+	updateCount(0),
 	renderCount(0),
 	numBunniesHit(0) {}
 
@@ -89,20 +94,19 @@ void GameWorld::clearDynamicGameObjects() {
 
 void GameWorld::clearStaticGameObjects() {
 	staticGameObjects_.clear();
+	skybox_.reset();
 	while (!staticGameObjectsToAdd_.empty()) {
 		staticGameObjectsToAdd_.pop();
 	}
 	staticGameObjectsTree_.clearTree();
+	staticIndices_.clear();
+	staticItems_.reset();
 }
 
 void GameWorld::init() {
-	updateInternalGameObjectLists();
-
-	for (std::shared_ptr<GameObject> obj : staticGameObjects_) {
-		staticGameObjectsTree_.addObject(obj);
-	}
 
-	staticGameObjectsTree_.buildTree();
+	// Builds the static object tree from the queued static objects
+	updateInternalGameObjectLists();
 }
 
 void GameWorld::updateGameObjects(double deltaTime, double totalTime) {
@@ -127,116 +131,202 @@ void GameWorld::updateGameObjects(double deltaTime, double totalTime) {
 		obj->update(deltaTime);
 	}
 
+	particleSystem_.update(deltaTime);
+	debrisSystem_.update(deltaTime);
+
+	// Debris the player runs into breaks into smaller pieces
+	std::shared_ptr<GameObject> player = GameManager::instance().getPlayer();
+	BoundingBox* playerBox = player != nullptr ? player->getBoundingBox() : NULL;
+	if (playerBox != NULL) {
+		debrisSystem_.shatter(playerBox->min_, playerBox->max_, player->direction, player->velocity);
+	}
+
 	updateInternalGameObjectLists();
 	updateCount++;
 }
 
-void GameWorld::drawGameObjects() {
+void GameWorld::buildFrameSnapshot(FrameSnapshot& snapshot) {
 	GameManager& gameManager = GameManager::instance();
+	Camera& camera = gameManager.getCamera();
+	ViewFrustum& viewFrustum = gameManager.getViewFrustum();
+	WindowManager& windowManager = WindowManager::instance();
 
-    gameManager.getShadowMap()->bindForDraw();
+	snapshot.settings = renderSettings_;
+	snapshot.viewWidth = windowManager.getViewWidth();
+	snapshot.viewHeight = windowManager.getViewHeight();
+
+	// The projection reaches further than the one objects are culled with, so that the skybox isn't clipped
+	snapshot.P = glm::perspective(GameManager::fieldOfView, windowManager.getAspectRatio(), GameManager::nearPlane,
+		GameManager::camFarPlane);
+	glm::mat4 cullP = glm::perspective(GameManager::fieldOfView, windowManager.getAspectRatio(),
+		GameManager::nearPlane, GameManager::cullFarPlane);
+	snapshot.V = glm::lookAt(camera.getEye(), camera.getTarget(), camera.getUp());
+	snapshot.eye = camera.getEye();
+	snapshot.viewDirection = camera.getLookAt();
+	snapshot.cullFarPlane = GameManager::cullFarPlane;
+
+	// Calculate view frustum planes and cull the world once for every view using them
+	viewFrustum.extractPlanes(cullP, snapshot.V);
+	findVisibleGameObjects(viewFrustum);
+
+	if (occlusionCulling_) {
+		cullOccludedGameObjects(cullP * snapshot.V);
+	}
 
-	Camera& camera = gameManager.getCamera();
-   ViewFrustum& viewFrustum = gameManager.getViewFrustum();
+	// The shadow map covers the area around the camera as seen by the first directional light
+	if (!directionalLights.empty() && shadowWindow_.update(*directionalLights.at(0), snapshot.eye,
+		snapshot.viewDirection, renderSettings_.staticShadowCaching)) {
+		shadowWindowVersion_++;
+	}
+	snapshot.lightP = shadowWindow_.getLightProjection();
+	snapshot.lightV = shadowWindow_.getLightView();
+	snapshot.shadowWindowVersion = shadowWindowVersion_;
+
+	shadowFrustum_.extractPlanes(snapshot.lightP, snapshot.lightV);
+	findShadowCasters(snapshot);
+
+	snapshot.visibleItems.clear();
+	snapshot.markerItems.clear();
+	for (std::shared_ptr<GameObject>& obj : visibleGameObjects_) {
+		RenderItem item;
+		if (getRenderItem(obj, item)) {
+			item.receivesShadow = item.castsShadow && !shadowFrustum_.cull(obj);
+			snapshot.visibleItems.push_back(item);
+		}
 
-	WindowManager& windowManager = WindowManager::instance();
+		std::shared_ptr<GameObject> marker = obj->getMarker();
+		if (marker != nullptr && marker->getRenderItem(item)) {
+			item.receivesShadow = item.castsShadow && !shadowFrustum_.cull(marker);
+			snapshot.markerItems.push_back(item);
+		}
+	}
 
-	
-	// Create the matrix stacks
-	std::shared_ptr<MatrixStack> P = std::make_shared<MatrixStack>();
-	std::shared_ptr<MatrixStack> M = std::make_shared<MatrixStack>();
-	std::shared_ptr<MatrixStack> V = std::make_shared<MatrixStack>();
-    //create another projection, identical but with closer far plane for VFC
-    std::shared_ptr<MatrixStack> cullP = std::make_shared<MatrixStack>();
-
-	// Apply perspective projection
-	P->pushMatrix();
-    cullP->pushMatrix();
-	//TODO(nurgan) check for better way of not clipping skybox instead of increasing far plane
-	//P->perspective(45.0f, windowManager.getAspectRatio(), 0.01f, 300.0f);
-    P->perspective(45.0f, windowManager.getAspectRatio(), GameManager::nearPlane, GameManager::camFarPlane);
-    cullP->perspective(45.0f, windowManager.getAspectRatio(), GameManager::nearPlane, GameManager::cullFarPlane);
-
-    // Set up view Matrix
-	V->pushMatrix();
-	V->loadIdentity();
-	V->lookAt(camera.getEye(), camera.getTarget(), camera.getUp());
-
-   // Calculate view frustum planes
-   viewFrustum.extractPlanes(cullP->topMatrix(), V->topMatrix());
-
-	// Draw non-static objects
-	for (std::shared_ptr<GameObject> obj : dynamicGameObjects_) {
-      if (!viewFrustum.cull(obj)) {
-		   obj->draw(P, M, V);
-      }
+	// The sky is centered on the camera when drawn, so only it's rotation is kept
+	snapshot.hasSkybox = skybox_ != NULL && skybox_->getRenderItem(snapshot.skybox);
+	if (snapshot.hasSkybox) {
+		snapshot.skybox.M = skybox_->transform.getRotate();
 	}
 
-	// Draw static objects
-	for (std::shared_ptr<GameObject> obj : staticGameObjects_) {
-      if (!viewFrustum.cull(obj)) {
-		   obj->draw(P, M, V);
-      }
+	snapshot.pointLights.clear();
+	for (std::shared_ptr<Light>& light : pointLights) {
+		snapshot.pointLights.push_back(*light);
+	}
+	snapshot.directionalLights.clear();
+	for (std::shared_ptr<Light>& light : directionalLights) {
+		snapshot.directionalLights.push_back(*light);
 	}
+
+	particleSystem_.collectInstances(snapshot.particles);
+	debrisSystem_.collect(snapshot.debrisBatches, snapshot.debrisData);
+
+	DebugDraw& debugDraw = DebugDraw::instance();
+	addDebugLines(debugDraw, cullP * snapshot.V);
+	debugDraw.collectFrame(snapshot.debugLines);
+
+	// Top down view of the culling around the player. This is mostly magic
+	snapshot.vfcViewport = debugDraw.isEnabled(DebugDraw::FRUSTA);
+	if (snapshot.vfcViewport) {
+		snapshot.vfcP = glm::ortho(-15.0f, 15.0f, -15.0f, 15.0f, 2.1f, 100.0f);
+		snapshot.vfcV = glm::lookAt(camera.getNoSpringEye() + glm::vec3(0, 8, 0), camera.getNoSpringEye(),
+			camera.getLookAt() - camera.getNoSpringEye());
+	}
+
 	renderCount++;
+}
+
+void GameWorld::addDebugLines(DebugDraw& debugDraw, const glm::mat4& cullViewProjection) {
+   if (debugDraw.isEnabled(DebugDraw::BOUNDING_BOXES)) {
+      for (std::shared_ptr<GameObject>& obj : visibleGameObjects_) {
+         BoundingBox* boundingBox = obj->getBoundingBox();
+         if (boundingBox) {
+            debugDraw.addBox(boundingBox->min_, boundingBox->max_, glm::vec3(1.0f, 1.0f, 0.0f));
+         }
+      }
+   }
+
+   if (debugDraw.isEnabled(DebugDraw::OCTREE)) {
+      staticGameObjectsTree_.addDebugLines(debugDraw);
+   }
 
-   #ifdef DEBUG
-   drawVFCViewport();
-   #endif
+   if (debugDraw.isEnabled(DebugDraw::FRUSTA)) {
+      debugDraw.addFrustum(cullViewProjection, glm::vec3(0.0f, 1.0f, 0.0f));
+      debugDraw.addFrustum(shadowWindow_.getLightProjection() * shadowWindow_.getLightView(),
+         glm::vec3(1.0f, 0.5f, 0.0f));
+   }
 }
 
-void GameWorld::renderShadowMap() {
+void GameWorld::findVisibleGameObjects(ViewFrustum& viewFrustum) {
+	visibleGameObjects_.clear();
 
-    GameManager::instance().getShadowMap()->bindForShadowPass();
+	// Non-static objects
+	for (std::shared_ptr<GameObject>& obj : dynamicGameObjects_) {
+		if (!viewFrustum.cull(obj)) {
+			visibleGameObjects_.push_back(obj);
+		}
+	}
+
+	// Static objects, accepted or rejected a whole octree region at a time
+	staticGameObjectsTree_.getObjectsInFrustum(viewFrustum, visibleGameObjects_);
+}
+
+void GameWorld::cullOccludedGameObjects(const glm::mat4& viewProjection) {
+	occlusionCuller_.beginFrame(viewProjection);
+
+	// Only occluders inside of the view frustum can hide anything
+	for (std::shared_ptr<GameObject>& obj : visibleGameObjects_) {
+		if (obj->occluder) {
+			occlusionCuller_.addOccluder(obj);
+		}
+	}
 
-    std::shared_ptr<MatrixStack> M = std::make_shared<MatrixStack>();
+	if (occlusionCuller_.getNumOccluderTriangles() == 0) {
+		return;
+	}
 
-    // Draw non-static objects
-    for (std::shared_ptr<GameObject> obj : dynamicGameObjects_) {
-            obj->renderToShadowMap(M);
-    }
+	occlusionCuller_.rasterizeOccluders();
 
-    // Draw static objects
-    for (std::shared_ptr<GameObject> obj : staticGameObjects_) {
-            obj->renderToShadowMap(M);
-    }
+	// Occluders are kept as testing them against their own depth is unreliable
+	visibleGameObjects_.erase(std::remove_if(visibleGameObjects_.begin(), visibleGameObjects_.end(),
+		[this](const std::shared_ptr<GameObject>& obj) { return !obj->occluder && occlusionCuller_.isOccluded(obj); }),
+		visibleGameObjects_.end());
 }
 
-// For debugging view frustum culling. This is mostly magic.
-void GameWorld::drawVFCViewport() {
-	GameManager& gameManager = GameManager::instance();
-	Camera& camera = gameManager.getCamera();
-   ViewFrustum& viewFrustum = gameManager.getViewFrustum();
-	WindowManager& windowManager = WindowManager::instance();
-	
-	// Create the matrix stacks
-	std::shared_ptr<MatrixStack> P = std::make_shared<MatrixStack>();
-	std::shared_ptr<MatrixStack> M = std::make_shared<MatrixStack>();
-	std::shared_ptr<MatrixStack> V = std::make_shared<MatrixStack>();
-
-   glClear(GL_DEPTH_BUFFER_BIT);
-   glViewport(0, 0, (windowManager.getViewHeight() / 3.0),
-      windowManager.getViewHeight() / 3.0);
-   P->pushMatrix();
-   P->ortho(-15.0f, 15.0f, -15.0f, 15.0f, 2.1f, 100.0f);
-   V->pushMatrix();
-   V->loadIdentity();
-   V->lookAt(camera.getNoSpringEye() + glm::vec3(0, 8, 0), camera.getNoSpringEye(),
-      camera.getLookAt() - camera.getNoSpringEye());
-
-	// Draw non-static objects
-	for (std::shared_ptr<GameObject> obj : dynamicGameObjects_) {
-      if (!viewFrustum.cull(obj)) {
-		   obj->draw(P, M, V);
-      }
+void GameWorld::findShadowCasters(FrameSnapshot& snapshot) {
+	snapshot.staticShadowCasters.clear();
+	snapshot.dynamicShadowCasters.clear();
+
+	// Gather static objects, whole octree regions outside of the light frustum are skipped.
+	// Objects that don't cast a shadow (e.g. billboards) are dropped
+	shadowCasters_.clear();
+	staticGameObjectsTree_.getObjectsInFrustum(shadowFrustum_, shadowCasters_);
+	for (std::shared_ptr<GameObject>& obj : shadowCasters_) {
+		std::unordered_map<GameObject*, unsigned int>::iterator found = staticIndices_.find(obj.get());
+		if (found != staticIndices_.end() && (*staticItems_)[found->second].castsShadow) {
+			snapshot.staticShadowCasters.push_back(found->second);
+		}
 	}
 
-	// Draw static objects
-	for (std::shared_ptr<GameObject> obj : staticGameObjects_) {
-      if (!viewFrustum.cull(obj)) {
-		   obj->draw(P, M, V);
-      }
+	// Gather non-static objects inside of the light frustum
+	for (std::shared_ptr<GameObject>& obj : dynamicGameObjects_) {
+		RenderItem item;
+		if (!shadowFrustum_.cull(obj) && obj->getRenderItem(item) && item.castsShadow) {
+			snapshot.dynamicShadowCasters.push_back(item);
+		}
+	}
+}
+
+bool GameWorld::getRenderItem(const std::shared_ptr<GameObject>& obj, RenderItem& item) {
+	std::unordered_map<GameObject*, unsigned int>::iterator found = staticIndices_.find(obj.get());
+	if (found == staticIndices_.end()) {
+		return obj->getRenderItem(item);
 	}
+
+	// Static objects don't move, but they may still change how they look (e.g. when hit by a cookie)
+	item = (*staticItems_)[found->second];
+	item.material = obj->getRenderComponent()->getMaterial();
+	item.shaderName = obj->getRenderComponent()->getShader();
+
+	return true;
 }
 
 std::vector<std::shared_ptr<GameObject>> GameWorld::checkCollision(std::shared_ptr<GameObject> objToCheck) {
@@ -272,6 +362,26 @@ unsigned long GameWorld::getRenderCount() {
 	return renderCount;
 }
 
+RenderSettings& GameWorld::getRenderSettings() {
+	return renderSettings_;
+}
+
+void GameWorld::setOcclusionCulling(bool enabled) {
+	occlusionCulling_ = enabled;
+}
+
+bool GameWorld::isOcclusionCulling() {
+	return occlusionCulling_;
+}
+
+ParticleSystem& GameWorld::getParticleSystem() {
+	return particleSystem_;
+}
+
+DebrisSystem& GameWorld::getDebrisSystem() {
+	return debrisSystem_;
+}
+
 // TODO(rgarmsen2295): Abstract into "bunny world" specific sub-class
 int GameWorld::getNumBunniesHit() {
 	return numBunniesHit;
@@ -321,13 +431,22 @@ void GameWorld::addBunnyToGameWorld() {
 }
 
 void GameWorld::updateInternalGameObjectLists() {
+	bool staticObjectsChanged = !staticGameObjectsToAdd_.empty() || !staticGameObjectsToRemove_.empty();
+
 	while (!dynamicGameObjectsToAdd_.empty()) {
 		dynamicGameObjects_.push_back(dynamicGameObjectsToAdd_.front());
 		dynamicGameObjectsToAdd_.pop();
 	}
 
 	while (!staticGameObjectsToAdd_.empty()) {
-		staticGameObjects_.push_back(staticGameObjectsToAdd_.front());
+		std::shared_ptr<GameObject> obj = staticGameObjectsToAdd_.front();
+
+		// The sky is drawn on it's own after everything else, it's never culled nor batched
+		if (obj->getRenderComponent() != NULL && obj->getRenderComponent()->isSkybox()) {
+			skybox_ = obj;
+		} else {
+			staticGameObjects_.push_back(obj);
+		}
 		staticGameObjectsToAdd_.pop();
 	}
 
@@ -341,9 +460,39 @@ void GameWorld::updateInternalGameObjectLists() {
 
    while (!staticGameObjectsToRemove_.empty()) {
       std::shared_ptr<GameObject> obj = staticGameObjectsToRemove_.front();
+      if (obj == skybox_) {
+         skybox_.reset();
+      }
       staticGameObjects_.erase(std::remove(staticGameObjects_.begin(),
          staticGameObjects_.end(), obj), staticGameObjects_.end());
 
       staticGameObjectsToRemove_.pop();
    }
+
+   // The renderer rebuilds it's static batch and shadow cache once it sees the new static items
+   if (staticObjectsChanged) {
+      rebuildStaticGameObjectsTree();
+   }
+}
+
+void GameWorld::rebuildStaticGameObjectsTree() {
+	for (std::shared_ptr<GameObject> obj : staticGameObjects_) {
+		staticGameObjectsTree_.addObject(obj);
+	}
+
+	staticGameObjectsTree_.buildTree();
+
+	std::shared_ptr<std::vector<RenderItem>> staticItems = std::make_shared<std::vector<RenderItem>>();
+	staticIndices_.clear();
+	for (std::shared_ptr<GameObject>& obj : staticGameObjects_) {
+		RenderItem item;
+		if (obj->getRenderItem(item)) {
+			item.staticIndex = staticItems->size();
+			staticIndices_[obj.get()] = item.staticIndex;
+			staticItems->push_back(item);
+		}
+	}
+
+	// Snapshots still in flight keep the previous items alive
+	staticItems_ = staticItems;
 }
@@ -7,6 +7,7 @@
 #include <iterator>
 #include <vector>
 #include <queue>
+#include <unordered_map>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,13 +17,16 @@
 #include "BunnyPhysicsComponent.h"
 #include "BunnyRenderComponent.h"
 #include "CookiePhysicsComponent.h"
+#include "DebrisSystem.h"
+#include "DebugDraw.h"
+#include "FrameSnapshot.h"
+#include "OcclusionCuller.h"
 #include "OctreeNode.h"
+#include "ParticleSystem.h"
 #include "PlayerInputComponent.h"
 #include "PlayerPhysicsComponent.h"
 #include "PlayerRenderComponent.h"
-
-// Forward-declare the Light struct in ShaderManager.h
-struct Light;
+#include "ShadowWindow.h"
 
 /* 
  * The holder class for anything that could be considered "in" or pertaining
@@ -89,22 +93,35 @@ public:
 	// Calls the update function on all GameObjects in the world
 	void updateGameObjects(double deltaTime, double totalTime);
 
-	// Calls the draw function on all GameObjects in the world
-	void drawGameObjects();
-
-	// Renders all GameObjects to the shadow map
-	void renderShadowMap();
+	// Culls the world from the camera's point of view and fills |snapshot| with everything the renderer needs to
+	// draw the current state of the world. Called once at the end of every tick
+	void buildFrameSnapshot(FrameSnapshot& snapshot);
 
-   // Draws a small view port to see view frustum culling
-   void drawVFCViewport();
+   // Adds the debug lines of every enabled category that belongs to the world. |cullViewProjection| is the
+   // frustum objects were culled with
+   void addDebugLines(DebugDraw& debugDraw, const glm::mat4& cullViewProjection);
 
 	// Checks to see if the passed Game Object collides with any other object in the world.
 	// Returns an array of all objects collided with
 	std::vector<std::shared_ptr<GameObject>> checkCollision(std::shared_ptr<GameObject> objToCheck);
 
-	// Returns the number of render iterations performed so far
+	// Returns the number of frame snapshots built so far
 	unsigned long getRenderCount();
 
+	// Enables or disables CPU occlusion culling of the visible objects
+	void setOcclusionCulling(bool enabled);
+
+	bool isOcclusionCulling();
+
+	// Returns the render options handed to the renderer with every snapshot
+	RenderSettings& getRenderSettings();
+
+	// Returns the pooled particles used for hit effects
+	ParticleSystem& getParticleSystem();
+
+	// Returns the pieces of broken objects
+	DebrisSystem& getDebrisSystem();
+
 	// Returns the number of currently hit bunnies by the player in the world
 	int getNumBunniesHit();
 
@@ -119,6 +136,9 @@ private:
 	// Collection of static geometry in the world - these should never move
 	std::vector<std::shared_ptr<GameObject>> staticGameObjects_;
 
+	// The sky, kept out of the static objects and drawn after all opaque objects
+	std::shared_ptr<GameObject> skybox_;
+
 	// Queue of dynamic objects added to the world but that have yet to be added to the vector
 	std::queue<std::shared_ptr<GameObject>> dynamicGameObjectsToAdd_;
 
@@ -135,6 +155,42 @@ private:
 	// If they do, the tree must be rebuilt
 	OctreeNode staticGameObjectsTree_;
 
+	// Frustum of the orthographic light projection used to cull objects from the shadow pass
+	ViewFrustum shadowFrustum_;
+
+	// Area covered by the shadow map, following the camera
+	ShadowWindow shadowWindow_;
+
+	// Incremented whenever |shadowWindow_| moves, see |FrameSnapshot::shadowWindowVersion|
+	unsigned long shadowWindowVersion_;
+
+	// Objects found inside of |shadowFrustum_| that need to be rendered into the shadow map.
+	// Kept as a member so that it's storage is reused between frames
+	std::vector<std::shared_ptr<GameObject>> shadowCasters_;
+
+	// Objects found inside of the camera's view frustum this frame, shared by the main pass and debug views
+	std::vector<std::shared_ptr<GameObject>> visibleGameObjects_;
+
+	// Removes objects hidden behind occluders from |visibleGameObjects_|
+	OcclusionCuller occlusionCuller_;
+
+	bool occlusionCulling_;
+
+	// Render items of all static objects, rebuilt with |staticGameObjectsTree_| and shared by every snapshot
+	// until then
+	std::shared_ptr<const std::vector<RenderItem>> staticItems_;
+
+	// Index of each static object in |staticItems_|
+	std::unordered_map<GameObject*, unsigned int> staticIndices_;
+
+	RenderSettings renderSettings_;
+
+	// Hit effects, simulated with the objects and drawn after them
+	ParticleSystem particleSystem_;
+
+	// Pieces of broken objects, simulated with the objects
+	DebrisSystem debrisSystem_;
+
 	// List of the lights currently in the world
 	std::vector<std::shared_ptr<Light>> pointLights;
 
@@ -147,7 +203,7 @@ private:
 	// Number of update iterations
 	unsigned long updateCount;
 
-	// Number of render iterations
+	// Number of frame snapshots built
 	unsigned long renderCount;
 
 	// Number of "hit" bunnies
@@ -159,6 +215,22 @@ private:
 	// Updates the GameObject lists from the incoming object queues
 	void updateInternalGameObjectLists();
 
+	// Rebuilds |staticGameObjectsTree_| from the current list of static objects
+	void rebuildStaticGameObjectsTree();
+
+	// Fills |visibleGameObjects_| with the objects inside of the given view frustum
+	void findVisibleGameObjects(ViewFrustum& viewFrustum);
+
+	// Rasterizes the visible occluders and removes every object they hide from |visibleGameObjects_|
+	void cullOccludedGameObjects(const glm::mat4& viewProjection);
+
+	// Fills the shadow casters of |snapshot| with the objects inside of the light frustum
+	void findShadowCasters(FrameSnapshot& snapshot);
+
+	// Fills |item| with the render item of the object, from |staticItems_| if it's static. Returns false if the
+	// object isn't drawn
+	bool getRenderItem(const std::shared_ptr<GameObject>& obj, RenderItem& item);
+
 };
 
 #endif
@@ -7,7 +7,13 @@
 #include <iostream>
 
 Image::Image(std::string path) {
-    imageData = stbi_load( path.c_str() , &width, &height, &components, STBI_rgb);
+    int fileComponents = 0;
+    width = height = 0;
+    stbi_info(path.c_str(), &width, &height, &fileComponents);
+
+    // keep alpha if the file has it, |components| always describes the returned data
+    components = (fileComponents == 2 || fileComponents == 4) ? STBI_rgb_alpha : STBI_rgb;
+    imageData = stbi_load( path.c_str() , &width, &height, &fileComponents, components);
 }
 
 Image::~Image() {
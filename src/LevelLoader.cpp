@@ -14,7 +14,10 @@
 #include "ShaderManager.h"
 #include "ShapeManager.h"
 #include "MaterialManager.h"
+#include "TextureManager.h"
 #include "AudioManager.h"
+#include "DebugDraw.h"
+#include "RenderProfiler.h"
 
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
@@ -33,9 +36,9 @@ LevelLoader::~LevelLoader() {}
 
 /* Open for reading only for now, if we want to save gamestate we can at
    some point. Possible saveLevel() member function? */
-int LevelLoader::loadLevel(GameWorld &world, std::shared_ptr<GameObject> &player) {
-   std::ifstream level_file("../levels/grandmas-awakening.json",
-      std::ifstream::in);
+int LevelLoader::loadLevel(GameWorld &world, std::shared_ptr<GameObject> &player,
+   const std::string &levelPath) {
+   std::ifstream level_file(levelPath, std::ifstream::in);
    int res = 0;
 
    if (!level_file) {
@@ -101,6 +104,10 @@ int LevelLoader::parseShaders(json shaders) {
    if (shaders != nullptr) {
       ShaderManager& shaderManager = ShaderManager::instance();
 
+      // The driver may still be compiling the programs in the background until they're all created
+      std::vector<std::string> shaderNames;
+      std::string defaultShaderName;
+
       for (json shader : shaders) {
          std::string shaderName = shader["name"];
 
@@ -109,7 +116,22 @@ int LevelLoader::parseShaders(json shaders) {
             return 1;
          }
          if (shader["default"]) {
-             shaderManager.setDefaultShader(shaderName);
+             defaultShaderName = shaderName;
+         }
+         shaderNames.push_back(shaderName);
+
+         // The static batch falls back to regular draws for shaders without an indirect variant
+         if (shader["indirect"] != nullptr && shader["indirect"] && ShaderManager::isIndirectDrawingSupported()) {
+            if (shaderManager.createIndirectShader(resourceManager, shaderName, shader["file-prefix"]) == 0) {
+               std::cerr << "Warning - Could not create indirect variant of " << shaderName << std::endl;
+            }
+         }
+
+         // Debris of objects using shaders without a debris variant is drawn with the default shader's
+         if (shader["debris"] != nullptr && shader["debris"]) {
+            if (shaderManager.createDebrisShader(resourceManager, shaderName) == 0) {
+               std::cerr << "Warning - Could not create debris variant of " << shaderName << std::endl;
+            }
          }
       }
       // load shadow pass shader
@@ -117,6 +139,39 @@ int LevelLoader::parseShaders(json shaders) {
                                                ShaderManager::shadowPassShaderName) == 0) {
          return 1;
       }
+      shaderNames.push_back(ShaderManager::shadowPassShaderName);
+
+      // load the EVSM moments passes
+      for (const char* shaderName : {ShaderManager::shadowMomentsShaderName, ShaderManager::shadowBlurShaderName}) {
+         if (shaderManager.createFullscreenShader(resourceManager, shaderName) == 0) {
+            return 1;
+         }
+         shaderNames.push_back(shaderName);
+      }
+
+      // The profiler simply doesn't draw it's overlay without it
+      if (shaderManager.createIsomorphicShader(resourceManager, RenderProfiler::OVERLAY_SHADER_NAME,
+                                               RenderProfiler::OVERLAY_SHADER_NAME) == 0) {
+         std::cerr << "Warning - Could not create the profiler overlay shader" << std::endl;
+      }
+
+      // Debug lines are skipped without it
+      if (shaderManager.createIsomorphicShader(resourceManager, DebugDraw::SHADER_NAME,
+                                               DebugDraw::SHADER_NAME) == 0) {
+         std::cerr << "Warning - Could not create the debug line shader" << std::endl;
+      }
+
+      // Only the shaders themselves are required, their indirect and debris variants may fail
+      shaderManager.finishShaderPrograms();
+      for (const std::string& shaderName : shaderNames) {
+         if (!shaderManager.hasShaderProgram(shaderName)) {
+            return 1;
+         }
+      }
+
+      if (!defaultShaderName.empty()) {
+         shaderManager.setDefaultShader(defaultShaderName);
+      }
    }
 
    return 0;
@@ -128,16 +183,25 @@ int LevelLoader::parseShapes(json shapes) {
    if (shapes != nullptr) {
       ShapeManager& shapeManager = ShapeManager::instance();
 
+      std::vector<std::string> names;
+      std::vector<std::string> filenames;
       for (json shape : shapes) {
-         if (shapeManager.createShape(resourceManager, shape["name"],
-             shape["filename"])) {
-            return 1;
-         }
+         names.push_back(shape["name"]);
+         filenames.push_back(shape["filename"]);
       }
 
-      if (shapeManager.createShape(resourceManager, "Arrow", "arrow.obj")) {
-          return 1;
+      names.push_back("Arrow");
+      filenames.push_back("arrow.obj");
+
+      // The meshes are processed in parallel, textures keep loading in the background after this returns
+      if (shapeManager.createShapes(resourceManager, names, filenames)) {
+         return 1;
       }
+
+#ifdef DEBUG
+      resourceManager.printShapeMemoryReport();
+      TextureManager::instance().printResidencyReport();
+#endif
    }
 
    return 0;
@@ -228,7 +292,9 @@ int LevelLoader::parseLights(GameWorld &world, json lightObjs) {
             glm::vec3(lightObj["pos"]["x"], lightObj["pos"]["y"], lightObj["pos"]["z"]),
             glm::vec3(lightObj["color"]["r"], lightObj["color"]["g"], lightObj["color"]["b"]),
             glm::vec3(lightObj["orientation"]["x"], lightObj["orientation"]["y"], lightObj["orientation"]["z"]),
-            ShaderManager::stringToLightType(lightObj["light-type"])
+            ShaderManager::stringToLightType(lightObj["light-type"]),
+            lightObj["radius"] != nullptr ? lightObj["radius"].get<float>()
+               : ClusteredLighting::DEFAULT_POINT_LIGHT_RADIUS
          };
 
          world.addLight(light);
@@ -282,6 +348,10 @@ std::shared_ptr<GameObject> LevelLoader::createGameObject(json obj,
       obj["deliverable"]
    );
 
+   if (obj["occluder"] != nullptr) {
+      gameObj->occluder = obj["occluder"];
+   }
+
    return gameObj;
 }
 
@@ -15,7 +15,8 @@ public:
    ~LevelLoader();
 
    // Loads a level and populates reference of GameWorld, returns 0 on success
-   int loadLevel(GameWorld &world, std::shared_ptr<GameObject> &player);
+   int loadLevel(GameWorld &world, std::shared_ptr<GameObject> &player,
+      const std::string &levelPath = "../levels/grandmas-awakening.json");
 private:
    LevelLoader();
 
@@ -0,0 +1,25 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include "glm/glm.hpp"
+
+enum class LightType { POINT, DIRECTIONAL, AREA };
+
+/**
+ * Data structure that represents a prescence of light
+ *
+ * position 	- Represents the position of the light
+ * color 		- Represents the color of the light
+ * orientation  - Represents the orientation of the light
+ * Type 		- The type of light represented
+ * radius 		- Distance at which a point light's contribution reaches zero
+ */
+typedef struct Light {
+	glm::vec3 position;
+	glm::vec3 color;
+	glm::vec3 orientation;
+	LightType type;
+	float radius;
+} Light;
+
+#endif
@@ -1,73 +1,83 @@
 
 #include "MatrixStack.h"
+
+#include <cassert>
+#include <cstdio>
+
 #include <glm/gtc/matrix_transform.hpp>
 
-MatrixStack::MatrixStack() {
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATRIX_STACK_SSE
+#include <xmmintrin.h>
+#endif
 
-   mstack = std::make_shared< std::stack<glm::mat4> >();
-   mstack->push(glm::mat4(1.0));
+MatrixStack::MatrixStack()
+   : top_(0)
+{
+   matrices_[0] = glm::mat4(1.0);
+   affine_[0] = true;
 }
 
-MatrixStack::~MatrixStack() { }
+MatrixStack::MatrixStack(const glm::mat4 &matrix)
+   : top_(0)
+{
+   matrices_[0] = matrix;
+   affine_[0] = isAffine(matrix);
+}
 
 void MatrixStack::pushMatrix()
 {
-	const glm::mat4 &top = mstack->top();
-   mstack->push(top);
-   assert(mstack->size() < 100);
+   assert(top_ + 1 < MAX_DEPTH);
+   matrices_[top_ + 1] = matrices_[top_];
+   affine_[top_ + 1] = affine_[top_];
+   top_++;
 }
 
 void MatrixStack::popMatrix()
 {
-   assert(!mstack->empty());
-   mstack->pop();
    // There should always be one matrix left.
-   assert(!mstack->empty());
+   assert(top_ > 0);
+   top_--;
 }
 
 void MatrixStack::loadIdentity()
 {
-   glm::mat4 &top = mstack->top();
-   top = glm::mat4(1.0);
+   matrices_[top_] = glm::mat4(1.0);
+   affine_[top_] = true;
 }
 
 void MatrixStack::translate(const glm::vec3 &offset)
 {
-   glm::mat4 &top = mstack->top();
-	glm::mat4 t = glm::translate(glm::mat4(1.0), offset);
-	top *= t;
+   // Only the last column changes: M * T = [c0 c1 c2 c0 * x + c1 * y + c2 * z + c3]
+   glm::mat4 &top = matrices_[top_];
+   top[3] = top[0] * offset.x + top[1] * offset.y + top[2] * offset.z + top[3];
 }
 
 void MatrixStack::scale(const glm::vec3 &scaleV)
 {
-   glm::mat4 &top = mstack->top();
-	glm::mat4 s = glm::scale(glm::mat4(1.0), scaleV);
-	top *= s;
+   glm::mat4 &top = matrices_[top_];
+   top[0] *= scaleV.x;
+   top[1] *= scaleV.y;
+   top[2] *= scaleV.z;
 }
 
 void MatrixStack::scale(float size)
 {
-   glm::mat4 &top = mstack->top();
-	glm::mat4 s = glm::scale(glm::mat4(1.0), glm::vec3(size));
-	top *= s;
+   scale(glm::vec3(size));
 }
 
 void MatrixStack::rotate(float angle, const glm::vec3 &axis)
 {
-   glm::mat4 &top = mstack->top();
-	glm::mat4 r = glm::rotate(glm::mat4(1.0), angle, axis);
-	top *= r;
+   multTop(glm::rotate(glm::mat4(1.0), angle, axis), true);
 }
 
-void MatrixStack::rotateMat4(glm::mat4 &rotMat) {
-   glm::mat4 &top = mstack->top();
-   top *= rotMat;
+void MatrixStack::rotateMat4(const glm::mat4 &rotMat) {
+   multTop(rotMat, isAffine(rotMat));
 }
 
 void MatrixStack::multMatrix(const glm::mat4 &matrix)
 {
-   glm::mat4 &top = mstack->top();
-	top *= matrix;
+   multTop(matrix, isAffine(matrix));
 }
 
 void MatrixStack::ortho(float left, float right, float bottom, float top, float zNear, float zFar)
@@ -75,31 +85,126 @@ void MatrixStack::ortho(float left, float right, float bottom, float top, float
    assert(left != right);
    assert(bottom != top);
    assert(zFar != zNear);
-   glm::mat4 &ctm = mstack->top();
-   ctm *= glm::ortho(left, right, bottom, top, zNear, zFar);
+   multTop(glm::ortho(left, right, bottom, top, zNear, zFar), true);
+}
+
+void MatrixStack::ortho2D(float left, float right, float bottom, float top)
+{
+   multTop(glm::ortho(left, right, bottom, top), true);
 }
 
 void MatrixStack::frustum(float left, float right, float bottom, float top, float zNear, float zFar)
 {
-   glm::mat4 &ctm = mstack->top();
-	ctm *= glm::frustum(left, right, bottom, top, zNear, zFar);
+   multTop(glm::frustum(left, right, bottom, top, zNear, zFar), false);
 }
 
 void MatrixStack::lookAt(glm::vec3 eye, glm::vec3 target, glm::vec3 up)
 {
-   glm::mat4 &top = mstack->top();
-	top *= glm::lookAt(eye, target, up);
+   multTop(glm::lookAt(eye, target, up), true);
 }
 
 void MatrixStack::perspective(float fovy, float aspect, float zNear, float zFar)
 {
-   glm::mat4 &top = mstack->top();
-	top *= glm::perspective(fovy, aspect, zNear, zFar);
+   multTop(glm::perspective(fovy, aspect, zNear, zFar), false);
+}
+
+const glm::mat4 &MatrixStack::topMatrix() const
+{
+   return matrices_[top_];
+}
+
+bool MatrixStack::isTopAffine() const
+{
+   return affine_[top_];
+}
+
+int MatrixStack::getDepth() const
+{
+   return top_ + 1;
+}
+
+void MatrixStack::multTop(const glm::mat4 &matrix, bool affine)
+{
+   glm::mat4 &top = matrices_[top_];
+   if (affine_[top_] && affine) {
+      multiplyAffine(top, matrix, top);
+   } else {
+      multiply(top, matrix, top);
+      affine_[top_] = false;
+   }
+}
+
+void MatrixStack::multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+#ifdef MATRIX_STACK_SSE
+   // Column j of the product is a's columns weighted by column j of b
+   const float *bElements = &b[0][0];
+   __m128 a0 = _mm_loadu_ps(&a[0][0]);
+   __m128 a1 = _mm_loadu_ps(&a[1][0]);
+   __m128 a2 = _mm_loadu_ps(&a[2][0]);
+   __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+   __m128 columns[4];
+   for (int j = 0; j < 4; ++j) {
+      const float *bColumn = bElements + 4 * j;
+      __m128 column = _mm_mul_ps(a0, _mm_set1_ps(bColumn[0]));
+      column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(bColumn[1])));
+      column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(bColumn[2])));
+      column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(bColumn[3])));
+      columns[j] = column;
+   }
+
+   // Stored last, since |out| may be one of the inputs
+   float *outElements = &out[0][0];
+   for (int j = 0; j < 4; ++j) {
+      _mm_storeu_ps(outElements + 4 * j, columns[j]);
+   }
+#else
+   out = a * b;
+#endif
+}
+
+void MatrixStack::multiplyAffine(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+   // With 0 0 0 1 as the bottom row of both, b's bottom row only adds a's translation to the last column and the
+   // product's bottom row stays 0 0 0 1
+#ifdef MATRIX_STACK_SSE
+   const float *bElements = &b[0][0];
+   __m128 a0 = _mm_loadu_ps(&a[0][0]);
+   __m128 a1 = _mm_loadu_ps(&a[1][0]);
+   __m128 a2 = _mm_loadu_ps(&a[2][0]);
+   __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+   __m128 columns[4];
+   for (int j = 0; j < 4; ++j) {
+      const float *bColumn = bElements + 4 * j;
+      __m128 column = _mm_mul_ps(a0, _mm_set1_ps(bColumn[0]));
+      column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(bColumn[1])));
+      column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(bColumn[2])));
+      columns[j] = column;
+   }
+   columns[3] = _mm_add_ps(columns[3], a3);
+
+   float *outElements = &out[0][0];
+   for (int j = 0; j < 4; ++j) {
+      _mm_storeu_ps(outElements + 4 * j, columns[j]);
+   }
+#else
+   glm::mat4 product;
+   for (int j = 0; j < 4; ++j) {
+      for (int i = 0; i < 3; ++i) {
+         product[j][i] = a[0][i] * b[j][0] + a[1][i] * b[j][1] + a[2][i] * b[j][2];
+      }
+      product[j][3] = 0.0f;
+   }
+   product[3] += glm::vec4(glm::vec3(a[3]), 1.0f);
+   out = product;
+#endif
 }
 
-const glm::mat4 &MatrixStack::topMatrix()
+bool MatrixStack::isAffine(const glm::mat4 &matrix)
 {
-	return mstack->top();
+   return matrix[0][3] == 0.0f && matrix[1][3] == 0.0f && matrix[2][3] == 0.0f && matrix[3][3] == 1.0f;
 }
 
 void MatrixStack::print(const glm::mat4 &mat, const char *name) const
@@ -121,6 +226,5 @@ void MatrixStack::print(const glm::mat4 &mat, const char *name) const
 
 void MatrixStack::print(const char *name) const
 {
-   print(mstack->top(), name);
+   print(matrices_[top_], name);
 }
-
@@ -1,38 +1,39 @@
 #ifndef MATRIX_STACK_H
 #define MATRIX_STACK_H
 
-#include <stack>
-#include <memory>
-
 #include "glm/glm.hpp"
 #include "glm/vec4.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
-//#include "vector_angle.hpp"
-//#include "component_wise.hpp"
-
-//#include "matrix_access.hpp"
-//#include "matrix_integer.hpp"
-//#include "matrix_inverse.hpp"
 
+/*
+ * Stack of 4x4 matrices in the style of the fixed function GL matrix stack. The matrices are stored inline with a
+ * fixed capacity, so a stack is a plain value: create it where it's used and pass it on by reference.
+ *
+ * Products are computed with SSE where available. The stack also tracks whether each matrix is affine (bottom row
+ * 0 0 0 1, true for everything but projections), products of affine matrices only need the upper 3x4 part.
+ */
 class MatrixStack {
+public:
 
-	std::shared_ptr<std::stack<glm::mat4>> mstack;
+   // Maximum number of matrices on the stack
+   static constexpr int MAX_DEPTH = 32;
 
-public:
+   // Starts with a single identity matrix
+   MatrixStack();
 
-   MatrixStack();   
-	virtual ~MatrixStack();
+   // Starts with a single copy of the given matrix
+   explicit MatrixStack(const glm::mat4 &matrix);
 
    // Copies the current matrix and adds it to the top of the stack
-   void pushMatrix();   
+   void pushMatrix();
    // Removes the top of the stack and sets the current matrix to be the matrix that is now on top
-	void popMatrix();
+   void popMatrix();
    //  Sets the top matrix to be the identity
    void loadIdentity();
-   // glMultMatrix(): Right multiplies the top matrix   
-	void multMatrix(const glm::mat4 &matrix);
-  
+   // glMultMatrix(): Right multiplies the top matrix
+   void multMatrix(const glm::mat4 &matrix);
+
    // Right multiplies the top matrix by a translation matrix
    void translate(const glm::vec3 &offset);
    // Right multiplies the top matrix by a scaling matrix
@@ -42,10 +43,16 @@ public:
    // Right multiplies the top matrix by a rotation matrix (angle in deg)
    void rotate(float angle, const glm::vec3 &axis);
    // Same as rotate but takes the matrix already
-   void rotateMat4(glm::mat4 &rotMat);
+   void rotateMat4(const glm::mat4 &rotMat);
 
    // Gets the top matrix
-   const glm::mat4 &topMatrix();
+   const glm::mat4 &topMatrix() const;
+
+   // Returns true if the top matrix is affine, i.e. nothing projective was multiplied onto it
+   bool isTopAffine() const;
+
+   // Returns the number of matrices on the stack
+   int getDepth() const;
 
    // Sets the top matrix to be an orthogonal projection matrix
    void ortho(float left, float right, float bottom, float top, float zNear, float zFar);
@@ -62,6 +69,28 @@ public:
    void print(const glm::mat4 &mat, const char *name = 0) const;
    // Prints out the top matrix
    void print(const char *name = 0) const;
+
+   // Sets |out| to a * b. |out| may be either of the inputs
+   static void multiply(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out);
+
+   // Sets |out| to a * b for affine a and b, only the upper 3x4 part is computed. |out| may be either of the inputs
+   static void multiplyAffine(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out);
+
+   // Returns true if the bottom row of the matrix is 0 0 0 1
+   static bool isAffine(const glm::mat4 &matrix);
+
+private:
+
+   glm::mat4 matrices_[MAX_DEPTH];
+
+   // Whether each matrix on the stack is affine
+   bool affine_[MAX_DEPTH];
+
+   // Index of the top matrix
+   int top_;
+
+   // Right multiplies the top matrix, taking the affine path if both matrices are affine
+   void multTop(const glm::mat4 &matrix, bool affine);
 };
 
 #endif
@@ -0,0 +1,175 @@
+#include "MatrixStackBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stack>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MatrixStack.h"
+
+namespace {
+
+// The MatrixStack as it was before it stored it's matrices inline, kept to compare against
+class HeapMatrixStack {
+public:
+
+   HeapMatrixStack()
+      : mstack(std::make_shared<std::stack<glm::mat4>>()) {
+      mstack->push(glm::mat4(1.0));
+   }
+
+   void pushMatrix() {
+      const glm::mat4 &top = mstack->top();
+      mstack->push(top);
+   }
+
+   void popMatrix() {
+      mstack->pop();
+   }
+
+   void loadIdentity() {
+      mstack->top() = glm::mat4(1.0);
+   }
+
+   void translate(const glm::vec3 &offset) {
+      mstack->top() *= glm::translate(glm::mat4(1.0), offset);
+   }
+
+   void scale(const glm::vec3 &scaleV) {
+      mstack->top() *= glm::scale(glm::mat4(1.0), scaleV);
+   }
+
+   void rotateMat4(const glm::mat4 &rotMat) {
+      mstack->top() *= rotMat;
+   }
+
+   const glm::mat4 &topMatrix() {
+      return mstack->top();
+   }
+
+private:
+
+   std::shared_ptr<std::stack<glm::mat4>> mstack;
+};
+
+// Transform of one benchmarked object
+struct ObjectTransform {
+   glm::vec3 position;
+   glm::vec3 scale;
+   glm::mat4 rotation;
+};
+
+// Returns the time since |start| in nanoseconds per object
+double getNanosecondsPerObject(std::chrono::steady_clock::time_point start) {
+   std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+   return elapsed.count() / matrixStackBenchmarkObjects;
+}
+
+// Sums an element of every matrix so the work can't be optimized away
+float checksum(const glm::mat4 &matrix) {
+   return matrix[3][0] + matrix[0][0];
+}
+
+}
+
+void runMatrixStackBenchmark(std::ostream& out) {
+   // Deterministic transforms, distinct enough that no two products are the same
+   std::vector<ObjectTransform> transforms(1024);
+   for (size_t i = 0; i < transforms.size(); ++i) {
+      float t = static_cast<float>(i);
+      transforms[i].position = glm::vec3(std::sin(t) * 50.0f, std::cos(t * 0.5f), std::sin(t * 0.25f) * 50.0f);
+      transforms[i].scale = glm::vec3(1.0f + 0.001f * t);
+      transforms[i].rotation = glm::rotate(glm::mat4(1.0), t * 0.1f, glm::normalize(glm::vec3(1.0f, t, 0.5f)));
+   }
+   size_t mask = transforms.size() - 1;
+
+   // Per object stacks, as every draw used to create them
+   float heapSum = 0.0f;
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for (int i = 0; i < matrixStackBenchmarkObjects; ++i) {
+      const ObjectTransform &transform = transforms[i & mask];
+      std::shared_ptr<HeapMatrixStack> M = std::make_shared<HeapMatrixStack>();
+      M->pushMatrix();
+      M->loadIdentity();
+      M->translate(transform.position);
+      M->scale(transform.scale);
+      M->rotateMat4(transform.rotation);
+      heapSum += checksum(M->topMatrix());
+      M->popMatrix();
+   }
+   double heapTime = getNanosecondsPerObject(start);
+
+   float inlineSum = 0.0f;
+   start = std::chrono::steady_clock::now();
+   for (int i = 0; i < matrixStackBenchmarkObjects; ++i) {
+      const ObjectTransform &transform = transforms[i & mask];
+      MatrixStack M;
+      M.pushMatrix();
+      M.loadIdentity();
+      M.translate(transform.position);
+      M.scale(transform.scale);
+      M.rotateMat4(transform.rotation);
+      inlineSum += checksum(M.topMatrix());
+      M.popMatrix();
+   }
+   double inlineTime = getNanosecondsPerObject(start);
+
+   // Products on their own, chained so that each depends on the last
+   glm::mat4 product(1.0f);
+   start = std::chrono::steady_clock::now();
+   for (int i = 0; i < matrixStackBenchmarkObjects; ++i) {
+      product = product * transforms[i & mask].rotation;
+   }
+   double glmMultiplyTime = getNanosecondsPerObject(start);
+   float glmSum = checksum(product);
+
+   product = glm::mat4(1.0f);
+   start = std::chrono::steady_clock::now();
+   for (int i = 0; i < matrixStackBenchmarkObjects; ++i) {
+      MatrixStack::multiply(product, transforms[i & mask].rotation, product);
+   }
+   double multiplyTime = getNanosecondsPerObject(start);
+   float multiplySum = checksum(product);
+
+   product = glm::mat4(1.0f);
+   start = std::chrono::steady_clock::now();
+   for (int i = 0; i < matrixStackBenchmarkObjects; ++i) {
+      MatrixStack::multiplyAffine(product, transforms[i & mask].rotation, product);
+   }
+   double affineTime = getNanosecondsPerObject(start);
+   float affineSum = checksum(product);
+
+   // Both stacks have to build the same matrices
+   float maxDifference = 0.0f;
+   for (const ObjectTransform &transform : transforms) {
+      HeapMatrixStack heap;
+      heap.translate(transform.position);
+      heap.scale(transform.scale);
+      heap.rotateMat4(transform.rotation);
+
+      MatrixStack inlineStack;
+      inlineStack.translate(transform.position);
+      inlineStack.scale(transform.scale);
+      inlineStack.rotateMat4(transform.rotation);
+
+      for (int column = 0; column < 4; ++column) {
+         for (int row = 0; row < 4; ++row) {
+            maxDifference = std::max(maxDifference,
+               std::abs(heap.topMatrix()[column][row] - inlineStack.topMatrix()[column][row]));
+         }
+      }
+   }
+
+   out << "Model matrix, heap stack: " << heapTime << " ns, inline stack: " << inlineTime << " ns ("
+      << heapTime / inlineTime << "x)" << std::endl;
+   out << "mat4 product, glm: " << glmMultiplyTime << " ns, MatrixStack: " << multiplyTime << " ns, affine: "
+      << affineTime << " ns" << std::endl;
+   out << "Largest difference between the stacks: " << maxDifference << std::endl;
+
+   // Printed so that none of the loops can be left out
+   out << "Checksum: " << heapSum + inlineSum + glmSum + multiplySum + affineSum << std::endl;
+}
@@ -0,0 +1,14 @@
+#ifndef MATRIX_STACK_BENCHMARK_H
+#define MATRIX_STACK_BENCHMARK_H
+
+#include <ostream>
+
+// Number of object transforms built per run of the benchmark
+constexpr int matrixStackBenchmarkObjects = 1000000;
+
+// Times building model matrices the way objects used to be drawn, once with the previous heap allocated
+// std::stack based MatrixStack and once with the current one, plus the full and affine products on their own.
+// Prints the time per object of each and the largest difference between the matrices the two stacks built
+void runMatrixStackBenchmark(std::ostream& out);
+
+#endif
@@ -6,53 +6,81 @@
 
 MatrixTransform::MatrixTransform() :
 
-   transform_(glm::mat4(1.0)),
-   translate_(glm::mat4(1.0)),
-   scale_(glm::mat4(1.0)),
-   rotate_(glm::mat4(1.0)) {
+   translation_(0.0f),
+   scale_(1.0f),
+   rotation_(1.0f, 0.0f, 0.0f, 0.0f),
+   dirty_(true) {
 }
 
 MatrixTransform::~MatrixTransform() {
 
 }
 
-glm::mat4& MatrixTransform::getBoundingBoxTransform() { 
-   return boundingBoxTransform_; 
+const glm::mat4& MatrixTransform::getBoundingBoxTransform() {
+   updateTransform();
+   return boundingBoxTransform_;
 }
 
-glm::mat4& MatrixTransform::getTransform() {
+const glm::mat4& MatrixTransform::getTransform() {
+   updateTransform();
    return transform_;
 }
 
-glm::mat4 MatrixTransform::getRotate() {
-   return rotate_;
+const glm::mat4& MatrixTransform::getNormalMatrix() {
+   updateTransform();
+   return normalMatrix_;
 }
 
-void MatrixTransform::setTranslation(glm::vec3& offset) {
-   translate_ = glm::translate(glm::mat4(1.0), offset);
-
+const glm::mat4& MatrixTransform::getRotate() {
    updateTransform();
+   return rotate_;
 }
 
-void MatrixTransform::setScale(glm::vec3& scaleV) {
-   scale_ = glm::scale(glm::mat4(1.0), scaleV);
+void MatrixTransform::setTranslation(const glm::vec3& offset) {
+   translation_ = offset;
+   dirty_ = true;
+}
 
-   updateTransform();
+void MatrixTransform::setScale(const glm::vec3& scaleV) {
+   scale_ = scaleV;
+   dirty_ = true;
 }
 
 void MatrixTransform::setRotate(float angle, const glm::vec3& axis) {
-   rotate_ = glm::rotate(glm::mat4(1.0), angle, axis);
-
-   updateTransform();
+   rotation_ = glm::angleAxis(angle, glm::normalize(axis));
+   dirty_ = true;
 }
 
 void MatrixTransform::addRotation(float angle, const glm::vec3& axis) {
-   rotate_ *= glm::rotate(glm::mat4(1.0), angle, axis);
-
-   updateTransform();
+   // Renormalized so that rounding errors don't add up over many small rotations
+   rotation_ = glm::normalize(rotation_ * glm::angleAxis(angle, glm::normalize(axis)));
+   dirty_ = true;
 }
 
 void MatrixTransform::updateTransform() {
-   boundingBoxTransform_ = translate_ * scale_;
-   transform_ = translate_ * rotate_ * scale_;
+   if (!dirty_) {
+      return;
+   }
+
+   rotate_ = glm::mat4_cast(rotation_);
+
+   boundingBoxTransform_ = glm::mat4(1.0f);
+   transform_ = glm::mat4(1.0f);
+   normalMatrix_ = glm::mat4(1.0f);
+
+   // Scaling after the rotation scales the rows of the rotation. The inverse transpose of scale * rotate is
+   // (scale * rotate)^-T = scale^-1 * rotate, since the rotation is orthonormal and the scale diagonal
+   glm::vec3 inverseScale = 1.0f / scale_;
+   for (int column = 0; column < 3; ++column) {
+      glm::vec3 axis = glm::vec3(rotate_[column]);
+
+      boundingBoxTransform_[column][column] = scale_[column];
+      transform_[column] = glm::vec4(axis * scale_, 0.0f);
+      normalMatrix_[column] = glm::vec4(axis * inverseScale, 0.0f);
+   }
+
+   boundingBoxTransform_[3] = glm::vec4(translation_, 1.0f);
+   transform_[3] = glm::vec4(translation_, 1.0f);
+
+   dirty_ = false;
 }
@@ -3,36 +3,56 @@
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-
+#include <glm/gtc/quaternion.hpp>
+
+/*
+ * Translation, scale and rotation (as a quaternion) of an object. Setting them only marks the matrices as out of
+ * date, they're composed the next time one is asked for, so an object moved several times in a tick still only
+ * builds it's matrices once per frame.
+ *
+ * Objects are scaled along the world axes after being rotated, so the world matrix is translate * scale * rotate.
+ */
 class MatrixTransform {
 public:
 
-	MatrixTransform(); 
+	MatrixTransform();
 
 	~MatrixTransform();
 
-	glm::mat4& getBoundingBoxTransform();
+	// Returns translate * scale, bounding boxes are fitted around the rotated shape
+	const glm::mat4& getBoundingBoxTransform();
+
+	// Returns the world matrix translate * scale * rotate
+	const glm::mat4& getTransform();
 
-	glm::mat4& getTransform();
+	// Returns the inverse transpose of the world matrix, which transforms normals. Only valid for directions
+	const glm::mat4& getNormalMatrix();
 
-   glm::mat4 getRotate();
+	// Returns the rotation as a matrix
+	const glm::mat4& getRotate();
 
-	void setTranslation(glm::vec3& offset);
+	void setTranslation(const glm::vec3& offset);
 
-	void setScale(glm::vec3& scaleV);
+	void setScale(const glm::vec3& scaleV);
 
 	void setRotate(float angle, const glm::vec3& axis);
 
    void addRotation(float angle, const glm::vec3& axis);
 private:
 
+	glm::vec3 translation_;
+	glm::vec3 scale_;
+	glm::quat rotation_;
+
+	// Whether the matrices below are out of date
+	bool dirty_;
+
 	glm::mat4 boundingBoxTransform_;
 	glm::mat4 transform_;
-
-	glm::mat4 translate_;
-	glm::mat4 scale_;
+	glm::mat4 normalMatrix_;
 	glm::mat4 rotate_;
 
+	// Composes the matrices from the current components if they're out of date
 	void updateTransform();
 };
 
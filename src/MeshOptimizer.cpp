@@ -0,0 +1,333 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+   // Clusters are split wherever the cache miss ratio of the triangles since the last split drops to
+   // this factor of the whole mesh's ratio. Higher values give more, smaller clusters for the overdraw
+   // sort at the cost of vertex cache efficiency
+   const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+   // Returns a vertex that still has triangles left, preferring recently emitted ones. -1 if there is none
+   int skipDeadEnd(std::vector<unsigned>& deadEnd, const std::vector<unsigned>& liveCount, unsigned int& cursor) {
+      while (!deadEnd.empty()) {
+         unsigned v = deadEnd.back();
+         deadEnd.pop_back();
+
+         if (liveCount[v] > 0) {
+            return v;
+         }
+      }
+
+      while (cursor < liveCount.size()) {
+         if (liveCount[cursor] > 0) {
+            return cursor;
+         }
+         ++cursor;
+      }
+
+      return -1;
+   }
+
+   // Splits each hard cluster further where the cache efficiency allows it
+   void addSoftBoundaries(const std::vector<unsigned>& indices, unsigned int numVertices, unsigned int cacheSize,
+      std::vector<unsigned>& clusters) {
+      float meshAcmr = MeshOptimizer::simulateVertexCache(indices, numVertices, cacheSize).acmr();
+      unsigned int numTris = indices.size() / 3;
+
+      std::vector<unsigned> cacheTime(numVertices, 0);
+      unsigned int time = cacheSize + 1;
+
+      std::vector<unsigned> softClusters;
+      for (size_t c = 0; c < clusters.size(); ++c) {
+         unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : numTris;
+         unsigned int start = clusters[c];
+         unsigned int misses = 0;
+
+         softClusters.push_back(start);
+
+         for (unsigned int t = start; t < end; ++t) {
+            for (int k = 0; k < 3; ++k) {
+               unsigned v = indices[3 * t + k];
+               if (time - cacheTime[v] > cacheSize) {
+                  cacheTime[v] = time++;
+                  ++misses;
+               }
+            }
+
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= meshAcmr * OVERDRAW_ACMR_THRESHOLD) {
+               start = t + 1;
+               misses = 0;
+               softClusters.push_back(start);
+
+               // Clusters get reordered, so the next one starts with a cold cache
+               time += cacheSize + 1;
+            }
+         }
+
+         time += cacheSize + 1;
+      }
+
+      clusters.swap(softClusters);
+   }
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::simulateVertexCache(const std::vector<unsigned>& indices,
+   unsigned int numVertices, unsigned int cacheSize) {
+   CacheStatistics statistics = { 0, static_cast<unsigned int>(indices.size() / 3), 0 };
+
+   // A vertex is in the cache if less than |cacheSize| vertices were added since it was
+   std::vector<unsigned> cacheTime(numVertices, 0);
+   std::vector<bool> referenced(numVertices, false);
+   unsigned int time = cacheSize + 1;
+
+   for (unsigned v : indices) {
+      if (time - cacheTime[v] > cacheSize) {
+         cacheTime[v] = time++;
+         statistics.vertexTransforms++;
+      }
+
+      if (!referenced[v]) {
+         referenced[v] = true;
+         statistics.numVertices++;
+      }
+   }
+
+   return statistics;
+}
+
+std::vector<unsigned> MeshOptimizer::optimizeVertexCache(const std::vector<unsigned>& indices, unsigned int numVertices,
+   unsigned int cacheSize, std::vector<unsigned>* clusters) {
+   unsigned int numTris = indices.size() / 3;
+
+   if (clusters) {
+      clusters->clear();
+      clusters->push_back(0);
+   }
+
+   if (numTris == 0) {
+      return indices;
+   }
+
+   // Triangles using each vertex, |adjacency| of vertex v starts at |adjacencyOffset[v]|
+   std::vector<unsigned> liveCount(numVertices, 0);
+   for (unsigned v : indices) {
+      liveCount[v]++;
+   }
+
+   std::vector<unsigned> adjacencyOffset(numVertices + 1, 0);
+   for (unsigned int v = 0; v < numVertices; ++v) {
+      adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+   }
+
+   std::vector<unsigned> adjacency(indices.size());
+   std::vector<unsigned> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+   for (unsigned int t = 0; t < numTris; ++t) {
+      for (int k = 0; k < 3; ++k) {
+         adjacency[fill[indices[3 * t + k]]++] = t;
+      }
+   }
+
+   std::vector<unsigned> cacheTime(numVertices, 0);
+   std::vector<bool> emitted(numTris, false);
+   std::vector<unsigned> deadEnd;
+   std::vector<unsigned> candidates;
+
+   std::vector<unsigned> optimized;
+   optimized.reserve(indices.size());
+
+   unsigned int time = cacheSize + 1;
+   unsigned int cursor = 0;
+   int fanning = 0;
+
+   while (fanning >= 0) {
+      candidates.clear();
+
+      // Emit all remaining triangles around the fanning vertex
+      for (unsigned int a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; ++a) {
+         unsigned t = adjacency[a];
+         if (emitted[t]) {
+            continue;
+         }
+
+         for (int k = 0; k < 3; ++k) {
+            unsigned v = indices[3 * t + k];
+            optimized.push_back(v);
+            deadEnd.push_back(v);
+            candidates.push_back(v);
+            liveCount[v]--;
+
+            if (time - cacheTime[v] > cacheSize) {
+               cacheTime[v] = time++;
+            }
+         }
+
+         emitted[t] = true;
+      }
+
+      // Continue with the candidate that is oldest in the cache, but will still be in it after emitting all of
+      // it's triangles
+      int next = -1;
+      int bestPriority = -1;
+      for (unsigned v : candidates) {
+         if (liveCount[v] == 0) {
+            continue;
+         }
+
+         int priority = 0;
+         if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize) {
+            priority = time - cacheTime[v];
+         }
+
+         if (priority > bestPriority) {
+            bestPriority = priority;
+            next = v;
+         }
+      }
+
+      if (next == -1) {
+         next = skipDeadEnd(deadEnd, liveCount, cursor);
+
+         // Jumping to an unconnected vertex breaks the cache anyway, so it's a natural cluster boundary
+         if (next >= 0 && clusters && optimized.size() / 3 > clusters->back()) {
+            clusters->push_back(optimized.size() / 3);
+         }
+      }
+
+      fanning = next;
+   }
+
+   if (clusters) {
+      addSoftBoundaries(optimized, numVertices, cacheSize, *clusters);
+   }
+
+   return optimized;
+}
+
+std::vector<unsigned> MeshOptimizer::optimizeOverdraw(const std::vector<float>& positions, const std::vector<unsigned>& indices,
+   const std::vector<unsigned>& clusters) {
+   unsigned int numTris = indices.size() / 3;
+   size_t numClusters = clusters.size();
+
+   if (numClusters <= 1) {
+      return indices;
+   }
+
+   // Area weighted center and normal of each cluster, and the center of the whole mesh
+   std::vector<float> clusterCenter(3 * numClusters, 0.0f);
+   std::vector<float> clusterNormal(3 * numClusters, 0.0f);
+   std::vector<float> clusterArea(numClusters, 0.0f);
+   float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+   float meshArea = 0.0f;
+
+   for (size_t c = 0; c < numClusters; ++c) {
+      unsigned int end = c + 1 < numClusters ? clusters[c + 1] : numTris;
+
+      for (unsigned int t = clusters[c]; t < end; ++t) {
+         const float* p0 = &positions[3 * indices[3 * t]];
+         const float* p1 = &positions[3 * indices[3 * t + 1]];
+         const float* p2 = &positions[3 * indices[3 * t + 2]];
+
+         float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+         float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+         float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+         float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5f;
+
+         for (int k = 0; k < 3; ++k) {
+            float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+            clusterCenter[3 * c + k] += center * area;
+            clusterNormal[3 * c + k] += n[k];
+            meshCenter[k] += center * area;
+         }
+
+         clusterArea[c] += area;
+         meshArea += area;
+      }
+   }
+
+   if (meshArea <= 0.0f) {
+      return indices;
+   }
+
+   for (int k = 0; k < 3; ++k) {
+      meshCenter[k] /= meshArea;
+   }
+
+   // Clusters pointing away from the center are likely to hide the rest of the mesh
+   std::vector<float> occlusionPotential(numClusters, 0.0f);
+   for (size_t c = 0; c < numClusters; ++c) {
+      const float* n = &clusterNormal[3 * c];
+      float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      if (clusterArea[c] <= 0.0f || length <= 0.0f) {
+         continue;
+      }
+
+      for (int k = 0; k < 3; ++k) {
+         occlusionPotential[c] += (clusterCenter[3 * c + k] / clusterArea[c] - meshCenter[k]) * n[k] / length;
+      }
+   }
+
+   std::vector<unsigned> order(numClusters);
+   for (size_t c = 0; c < numClusters; ++c) {
+      order[c] = c;
+   }
+
+   std::stable_sort(order.begin(), order.end(), [&occlusionPotential](unsigned a, unsigned b) {
+      return occlusionPotential[a] > occlusionPotential[b];
+   });
+
+   std::vector<unsigned> sorted;
+   sorted.reserve(indices.size());
+   for (unsigned c : order) {
+      unsigned int end = c + 1 < numClusters ? clusters[c + 1] : numTris;
+      sorted.insert(sorted.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * end);
+   }
+
+   return sorted;
+}
+
+std::vector<unsigned> MeshOptimizer::optimizeVertexFetch(const std::vector<unsigned>& indices, unsigned int numVertices) {
+   const unsigned unassigned = static_cast<unsigned>(-1);
+
+   std::vector<unsigned> remap(numVertices, unassigned);
+   unsigned int next = 0;
+
+   for (unsigned v : indices) {
+      if (remap[v] == unassigned) {
+         remap[v] = next++;
+      }
+   }
+
+   for (unsigned int v = 0; v < numVertices; ++v) {
+      if (remap[v] == unassigned) {
+         remap[v] = next++;
+      }
+   }
+
+   return remap;
+}
+
+void MeshOptimizer::remapVertices(std::vector<float>& attribute, int componentCount, const std::vector<unsigned>& remap) {
+   // Attributes the mesh doesn't have (e.g. texcoords) are left empty
+   if (attribute.size() != remap.size() * componentCount) {
+      return;
+   }
+
+   std::vector<float> remapped(attribute.size());
+   for (size_t v = 0; v < remap.size(); ++v) {
+      for (int k = 0; k < componentCount; ++k) {
+         remapped[remap[v] * componentCount + k] = attribute[v * componentCount + k];
+      }
+   }
+
+   attribute.swap(remapped);
+}
+
+void MeshOptimizer::remapIndices(std::vector<unsigned>& indices, const std::vector<unsigned>& remap) {
+   for (unsigned& v : indices) {
+      v = remap[v];
+   }
+}
@@ -0,0 +1,74 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+/*
+ * Reorders the triangles and vertices of indexed meshes for the GPU's post transform vertex cache,
+ * vertex fetch locality and overdraw. Also contains a FIFO cache simulator to measure the results
+ * without a GPU.
+ *
+ * Design influenced and informed by: Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw" (Tipsify)
+ */
+namespace MeshOptimizer {
+
+   // Size of the simulated post transform cache, both for optimizing and measuring
+   static constexpr unsigned int DEFAULT_CACHE_SIZE = 16;
+
+   // Results of simulating a FIFO post transform cache over an index buffer
+   struct CacheStatistics {
+      // Number of cache misses, i.e. times the vertex shader would run
+      unsigned int vertexTransforms;
+
+      unsigned int numTriangles;
+
+      // Number of distinct vertices referenced by the indices
+      unsigned int numVertices;
+
+      // Average cache miss ratio, transforms per triangle (0.5 is ideal for large meshes, 3 is the worst)
+      float acmr() const {
+         return numTriangles > 0 ? static_cast<float>(vertexTransforms) / numTriangles : 0.0f;
+      }
+
+      // Average transform to vertex ratio (1 is ideal)
+      float atvr() const {
+         return numVertices > 0 ? static_cast<float>(vertexTransforms) / numVertices : 0.0f;
+      }
+
+      // Accumulates the statistics of another mesh
+      void add(const CacheStatistics& other) {
+         vertexTransforms += other.vertexTransforms;
+         numTriangles += other.numTriangles;
+         numVertices += other.numVertices;
+      }
+   };
+
+   // Runs the indices through a simulated FIFO cache holding |cacheSize| vertices
+   CacheStatistics simulateVertexCache(const std::vector<unsigned>& indices, unsigned int numVertices,
+      unsigned int cacheSize = DEFAULT_CACHE_SIZE);
+
+   // Returns the triangles reordered for vertex cache reuse (Tipsify). If |clusters| is given it's filled with the
+   // index of the first triangle of each cluster, split wherever the ordering had to jump to an unconnected
+   // vertex or the cache efficiency allows it, to be used by |optimizeOverdraw|
+   std::vector<unsigned> optimizeVertexCache(const std::vector<unsigned>& indices, unsigned int numVertices,
+      unsigned int cacheSize = DEFAULT_CACHE_SIZE, std::vector<unsigned>* clusters = nullptr);
+
+   // Returns the triangles with their clusters sorted so the ones facing away from the mesh center, likely
+   // to occlude the rest, are drawn first. The order of triangles within each cluster is kept.
+   // |positions| holds xyz triplets
+   std::vector<unsigned> optimizeOverdraw(const std::vector<float>& positions, const std::vector<unsigned>& indices,
+      const std::vector<unsigned>& clusters);
+
+   // Returns the new index of every vertex when ordering them by first use in |indices|.
+   // Vertices that aren't referenced are moved to the end
+   std::vector<unsigned> optimizeVertexFetch(const std::vector<unsigned>& indices, unsigned int numVertices);
+
+   // Reorders the |componentCount| sized elements of a vertex attribute by the given remap
+   void remapVertices(std::vector<float>& attribute, int componentCount, const std::vector<unsigned>& remap);
+
+   // Replaces each index by it's remapped vertex
+   void remapIndices(std::vector<unsigned>& indices, const std::vector<unsigned>& remap);
+}
+
+#endif
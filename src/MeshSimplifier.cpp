@@ -0,0 +1,305 @@
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+   // Symmetric 4x4 matrix storing the sum of squared distances to a set of planes:
+   // a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+   struct Quadric {
+      double a[10];
+
+      Quadric() {
+         for (int i = 0; i < 10; ++i) {
+            a[i] = 0.0;
+         }
+      }
+
+      // Adds the plane (nx, ny, nz, d) with the given weight
+      void addPlane(double nx, double ny, double nz, double d, double weight) {
+         a[0] += weight * nx * nx; a[1] += weight * nx * ny; a[2] += weight * nx * nz; a[3] += weight * nx * d;
+         a[4] += weight * ny * ny; a[5] += weight * ny * nz; a[6] += weight * ny * d;
+         a[7] += weight * nz * nz; a[8] += weight * nz * d;
+         a[9] += weight * d * d;
+      }
+
+      void add(const Quadric& other) {
+         for (int i = 0; i < 10; ++i) {
+            a[i] += other.a[i];
+         }
+      }
+
+      // Returns the sum of squared distances from the point to all planes
+      double error(double x, double y, double z) const {
+         return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+              + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+              + a[7] * z * z + 2.0 * a[8] * z
+              + a[9];
+      }
+   };
+
+   // A possible collapse of |from| onto |to|. The versions are used to detect outdated entries
+   struct Collapse {
+      double cost;
+      unsigned from;
+      unsigned to;
+      unsigned fromVersion;
+      unsigned toVersion;
+
+      bool operator>(const Collapse& other) const {
+         return cost > other.cost;
+      }
+   };
+
+   inline uint64_t edgeKey(unsigned a, unsigned b) {
+      return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+   }
+
+   // Cross product of (p1 - p0) and (p2 - p0)
+   inline void triangleNormal(const float* p0, const float* p1, const float* p2, double* n) {
+      double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+      n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+      n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+      n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+   }
+
+   class Simplifier {
+   public:
+      Simplifier(const std::vector<float>& positions, const std::vector<unsigned>& indices)
+         : positions_(positions),
+         indices_(indices),
+         numVerts_(positions.size() / 3),
+         quadrics_(numVerts_),
+         locked_(numVerts_, false),
+         removed_(numVerts_, false),
+         version_(numVerts_, 0),
+         vertTris_(numVerts_),
+         triRemoved_(indices.size() / 3, false),
+         numTris_(indices.size() / 3) {
+      }
+
+      std::vector<unsigned> run(unsigned int targetTriangleCount, float maxError) {
+         initQuadricsAndAdjacency();
+         lockBoundaries();
+
+         for (unsigned t = 0; t < triRemoved_.size(); ++t) {
+            for (int k = 0; k < 3; ++k) {
+               pushCollapse(indices_[3 * t + k], indices_[3 * t + (k + 1) % 3]);
+            }
+         }
+
+         while (numTris_ > targetTriangleCount && !heap_.empty()) {
+            Collapse collapse = heap_.top();
+            heap_.pop();
+
+            if (collapse.cost > maxError) {
+               break;
+            }
+
+            // Skip entries made outdated by earlier collapses
+            if (removed_[collapse.from] || removed_[collapse.to]
+             || version_[collapse.from] != collapse.fromVersion || version_[collapse.to] != collapse.toVersion) {
+               continue;
+            }
+
+            if (!flipsTriangle(collapse.from, collapse.to)) {
+               applyCollapse(collapse.from, collapse.to);
+            }
+         }
+
+         std::vector<unsigned> simplified;
+         simplified.reserve(numTris_ * 3);
+         for (unsigned t = 0; t < triRemoved_.size(); ++t) {
+            if (!triRemoved_[t]) {
+               simplified.insert(simplified.end(), indices_.begin() + 3 * t, indices_.begin() + 3 * t + 3);
+            }
+         }
+
+         return simplified;
+      }
+
+   private:
+      const std::vector<float>& positions_;
+
+      // Working copy of the indices that collapses are applied to
+      std::vector<unsigned> indices_;
+
+      unsigned numVerts_;
+
+      std::vector<Quadric> quadrics_;
+      std::vector<bool> locked_;
+      std::vector<bool> removed_;
+      std::vector<unsigned> version_;
+
+      // Triangles using each vertex, may also hold removed triangles
+      std::vector<std::vector<unsigned>> vertTris_;
+
+      std::vector<bool> triRemoved_;
+      unsigned numTris_;
+
+      std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap_;
+
+      const float* position(unsigned v) const {
+         return &positions_[3 * v];
+      }
+
+      void initQuadricsAndAdjacency() {
+         for (unsigned t = 0; t < triRemoved_.size(); ++t) {
+            unsigned i0 = indices_[3 * t], i1 = indices_[3 * t + 1], i2 = indices_[3 * t + 2];
+
+            vertTris_[i0].push_back(t);
+            vertTris_[i1].push_back(t);
+            vertTris_[i2].push_back(t);
+
+            double n[3];
+            triangleNormal(position(i0), position(i1), position(i2), n);
+
+            double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length <= 0.0) {
+               continue;
+            }
+
+            n[0] /= length; n[1] /= length; n[2] /= length;
+            double d = -(n[0] * position(i0)[0] + n[1] * position(i0)[1] + n[2] * position(i0)[2]);
+
+            // Area weighted so large faces resist collapses more than small ones
+            double area = length * 0.5;
+            quadrics_[i0].addPlane(n[0], n[1], n[2], d, area);
+            quadrics_[i1].addPlane(n[0], n[1], n[2], d, area);
+            quadrics_[i2].addPlane(n[0], n[1], n[2], d, area);
+         }
+      }
+
+      // Locks every vertex on an edge that isn't shared by exactly two triangles
+      void lockBoundaries() {
+         std::unordered_map<uint64_t, int> edgeUses;
+         for (unsigned t = 0; t < triRemoved_.size(); ++t) {
+            for (int k = 0; k < 3; ++k) {
+               edgeUses[edgeKey(indices_[3 * t + k], indices_[3 * t + (k + 1) % 3])]++;
+            }
+         }
+
+         for (const std::pair<const uint64_t, int>& edge : edgeUses) {
+            if (edge.second != 2) {
+               locked_[static_cast<unsigned>(edge.first >> 32)] = true;
+               locked_[static_cast<unsigned>(edge.first & 0xFFFFFFFF)] = true;
+            }
+         }
+      }
+
+      // Queues the cheapest allowed direction of collapsing the edge between |a| and |b|
+      void pushCollapse(unsigned a, unsigned b) {
+         if (a == b || (locked_[a] && locked_[b])) {
+            return;
+         }
+
+         Quadric q = quadrics_[a];
+         q.add(quadrics_[b]);
+
+         double costAToB = locked_[a] ? DBL_MAX : q.error(position(b)[0], position(b)[1], position(b)[2]);
+         double costBToA = locked_[b] ? DBL_MAX : q.error(position(a)[0], position(a)[1], position(a)[2]);
+
+         Collapse collapse;
+         if (costAToB <= costBToA) {
+            collapse.cost = costAToB;
+            collapse.from = a;
+            collapse.to = b;
+         } else {
+            collapse.cost = costBToA;
+            collapse.from = b;
+            collapse.to = a;
+         }
+         collapse.fromVersion = version_[collapse.from];
+         collapse.toVersion = version_[collapse.to];
+
+         heap_.push(collapse);
+      }
+
+      // Returns true if moving |from| onto |to| would flip or collapse any remaining triangle of |from|
+      bool flipsTriangle(unsigned from, unsigned to) {
+         for (unsigned t : vertTris_[from]) {
+            if (triRemoved_[t]) {
+               continue;
+            }
+
+            unsigned* tri = &indices_[3 * t];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+               continue;
+            }
+
+            const float* before[3];
+            const float* after[3];
+            for (int k = 0; k < 3; ++k) {
+               before[k] = position(tri[k]);
+               after[k] = tri[k] == from ? position(to) : position(tri[k]);
+            }
+
+            double nBefore[3], nAfter[3];
+            triangleNormal(before[0], before[1], before[2], nBefore);
+            triangleNormal(after[0], after[1], after[2], nAfter);
+
+            if (nBefore[0] * nAfter[0] + nBefore[1] * nAfter[1] + nBefore[2] * nAfter[2] <= 0.0) {
+               return true;
+            }
+         }
+
+         return false;
+      }
+
+      void applyCollapse(unsigned from, unsigned to) {
+         for (unsigned t : vertTris_[from]) {
+            if (triRemoved_[t]) {
+               continue;
+            }
+
+            unsigned* tri = &indices_[3 * t];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+               // Triangles on the collapsed edge degenerate
+               triRemoved_[t] = true;
+               --numTris_;
+            } else {
+               for (int k = 0; k < 3; ++k) {
+                  if (tri[k] == from) {
+                     tri[k] = to;
+                  }
+               }
+               vertTris_[to].push_back(t);
+            }
+         }
+
+         vertTris_[from].clear();
+         removed_[from] = true;
+         quadrics_[to].add(quadrics_[from]);
+         ++version_[to];
+
+         // Re-queue the edges around the merged vertex with it's new quadric
+         for (unsigned t : vertTris_[to]) {
+            if (triRemoved_[t]) {
+               continue;
+            }
+
+            for (int k = 0; k < 3; ++k) {
+               if (indices_[3 * t + k] != to) {
+                  pushCollapse(to, indices_[3 * t + k]);
+               }
+            }
+         }
+      }
+   };
+}
+
+std::vector<unsigned> MeshSimplifier::simplify(const std::vector<float>& positions, const std::vector<unsigned>& indices,
+   unsigned int targetTriangleCount, float maxError) {
+   if (indices.size() / 3 <= targetTriangleCount) {
+      return indices;
+   }
+
+   Simplifier simplifier(positions, indices);
+   return simplifier.run(targetTriangleCount, maxError);
+}
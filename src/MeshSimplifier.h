@@ -0,0 +1,23 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cfloat>
+#include <vector>
+
+/*
+ * Quadric error metric mesh simplification used to generate levels of detail at load time
+ *
+ * Design influenced and informed by: Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"
+ */
+namespace MeshSimplifier {
+
+   // Simplifies the indexed triangle mesh to at most |targetTriangleCount| triangles (if possible) by collapsing
+   // edges onto one of their end points, cheapest quadric error first. |positions| holds xyz triplets.
+   // Vertices are never moved or added so the returned indices still refer to |positions|. Edges on a boundary
+   // are never collapsed, which also keeps the seams between texture coordinates and normals intact.
+   // Collapses costing more than |maxError| are not performed
+   std::vector<unsigned> simplify(const std::vector<float>& positions, const std::vector<unsigned>& indices,
+      unsigned int targetTriangleCount, float maxError = FLT_MAX);
+}
+
+#endif
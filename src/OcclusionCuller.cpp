@@ -0,0 +1,449 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+   // Clip space w below which a point is treated as lying behind the camera
+   const float MIN_CLIP_W = 1e-4f;
+
+   const int NUM_TILES_X = OcclusionCuller::DEPTH_WIDTH / OcclusionCuller::TILE_WIDTH;
+   const int NUM_TILES_Y = OcclusionCuller::DEPTH_HEIGHT / OcclusionCuller::TILE_HEIGHT;
+
+   // Transforms (x, y, z, 1) by the column major matrix |m| into |out|
+   inline void transformPoint(const float* m, float x, float y, float z, float* out) {
+#ifdef OCCLUSION_CULLER_SSE
+      __m128 result = _mm_add_ps(
+         _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(x)), _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y))),
+         _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)), _mm_loadu_ps(m + 12)));
+      _mm_storeu_ps(out, result);
+#else
+      for (int row = 0; row < 4; ++row) {
+         out[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+      }
+#endif
+   }
+}
+
+OcclusionCuller::OcclusionCuller()
+   // Leave a core to the render thread
+   : numThreads_(std::max(2u, std::thread::hardware_concurrency()) - 1),
+   nextTile_(0),
+   workerFrame_(0),
+   numHelpers_(0),
+   numBusyHelpers_(0),
+   stopping_(false) {
+   static_assert(DEPTH_WIDTH % TILE_WIDTH == 0 && DEPTH_HEIGHT % TILE_HEIGHT == 0,
+      "Depth buffer must be made up of whole tiles");
+   static_assert(TILE_WIDTH % 4 == 0, "Tiles are rasterized 4 pixels at a time");
+
+   // Allocate every level down to a single texel
+   int width = DEPTH_WIDTH;
+   int height = DEPTH_HEIGHT;
+   while (true) {
+      levelWidth_.push_back(width);
+      levelHeight_.push_back(height);
+      minDepthPyramid_.emplace_back(width * height, 1.0f);
+      maxDepthPyramid_.emplace_back(width * height, 1.0f);
+
+      if (width == 1 && height == 1) {
+         break;
+      }
+
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+   }
+}
+
+OcclusionCuller::~OcclusionCuller() {
+   {
+      std::lock_guard<std::mutex> lock(workerMutex_);
+      stopping_ = true;
+   }
+   tilesAvailable_.notify_all();
+
+   for (std::thread& worker : workers_) {
+      worker.join();
+   }
+}
+
+void OcclusionCuller::setNumThreads(unsigned int numThreads) {
+   numThreads_ = std::max(1u, numThreads);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection) {
+   viewProjection_ = viewProjection;
+   triangles_.clear();
+}
+
+void OcclusionCuller::addOccluder(std::shared_ptr<GameObject> obj) {
+   RenderComponent* render = obj->getRenderComponent();
+   if (render == NULL) {
+      return;
+   }
+
+   // Same model transform the object is rendered with
+   const glm::mat4& M = obj->transform.getTransform();
+
+   std::shared_ptr<Shape> shape = render->getShape();
+   for (int i = 0; i < shape->getNumSubShapes(); ++i) {
+      addOccluder(M, shape->getPositions(i), shape->getIndices(i));
+   }
+}
+
+void OcclusionCuller::addOccluder(const glm::mat4& M, const std::vector<float>& positions, const std::vector<unsigned>& indices) {
+   const glm::mat4 MVP = viewProjection_ * M;
+   const float* m = glm::value_ptr(MVP);
+
+   // Project every vertex once into depth buffer space
+   int numVerts = positions.size() / 3;
+   std::vector<glm::vec4> screenVerts(numVerts);
+   for (int v = 0; v < numVerts; ++v) {
+      float clip[4];
+      transformPoint(m, positions[3 * v], positions[3 * v + 1], positions[3 * v + 2], clip);
+
+      // w <= 0 marks a vertex behind the camera
+      if (clip[3] < MIN_CLIP_W) {
+         screenVerts[v] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+         continue;
+      }
+
+      float invW = 1.0f / clip[3];
+      screenVerts[v] = glm::vec4(
+         (clip[0] * invW * 0.5f + 0.5f) * DEPTH_WIDTH,
+         (clip[1] * invW * 0.5f + 0.5f) * DEPTH_HEIGHT,
+         clip[2] * invW * 0.5f + 0.5f,
+         1.0f);
+   }
+
+   for (unsigned int t = 0; t + 2 < indices.size(); t += 3) {
+      const glm::vec4& v0 = screenVerts[indices[t]];
+      const glm::vec4& v1 = screenVerts[indices[t + 1]];
+      const glm::vec4& v2 = screenVerts[indices[t + 2]];
+
+      // Triangles crossing the near plane are dropped rather than clipped, which only ever
+      // makes the occluders smaller and therefore keeps culling conservative
+      if (v0.w < 0.0f || v1.w < 0.0f || v2.w < 0.0f) {
+         continue;
+      }
+
+      // Skip back facing (clockwise) and degenerate triangles
+      float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+      if (area <= 0.0f) {
+         continue;
+      }
+
+      ScreenTriangle tri;
+      tri.x[0] = v0.x; tri.x[1] = v1.x; tri.x[2] = v2.x;
+      tri.y[0] = v0.y; tri.y[1] = v1.y; tri.y[2] = v2.y;
+      tri.z[0] = v0.z; tri.z[1] = v1.z; tri.z[2] = v2.z;
+
+      tri.minX = std::max(0, static_cast<int>(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+      tri.minY = std::max(0, static_cast<int>(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+      tri.maxX = std::min(DEPTH_WIDTH - 1, static_cast<int>(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+      tri.maxY = std::min(DEPTH_HEIGHT - 1, static_cast<int>(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+
+      // Completely off screen
+      if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+         continue;
+      }
+
+      triangles_.push_back(tri);
+   }
+}
+
+void OcclusionCuller::rasterizeOccluders() {
+   std::vector<float>& depth = minDepthPyramid_[0];
+   std::fill(depth.begin(), depth.end(), 1.0f);
+
+   nextTile_ = 0;
+
+   // Waking the workers is only worth it with enough triangles to go around
+   unsigned int numThreads = std::min(numThreads_, static_cast<unsigned int>(NUM_TILES_X * NUM_TILES_Y));
+   if (static_cast<int>(triangles_.size()) < MIN_TRIANGLES_FOR_THREADS) {
+      numThreads = 1;
+   }
+   unsigned int numHelpers = numThreads - 1;
+
+   if (numHelpers > 0) {
+      std::lock_guard<std::mutex> lock(workerMutex_);
+
+      while (workers_.size() < numHelpers) {
+         workers_.emplace_back(&OcclusionCuller::workerLoop, this, workers_.size(), workerFrame_);
+      }
+
+      numHelpers_ = numHelpers;
+      numBusyHelpers_ = numHelpers;
+      ++workerFrame_;
+   }
+   tilesAvailable_.notify_all();
+
+   rasterizeTiles();
+
+   if (numHelpers > 0) {
+      std::unique_lock<std::mutex> lock(workerMutex_);
+      tilesDone_.wait(lock, [this]() { return numBusyHelpers_ == 0; });
+   }
+
+   buildPyramid();
+}
+
+void OcclusionCuller::workerLoop(unsigned int index, unsigned long seenFrame) {
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock(workerMutex_);
+         tilesAvailable_.wait(lock, [this, seenFrame]() { return stopping_ || workerFrame_ != seenFrame; });
+
+         if (stopping_) {
+            return;
+         }
+
+         // Workers beyond the ones needed sit this frame out
+         seenFrame = workerFrame_;
+         if (index >= numHelpers_) {
+            continue;
+         }
+      }
+
+      rasterizeTiles();
+
+      std::lock_guard<std::mutex> lock(workerMutex_);
+      if (--numBusyHelpers_ == 0) {
+         tilesDone_.notify_one();
+      }
+   }
+}
+
+void OcclusionCuller::rasterizeTiles() {
+   int tile;
+   while ((tile = nextTile_++) < NUM_TILES_X * NUM_TILES_Y) {
+      rasterizeTile(tile);
+   }
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+   int tileMinX = (tile % NUM_TILES_X) * TILE_WIDTH;
+   int tileMinY = (tile / NUM_TILES_X) * TILE_HEIGHT;
+   int tileMaxX = tileMinX + TILE_WIDTH - 1;
+   int tileMaxY = tileMinY + TILE_HEIGHT - 1;
+
+   for (const ScreenTriangle& tri : triangles_) {
+      int minX = std::max(tri.minX, tileMinX);
+      int minY = std::max(tri.minY, tileMinY);
+      int maxX = std::min(tri.maxX, tileMaxX);
+      int maxY = std::min(tri.maxY, tileMaxY);
+
+      if (minX <= maxX && minY <= maxY) {
+         rasterizeTriangle(tri, minX, minY, maxX, maxY);
+      }
+   }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& tri, int minX, int minY, int maxX, int maxY) {
+   std::vector<float>& depth = minDepthPyramid_[0];
+
+   // Edge functions E(x, y) = a * x + b * y + c, positive on the inside of counter clockwise triangles
+   float a[3], b[3], c[3];
+   for (int i = 0; i < 3; ++i) {
+      int j = (i + 1) % 3;
+      a[i] = tri.y[i] - tri.y[j];
+      b[i] = tri.x[j] - tri.x[i];
+      c[i] = tri.x[i] * tri.y[j] - tri.x[j] * tri.y[i];
+   }
+
+   // Depth is linear in screen space: z(x, y) = dzdx * x + dzdy * y + z0
+   float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+   float dzdx = ((tri.z[1] - tri.z[0]) * (tri.y[2] - tri.y[0]) - (tri.z[2] - tri.z[0]) * (tri.y[1] - tri.y[0])) / area;
+   float dzdy = ((tri.x[1] - tri.x[0]) * (tri.z[2] - tri.z[0]) - (tri.x[2] - tri.x[0]) * (tri.z[1] - tri.z[0])) / area;
+   float z0 = tri.z[0] - dzdx * tri.x[0] - dzdy * tri.y[0];
+
+   // Start on a multiple of 4 so each group of pixels stays within the tile
+   int startX = minX & ~3;
+
+#ifdef OCCLUSION_CULLER_SSE
+   const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+   const __m128 zero = _mm_setzero_ps();
+
+   for (int y = minY; y <= maxY; ++y) {
+      float py = y + 0.5f;
+      float* row = &depth[y * DEPTH_WIDTH];
+
+      for (int x = startX; x <= maxX; x += 4) {
+         __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+
+         __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(b[0] * py + c[0]));
+         __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(b[1] * py + c[1]));
+         __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(b[2] * py + c[2]));
+
+         __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+         if (_mm_movemask_ps(inside) == 0) {
+            continue;
+         }
+
+         __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + z0));
+         __m128 oldZ = _mm_loadu_ps(row + x);
+         __m128 newZ = _mm_min_ps(oldZ, z);
+
+         _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, newZ), _mm_andnot_ps(inside, oldZ)));
+      }
+   }
+#else
+   for (int y = minY; y <= maxY; ++y) {
+      float py = y + 0.5f;
+      float* row = &depth[y * DEPTH_WIDTH];
+
+      for (int x = startX; x <= maxX; ++x) {
+         float px = x + 0.5f;
+
+         if (a[0] * px + b[0] * py + c[0] >= 0.0f
+          && a[1] * px + b[1] * py + c[1] >= 0.0f
+          && a[2] * px + b[2] * py + c[2] >= 0.0f) {
+            row[x] = std::min(row[x], dzdx * px + dzdy * py + z0);
+         }
+      }
+   }
+#endif
+}
+
+void OcclusionCuller::buildPyramid() {
+   maxDepthPyramid_[0] = minDepthPyramid_[0];
+
+   for (unsigned int level = 1; level < levelWidth_.size(); ++level) {
+      int width = levelWidth_[level];
+      int height = levelHeight_[level];
+      int prevWidth = levelWidth_[level - 1];
+      int prevHeight = levelHeight_[level - 1];
+
+      const std::vector<float>& prevMin = minDepthPyramid_[level - 1];
+      const std::vector<float>& prevMax = maxDepthPyramid_[level - 1];
+      std::vector<float>& curMin = minDepthPyramid_[level];
+      std::vector<float>& curMax = maxDepthPyramid_[level];
+
+      for (int y = 0; y < height; ++y) {
+         for (int x = 0; x < width; ++x) {
+            float minDepth = 1.0f;
+            float maxDepth = 0.0f;
+
+            for (int childY = 2 * y; childY < std::min(2 * y + 2, prevHeight); ++childY) {
+               for (int childX = 2 * x; childX < std::min(2 * x + 2, prevWidth); ++childX) {
+                  minDepth = std::min(minDepth, prevMin[childY * prevWidth + childX]);
+                  maxDepth = std::max(maxDepth, prevMax[childY * prevWidth + childX]);
+               }
+            }
+
+            curMin[y * width + x] = minDepth;
+            curMax[y * width + x] = maxDepth;
+         }
+      }
+   }
+}
+
+bool OcclusionCuller::isOccluded(std::shared_ptr<GameObject> obj) {
+   BoundingBox* objBox = obj->getBoundingBox();
+   if (objBox == NULL) {
+      return false;
+   }
+
+   return isOccluded(objBox->min_, objBox->max_);
+}
+
+bool OcclusionCuller::isOccluded(const glm::vec3& min, const glm::vec3& max) {
+   const float* m = glm::value_ptr(viewProjection_);
+
+   float minX = FLT_MAX, minY = FLT_MAX;
+   float maxX = -FLT_MAX, maxY = -FLT_MAX;
+   float nearestDepth = FLT_MAX;
+
+   // Screen space bounds and nearest depth of the box's corners
+   for (int i = 0; i < 8; ++i) {
+      float clip[4];
+      transformPoint(m, (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, clip);
+
+      // Box reaches behind the camera
+      if (clip[3] < MIN_CLIP_W) {
+         return false;
+      }
+
+      float invW = 1.0f / clip[3];
+      float x = (clip[0] * invW * 0.5f + 0.5f) * DEPTH_WIDTH;
+      float y = (clip[1] * invW * 0.5f + 0.5f) * DEPTH_HEIGHT;
+
+      minX = std::min(minX, x);
+      minY = std::min(minY, y);
+      maxX = std::max(maxX, x);
+      maxY = std::max(maxY, y);
+      nearestDepth = std::min(nearestDepth, clip[2] * invW * 0.5f + 0.5f);
+   }
+
+   int pixelMinX = std::max(0, static_cast<int>(std::floor(minX)));
+   int pixelMinY = std::max(0, static_cast<int>(std::floor(minY)));
+   int pixelMaxX = std::min(DEPTH_WIDTH - 1, static_cast<int>(std::floor(maxX)));
+   int pixelMaxY = std::min(DEPTH_HEIGHT - 1, static_cast<int>(std::floor(maxY)));
+
+   // Off screen boxes are left for frustum culling to deal with
+   if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) {
+      return false;
+   }
+
+   // Start at the finest level where the bounds cover at most 2x2 texels
+   int level = 0;
+   while (level + 1 < static_cast<int>(levelWidth_.size())
+    && ((pixelMaxX >> level) - (pixelMinX >> level) > 1 || (pixelMaxY >> level) - (pixelMinY >> level) > 1)) {
+      ++level;
+   }
+
+   for (int y = pixelMinY >> level; y <= (pixelMaxY >> level); ++y) {
+      for (int x = pixelMinX >> level; x <= (pixelMaxX >> level); ++x) {
+         if (isVisibleInTexel(level, x, y, pixelMinX, pixelMinY, pixelMaxX, pixelMaxY, nearestDepth)) {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+bool OcclusionCuller::isVisibleInTexel(int level, int x, int y, int minX, int minY, int maxX, int maxY, float nearestDepth) {
+   int index = y * levelWidth_[level] + x;
+
+   // Everything in the texel is in front of the box
+   if (nearestDepth >= maxDepthPyramid_[level][index]) {
+      return false;
+   }
+
+   // Everything in the texel is behind the box, or there is no finer level to decide with
+   if (nearestDepth < minDepthPyramid_[level][index] || level == 0) {
+      return true;
+   }
+
+   // Refine with the child texels that overlap the bounds
+   int childLevel = level - 1;
+   for (int childY = std::max(2 * y, minY >> childLevel); childY <= std::min(2 * y + 1, maxY >> childLevel); ++childY) {
+      for (int childX = std::max(2 * x, minX >> childLevel); childX <= std::min(2 * x + 1, maxX >> childLevel); ++childX) {
+         if (isVisibleInTexel(childLevel, childX, childY, minX, minY, maxX, maxY, nearestDepth)) {
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+const std::vector<float>& OcclusionCuller::getDepthBuffer() {
+   return minDepthPyramid_[0];
+}
+
+int OcclusionCuller::getNumOccluderTriangles() {
+   return triangles_.size();
+}
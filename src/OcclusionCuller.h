@@ -0,0 +1,135 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "GameObject.h"
+
+/*
+ * CPU only occlusion culling. A small set of large occluders is rasterized into a low resolution
+ * depth buffer, which is reduced into a hierarchical min/max depth pyramid that the screen space
+ * bounds of other objects are tested against. No GL calls are made, so it works without a GPU.
+ *
+ * The depth buffer is split into tiles that are rasterized independently (and in parallel, by the calling thread
+ * together with a pool of worker threads that is kept alive between frames).
+ *
+ * Design influenced and informed by: https://software.intel.com/en-us/articles/masked-software-occlusion-culling
+ */
+class OcclusionCuller {
+public:
+
+   // Resolution of the occlusion depth buffer
+   static constexpr int DEPTH_WIDTH = 256;
+   static constexpr int DEPTH_HEIGHT = 128;
+
+   // Size of the tiles the depth buffer is split into (width must be a multiple of 4)
+   static constexpr int TILE_WIDTH = 64;
+   static constexpr int TILE_HEIGHT = 32;
+
+   // Number of occluder triangles below which the tiles are rasterized on the calling thread only
+   static constexpr int MIN_TRIANGLES_FOR_THREADS = 1024;
+
+   OcclusionCuller();
+
+   ~OcclusionCuller();
+
+   // Sets the maximum number of threads the tiles are rasterized on, including the calling thread
+   void setNumThreads(unsigned int numThreads);
+
+   // Clears the occluders of the last frame and sets the view projection used for this frame
+   void beginFrame(const glm::mat4& viewProjection);
+
+   // Adds the triangles of the object's shape as an occluder for the current frame
+   void addOccluder(std::shared_ptr<GameObject> obj);
+
+   // Adds the given triangles as an occluder for the current frame. |positions| holds xyz triplets in
+   // object space, |M| transforms them into world space
+   void addOccluder(const glm::mat4& M, const std::vector<float>& positions, const std::vector<unsigned>& indices);
+
+   // Rasterizes all occluders added since |beginFrame| and builds the depth pyramid
+   void rasterizeOccluders();
+
+   // Returns true if the world space box given by |min| and |max| is completely hidden by the occluders
+   bool isOccluded(const glm::vec3& min, const glm::vec3& max);
+
+   // Returns true if the object's bounding box is completely hidden by the occluders.
+   // Objects without a bounding box are never occluded
+   bool isOccluded(std::shared_ptr<GameObject> obj);
+
+   // Returns the rasterized depth buffer (row major, bottom row first) of the current frame
+   const std::vector<float>& getDepthBuffer();
+
+   // Returns the number of occluder triangles rasterized in the current frame
+   int getNumOccluderTriangles();
+
+private:
+
+   // Triangle in depth buffer space (pixels, depth in [0, 1]) with it's bounds clamped to the buffer
+   struct ScreenTriangle {
+      float x[3];
+      float y[3];
+      float z[3];
+      int minX, minY, maxX, maxY;
+   };
+
+   glm::mat4 viewProjection_;
+
+   std::vector<ScreenTriangle> triangles_;
+
+   // Level 0 of both pyramids is the full resolution depth buffer, each following level halves the
+   // resolution keeping the nearest (min) or furthest (max) depth of the texels it covers
+   std::vector<std::vector<float>> minDepthPyramid_;
+   std::vector<std::vector<float>> maxDepthPyramid_;
+
+   std::vector<int> levelWidth_;
+   std::vector<int> levelHeight_;
+
+   unsigned int numThreads_;
+
+   // Next tile to be picked up by a rasterizing thread
+   std::atomic<int> nextTile_;
+
+   // Workers helping the calling thread rasterize, started as they're first needed
+   std::vector<std::thread> workers_;
+   std::mutex workerMutex_;
+   std::condition_variable tilesAvailable_;
+   std::condition_variable tilesDone_;
+
+   // Incremented for every frame the workers are woken up for
+   unsigned long workerFrame_;
+
+   // Number of workers taking part in the current frame and how many of them haven't finished yet
+   unsigned int numHelpers_;
+   unsigned int numBusyHelpers_;
+
+   bool stopping_;
+
+   // Waits for frames and rasterizes their tiles. |index| is the worker's position in |workers_| and |seenFrame|
+   // the last frame it has to ignore
+   void workerLoop(unsigned int index, unsigned long seenFrame);
+
+   // Rasterizes tiles until none are left
+   void rasterizeTiles();
+
+   // Rasterizes every triangle overlapping the given tile into the depth buffer
+   void rasterizeTile(int tile);
+
+   // Rasterizes the part of |tri| that lies within the given pixel bounds (inclusive)
+   void rasterizeTriangle(const ScreenTriangle& tri, int minX, int minY, int maxX, int maxY);
+
+   // Builds all levels of the min/max pyramid above level 0
+   void buildPyramid();
+
+   // Returns true if a box at depth |nearestDepth| covering the level 0 pixel bounds is visible within
+   // texel (|x|, |y|) of |level|
+   bool isVisibleInTexel(int level, int x, int y, int minX, int minY, int maxX, int maxY, float nearestDepth);
+};
+
+#endif
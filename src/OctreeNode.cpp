@@ -31,9 +31,9 @@ void OctreeNode::createEnclosingRegionForRoot() {
          min.y = objMin.y < min.y ? objMin.y : min.y;
          min.z = objMin.z < min.z ? objMin.z : min.z;
 
-         max.x = objMax.x < max.x ? objMax.x : max.x;
-         max.y = objMax.y < max.y ? objMax.y : max.y;
-         max.z = objMax.z < max.z ? objMax.z : max.z;
+         max.x = objMax.x > max.x ? objMax.x : max.x;
+         max.y = objMax.y > max.y ? objMax.y : max.y;
+         max.z = objMax.z > max.z ? objMax.z : max.z;
       }
    }
 
@@ -50,12 +50,12 @@ bool OctreeNode::contains(const std::shared_ptr<GameObject> obj) {
 
    // Make sure each point of the object's bounding box is within the node's enclosing region
    for (int i = 0; i < 8; ++i) {
-      if (enclosingRegion_.min_.x >= objBoundBox->boxPoints[i].x 
-       && enclosingRegion_.min_.y >= objBoundBox->boxPoints[i].y
-       && enclosingRegion_.min_.z >= objBoundBox->boxPoints[i].z
-       && enclosingRegion_.max_.x <= objBoundBox->boxPoints[i].x
-       && enclosingRegion_.max_.y <= objBoundBox->boxPoints[i].y
-       && enclosingRegion_.max_.z <= objBoundBox->boxPoints[i].z) {
+      if (objBoundBox->boxPoints[i].x < enclosingRegion_.min_.x
+       || objBoundBox->boxPoints[i].y < enclosingRegion_.min_.y
+       || objBoundBox->boxPoints[i].z < enclosingRegion_.min_.z
+       || objBoundBox->boxPoints[i].x > enclosingRegion_.max_.x
+       || objBoundBox->boxPoints[i].y > enclosingRegion_.max_.y
+       || objBoundBox->boxPoints[i].z > enclosingRegion_.max_.z) {
          return false;
       }
    }
@@ -81,14 +81,20 @@ void OctreeNode::clearTree() {
 std::vector<std::shared_ptr<GameObject>> OctreeNode::checkIntersection(std::shared_ptr<GameObject> objToCheck) {
    std::vector<std::shared_ptr<GameObject>> hitObjs;
 
-   // Check for a child that contains the object and recursively call it's |checkIntersection| method
+   // Objects without a bounding box can't hit anything in the tree
+   BoundingBox* objBoundBox = objToCheck->getBoundingBox();
+   if (objBoundBox == NULL) {
+      return hitObjs;
+   }
+
+   // Recurse into every child whose region overlaps the object, an object straddling
+   // a split plane can hit objects stored in more than one child
    for (OctreeNode& child : children_) {
-      if (child.contains(objToCheck)) {
+      if (child.enclosingRegion_.checkIntersection(*objBoundBox)) {
          std::vector<std::shared_ptr<GameObject>> childHitObjs = child.checkIntersection(objToCheck);
          hitObjs.insert(hitObjs.end(), 
           std::make_move_iterator(childHitObjs.begin()),
           std::make_move_iterator(childHitObjs.end()));
-         break;
       }
    }
 
@@ -101,6 +107,51 @@ std::vector<std::shared_ptr<GameObject>> OctreeNode::checkIntersection(std::shar
 
    return hitObjs;
 }
+
+void OctreeNode::getObjectsInFrustum(ViewFrustum& frustum, std::vector<std::shared_ptr<GameObject>>& objsInFrustum,
+ unsigned int planeMask) {
+
+   // The root is never rejected as a whole since it also holds the objects without a bounding box
+   if (parent_ != NULL && frustum.cullBox(enclosingRegion_, planeMask)) {
+      return;
+   }
+
+   // Region is completely inside of the frustum, so is everything it encloses
+   if (planeMask == 0) {
+      getAllObjects(objsInFrustum);
+      return;
+   }
+
+   for (std::shared_ptr<GameObject>& obj : objsEnclosed_) {
+      if (!frustum.cull(obj, planeMask)) {
+         objsInFrustum.push_back(obj);
+      }
+   }
+
+   for (OctreeNode& child : children_) {
+      child.getObjectsInFrustum(frustum, objsInFrustum, planeMask);
+   }
+}
+
+void OctreeNode::addDebugLines(DebugDraw& debugDraw, int depth) {
+   // Most nodes are empty, drawing all of them would hide the ones that matter
+   if (parent_ == NULL || !objsEnclosed_.empty()) {
+      float shade = 1.0f / (1.0f + depth * 0.5f);
+      debugDraw.addBox(enclosingRegion_.min_, enclosingRegion_.max_, glm::vec3(0.0f, shade, 1.0f - shade));
+   }
+
+   for (OctreeNode& child : children_) {
+      child.addDebugLines(debugDraw, depth + 1);
+   }
+}
+
+void OctreeNode::getAllObjects(std::vector<std::shared_ptr<GameObject>>& objs) {
+   objs.insert(objs.end(), objsEnclosed_.begin(), objsEnclosed_.end());
+
+   for (OctreeNode& child : children_) {
+      child.getAllObjects(objs);
+   }
+}
    
 void OctreeNode::buildTreeNode() {
    glm::vec3& regionMin = enclosingRegion_.min_;
@@ -154,7 +205,7 @@ void OctreeNode::buildTreeNode() {
    children_.emplace_back(this, childMin, childMax);
 
    childMin = glm::vec3(regionMin.x, centerOfRegion.y, centerOfRegion.z);
-   childMax = glm::vec3(centerOfRegion.x, regionMax.y, centerOfRegion.z);
+   childMax = glm::vec3(centerOfRegion.x, regionMax.y, regionMax.z);
    children_.emplace_back(this, childMin, childMax);
 
    // Enqueue any objects that are going to be handled by a child
@@ -9,7 +9,9 @@
 
 #include "glm/glm.hpp"
 
+#include "DebugDraw.h"
 #include "GameObject.h"
+#include "ViewFrustum.h"
 
 /* 
  * Spatial data structure used to store static objects in the world
@@ -39,6 +41,15 @@ public:
    // Returns an object that intersects with the past object. Returns |nullptr| if no such object exists
    std::vector<std::shared_ptr<GameObject>> checkIntersection(std::shared_ptr<GameObject> objToCheck);
 
+   // Appends every object in the tree that is not culled by |frustum| to |objsInFrustum|.
+   // Whole subtrees are skipped once their enclosing region falls outside of the frustum and accepted
+   // without further tests once it's completely inside. |planeMask| holds the planes still to be tested
+   void getObjectsInFrustum(ViewFrustum& frustum, std::vector<std::shared_ptr<GameObject>>& objsInFrustum,
+    unsigned int planeMask = ViewFrustum::ALL_PLANES);
+
+   // Adds the enclosing region of every node holding objects to |debugDraw|, colored by depth in the tree
+   void addDebugLines(DebugDraw& debugDraw, int depth = 0);
+
 private:
 
    // The children whose parent is this node
@@ -66,6 +77,9 @@ private:
    // Checks if the object is contained within the |enclosingRegion_| of the node
    bool contains(const std::shared_ptr<GameObject> obj);
 
+   // Appends every object in this node and all of it's children to |objs|
+   void getAllObjects(std::vector<std::shared_ptr<GameObject>>& objs);
+
 };
 
 #endif
@@ -0,0 +1,89 @@
+#include "OverdrawCounter.h"
+
+OverdrawCounter::OverdrawCounter()
+   : currentQuery_(0),
+   enabled_(false),
+   counting_(false),
+   overdraw_(0.0f) {
+   for (int i = 0; i < NUM_QUERIES; ++i) {
+      queryIDs_[i] = 0;
+      queryPixels_[i] = 0;
+   }
+}
+
+OverdrawCounter::~OverdrawCounter() {
+   if (queryIDs_[0] != 0) {
+      glDeleteQueries(NUM_QUERIES, queryIDs_);
+   }
+}
+
+void OverdrawCounter::setEnabled(bool enabled) {
+   enabled_ = enabled;
+
+   // Results of an earlier run would be stale
+   if (!enabled_) {
+      for (int i = 0; i < NUM_QUERIES; ++i) {
+         queryPixels_[i] = 0;
+      }
+      overdraw_ = 0.0f;
+   }
+}
+
+bool OverdrawCounter::isEnabled() {
+   return enabled_;
+}
+
+void OverdrawCounter::begin(unsigned int numPixels) {
+   if (!enabled_ || numPixels == 0) {
+      return;
+   }
+
+   if (queryIDs_[0] == 0) {
+      glGenQueries(NUM_QUERIES, queryIDs_);
+   }
+
+   // The query about to be reused is the oldest and has to be read even if that means waiting, then pick up
+   // whatever newer ones finished
+   readQuery(currentQuery_, true);
+   for (int i = 1; i < NUM_QUERIES; ++i) {
+      readQuery((currentQuery_ + i) % NUM_QUERIES, false);
+   }
+
+   glBeginQuery(GL_SAMPLES_PASSED, queryIDs_[currentQuery_]);
+   queryPixels_[currentQuery_] = numPixels;
+   counting_ = true;
+}
+
+void OverdrawCounter::end() {
+   if (!counting_) {
+      return;
+   }
+
+   glEndQuery(GL_SAMPLES_PASSED);
+   counting_ = false;
+   currentQuery_ = (currentQuery_ + 1) % NUM_QUERIES;
+}
+
+float OverdrawCounter::getOverdraw() {
+   return overdraw_;
+}
+
+void OverdrawCounter::readQuery(int query, bool wait) {
+   if (queryPixels_[query] == 0) {
+      return;
+   }
+
+   if (!wait) {
+      GLuint available = 0;
+      glGetQueryObjectuiv(queryIDs_[query], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) {
+         return;
+      }
+   }
+
+   GLuint samples = 0;
+   glGetQueryObjectuiv(queryIDs_[query], GL_QUERY_RESULT, &samples);
+
+   overdraw_ = static_cast<float>(samples) / queryPixels_[query];
+   queryPixels_[query] = 0;
+}
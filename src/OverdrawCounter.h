@@ -0,0 +1,56 @@
+#ifndef OVERDRAW_COUNTER_H
+#define OVERDRAW_COUNTER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+/*
+ * Measures overdraw, the average number of fragments shaded per pixel, by counting the samples that pass the
+ * depth test during the color pass with an occlusion query. Queries are read a few frames late from a small ring
+ * so that counting never waits for the GPU.
+ */
+class OverdrawCounter {
+public:
+
+   // Number of frames a query result may lag behind
+   static constexpr int NUM_QUERIES = 3;
+
+   OverdrawCounter();
+
+   ~OverdrawCounter();
+
+   // Enables or disables counting, the counter does nothing while disabled
+   void setEnabled(bool enabled);
+
+   bool isEnabled();
+
+   // Starts counting the samples of the following draws, which cover |numPixels| pixels
+   void begin(unsigned int numPixels);
+
+   // Stops counting the samples of the current frame
+   void end();
+
+   // Returns the fragments shaded per pixel in the latest frame whose count is known, 0 if there is none yet
+   float getOverdraw();
+
+private:
+
+   GLuint queryIDs_[NUM_QUERIES];
+
+   // Pixels covered by each query's frame, 0 if the query holds no result to read
+   unsigned int queryPixels_[NUM_QUERIES];
+
+   // Query counting the current frame
+   int currentQuery_;
+
+   bool enabled_;
+
+   bool counting_;
+
+   float overdraw_;
+
+   // Reads the result of the given query if there is one
+   void readQuery(int query, bool wait);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "ParticleRenderer.h"
+
+#include <cstddef>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ShaderManager.h"
+#include "TextureManager.h"
+
+ParticleRenderer::ParticleRenderer()
+   : vaoID_(0),
+   quadBufID_(0),
+   instanceBufID_(0) {
+}
+
+ParticleRenderer::~ParticleRenderer() {
+   if (vaoID_ != 0) {
+      glDeleteVertexArrays(1, &vaoID_);
+      glDeleteBuffers(1, &quadBufID_);
+      glDeleteBuffers(1, &instanceBufID_);
+   }
+}
+
+void ParticleRenderer::draw(
+   const std::vector<ParticleSystem::ParticleInstance> instances[ParticleSystem::NUM_PARTICLE_TYPES],
+   const MatrixStack& P, const MatrixStack& V) {
+   bool anyParticles = false;
+   for (int type = 0; type < ParticleSystem::NUM_PARTICLE_TYPES; ++type) {
+      anyParticles = anyParticles || !instances[type].empty();
+   }
+
+   if (!anyParticles) {
+      return;
+   }
+
+   if (vaoID_ == 0) {
+      init();
+   }
+
+   ShaderManager& shaderManager = ShaderManager::instance();
+   const std::shared_ptr<Program> shaderProgram = shaderManager.bindShader(SHADER_NAME);
+   glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P.topMatrix()));
+   glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(V.topMatrix()));
+
+   // Blended on top of the scene without hiding each other
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glDepthMask(GL_FALSE);
+
+   glBindVertexArray(vaoID_);
+   glBindBuffer(GL_ARRAY_BUFFER, instanceBufID_);
+
+   for (int type = 0; type < ParticleSystem::NUM_PARTICLE_TYPES; ++type) {
+      const std::vector<ParticleSystem::ParticleInstance>& typeInstances = instances[type];
+      const std::shared_ptr<Texture>& texture = textures_[type];
+      if (typeInstances.empty()) {
+         continue;
+      }
+
+      // Orphan the buffer so the previous draw doesn't have to finish first
+      glBufferData(GL_ARRAY_BUFFER, ParticleSystem::CAPACITY * sizeof(ParticleSystem::ParticleInstance), nullptr,
+         GL_STREAM_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, typeInstances.size() * sizeof(ParticleSystem::ParticleInstance),
+         typeInstances.data());
+
+      if (texture) {
+         texture->bind(0, shaderProgram);
+      }
+      glUniform1i(shaderProgram->getUniform("textureActive"), texture ? 1 : 0);
+
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, typeInstances.size());
+
+      if (texture) {
+         texture->unbind();
+      }
+   }
+
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   glBindVertexArray(0);
+
+   glDepthMask(GL_TRUE);
+   glDisable(GL_BLEND);
+
+   shaderManager.unbindShader();
+}
+
+void ParticleRenderer::init() {
+   static const GLfloat quadVerts[] = {
+      -1.0f, -1.0f,
+      1.0f, -1.0f,
+      -1.0f, 1.0f,
+      1.0f, 1.0f
+   };
+
+   glGenVertexArrays(1, &vaoID_);
+   glBindVertexArray(vaoID_);
+
+   glGenBuffers(1, &quadBufID_);
+   glBindBuffer(GL_ARRAY_BUFFER, quadBufID_);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), quadVerts, GL_STATIC_DRAW);
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
+
+   glGenBuffers(1, &instanceBufID_);
+   glBindBuffer(GL_ARRAY_BUFFER, instanceBufID_);
+   glBufferData(GL_ARRAY_BUFFER, ParticleSystem::CAPACITY * sizeof(ParticleSystem::ParticleInstance), nullptr,
+      GL_STREAM_DRAW);
+
+   glEnableVertexAttribArray(POSITION_SIZE_ATTRIBUTE);
+   glVertexAttribPointer(POSITION_SIZE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleSystem::ParticleInstance),
+      (const void *)offsetof(ParticleSystem::ParticleInstance, positionSize));
+   glVertexAttribDivisor(POSITION_SIZE_ATTRIBUTE, 1);
+
+   glEnableVertexAttribArray(COLOR_ATTRIBUTE);
+   glVertexAttribPointer(COLOR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleSystem::ParticleInstance),
+      (const void *)offsetof(ParticleSystem::ParticleInstance, color));
+   glVertexAttribDivisor(COLOR_ATTRIBUTE, 1);
+
+   glBindVertexArray(0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   for (int type = 0; type < ParticleSystem::NUM_PARTICLE_TYPES; ++type) {
+      const char* texturePath = ParticleSystem::getTexturePath(static_cast<ParticleSystem::ParticleType>(type));
+      if (texturePath != nullptr) {
+         textures_[type] = TextureManager::instance().getTexture(texturePath);
+      }
+   }
+}
@@ -0,0 +1,50 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+#include <vector>
+
+#include "MatrixStack.h"
+#include "ParticleSystem.h"
+#include "Texture.h"
+
+/*
+ * Draws the particles of a frame as collected by |ParticleSystem::collectInstances|. All particles of a type are
+ * drawn with one instanced draw of a shared quad ("billboard_*.glsl"). Owned by the renderer, so the buffers and
+ * textures are only ever touched by the thread drawing the frames.
+ */
+class ParticleRenderer {
+public:
+
+   // Name of the shader used to draw the particles
+   static constexpr const char* SHADER_NAME = "Billboard";
+
+   // Attribute locations of the per particle data in "billboard_vert.glsl"
+   static constexpr unsigned int POSITION_SIZE_ATTRIBUTE = 2;
+   static constexpr unsigned int COLOR_ATTRIBUTE = 3;
+
+   ParticleRenderer();
+
+   ~ParticleRenderer();
+
+   // Draws the given instances (one list per type), blended on top of the scene
+   void draw(const std::vector<ParticleSystem::ParticleInstance> instances[ParticleSystem::NUM_PARTICLE_TYPES],
+      const MatrixStack& P, const MatrixStack& V);
+
+private:
+
+   GLuint vaoID_;
+   GLuint quadBufID_;
+   GLuint instanceBufID_;
+
+   // Texture of each type, empty for untextured types
+   std::shared_ptr<Texture> textures_[ParticleSystem::NUM_PARTICLE_TYPES];
+
+   // Creates the shared quad and instance buffer and requests the particle textures. Called by the first |draw|
+   void init();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "ParticleSystem.h"
+
+#include <cstdlib>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PARTICLE_SYSTEM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+   // Returns a random float in [min, max]
+   float randomFloat(float min, float max) {
+      return min + (max - min) * (static_cast<float>(std::rand()) / RAND_MAX);
+   }
+}
+
+const ParticleSystem::ParticleSettings ParticleSystem::settings_[NUM_PARTICLE_TYPES] = {
+   // POW
+   { 3.0f, 1.0f, 0.0f, glm::vec4(1.0f), "../resources/billboard/pow-text-stuff.jpg" },
+
+   // SPARK
+   { 0.6f, 0.08f, 9.8f, glm::vec4(1.0f, 0.75f, 0.25f, 1.0f), nullptr }
+};
+
+ParticleSystem::ParticleSystem() {
+   for (ParticlePool& pool : pools_) {
+      pool.positionX.assign(CAPACITY, 0.0f);
+      pool.positionY.assign(CAPACITY, 0.0f);
+      pool.positionZ.assign(CAPACITY, 0.0f);
+      pool.velocityX.assign(CAPACITY, 0.0f);
+      pool.velocityY.assign(CAPACITY, 0.0f);
+      pool.velocityZ.assign(CAPACITY, 0.0f);
+      pool.age.assign(CAPACITY, 0.0f);
+      pool.first = 0;
+      pool.count = 0;
+   }
+}
+
+ParticleSystem::~ParticleSystem() {
+
+}
+
+void ParticleSystem::emit(ParticleType type, const glm::vec3& position, const glm::vec3& velocity) {
+   ParticlePool& pool = pools_[type];
+
+   // A full pool drops it's oldest particle
+   if (pool.count == CAPACITY) {
+      pool.first = (pool.first + 1) % CAPACITY;
+      pool.count--;
+   }
+
+   unsigned int i = (pool.first + pool.count) % CAPACITY;
+   pool.positionX[i] = position.x;
+   pool.positionY[i] = position.y;
+   pool.positionZ[i] = position.z;
+   pool.velocityX[i] = velocity.x;
+   pool.velocityY[i] = velocity.y;
+   pool.velocityZ[i] = velocity.z;
+   pool.age[i] = 0.0f;
+   pool.count++;
+}
+
+void ParticleSystem::spawnHitEffect(const glm::vec3& position) {
+   emit(POW, position, glm::vec3(0.0f, 5.0f, 0.0f));
+
+   for (unsigned int i = 0; i < SPARKS_PER_HIT; ++i) {
+      // Upwards hemisphere, so the sparks arc out and fall back down
+      glm::vec3 direction(randomFloat(-1.0f, 1.0f), randomFloat(0.2f, 1.0f), randomFloat(-1.0f, 1.0f));
+      emit(SPARK, position, glm::normalize(direction) * randomFloat(3.0f, 7.0f));
+   }
+}
+
+void ParticleSystem::update(float deltaTime) {
+   for (int type = 0; type < NUM_PARTICLE_TYPES; ++type) {
+      ParticlePool& pool = pools_[type];
+      if (pool.count == 0) {
+         continue;
+      }
+
+      simulate(pool, settings_[type].gravity, deltaTime);
+
+      while (pool.count > 0 && pool.age[pool.first] >= settings_[type].lifetime) {
+         pool.first = (pool.first + 1) % CAPACITY;
+         pool.count--;
+      }
+   }
+}
+
+void ParticleSystem::simulate(ParticlePool& pool, float gravity, float deltaTime) {
+   // Dead slots are simulated too, it's cheaper than skipping them and they are overwritten when reused
+#ifdef PARTICLE_SYSTEM_SSE
+   const __m128 dt = _mm_set1_ps(deltaTime);
+   const __m128 dv = _mm_set1_ps(-gravity * deltaTime);
+
+   for (unsigned int i = 0; i < CAPACITY; i += 4) {
+      __m128 vy = _mm_add_ps(_mm_loadu_ps(&pool.velocityY[i]), dv);
+      _mm_storeu_ps(&pool.velocityY[i], vy);
+
+      _mm_storeu_ps(&pool.positionX[i],
+         _mm_add_ps(_mm_loadu_ps(&pool.positionX[i]), _mm_mul_ps(_mm_loadu_ps(&pool.velocityX[i]), dt)));
+      _mm_storeu_ps(&pool.positionY[i], _mm_add_ps(_mm_loadu_ps(&pool.positionY[i]), _mm_mul_ps(vy, dt)));
+      _mm_storeu_ps(&pool.positionZ[i],
+         _mm_add_ps(_mm_loadu_ps(&pool.positionZ[i]), _mm_mul_ps(_mm_loadu_ps(&pool.velocityZ[i]), dt)));
+      _mm_storeu_ps(&pool.age[i], _mm_add_ps(_mm_loadu_ps(&pool.age[i]), dt));
+   }
+#else
+   for (unsigned int i = 0; i < CAPACITY; ++i) {
+      pool.velocityY[i] -= gravity * deltaTime;
+      pool.positionX[i] += pool.velocityX[i] * deltaTime;
+      pool.positionY[i] += pool.velocityY[i] * deltaTime;
+      pool.positionZ[i] += pool.velocityZ[i] * deltaTime;
+      pool.age[i] += deltaTime;
+   }
+#endif
+}
+
+void ParticleSystem::collectInstances(std::vector<ParticleInstance> instances[NUM_PARTICLE_TYPES]) const {
+   for (int type = 0; type < NUM_PARTICLE_TYPES; ++type) {
+      const ParticlePool& pool = pools_[type];
+      const ParticleSettings& particleSettings = settings_[type];
+
+      instances[type].clear();
+      for (unsigned int n = 0; n < pool.count; ++n) {
+         unsigned int i = (pool.first + n) % CAPACITY;
+
+         // Fade out over the last third of the lifetime
+         float fade = glm::clamp(3.0f * (1.0f - pool.age[i] / particleSettings.lifetime), 0.0f, 1.0f);
+
+         ParticleInstance instance;
+         instance.positionSize = glm::vec4(pool.positionX[i], pool.positionY[i], pool.positionZ[i],
+            particleSettings.size);
+         instance.color = glm::vec4(glm::vec3(particleSettings.color), particleSettings.color.a * fade);
+         instances[type].push_back(instance);
+      }
+   }
+}
+
+unsigned int ParticleSystem::getNumParticles(ParticleType type) const {
+   return pools_[type].count;
+}
+
+const char* ParticleSystem::getTexturePath(ParticleType type) {
+   return settings_[type].texturePath;
+}
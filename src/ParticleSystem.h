@@ -0,0 +1,97 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/*
+ * Pooled particles for short lived effects, like the "POW" and sparks of a cookie hit. Every particle type has a
+ * fixed capacity ring buffer stored as a structure of arrays and simulated four particles at a time with SSE.
+ * The live particles are collected into a list per type once per frame, which |ParticleRenderer| draws with one
+ * instanced draw each, so spawning effects never allocates memory or adds draw calls.
+ */
+class ParticleSystem {
+public:
+
+   enum ParticleType {
+      POW,
+      SPARK,
+      NUM_PARTICLE_TYPES
+   };
+
+   // Particles per type, a multiple of the SIMD width. When a pool is full the oldest particle is replaced
+   static constexpr unsigned int CAPACITY = 4096;
+
+   // Sparks flying off of every hit
+   static constexpr unsigned int SPARKS_PER_HIT = 24;
+
+   // Per instance data read by "billboard_vert.glsl"
+   struct ParticleInstance {
+      glm::vec4 positionSize;
+      glm::vec4 color;
+   };
+
+   ParticleSystem();
+
+   ~ParticleSystem();
+
+   // Spawns one particle
+   void emit(ParticleType type, const glm::vec3& position, const glm::vec3& velocity);
+
+   // Spawns a rising "POW" with a burst of sparks at the given position
+   void spawnHitEffect(const glm::vec3& position);
+
+   // Advances all particles and removes the expired ones
+   void update(float deltaTime);
+
+   // Replaces the contents of |instances| (one list per type) with the live particles as they are drawn
+   void collectInstances(std::vector<ParticleInstance> instances[NUM_PARTICLE_TYPES]) const;
+
+   unsigned int getNumParticles(ParticleType type) const;
+
+   // Returns the path of the texture drawn on particles of the type, |nullptr| for round dots
+   static const char* getTexturePath(ParticleType type);
+
+private:
+
+   // Behaviour shared by all particles of a type
+   struct ParticleSettings {
+      float lifetime;
+
+      // Half the width of the quad in world units
+      float size;
+
+      // Downwards acceleration
+      float gravity;
+
+      glm::vec4 color;
+
+      // Texture drawn on the quad, untextured particles are round dots
+      const char* texturePath;
+   };
+
+   // Live particles are [first, first + count) modulo |CAPACITY|. All particles of a type live equally long,
+   // so they expire in the order they were emitted
+   struct ParticlePool {
+      std::vector<float> positionX;
+      std::vector<float> positionY;
+      std::vector<float> positionZ;
+      std::vector<float> velocityX;
+      std::vector<float> velocityY;
+      std::vector<float> velocityZ;
+      std::vector<float> age;
+
+      unsigned int first;
+      unsigned int count;
+   };
+
+   static const ParticleSettings settings_[NUM_PARTICLE_TYPES];
+
+   ParticlePool pools_[NUM_PARTICLE_TYPES];
+
+   // Advances the particles of one pool
+   void simulate(ParticlePool& pool, float gravity, float deltaTime);
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "PlayerPhysicsComponent.h"
 
+#include "DebugDraw.h"
 #include "GameManager.h"
 #include "GameObject.h"
 #include "GameWorld.h"
@@ -30,6 +31,7 @@ void PlayerPhysicsComponent::updatePhysics(float deltaTime) {
          if (objTypeHit == GameObjectType::STATIC_OBJECT) {
             BoundingBox* objHitBB = objHit->getBoundingBox();
             glm::vec3 normalOfObjHit = objHitBB->calcReflNormal(getBoundingBox());
+            DebugDraw::instance().addContact(holder_->getPosition(), normalOfObjHit);
 
             if (normalOfObjHit.x != 0.0f) {
                newPosition.x = oldPosition.x;
@@ -9,15 +9,3 @@ PlayerRenderComponent::PlayerRenderComponent(std::shared_ptr<Shape> shape,
 }
 
 PlayerRenderComponent::~PlayerRenderComponent() {}
-
-void PlayerRenderComponent::draw(std::shared_ptr<MatrixStack> P,
-   std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V) {
-	ShaderManager& shaderManager = ShaderManager::instance();
-
-	shaderManager.renderObject(holder_, shaderName_, shape_, material_, P, V, M);
-}
-
-void PlayerRenderComponent::renderShadow(std::shared_ptr <MatrixStack> M) {
-    ShaderManager& shaderManager = ShaderManager::instance();
-    shaderManager.renderShadowPass(holder_, shape_, M);
-}
\ No newline at end of file
@@ -11,11 +11,6 @@ public:
 
    ~PlayerRenderComponent();
 
-	void draw(std::shared_ptr<MatrixStack> P,
-      std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V);
-
-	void renderShadow(std::shared_ptr<MatrixStack> M);
-
 private:
 
 };
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <string>
 
+#include "ClusteredLighting.h"
 #include "GLSL.h"
 #include "ShaderManager.h"
 
@@ -37,6 +38,14 @@ GLuint Program::getPid() {
 	return pid;
 }
 
+const std::string& Program::getVertexShaderName() const {
+	return vertexShaderName;
+}
+
+const std::string& Program::getFragmentShaderName() const {
+	return fragmentShaderName;
+}
+
 GLint Program::getAttribute(const std::string& name) const {
 	GLint attributeLocation = attributes.at(name);
 	return attributeLocation;
@@ -82,13 +91,15 @@ void Program::addDefaultAttributesAndUniforms() {
 	// Add transpose inverse M, so no per vertex calculation
 	addUniform("tiM");
 
-	// Add directional light uniforms
-	addUniform("numDirectionLights");
-	for (int i = 0; i < MAX_DIRECTIONAL_LIGHTS; ++i) {
-		addUniform("directionLights[" + std::to_string(i) + "].position");
-		addUniform("directionLights[" + std::to_string(i) + "].color");
-		addUniform("directionLights[" + std::to_string(i) + "].orientation");
-	}
+	// Add clustered lighting uniforms, directional lights come from the "DirectionalLights" block
+	addUniform("pointLights");
+	addUniform("clusterGrid");
+	addUniform("clusterLightIndices");
+	addUniform("clusterV");
+	addUniform("clusterP");
+	addUniform("clusterDims");
+	addUniform("clusterDepthRange");
+	ClusteredLighting::bindUniformBlocks(pid);
 
 	//TODO(nurgan) remove from default attributs
 	addUniform("cubemap");
@@ -97,10 +108,26 @@ void Program::addDefaultAttributesAndUniforms() {
 	addUniform("billboardTex");
 
 	addUniform("shadowMapTex");
+	addUniform("shadowMomentsTex");
 	addUniform("textureMap");
 
     addUniform("textureActive");
 
+	// Adds the inputs of the EVSM moments and blur passes
+	addUniform("shadowDepthTex");
+	addUniform("momentsDownsample");
+	addUniform("blurSource");
+	addUniform("blurDirection");
+
+	// Adds the bars of the profiler overlay
+	addUniform("overlayRect");
+	addUniform("overlayColor");
+
+	// Adds the per instance data of the debris shaders
+	addUniform("debrisData");
+	addUniform("debrisOffset");
+	addUniform("debrisStride");
+
 	// Adds material uniforms
 	addUniform("MatAmb");
 	addUniform("MatDif");
@@ -32,6 +32,10 @@ public:
 	// Returns the ID of this shader program
 	GLuint getPid();
 
+	// Returns the names of the linked vertex and fragment shaders
+	const std::string& getVertexShaderName() const;
+	const std::string& getFragmentShaderName() const;
+
 	// Returns the location of the attribute with the given name.
 	// Throws an |out_of_range| exception if no attribute with the given name is found
 	GLint getAttribute(const std::string &name) const;
@@ -0,0 +1,155 @@
+#include "ProgramBinaryCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+// Layout of the start of a cache file
+struct FileHeader {
+   uint32_t magic;
+   uint32_t format;
+   uint32_t length;
+};
+
+// 64 bit FNV-1a, continuing from |hash|
+uint64_t hashString(const std::string& data, uint64_t hash = 0xcbf29ce484222325ULL) {
+   for (unsigned char c : data) {
+      hash ^= c;
+      hash *= 0x100000001b3ULL;
+   }
+
+   return hash;
+}
+
+// Returns the GL string or an empty one if the driver doesn't report it
+std::string getGLString(GLenum name) {
+   const GLubyte* value = glGetString(name);
+   return value != nullptr ? reinterpret_cast<const char*>(value) : "";
+}
+
+}
+
+ProgramBinaryCache::ProgramBinaryCache()
+   : supportChecked_(false),
+   supported_(false) {}
+
+void ProgramBinaryCache::setDirectory(const std::string& directory) {
+   directory_ = directory;
+   if (!directory_.empty() && directory_.back() != '/' && directory_.back() != '\\') {
+      directory_ += '/';
+   }
+
+   // Fails harmlessly if it already exists
+#ifdef _WIN32
+   _mkdir(directory_.c_str());
+#else
+   mkdir(directory_.c_str(), 0755);
+#endif
+}
+
+bool ProgramBinaryCache::isEnabled() {
+   if (!supportChecked_) {
+      supportChecked_ = true;
+
+      GLint numFormats = 0;
+      if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+         glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+      }
+      supported_ = numFormats > 0;
+
+      driver_ = getGLString(GL_VENDOR) + "\n" + getGLString(GL_RENDERER) + "\n" + getGLString(GL_VERSION);
+   }
+
+   return supported_ && !directory_.empty();
+}
+
+std::string ProgramBinaryCache::getKey(const std::string& vertexSource, const std::string& fragmentSource) {
+   // Separators keep moving text from one part to the next from giving the same hash
+   uint64_t hash = hashString(driver_);
+   hash = hashString(std::string(1, '\0') + vertexSource, hash);
+   hash = hashString(std::string(1, '\0') + fragmentSource, hash);
+
+   char key[17];
+   std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+
+   return key;
+}
+
+GLuint ProgramBinaryCache::load(const std::string& key) {
+   std::ifstream file(getPath(key), std::ios::binary);
+   if (!file) {
+      return 0;
+   }
+
+   std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+   file.close();
+
+   FileHeader header;
+   if (contents.size() < sizeof(header)) {
+      std::remove(getPath(key).c_str());
+      return 0;
+   }
+   std::memcpy(&header, contents.data(), sizeof(header));
+
+   if (header.magic != FILE_MAGIC || header.length != contents.size() - sizeof(header)) {
+      std::remove(getPath(key).c_str());
+      return 0;
+   }
+
+   GLuint pid = glCreateProgram();
+   glProgramBinary(pid, header.format, contents.data() + sizeof(header), header.length);
+
+   // Drivers reject binaries of other builds even if they report the same version
+   GLint linkStatus;
+   glGetProgramiv(pid, GL_LINK_STATUS, &linkStatus);
+   if (!linkStatus) {
+      glDeleteProgram(pid);
+      std::remove(getPath(key).c_str());
+      return 0;
+   }
+
+   return pid;
+}
+
+bool ProgramBinaryCache::store(const std::string& key, GLuint pid) {
+   GLint length = 0;
+   glGetProgramiv(pid, GL_PROGRAM_BINARY_LENGTH, &length);
+   if (length <= 0) {
+      return false;
+   }
+
+   std::vector<char> binary(length);
+   GLenum format = 0;
+   glGetProgramBinary(pid, length, &length, &format, binary.data());
+
+   FileHeader header;
+   header.magic = FILE_MAGIC;
+   header.format = format;
+   header.length = length;
+
+   std::ofstream file(getPath(key), std::ios::binary);
+   if (!file) {
+      std::cerr << "Warning - Could not write the program binary " << getPath(key) << std::endl;
+      return false;
+   }
+
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   file.write(binary.data(), length);
+
+   return static_cast<bool>(file);
+}
+
+std::string ProgramBinaryCache::getPath(const std::string& key) const {
+   return directory_ + key + ".bin";
+}
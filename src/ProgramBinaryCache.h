@@ -0,0 +1,55 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Keeps the driver's binaries of linked shader programs on disk, so later launches can skip compiling and linking
+ * with a single glProgramBinary. Each binary is stored in it's own file named after a hash of the program's vertex
+ * and fragment shader source (which includes any injected defines) and the GL vendor, renderer and version, so
+ * editing a shader or updating the driver simply misses the cache. Binaries the driver rejects anyway are deleted.
+ */
+class ProgramBinaryCache {
+public:
+
+   // Start of every cache file, followed by the binary format, the binary's length and the binary itself
+   static constexpr uint32_t FILE_MAGIC = 0x42505247;
+
+   ProgramBinaryCache();
+
+   // Sets the directory the binaries are kept in, creating it if needed. The cache is disabled until it's set
+   void setDirectory(const std::string& directory);
+
+   // Returns true if a directory is set and the driver supports program binaries. Needs a current context
+   bool isEnabled();
+
+   // Returns the key a program linked from the given sources is stored under on the current driver
+   std::string getKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+   // Creates a program from the binary stored under the key. Returns 0 if there is none or the driver rejected it
+   GLuint load(const std::string& key);
+
+   // Stores the binary of the linked program under the key. The program should have been linked with
+   // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Returns false if the binary couldn't be written
+   bool store(const std::string& key, GLuint pid);
+
+private:
+
+   std::string directory_;
+
+   // Vendor, renderer and version of the driver, hashed into every key
+   std::string driver_;
+
+   // Whether the driver supports program binaries, queried by the first |isEnabled|
+   bool supportChecked_;
+   bool supported_;
+
+   // Returns the path of the file the key's binary is stored in
+   std::string getPath(const std::string& key) const;
+};
+
+#endif
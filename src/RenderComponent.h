@@ -10,6 +10,8 @@
 
 #include "Component.h"
 
+class Cubemap;
+
 class RenderComponent : public Component {
 public:
 
@@ -17,7 +19,9 @@ public:
 	RenderComponent(std::shared_ptr<Shape> shape, const std::string& shaderName, std::shared_ptr<Material> material)
 		: shape_(shape), 
 		shaderName_(shaderName),
-		material_(material) {}
+		material_(material),
+		castsShadow_(true),
+		isSkybox_(false) {}
 
 	virtual ~RenderComponent() {}
 
@@ -28,15 +32,18 @@ public:
 
 	inline void setMaterial(std::shared_ptr<Material> newMaterial) { material_ = newMaterial; }
 
-	inline std::string getShader() { return shaderName_; }
+	inline const std::string& getShader() { return shaderName_; }
 
-	// Draws the object using the passed Perspective (P), Model (M), and View (V) matrices
-	virtual void draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V) = 0;
+	inline void changeShader(const std::string& newShaderName) { shaderName_ = newShaderName; }
 
-    // Renders the depht of the object to the shadow map
-    virtual void renderShadow(std::shared_ptr<MatrixStack> M) = 0;
+	// Returns true if the object should be rendered into the shadow map
+	inline bool castsShadow() { return castsShadow_; }
 
-	inline void changeShader(const std::string& newShaderName) { shaderName_ = newShaderName; }
+	// Returns true if the object is the sky, drawn in a pass of its own after everything opaque
+	inline bool isSkybox() { return isSkybox_; }
+
+	// Returns the sky texture of a skybox, |nullptr| for everything else
+	virtual Cubemap* getCubemap() { return nullptr; }
 
 protected:
 
@@ -49,6 +56,12 @@ protected:
 	// Material that is currently in use for this object
 	std::shared_ptr<Material> material_;
 
+	// Whether or not the object is drawn during the shadow pass
+	bool castsShadow_;
+
+	// Whether or not the object is drawn as the sky instead of with the rest of the world
+	bool isSkybox_;
+
 private:
 
 };
@@ -0,0 +1,314 @@
+#include "RenderProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ShaderManager.h"
+
+namespace {
+
+// Returns the current CPU time in seconds
+double getCurrentTime() {
+   return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bar colors of the passes, GPU bars are drawn in full and CPU bars at half brightness
+const float passColors[RenderProfiler::NUM_PASSES + 1][3] = {
+   {0.9f, 0.3f, 0.2f},
+   {0.6f, 0.6f, 0.6f},
+   {0.2f, 0.8f, 0.3f},
+   {0.2f, 0.5f, 0.9f},
+   {0.9f, 0.8f, 0.2f},
+   {0.8f, 0.3f, 0.8f},
+   {1.0f, 1.0f, 1.0f}
+};
+
+}
+
+RenderProfiler& RenderProfiler::instance() {
+   static RenderProfiler *instance = new RenderProfiler();
+   return *instance;
+}
+
+RenderProfiler::RenderProfiler()
+   : currentFrame_(0),
+   queriesCreated_(false),
+   enabled_(false),
+   overlay_(false),
+   frameActive_(false),
+   numDroppedFrames_(0),
+   overlayVAO_(0) {
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      active_[i] = false;
+      cpuStart_[i] = 0.0;
+      cpuFrameTimes_[i] = 0.0;
+      gpuTimes_[i] = 0.0;
+      cpuTimes_[i] = 0.0;
+   }
+
+   for (FrameQueries& frame : frames_) {
+      frame.pending = false;
+   }
+}
+
+RenderProfiler::~RenderProfiler() {
+   if (queriesCreated_) {
+      for (FrameQueries& frame : frames_) {
+         glDeleteQueries(NUM_PASSES + 1, frame.begin);
+         glDeleteQueries(NUM_PASSES + 1, frame.end);
+      }
+   }
+
+   if (overlayVAO_ != 0) {
+      glDeleteVertexArrays(1, &overlayVAO_);
+   }
+}
+
+void RenderProfiler::setEnabled(bool enabled) {
+   enabled_ = enabled;
+
+   // Results of an earlier run would be stale
+   for (FrameQueries& frame : frames_) {
+      frame.pending = false;
+   }
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      active_[i] = false;
+      gpuTimes_[i] = 0.0;
+      cpuTimes_[i] = 0.0;
+   }
+   frameActive_ = false;
+
+   if (!enabled_) {
+      overlay_ = false;
+   }
+}
+
+bool RenderProfiler::isEnabled() {
+   return enabled_;
+}
+
+void RenderProfiler::setOverlay(bool enabled) {
+   if (enabled && !enabled_) {
+      setEnabled(true);
+   }
+
+   overlay_ = enabled;
+}
+
+bool RenderProfiler::isOverlay() {
+   return overlay_;
+}
+
+void RenderProfiler::beginFrame() {
+   if (!enabled_) {
+      return;
+   }
+
+   if (!queriesCreated_) {
+      for (FrameQueries& frame : frames_) {
+         glGenQueries(NUM_PASSES + 1, frame.begin);
+         glGenQueries(NUM_PASSES + 1, frame.end);
+      }
+      queriesCreated_ = true;
+   }
+
+   FrameQueries& frame = frames_[currentFrame_];
+   if (frame.pending) {
+      readFrame(frame);
+   }
+
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      frame.timed[i] = false;
+      active_[i] = false;
+      cpuFrameTimes_[i] = 0.0;
+   }
+   frameActive_ = true;
+
+   glQueryCounter(frame.begin[FRAME_INDEX], GL_TIMESTAMP);
+   cpuStart_[FRAME_INDEX] = getCurrentTime();
+}
+
+void RenderProfiler::endFrame() {
+   if (!frameActive_) {
+      return;
+   }
+
+   // The overlay shows the times of earlier frames, so drawing it is part of this one
+   if (overlay_) {
+      drawOverlay();
+   }
+
+   FrameQueries& frame = frames_[currentFrame_];
+   glQueryCounter(frame.end[FRAME_INDEX], GL_TIMESTAMP);
+   frame.timed[FRAME_INDEX] = true;
+   frame.pending = true;
+   frameActive_ = false;
+
+   cpuFrameTimes_[FRAME_INDEX] = getCurrentTime() - cpuStart_[FRAME_INDEX];
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      cpuTimes_[i] += SMOOTHING * (cpuFrameTimes_[i] * 1000.0 - cpuTimes_[i]);
+   }
+
+   currentFrame_ = (currentFrame_ + 1) % NUM_FRAMES;
+}
+
+void RenderProfiler::beginPass(RenderPass pass) {
+   int i = static_cast<int>(pass);
+   if (!frameActive_ || active_[i] || frames_[currentFrame_].timed[i]) {
+      return;
+   }
+
+   active_[i] = true;
+   glQueryCounter(frames_[currentFrame_].begin[i], GL_TIMESTAMP);
+   cpuStart_[i] = getCurrentTime();
+}
+
+void RenderProfiler::endPass(RenderPass pass) {
+   int i = static_cast<int>(pass);
+   if (!active_[i]) {
+      return;
+   }
+
+   cpuFrameTimes_[i] = getCurrentTime() - cpuStart_[i];
+   glQueryCounter(frames_[currentFrame_].end[i], GL_TIMESTAMP);
+
+   active_[i] = false;
+   frames_[currentFrame_].timed[i] = true;
+}
+
+double RenderProfiler::getGpuTime(RenderPass pass) {
+   return gpuTimes_[static_cast<int>(pass)];
+}
+
+double RenderProfiler::getCpuTime(RenderPass pass) {
+   return cpuTimes_[static_cast<int>(pass)];
+}
+
+double RenderProfiler::getFrameGpuTime() {
+   return gpuTimes_[FRAME_INDEX];
+}
+
+double RenderProfiler::getFrameCpuTime() {
+   return cpuTimes_[FRAME_INDEX];
+}
+
+unsigned long RenderProfiler::getNumDroppedFrames() {
+   return numDroppedFrames_;
+}
+
+void RenderProfiler::printTimes(std::ostream& out) {
+   out << "GPU / CPU ms:";
+   for (int i = 0; i < NUM_PASSES; ++i) {
+      RenderPass pass = static_cast<RenderPass>(i);
+      out << " " << getPassName(pass) << " " << getGpuTime(pass) << " / " << getCpuTime(pass) << ",";
+   }
+
+   out << " frame " << getFrameGpuTime() << " / " << getFrameCpuTime()
+      << (getFrameGpuTime() > getFrameCpuTime() ? " (GPU bound)" : " (CPU bound)") << std::endl;
+}
+
+const char* RenderProfiler::getPassName(RenderPass pass) {
+   switch (pass) {
+   case RenderPass::SHADOW:
+      return "shadow";
+   case RenderPass::DEPTH_PRE_PASS:
+      return "depth pre-pass";
+   case RenderPass::MAIN:
+      return "main";
+   case RenderPass::SKYBOX:
+      return "skybox";
+   case RenderPass::PARTICLES:
+      return "particles";
+   case RenderPass::VFC_VIEWPORT:
+      return "VFC viewport";
+   default:
+      return "unknown";
+   }
+}
+
+void RenderProfiler::readFrame(FrameQueries& frame) {
+   frame.pending = false;
+
+   // Timestamps complete in order, so all of the frame's are done once it's last one is
+   GLint available = 0;
+   glGetQueryObjectiv(frame.end[FRAME_INDEX], GL_QUERY_RESULT_AVAILABLE, &available);
+   if (!available) {
+      numDroppedFrames_++;
+      return;
+   }
+
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      double time = 0.0;
+
+      // Passes skipped in the frame took no time
+      if (frame.timed[i]) {
+         GLuint64 begin = 0;
+         GLuint64 end = 0;
+         glGetQueryObjectui64v(frame.begin[i], GL_QUERY_RESULT, &begin);
+         glGetQueryObjectui64v(frame.end[i], GL_QUERY_RESULT, &end);
+
+         time = (end - begin) / 1000000.0;
+      }
+
+      gpuTimes_[i] += SMOOTHING * (time - gpuTimes_[i]);
+   }
+}
+
+void RenderProfiler::drawOverlay() {
+   ShaderManager& shaderManager = ShaderManager::instance();
+   if (!shaderManager.hasShaderProgram(OVERLAY_SHADER_NAME)) {
+      return;
+   }
+
+   if (overlayVAO_ == 0) {
+      glGenVertexArrays(1, &overlayVAO_);
+   }
+
+   std::shared_ptr<Program> program = shaderManager.bindShader(OVERLAY_SHADER_NAME);
+   GLint rectLocation = program->getUniform("overlayRect");
+   GLint colorLocation = program->getUniform("overlayColor");
+
+   GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+   glDisable(GL_DEPTH_TEST);
+   glBindVertexArray(overlayVAO_);
+
+   constexpr float left = -0.95f;
+   constexpr float top = 0.95f;
+   constexpr float fullWidth = 0.8f;
+   constexpr float barHeight = 0.02f;
+   constexpr float rowHeight = 2.0f * barHeight + 0.01f;
+   const float backgroundColor[] = {0.0f, 0.0f, 0.0f};
+
+   drawOverlayRect(rectLocation, colorLocation, left - 0.01f, top + 0.01f, fullWidth + 0.02f,
+      (NUM_PASSES + 1) * rowHeight + 0.01f, backgroundColor);
+
+   for (int i = 0; i <= NUM_PASSES; ++i) {
+      float rowTop = top - i * rowHeight;
+      float gpuWidth = static_cast<float>(std::min(gpuTimes_[i] / OVERLAY_FULL_SCALE_MS, 1.0)) * fullWidth;
+      float cpuWidth = static_cast<float>(std::min(cpuTimes_[i] / OVERLAY_FULL_SCALE_MS, 1.0)) * fullWidth;
+      const float cpuColor[] = {0.5f * passColors[i][0], 0.5f * passColors[i][1], 0.5f * passColors[i][2]};
+
+      drawOverlayRect(rectLocation, colorLocation, left, rowTop, gpuWidth, barHeight, passColors[i]);
+      drawOverlayRect(rectLocation, colorLocation, left, rowTop - barHeight, cpuWidth, barHeight, cpuColor);
+   }
+
+   // Tick at the time of a 60 Hz frame
+   const float tickColor[] = {1.0f, 1.0f, 1.0f};
+   float tickX = left + static_cast<float>(1000.0 / 60.0 / OVERLAY_FULL_SCALE_MS) * fullWidth;
+   drawOverlayRect(rectLocation, colorLocation, tickX, top + 0.01f, 0.003f, (NUM_PASSES + 1) * rowHeight + 0.01f,
+      tickColor);
+
+   glBindVertexArray(0);
+   shaderManager.unbindShader();
+
+   if (depthTest) {
+      glEnable(GL_DEPTH_TEST);
+   }
+}
+
+void RenderProfiler::drawOverlayRect(GLint rectLocation, GLint colorLocation, float left, float top, float width,
+   float height, const float* color) {
+   glUniform4f(rectLocation, left, top - height, left + width, top);
+   glUniform3fv(colorLocation, 1, color);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
@@ -0,0 +1,144 @@
+#ifndef RENDER_PROFILER_H
+#define RENDER_PROFILER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <ostream>
+
+// Parts of a frame timed by the |RenderProfiler|
+enum class RenderPass { SHADOW, DEPTH_PRE_PASS, MAIN, SKYBOX, PARTICLES, VFC_VIEWPORT };
+
+/*
+ * Measures how long each render pass takes on the GPU and how long the CPU spends submitting it. GPU times come
+ * from GL_TIMESTAMP queries written at the start and end of every pass, so passes may nest (the skybox is drawn
+ * as part of the main pass). The queries of the last |NUM_FRAMES| frames are kept in a ring and a frame's results
+ * are only read once the GPU is done with them, frames it's still working on when their queries come up for
+ * reuse are dropped instead of waiting.
+ *
+ * Times are smoothed over several frames. Comparing the whole frame's GPU and CPU time tells whether a level is
+ * GPU or CPU bound.
+ */
+class RenderProfiler {
+public:
+
+   static constexpr int NUM_PASSES = 6;
+
+   // Frames of queries in flight
+   static constexpr int NUM_FRAMES = 4;
+
+   // Weight of the newest frame in the smoothed times
+   static constexpr double SMOOTHING = 0.1;
+
+   // Program drawing the bars of the overlay
+   static constexpr const char* OVERLAY_SHADER_NAME = "profilerOverlay";
+
+   // Frame time (ms) the full width of the overlay's bars stands for, a tick marks every 1/60 second
+   static constexpr double OVERLAY_FULL_SCALE_MS = 50.0;
+
+   static RenderProfiler& instance();
+
+   ~RenderProfiler();
+
+   // Enables or disables profiling, nothing is timed while disabled
+   void setEnabled(bool enabled);
+
+   bool isEnabled();
+
+   // Enables or disables drawing the times on top of the frame, which also enables profiling
+   void setOverlay(bool enabled);
+
+   bool isOverlay();
+
+   // Starts timing a frame, every pass has to be timed between this and |endFrame|
+   void beginFrame();
+
+   // Stops timing the current frame and draws the overlay (if enabled) into the bound framebuffer
+   void endFrame();
+
+   // Starts timing the given pass. Each pass is timed once per frame, later repeats are left out
+   void beginPass(RenderPass pass);
+
+   void endPass(RenderPass pass);
+
+   // Returns the smoothed GPU time of the pass in milliseconds
+   double getGpuTime(RenderPass pass);
+
+   // Returns the smoothed CPU time spent submitting the pass in milliseconds
+   double getCpuTime(RenderPass pass);
+
+   // Returns the smoothed GPU time of the whole frame in milliseconds
+   double getFrameGpuTime();
+
+   // Returns the smoothed CPU time of the whole frame in milliseconds
+   double getFrameCpuTime();
+
+   // Returns the number of frames whose GPU times were dropped because they weren't ready in time
+   unsigned long getNumDroppedFrames();
+
+   // Prints the times of all passes and whether the frame is GPU or CPU bound
+   void printTimes(std::ostream& out);
+
+   // Returns a printable name of the pass
+   static const char* getPassName(RenderPass pass);
+
+private:
+
+   // Index of the whole frame in the per pass arrays
+   static constexpr int FRAME_INDEX = NUM_PASSES;
+
+   // Timestamp queries written for the start and end of every pass and the frame
+   struct FrameQueries {
+      GLuint begin[NUM_PASSES + 1];
+      GLuint end[NUM_PASSES + 1];
+
+      // Which passes were timed in the frame
+      bool timed[NUM_PASSES + 1];
+
+      // Whether the queries hold results that weren't read yet
+      bool pending;
+   };
+
+   FrameQueries frames_[NUM_FRAMES];
+
+   // Frame in |frames_| currently being timed
+   int currentFrame_;
+
+   bool queriesCreated_;
+
+   bool enabled_;
+
+   bool overlay_;
+
+   bool frameActive_;
+
+   // Passes begun but not yet ended this frame
+   bool active_[NUM_PASSES + 1];
+
+   // Time the CPU started each pass at and the time it took this frame, in seconds
+   double cpuStart_[NUM_PASSES + 1];
+   double cpuFrameTimes_[NUM_PASSES + 1];
+
+   // Smoothed times in milliseconds
+   double gpuTimes_[NUM_PASSES + 1];
+   double cpuTimes_[NUM_PASSES + 1];
+
+   unsigned long numDroppedFrames_;
+
+   // Empty vertex array the overlay's bars are drawn with
+   GLuint overlayVAO_;
+
+   RenderProfiler();
+
+   // Reads the GPU times of the frame if the GPU is done with it, otherwise drops them
+   void readFrame(FrameQueries& frame);
+
+   // Draws a bar per pass, GPU time above CPU time, in the top left corner of the viewport
+   void drawOverlay();
+
+   // Draws a solid rectangle in normalized device coordinates with the overlay program
+   void drawOverlayRect(GLint rectLocation, GLint colorLocation, float left, float top, float width, float height,
+      const float* color);
+};
+
+#endif
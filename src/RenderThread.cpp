@@ -0,0 +1,121 @@
+#include "RenderThread.h"
+
+#include <iostream>
+
+#include "AsyncLoader.h"
+#include "RenderProfiler.h"
+#include "WindowManager.h"
+
+RenderThread::RenderThread()
+   : running_(false),
+   pending_(false) {}
+
+RenderThread::~RenderThread() {
+   stop();
+}
+
+void RenderThread::start() {
+   if (running_) {
+      return;
+   }
+
+   // A context can only be current on one thread at a time
+   WindowManager::instance().releaseContext();
+
+   pending_ = false;
+   running_ = true;
+   thread_ = std::thread(&RenderThread::run, this);
+}
+
+void RenderThread::stop() {
+   if (!running_) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+   }
+   published_.notify_one();
+   consumed_.notify_all();
+
+   thread_.join();
+
+   WindowManager::instance().makeContextCurrent();
+}
+
+bool RenderThread::isRunning() {
+   return running_;
+}
+
+FrameSnapshot& RenderThread::getBackSnapshot() {
+   return snapshots_.getBack();
+}
+
+void RenderThread::publish() {
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      snapshots_.publish();
+      pending_ = true;
+   }
+   published_.notify_one();
+}
+
+void RenderThread::waitForRenderer() {
+   std::unique_lock<std::mutex> lock(mutex_);
+   consumed_.wait(lock, [this]() { return !running_ || !pending_; });
+}
+
+void RenderThread::run() {
+   WindowManager& windowManager = WindowManager::instance();
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+
+   windowManager.makeContextCurrent();
+
+   double secondClock = glfwGetTime();
+
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         published_.wait(lock, [this]() { return !running_ || pending_; });
+         if (!running_) {
+            break;
+         }
+
+         snapshots_.update();
+         pending_ = false;
+      }
+      consumed_.notify_all();
+
+      // Upload the textures decoded in the background since the last frame, within a small time budget
+      AsyncLoader::instance().update();
+
+      renderProfiler.beginFrame();
+      renderer_.render(snapshots_.getFront());
+
+      // Also draws the profiler overlay if enabled
+      renderProfiler.endFrame();
+
+      windowManager.swapBuffers();
+
+      // Print info roughly every second
+      if (glfwGetTime() - secondClock >= 1.0) {
+         printStats();
+         secondClock = glfwGetTime();
+      }
+   }
+
+   windowManager.releaseContext();
+}
+
+void RenderThread::printStats() {
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+   if (renderProfiler.isEnabled()) {
+      renderProfiler.printTimes(std::cout);
+   }
+
+   OverdrawCounter& overdrawCounter = renderer_.getOverdrawCounter();
+   if (overdrawCounter.isEnabled()) {
+      std::cout << "Overdraw: " << overdrawCounter.getOverdraw() << " fragments per pixel" << std::endl;
+   }
+}
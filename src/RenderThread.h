@@ -0,0 +1,70 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "FrameSnapshot.h"
+#include "TripleBuffer.h"
+#include "WorldRenderer.h"
+
+/*
+ * Runs the |WorldRenderer| on it's own thread, which owns the GL context while it runs. The simulation fills the
+ * back snapshot at the end of every tick and publishes it, the render thread always draws the latest published
+ * snapshot. Snapshots are triple buffered, so neither thread ever waits for the other to finish with a snapshot.
+ *
+ * To keep input latency down the simulation is paced by the renderer and runs at most one frame ahead: it waits
+ * with publishing until the renderer picked up the previous snapshot (see |waitForRenderer|).
+ */
+class RenderThread {
+public:
+
+   RenderThread();
+
+   ~RenderThread();
+
+   // Hands the GL context over to a new thread and starts rendering published snapshots.
+   // Must be called on the thread the context is current on
+   void start();
+
+   // Stops rendering and makes the GL context current on the calling thread again
+   void stop();
+
+   bool isRunning();
+
+   // Returns the snapshot for the simulation to fill
+   FrameSnapshot& getBackSnapshot();
+
+   // Publishes the back snapshot for the renderer and hands the simulation a new one
+   void publish();
+
+   // Blocks until the renderer picked up the last published snapshot
+   void waitForRenderer();
+
+private:
+
+   TripleBuffer<FrameSnapshot> snapshots_;
+
+   std::thread thread_;
+   std::atomic<bool> running_;
+
+   // Guards |pending_|
+   std::mutex mutex_;
+   std::condition_variable published_;
+   std::condition_variable consumed_;
+
+   // Whether a snapshot was published that the renderer didn't pick up yet
+   bool pending_;
+
+   WorldRenderer renderer_;
+
+   // Renders snapshots until |stop| is called
+   void run();
+
+   // Prints the profiler and overdraw results, if enabled
+   void printStats();
+};
+
+#endif
@@ -1,5 +1,10 @@
 #include "ResourceManager.h"
 
+#include <iostream>
+#include <sstream>
+
+#include "AsyncLoader.h"
+
 ResourceManager& ResourceManager::instance() {
 	static ResourceManager *instance = new ResourceManager();
 	return *instance;
@@ -21,15 +26,97 @@ std::shared_ptr<std::string> ResourceManager::loadShader(const std::string& shad
 }
 
 std::shared_ptr<Shape> ResourceManager::loadShape(const std::string filename) {
+   std::shared_ptr<Shape> shape = prepareShape(filename);
+   finishShape(filename, shape);
+
+   return shape;
+}
+
+std::vector<std::shared_ptr<Shape>> ResourceManager::loadShapes(const std::vector<std::string>& filenames) {
+   std::vector<std::shared_ptr<Shape>> shapes(filenames.size());
+   std::vector<std::future<void>> prepared;
+
+   for (size_t i = 0; i < filenames.size(); ++i) {
+      prepared.push_back(AsyncLoader::instance().submit([this, &shapes, &filenames, i]() {
+         shapes[i] = prepareShape(filenames[i]);
+      }));
+   }
+
+   // Upload in order as soon as each shape is ready, while the workers continue with the rest
+   for (size_t i = 0; i < filenames.size(); ++i) {
+      try {
+         // Rethrows what the worker threw preparing the shape
+         prepared[i].get();
+      } catch (...) {
+         // The remaining jobs still write into |shapes|, they have to finish before it goes away
+         for (size_t j = i + 1; j < filenames.size(); ++j) {
+            prepared[j].wait();
+         }
+         throw;
+      }
+
+      if (shapes[i] != nullptr) {
+         finishShape(filenames[i], shapes[i]);
+      }
+   }
+
+   return shapes;
+}
+
+std::shared_ptr<Shape> ResourceManager::prepareShape(const std::string& filename) {
    std::shared_ptr<Shape> shape = std::make_shared<Shape>();
 
    shape->loadMesh(resourceDirectory + filename);
    shape->resize();
-   shape->init();
+   shape->generateLods();
+
+   MeshOptimizer::CacheStatistics before, after;
+   shape->optimizeMesh(optimizeOverdraw, &before, &after);
+
+#ifdef DEBUG
+   // Written at once so lines of shapes prepared in parallel don't interleave
+   std::ostringstream statistics;
+   statistics << filename << ": vertex cache ACMR " << before.acmr() << " -> " << after.acmr()
+              << ", ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+   std::cout << statistics.str();
+#endif
 
    return shape;
 }
 
+void ResourceManager::finishShape(const std::string& filename, std::shared_ptr<Shape> shape) {
+   shape->init(compactVertexFormat);
+
+   shapeMemoryUsage += shape->getGpuMemoryUsage();
+   uncompressedShapeMemoryUsage += shape->getUncompressedGpuMemoryUsage();
+
+#ifdef DEBUG
+   std::cout << filename << ": " << shape->getGpuMemoryUsage() / 1024 << " KB of GPU memory ("
+             << shape->getUncompressedGpuMemoryUsage() / 1024 << " KB uncompressed)" << std::endl;
+#endif
+}
+
+void ResourceManager::setOptimizeOverdraw(bool optimizeOverdraw) {
+	this->optimizeOverdraw = optimizeOverdraw;
+}
+
+void ResourceManager::setCompactVertexFormat(bool compactVertexFormat) {
+	this->compactVertexFormat = compactVertexFormat;
+}
+
+size_t ResourceManager::getShapeMemoryUsage() {
+	return shapeMemoryUsage;
+}
+
+void ResourceManager::printShapeMemoryReport() {
+	std::cout << "Shapes use " << shapeMemoryUsage / 1024 << " KB of GPU memory ("
+	          << uncompressedShapeMemoryUsage / 1024 << " KB uncompressed)" << std::endl;
+}
+
 ResourceManager::ResourceManager() {
 	resourceDirectory = "";
+	optimizeOverdraw = true;
+	compactVertexFormat = true;
+	shapeMemoryUsage = 0;
+	uncompressedShapeMemoryUsage = 0;
 }
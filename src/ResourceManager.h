@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include "Shape.h"
 
 #include "GLSL.h"
@@ -22,16 +23,49 @@ public:
 	// Reads shader source from a file and returns a pointer to the in-memory string
 	std::shared_ptr<std::string> loadShader(const std::string& shaderFileName);
 
-   // Loads, resizes, and initializes shape then returns it.
+   // Loads, resizes, simplifies, optimizes and initializes shape then returns it.
    std::shared_ptr<Shape> loadShape(const std::string filename);
 
+   // Loads all shapes like |loadShape|, reading and processing the meshes in parallel on the |AsyncLoader|'s
+   // workers. Only the uploads happen on the calling (GL) thread
+   std::vector<std::shared_ptr<Shape>> loadShapes(const std::vector<std::string>& filenames);
+
+   // Sets whether loaded shapes have their triangles sorted to reduce overdraw (on by default).
+   // This trades a little vertex cache efficiency for fewer shaded pixels
+   void setOptimizeOverdraw(bool optimizeOverdraw);
+
+   // Sets whether loaded shapes are uploaded in the compact vertex format (on by default), see |Shape::init|
+   void setCompactVertexFormat(bool compactVertexFormat);
+
+   // Returns the bytes of GPU memory used by all shapes loaded so far
+   size_t getShapeMemoryUsage();
+
+   // Prints how much GPU memory the loaded shapes use and would use in the full precision format
+   void printShapeMemoryReport();
+
 private:
 
+	// Whether loaded shapes are sorted to reduce overdraw
+	bool optimizeOverdraw;
+
+	// Whether loaded shapes use the compact vertex format
+	bool compactVertexFormat;
+
+	// GPU memory used by all loaded shapes and what they would use in the full precision format
+	size_t shapeMemoryUsage;
+	size_t uncompressedShapeMemoryUsage;
+
 	// The directory to parse resources from
 	std::string resourceDirectory;
 
 	ResourceManager();
 
+	// Reads, resizes, simplifies and optimizes the shape without any GL calls
+	std::shared_ptr<Shape> prepareShape(const std::string& filename);
+
+	// Uploads a prepared shape, must be called on the GL thread
+	void finishShape(const std::string& filename, std::shared_ptr<Shape> shape);
+
 };
 
 #endif
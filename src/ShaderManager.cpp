@@ -1,6 +1,37 @@
 #include "ShaderManager.h"
+#include "Cubemap.h"
 #include "ShapeManager.h"
 
+unsigned int ShaderVariant::getKey() const {
+	// The tap count only matters with filtered shadows
+	unsigned int taps = ((features & SHADOWED) && !(features & VARIANCE_SHADOWS)) ? pcfTaps : 0;
+
+	return features | (taps << 8) | (numDirLights << 16);
+}
+
+std::string ShaderVariant::getDefines() const {
+	std::string defines = "#define SHADER_VARIANT\n";
+
+	if (features & TEXTURED) {
+		defines += "#define TEXTURED\n";
+	}
+	if (features & SHADOWED) {
+		defines += "#define SHADOWED\n";
+
+		if (features & VARIANCE_SHADOWS) {
+			defines += "#define VARIANCE_SHADOWS\n";
+		} else {
+			defines += "#define PCF_TAPS " + std::to_string(pcfTaps) + "\n";
+		}
+	}
+	if (features & INSTANCED) {
+		defines += "#define INSTANCED\n";
+	}
+	defines += "#define NUM_DIR_LIGHTS " + std::to_string(numDirLights) + "\n";
+
+	return defines;
+}
+
 ShaderManager& ShaderManager::instance() {
 	static ShaderManager *instance = new ShaderManager();
 
@@ -8,6 +39,8 @@ ShaderManager& ShaderManager::instance() {
 }
 
 void ShaderManager::setDefaultShader(const std::string& shaderProgramName) {
+	finishShaderPrograms();
+
 	shaderPrograms[DefaultShader] = shaderPrograms.at(shaderProgramName);
 }
 
@@ -16,37 +49,33 @@ const std::string& ShaderManager::getBoundShaderName() {
 }
 
 std::shared_ptr<Program> ShaderManager::getShaderProgram(const std::string& shaderProgramName) {
+	finishShaderPrograms();
+
 	return shaderPrograms.at(shaderProgramName);
 }
 
-GLuint ShaderManager::createVertexShader(const std::string& vertexShaderName, std::shared_ptr<std::string> shaderSource) {
-	
-	// Compile the shader and check for errors
-	GLuint vertexShaderHandle = createAndCompileShader(vertexShaderName, shaderSource, GL_VERTEX_SHADER);
-	if (vertexShaderHandle == 0) {
-		return -1;
+bool ShaderManager::createVertexShader(const std::string& vertexShaderName, std::shared_ptr<std::string> shaderSource) {
+	if (shaderSource == nullptr) {
+		std::cout << "No source for vertex shader " << vertexShaderName << std::endl;
+		return false;
 	}
 
-	// Add the new vertex shader to the hash map
-	std::pair<std::string, GLuint> newVertexShader(vertexShaderName, vertexShaderHandle);
-	vertexShaderHandles.insert(newVertexShader);
+	// Compiled once a program that isn't in the binary cache needs it
+	vertexShaderSources[vertexShaderName] = shaderSource;
 
-	return vertexShaderHandle;
+	return true;
 }
 
-GLuint ShaderManager::createFragmentShader(const std::string& fragmentShaderName, std::shared_ptr<std::string> shaderSource) {
-	
-	// Compile the shader and check for errors
-	GLuint fragmentShaderHandle = createAndCompileShader(fragmentShaderName, shaderSource, GL_FRAGMENT_SHADER);
-	if (fragmentShaderHandle == 0) {
-		return -1;
+bool ShaderManager::createFragmentShader(const std::string& fragmentShaderName, std::shared_ptr<std::string> shaderSource) {
+	if (shaderSource == nullptr) {
+		std::cout << "No source for fragment shader " << fragmentShaderName << std::endl;
+		return false;
 	}
 
-	// Add the new fragment shader to the hash map
-	std::pair<std::string, GLuint> newFragmentShader(fragmentShaderName, fragmentShaderHandle);
-	fragmentShaderHandles.insert(newFragmentShader);
+	// Compiled once a program that isn't in the binary cache needs it
+	fragmentShaderSources[fragmentShaderName] = shaderSource;
 
-	return fragmentShaderHandle;
+	return true;
 }
 
 GLuint createAndCompileShader(const std::string& shaderName, std::shared_ptr<std::string> shaderSource, GLenum shaderType) {
@@ -54,12 +83,16 @@ GLuint createAndCompileShader(const std::string& shaderName, std::shared_ptr<std
 	// Compile shader and get respective handle ID
 	GLuint shaderHandle = glCreateShader(shaderType);
 
-	// Read and compile the shader source data
+	// Read and compile the shader source data. The status is only checked if linking fails, so that the driver
+	// can compile in the background (see |ShaderManager::finishShaderPrograms|)
 	const char* shaderSourcePointer = shaderSource->c_str();
 	glShaderSource(shaderHandle, 1, &shaderSourcePointer, NULL);
 	glCompileShader(shaderHandle);
 
-	// Check compilation success
+	return shaderHandle;
+}
+
+bool checkShaderCompiled(const std::string& shaderName, GLuint shaderHandle, GLenum shaderType) {
 	GLint compileStatus;
 	glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &compileStatus);
 	if(!compileStatus) {
@@ -76,33 +109,111 @@ GLuint createAndCompileShader(const std::string& shaderName, std::shared_ptr<std
 
 		std::cout << "Error compiling " << shaderTypeName << " " << shaderName << std::endl;
 
-		return 0;
+		return false;
 	}
 
-	GLSL::printError();
-	assert(glGetError() == GL_NO_ERROR);
+	return true;
+}
+
+GLuint ShaderManager::getShaderHandle(const std::string& shaderName, GLenum shaderType) {
+	std::unordered_map<std::string, GLuint>& handles = shaderType == GL_VERTEX_SHADER ? vertexShaderHandles : fragmentShaderHandles;
+
+	std::unordered_map<std::string, GLuint>::iterator handle = handles.find(shaderName);
+	if (handle != handles.end()) {
+		return handle->second;
+	}
+
+	std::shared_ptr<std::string> shaderSource = shaderType == GL_VERTEX_SHADER ? vertexShaderSources.at(shaderName) : fragmentShaderSources.at(shaderName);
+	GLuint shaderHandle = createAndCompileShader(shaderName, shaderSource, shaderType);
+	handles[shaderName] = shaderHandle;
 
 	return shaderHandle;
 }
 
 GLuint ShaderManager::createShaderProgram(const std::string& shaderProgramName, const std::string& vertexShaderName, const std::string& fragmentShaderName) {
-	
+
+	// Programs found in the binary cache skip compiling and linking altogether
+	std::string cacheKey;
+	if (programBinaryCache.isEnabled()) {
+		cacheKey = programBinaryCache.getKey(*vertexShaderSources.at(vertexShaderName), *fragmentShaderSources.at(fragmentShaderName));
+
+		GLuint pid = programBinaryCache.load(cacheKey);
+		if (pid != 0) {
+			addShaderProgram(shaderProgramName, vertexShaderName, fragmentShaderName, pid);
+			return pid;
+		}
+	}
+
 	// Create the program and link
 	GLuint pid = glCreateProgram();
-	glAttachShader(pid, vertexShaderHandles[vertexShaderName]);
-	glAttachShader(pid, fragmentShaderHandles[fragmentShaderName]);
+	glAttachShader(pid, getShaderHandle(vertexShaderName, GL_VERTEX_SHADER));
+	glAttachShader(pid, getShaderHandle(fragmentShaderName, GL_FRAGMENT_SHADER));
+
+	if (!cacheKey.empty()) {
+		glProgramParameteri(pid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
-	// Check link success
-	GLint linkStatus;
 	glLinkProgram(pid);
-	glGetProgramiv(pid, GL_LINK_STATUS, &linkStatus);
-	if(!linkStatus) {
-		GLSL::printProgramInfoLog(pid);
-		std::cout << "Error linking shaders " << vertexShaderName << " and " << fragmentShaderName << " for shader program " << shaderProgramName << std::endl;
 
+	PendingProgram pendingProgram = { shaderProgramName, vertexShaderName, fragmentShaderName, pid, cacheKey };
+	pendingPrograms.push_back(pendingProgram);
+
+	// Without parallel compilation the status is available right away anyway
+	if (!parallelShaderCompile && !finishShaderPrograms()) {
 		return 0;
 	}
-	
+
+	return pid;
+}
+
+bool ShaderManager::finishShaderPrograms() {
+	if (pendingPrograms.empty()) {
+		return true;
+	}
+
+	bool success = true;
+
+	for (const PendingProgram& pendingProgram : pendingPrograms) {
+
+		// Check link success, this waits for the driver if it's still busy
+		GLint linkStatus;
+		glGetProgramiv(pendingProgram.pid, GL_LINK_STATUS, &linkStatus);
+		if(!linkStatus) {
+			checkShaderCompiled(pendingProgram.vertexShaderName, vertexShaderHandles.at(pendingProgram.vertexShaderName), GL_VERTEX_SHADER);
+			checkShaderCompiled(pendingProgram.fragmentShaderName, fragmentShaderHandles.at(pendingProgram.fragmentShaderName), GL_FRAGMENT_SHADER);
+
+			GLSL::printProgramInfoLog(pendingProgram.pid);
+			std::cout << "Error linking shaders " << pendingProgram.vertexShaderName << " and " << pendingProgram.fragmentShaderName << " for shader program " << pendingProgram.name << std::endl;
+
+			glDeleteProgram(pendingProgram.pid);
+			success = false;
+			continue;
+		}
+
+		if (!pendingProgram.cacheKey.empty()) {
+			programBinaryCache.store(pendingProgram.cacheKey, pendingProgram.pid);
+		}
+
+		addShaderProgram(pendingProgram.name, pendingProgram.vertexShaderName, pendingProgram.fragmentShaderName, pendingProgram.pid);
+	}
+
+	pendingPrograms.clear();
+
+	return success;
+}
+
+bool ShaderManager::hasShaderProgram(const std::string& shaderProgramName) {
+	finishShaderPrograms();
+
+	std::unordered_map<std::string, std::shared_ptr<Program>>::iterator program = shaderPrograms.find(shaderProgramName);
+	return program != shaderPrograms.end() && program->second != nullptr;
+}
+
+void ShaderManager::setProgramBinaryCacheDirectory(const std::string& directory) {
+	programBinaryCache.setDirectory(directory);
+}
+
+void ShaderManager::addShaderProgram(const std::string& shaderProgramName, const std::string& vertexShaderName, const std::string& fragmentShaderName, GLuint pid) {
 	GLSL::printError();
 	assert(glGetError() == GL_NO_ERROR);
 
@@ -110,250 +221,389 @@ GLuint ShaderManager::createShaderProgram(const std::string& shaderProgramName,
 	std::shared_ptr<Program> shaderProgram = std::make_shared<Program>(shaderProgramName, vertexShaderName, fragmentShaderName, pid);
 	std::pair<std::string, std::shared_ptr<Program>> newShaderProgram(shaderProgramName, shaderProgram);
 	shaderPrograms.insert(newShaderProgram);
-
-	return pid;
 }
 
 GLuint ShaderManager::createIsomorphicShader(ResourceManager& resourceManager, const std::string& shaderName, const std::string& shaderResourcePrefix) {
-	if (createVertexShader(shaderName, resourceManager.loadShader(shaderResourcePrefix + "_vert.glsl")) == 0) {
+	if (!createVertexShader(shaderName, resourceManager.loadShader(shaderResourcePrefix + "_vert.glsl"))) {
 		return 0;
 	}
 
-	if (createFragmentShader(shaderName, resourceManager.loadShader(shaderResourcePrefix + "_frag.glsl")) == 0) {
+	if (!createFragmentShader(shaderName, resourceManager.loadShader(shaderResourcePrefix + "_frag.glsl"))) {
 		return 0;
 	}
 
 	return createShaderProgram(shaderName, shaderName, shaderName);
 }
 
-const std::shared_ptr<Program> ShaderManager::bindShader(const std::string& shaderProgramName) {
-	std::shared_ptr<Program> shaderToBind = shaderPrograms.at(shaderProgramName);
-	boundShaderName = shaderProgramName;
-	glUseProgram(shaderToBind->getPid());
+GLuint ShaderManager::createIndirectShader(ResourceManager& resourceManager, const std::string& shaderName, const std::string& shaderResourcePrefix) {
+	const std::string indirectVertexShaderName = "indirect";
 
-    //shaderToBind->bindTextures();
+	// All mesh shaders share the same vertex shader
+	if (vertexShaderSources.count(indirectVertexShaderName) == 0) {
+		if (!createVertexShader(indirectVertexShaderName, resourceManager.loadShader(indirectVertexShaderName + "_vert.glsl"))) {
+			return 0;
+		}
+	}
 
-	return shaderToBind;
+	std::shared_ptr<std::string> fragmentSource = resourceManager.loadShader(shaderResourcePrefix + "_frag.glsl");
+	if (fragmentSource == nullptr) {
+		return 0;
+	}
+
+	// Replace the version line, the material inputs need the vertex shader's SSBOs (4.3) to be filled in
+	size_t versionEnd = fragmentSource->find('\n');
+	if (fragmentSource->compare(0, 8, "#version") != 0 || versionEnd == std::string::npos) {
+		std::cout << "Expected a #version line in " << shaderResourcePrefix << "_frag.glsl" << std::endl;
+		return 0;
+	}
+	fragmentSource->replace(0, versionEnd, "#version 430 core\n#define INDIRECT_DRAW");
+
+	const std::string indirectShaderName = shaderName + IndirectShaderSuffix;
+	if (!createFragmentShader(indirectShaderName, fragmentSource)) {
+		return 0;
+	}
+
+	return createShaderProgram(indirectShaderName, indirectVertexShaderName, indirectShaderName);
 }
 
-void ShaderManager::unbindShader() {
-	//shaderPrograms.at(boundShaderName)->unbindTextures();
-    boundShaderName = "";
-	glUseProgram(NO_SHADER);
+GLuint ShaderManager::createFullscreenShader(ResourceManager& resourceManager, const std::string& shaderName) {
+	const std::string fullscreenVertexShaderName = "fullscreen";
+
+	if (vertexShaderSources.count(fullscreenVertexShaderName) == 0) {
+		if (!createVertexShader(fullscreenVertexShaderName, resourceManager.loadShader(fullscreenVertexShaderName + "_vert.glsl"))) {
+			return 0;
+		}
+	}
+
+	if (!createFragmentShader(shaderName, resourceManager.loadShader(shaderName + "_frag.glsl"))) {
+		return 0;
+	}
+
+	return createShaderProgram(shaderName, fullscreenVertexShaderName, shaderName);
 }
 
-void ShaderManager::renderObject(std::shared_ptr<GameObject> objToRender, const std::string& shaderName, const std::shared_ptr<Shape> shape,
- const std::shared_ptr<Material> material, std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> V, std::shared_ptr<MatrixStack> M) {
-	if (objToRender != NULL) {
+std::shared_ptr<Program> ShaderManager::getIndirectShaderProgram(const std::string& shaderProgramName) {
+	finishShaderPrograms();
 
-		const std::shared_ptr<Program> shaderProgram = bindShader(shaderName);
+	std::unordered_map<std::string, std::shared_ptr<Program>>::iterator program = shaderPrograms.find(shaderProgramName);
+	if (program == shaderPrograms.end()) {
+		return nullptr;
+	}
 
-		// Bind perspective and view tranforms
-		glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-		glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(V->topMatrix()));
+	// Look up by the program's own name so that the default shader resolves to it's current program
+	std::unordered_map<std::string, std::shared_ptr<Program>>::iterator indirectProgram =
+		shaderPrograms.find(program->second->name + IndirectShaderSuffix);
 
-		// Set up lights
-		GameManager& gameManager = GameManager::instance();
-		GameWorld& gameWorld = gameManager.getGameWorld();
+	return indirectProgram != shaderPrograms.end() ? indirectProgram->second : nullptr;
+}
 
-		// Point lights
-		// TODO(rgarmsen2295): Add point lights back
+GLuint ShaderManager::createDebrisShader(ResourceManager& resourceManager, const std::string& shaderName) {
+	const std::string debrisVertexShaderName = "debris";
 
-		// Directional lights
-		// TODO(rgarmsen2295): Implement more cleanly using "uniform buffer objects"
-		const std::vector<std::shared_ptr<Light>>& directionalLights = gameWorld.getDirectionalLights();
-		int numDirectionLights = directionalLights.size();
-		
-		glUniform1i(shaderProgram->getUniform("numDirectionLights"), numDirectionLights);
-		for (int i = 0; i < numDirectionLights; ++i) {
-			const std::shared_ptr<Light> light = directionalLights.at(i);
-			glUniform3f(shaderProgram->getUniform("directionLights[" + std::to_string(i) + "].position"), light->position.x, light->position.y, light->position.z);
-			glUniform3f(shaderProgram->getUniform("directionLights[" + std::to_string(i) + "].color"), light->color.x, light->color.y, light->color.z);
-			glUniform3f(shaderProgram->getUniform("directionLights[" + std::to_string(i) + "].orientation"), light->orientation.x, light->orientation.y, light->orientation.z);
+	if (vertexShaderSources.count(debrisVertexShaderName) == 0) {
+		if (!createVertexShader(debrisVertexShaderName, resourceManager.loadShader(debrisVertexShaderName + "_vert.glsl"))) {
+			return 0;
 		}
+	}
+
+	// Isomorphic shaders name their fragment shader after the program
+	if (fragmentShaderSources.count(shaderName) == 0) {
+		std::cout << "No fragment shader " << shaderName << " to build the debris variant with" << std::endl;
+		return 0;
+	}
+
+	return createShaderProgram(shaderName + DebrisShaderSuffix, debrisVertexShaderName, shaderName);
+}
 
-        // Calculate and bind light transorms and shadow Map
-        glm::mat4 lightP = calculateLightProjection(directionalLights.at(0));
-        glm::mat4 lightV = calculateLightView(directionalLights.at(0));
+std::shared_ptr<Program> ShaderManager::getDebrisShaderProgram(const std::string& shaderProgramName) {
+	finishShaderPrograms();
 
-        glUniformMatrix4fv(shaderProgram->getUniform("lightP"), 1, GL_FALSE, glm::value_ptr(lightP));
-        glUniformMatrix4fv(shaderProgram->getUniform("lightV"), 1, GL_FALSE, glm::value_ptr(lightV));
-        glUniform2f(shaderProgram->getUniform("shadowMapSize"), ShadowMap::SM_WIDTH, ShadowMap::SM_HEIGHT);
+	std::unordered_map<std::string, std::shared_ptr<Program>>::iterator program = shaderPrograms.find(shaderProgramName);
+	if (program == shaderPrograms.end()) {
+		return nullptr;
+	}
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gameManager.getShadowMap()->getShadowMap());
+	std::unordered_map<std::string, std::shared_ptr<Program>>::iterator debrisProgram =
+		shaderPrograms.find(program->second->name + DebrisShaderSuffix);
 
-        glUniform1i(shaderProgram->getUniform("shadowMapTex"), 0);
+	return debrisProgram != shaderPrograms.end() ? debrisProgram->second : nullptr;
+}
 
-      if (objToRender->fracture) {
-         shape->fracture(shaderProgram, material, M, objToRender);
-      } else {
-         // Set up and bind model transform
-         M->pushMatrix();
-         M->loadIdentity();
+std::shared_ptr<Program> ShaderManager::getShaderVariant(const std::string& shaderProgramName, const ShaderVariant& variant) {
+	finishShaderPrograms();
 
-         M->translate(objToRender->getPosition());
-         M->scale(objToRender->getScale());
+	std::shared_ptr<Program> baseProgram = shaderPrograms.at(shaderProgramName);
 
-         glm::mat4 rotation = objToRender->transform.getRotate();
-         M->rotateMat4(rotation);
+	if (variant.features & ShaderVariant::INSTANCED) {
+		baseProgram = getDebrisShaderProgram(shaderProgramName);
+		if (baseProgram == nullptr) {
+			return nullptr;
+		}
+	}
 
-         glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(M->topMatrix()));
+	std::unordered_map<unsigned int, std::shared_ptr<Program>>& variants = shaderVariants[baseProgram.get()];
+	unsigned int key = variant.getKey();
 
-         glm::mat4 tiM = glm::transpose(glm::inverse(M->topMatrix()));
-         glUniformMatrix4fv(shaderProgram->getUniform("tiM"), 1, GL_FALSE, glm::value_ptr(tiM));
+	std::unordered_map<unsigned int, std::shared_ptr<Program>>::iterator program = variants.find(key);
+	if (program != variants.end()) {
+		return program->second;
+	}
 
-	   	// Draw bunny
-		   // TODO(rgarmsen): Make shape not need the shader program
-   		shape->draw(shaderProgram, material);
+	std::shared_ptr<Program> variantProgram = createShaderVariant(baseProgram, variant);
+	variants[key] = variantProgram;
 
-         M->popMatrix();
-      }
+	return variantProgram;
+}
 
+std::shared_ptr<Program> ShaderManager::createShaderVariant(std::shared_ptr<Program> baseProgram, const ShaderVariant& variant) {
+	std::unordered_map<std::string, std::shared_ptr<std::string>>::iterator baseSource =
+		fragmentShaderSources.find(baseProgram->getFragmentShaderName());
+	if (baseSource == fragmentShaderSources.end()) {
+		return baseProgram;
+	}
 
-#ifdef DEBUG_BB
-      ShapeManager& shapeManager = ShapeManager::instance();
-      std::shared_ptr<Shape> shapeToDraw = shapeManager.getShape("Sphere");
-      if (objToRender->getBoundingBox()) {
-         for (int i = 0; i < 8; i++) {
-            M->pushMatrix();
-            M->loadIdentity();
-            glm::vec3 rotation = glm::vec3(objToRender->getBoundingBox()->boxPoints[i].x,
-                      objToRender->getBoundingBox()->boxPoints[i].y,
-                      objToRender->getBoundingBox()->boxPoints[i].z
-            );
+	// The defines go right after the version line
+	std::shared_ptr<std::string> fragmentSource = std::make_shared<std::string>(*baseSource->second);
+	size_t versionEnd = fragmentSource->find('\n');
+	if (fragmentSource->compare(0, 8, "#version") != 0 || versionEnd == std::string::npos) {
+		std::cout << "Expected a #version line in fragment shader " << baseProgram->getFragmentShaderName() << std::endl;
+		return baseProgram;
+	}
+	fragmentSource->insert(versionEnd + 1, variant.getDefines());
+
+	const std::string variantName = baseProgram->name + "#" + std::to_string(variant.getKey());
+	if (!createFragmentShader(variantName, fragmentSource) ||
+		createShaderProgram(variantName, baseProgram->getVertexShaderName(), variantName) == 0 ||
+		!hasShaderProgram(variantName)) {
+		std::cerr << "Warning - Could not create variant " << variantName << ", using " << baseProgram->name << std::endl;
+		return baseProgram;
+	}
 
-            M->translate(rotation);
-		      M->scale(0.25);
-            glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(M->topMatrix()));
+	return shaderPrograms.at(variantName);
+}
 
-            shapeToDraw->draw(shaderProgram, material);
-            M->popMatrix();
-         }
-      }
-#endif
+void ShaderManager::beginFrame(const glm::vec3& eye, ClusteredLighting* lighting) {
+	frameEye = eye;
+	frameLighting = lighting;
+
+	// Every program gets the new frame's uniforms the next time it's drawn with
+	frameNumber++;
+	frameTexturesBound = false;
+}
+
+ShaderVariant ShaderManager::getFrameVariant() {
+	ShadowMap* shadowMap = GameManager::instance().getShadowMap();
+
+	ShaderVariant variant;
+	variant.features = ShaderVariant::SHADOWED;
+	variant.pcfTaps = shadowMap->getPcfTaps();
+	if (shadowMap->getFilter() == ShadowMap::Filter::EVSM) {
+		variant.features |= ShaderVariant::VARIANCE_SHADOWS;
+	}
+	variant.numDirLights = frameLighting->getNumDirectionalLights();
+
+	return variant;
+}
+
+ShaderVariant ShaderManager::getObjectVariant(const RenderItem& item) {
+	ShaderVariant variant = getFrameVariant();
 
-		unbindShader();
+	// Objects outside of the area the shadow map covers can't be in shadow, neither can those not casting one
+	// themselves (e.g. the skybox)
+	if (!item.castsShadow || !item.receivesShadow) {
+		variant.features &= ~(ShaderVariant::SHADOWED | ShaderVariant::VARIANCE_SHADOWS);
+		variant.pcfTaps = 0;
 	}
+
+	return variant;
 }
 
-void ShaderManager::renderBillboard(std::shared_ptr<GameObject> objToRender, const std::string& shaderName, const std::shared_ptr<Shape> shape,
-	const std::shared_ptr<Material> material, const std::shared_ptr<Texture> billboardTexture, std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> V,
-	std::shared_ptr<MatrixStack> M) {
-	if (objToRender != NULL) {
-		const std::shared_ptr<Program> shaderProgram = getShaderProgram(shaderName);
+bool ShaderManager::isIndirectDrawingSupported() {
+	return GLEW_VERSION_4_3;
+}
 
-		// Bind perspective and view tranforms
-		glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P->topMatrix()));
-		glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(V->topMatrix()));
+const std::shared_ptr<Program> ShaderManager::bindShader(const std::string& shaderProgramName) {
+	finishShaderPrograms();
+	std::shared_ptr<Program> shaderToBind = shaderPrograms.at(shaderProgramName);
+	boundShaderName = shaderProgramName;
+	glUseProgram(shaderToBind->getPid());
 
-		GameManager& gameManager = GameManager::instance();
-		Camera& camera = gameManager.getCamera();
+    //shaderToBind->bindTextures();
 
-		// Set up and bind model transform
-		M->pushMatrix();
-		M->loadIdentity();
+	return shaderToBind;
+}
 
-		M->translate(objToRender->getPosition());
-		M->scale(objToRender->getScale());
+void ShaderManager::unbindShader() {
+	//shaderPrograms.at(boundShaderName)->unbindTextures();
+    boundShaderName = "";
+	glUseProgram(NO_SHADER);
+}
+
+void ShaderManager::bindFrameUniforms(const std::shared_ptr<Program> shaderProgram, const MatrixStack& P, const MatrixStack& V) {
+	GameManager& gameManager = GameManager::instance();
 
-		glm::mat4 rotation = objToRender->transform.getRotate();
-		M->rotateMat4(rotation);
+	// Texture units are shared by all programs, so they're bound once for the frame's first draw
+	if (!frameTexturesBound) {
+		frameLighting->bindBuffers();
 
-		glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(M->topMatrix()));
+		glActiveTexture(GL_TEXTURE0 + ShadowMap::MOMENTS_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, gameManager.getShadowMap()->getMomentsMap());
 
-		glm::mat4 tiM = glm::transpose(glm::inverse(M->topMatrix()));
-		glUniformMatrix4fv(shaderProgram->getUniform("tiM"), 1, GL_FALSE, glm::value_ptr(tiM));
-		
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, gameManager.getShadowMap()->getShadowMap());
 
-		M->popMatrix();
+		frameTexturesBound = true;
 	}
-}
 
-void ShaderManager::renderShadowPass(std::shared_ptr<GameObject> objToRender, const std::shared_ptr<Shape> shape,
-					  std::shared_ptr<MatrixStack> M){
-	if (objToRender != NULL) {
+	ProgramFrameState& state = programFrameStates[shaderProgram.get()];
+	bool setUp = state.frameNumber == frameNumber;
+	if (setUp && state.P == P.topMatrix() && state.V == V.topMatrix()) {
+		return;
+	}
+
+	// Bind perspective and view tranforms, again if the program is drawn from another view in the same frame
+	glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P.topMatrix()));
+	glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(V.topMatrix()));
+	state.P = P.topMatrix();
+	state.V = V.topMatrix();
+
+	if (setUp) {
+		return;
+	}
+	state.frameNumber = frameNumber;
 
-		const std::shared_ptr<Program> shaderProgram = bindShader(ShaderManager::shadowPassShaderName);
+	// Point and directional lights
+	frameLighting->setUniforms(shaderProgram);
 
-		// Set up lights
-		GameManager& gameManager = GameManager::instance();
-		GameWorld& gameWorld = gameManager.getGameWorld();
+    // Bind light transforms (calculated once per frame by the shadow pass) and shadow Map
+    glUniformMatrix4fv(shaderProgram->getUniform("lightP"), 1, GL_FALSE, glm::value_ptr(lightP));
+    glUniformMatrix4fv(shaderProgram->getUniform("lightV"), 1, GL_FALSE, glm::value_ptr(lightV));
+    glUniform2f(shaderProgram->getUniform("shadowMapSize"), ShadowMap::SM_WIDTH, ShadowMap::SM_HEIGHT);
 
-		const std::vector<std::shared_ptr<Light>>& directionalLights = gameWorld.getDirectionalLights();
+    glUniform1i(shaderProgram->getUniform("shadowMapTex"), 0);
 
-        std::shared_ptr<Light> light = directionalLights.at(0);
+    // Only |Texture::bind| points the texture sampler at a unit, so untextured draws would leave it on the shadow map's
+    // unit. Two sampler types reading one unit is an invalid operation, so it starts out on the textures' unit
+    glUniform1i(shaderProgram->getUniform("textureMap"), 1);
 
-        glm::mat4 lightP = calculateLightProjection(light);
-        glm::mat4 lightV = calculateLightView(light);
+    // Moments for variance shadow variants
+    glUniform1i(shaderProgram->getUniform("shadowMomentsTex"), ShadowMap::MOMENTS_TEXTURE_UNIT);
+}
 
-		glUniformMatrix4fv(shaderProgram->getUniform("lightP"), 1, GL_FALSE, glm::value_ptr(lightP));
-		glUniformMatrix4fv(shaderProgram->getUniform("lightV"), 1, GL_FALSE, glm::value_ptr(lightV));
+void ShaderManager::renderObject(const RenderItem& item, const MatrixStack& P, const MatrixStack& V) {
+	const std::shared_ptr<Shape>& shape = item.shape;
+	int lod = shape->selectLod(calculateScreenSize(item));
 
-		// Set up and bind model transform
-		M->pushMatrix();
-		M->loadIdentity();
+	// Untextured and textured sub shapes are drawn with their own variant, so that untextured fragments
+	// don't pay for the texture
+	ShaderVariant variant = getObjectVariant(item);
+	int numTexturedSubShapes = shape->getNumTexturedSubShapes();
 
-		M->translate(objToRender->getPosition());
-		M->scale(objToRender->getScale());
-        glm::mat4 rotation = objToRender->transform.getRotate();
-        M->rotateMat4(rotation);
+	for (bool textured : { false, true }) {
+		if ((textured ? numTexturedSubShapes : shape->getNumSubShapes() - numTexturedSubShapes) == 0) {
+			continue;
+		}
 
-		glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(M->topMatrix()));
+		ShaderVariant subShapeVariant = variant;
+		if (textured) {
+			subShapeVariant.features |= ShaderVariant::TEXTURED;
+		}
 
-		shape->draw(shaderProgram, nullptr);
+		std::shared_ptr<Program> shaderProgram = getShaderVariant(item.shaderName, subShapeVariant);
+		bindShader(shaderProgram->name);
 
-		M->popMatrix();
+		bindFrameUniforms(shaderProgram, P, V);
 
-		unbindShader();
+		glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(item.M));
+		glUniformMatrix4fv(shaderProgram->getUniform("tiM"), 1, GL_FALSE, glm::value_ptr(item.tiM));
 
+		// TODO(rgarmsen): Make shape not need the shader program
+		shape->draw(shaderProgram, item.material, lod, textured ? Shape::SubShapes::TEXTURED : Shape::SubShapes::UNTEXTURED);
 	}
+
+	unbindShader();
 }
 
-glm::mat4 ShaderManager::calculateLightView(std::shared_ptr<Light> light) {
+void ShaderManager::renderSkybox(const RenderItem& item, const MatrixStack& P, const MatrixStack& V) {
+	// Nothing but the cubemap is needed, so none of the lighting state goes through renderObject
+	std::shared_ptr<Program> shaderProgram = bindShader(item.shaderName);
 
-    Camera camera = GameManager::instance().getCamera();
-    glm::vec3 smMiddle = calculateShadowMapMid();
-    glm::vec3 smLightPos = calculateShadowMapLightPos(light);
-    glm::mat4 lightV = glm::lookAt(smLightPos, smMiddle, glm::vec3(0.0, 1.0, 0.0));
+	// Without the translation the sky stays centered on the camera, only the rotations are kept
+	glm::mat4 skyV = glm::mat4(glm::mat3(V.topMatrix()));
 
-    return lightV;
+	glUniformMatrix4fv(shaderProgram->getUniform("P"), 1, GL_FALSE, glm::value_ptr(P.topMatrix()));
+	glUniformMatrix4fv(shaderProgram->getUniform("V"), 1, GL_FALSE, glm::value_ptr(skyV));
+	glUniformMatrix4fv(shaderProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(item.M));
+
+	item.cubemap->bind();
+	glUniform1i(shaderProgram->getUniform("cubemap"), 0);
+
+	// The vertex shader puts the sky at the far plane, so it's only shaded where nothing else was drawn
+	glDepthFunc(GL_LEQUAL);
+	item.shape->drawDepth(shaderProgram);
+	glDepthFunc(GL_LESS);
+
+	item.cubemap->unbind();
+	unbindShader();
 }
 
-glm::mat4 ShaderManager::calculateLightProjection(std::shared_ptr<Light> light) {
+void ShaderManager::beginShadowPass(const glm::mat4& lightProjection, const glm::mat4& lightView) {
+	shadowPassProgram = bindShader(ShaderManager::shadowPassShaderName);
 
-    float viewFrustumMaxDiagonal = getViewFrustumMaxDiagonal();
-    float halfDiagonal = viewFrustumMaxDiagonal / 2.0;
+	lightP = lightProjection;
+	lightV = lightView;
 
-    glm::vec3 lightSmMid = calculateShadowMapLightPos(light) - calculateShadowMapMid();
-    float dist = glm::length(lightSmMid);
+	glUniformMatrix4fv(shadowPassProgram->getUniform("lightP"), 1, GL_FALSE, glm::value_ptr(lightP));
+	glUniformMatrix4fv(shadowPassProgram->getUniform("lightV"), 1, GL_FALSE, glm::value_ptr(lightV));
 
-    glm::mat4 lightP = glm::ortho(-halfDiagonal, halfDiagonal, -halfDiagonal, halfDiagonal, 0.1f, dist*2.0f);
+	depthPassLodBias = shadowLodBias;
+}
 
-    return lightP;
+void ShaderManager::endShadowPass() {
+	shadowPassProgram = nullptr;
+	unbindShader();
 }
 
-glm::vec3 ShaderManager::calculateShadowMapMid() {
+void ShaderManager::beginDepthPrePass(const glm::mat4& P, const glm::mat4& V) {
+	shadowPassProgram = bindShader(ShaderManager::shadowPassShaderName);
 
-    Camera camera = GameManager::instance().getCamera();
-    glm::vec3 camOrientationNoY = glm::normalize(glm::vec3(camera.getLookAt().x, 0.0f, camera.getLookAt().z));
-    glm::vec3 smMiddle = camera.getEye() + camOrientationNoY * (getViewFrustumMaxDiagonal() / 2.0f);
+	// The shadow pass shader only knows the light's matrices, the ones used for shading are left untouched
+	glUniformMatrix4fv(shadowPassProgram->getUniform("lightP"), 1, GL_FALSE, glm::value_ptr(P));
+	glUniformMatrix4fv(shadowPassProgram->getUniform("lightV"), 1, GL_FALSE, glm::value_ptr(V));
 
-    return smMiddle;
+	// The depth has to match the color pass exactly, so it has to pick the same meshes
+	depthPassLodBias = 1.0f;
 }
 
-glm::vec3 ShaderManager::calculateShadowMapLightPos(std::shared_ptr<Light> light) {
+void ShaderManager::endDepthPrePass() {
+	endShadowPass();
+}
 
-    glm::vec3 lightOrientation = glm::normalize(-light->orientation);
-    float heightFac = (getViewFrustumMaxDiagonal() / 2.0f) / lightOrientation.y;
-    glm::vec3 smLightPos = calculateShadowMapMid() + lightOrientation * heightFac;
+void ShaderManager::renderShadowPass(const RenderItem& item) {
+	if (shadowPassProgram != nullptr) {
+		glUniformMatrix4fv(shadowPassProgram->getUniform("M"), 1, GL_FALSE, glm::value_ptr(item.M));
 
-    return smLightPos;
+		item.shape->drawDepth(shadowPassProgram, item.shape->selectLod(calculateScreenSize(item) * depthPassLodBias));
+	}
 }
 
-float ShaderManager::getViewFrustumMaxDiagonal() {
-    float farNearDist = GameManager::cullFarPlane - GameManager::nearPlane;
-    return farNearDist;
+float ShaderManager::calculateScreenSize(const RenderItem& item) {
+	const std::shared_ptr<Shape>& shape = item.shape;
+
+	// Objects without levels of detail don't need the (relatively costly) estimate
+	if (shape->getNumLods() <= 1) {
+		return 1.0f;
+	}
+
+	float radius = 0.5f * glm::length((shape->getMax() - shape->getMin()) * item.scale);
+	float distance = glm::length(item.position - frameEye);
+
+	if (distance <= radius) {
+		return 1.0f;
+	}
+
+	// Projected diameter over the viewport height: (2 * radius / distance) / (2 * tan(fov / 2))
+	return radius / (distance * std::tan(glm::radians(GameManager::fieldOfView) * 0.5f));
 }
 
 LightType ShaderManager::stringToLightType(std::string type) {
@@ -369,6 +619,20 @@ LightType ShaderManager::stringToLightType(std::string type) {
 
 ShaderManager::ShaderManager() {
 	boundShaderName = "";
+	frameEye = glm::vec3(0.0f);
+	frameLighting = nullptr;
+	frameNumber = 0;
+	frameTexturesBound = false;
+	depthPassLodBias = shadowLodBias;
+
+	// Let the driver compile and link on it's own threads while the rest of the shaders are set up
+	parallelShaderCompile = false;
+#ifdef GL_KHR_parallel_shader_compile
+	if (GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		parallelShaderCompile = true;
+	}
+#endif
 
 	// Put the default shader pair into the map of pairs (it will be set to the default once a default shader is loaded)
 	std::pair<std::string, std::shared_ptr<Program>> newShaderProgram(DefaultShader, nullptr);
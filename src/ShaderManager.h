@@ -11,31 +11,43 @@
 #include <string>
 #include <unordered_map>
 
+#include "ClusteredLighting.h"
+#include "FrameSnapshot.h"
 #include "GameManager.h"
 #include "GameObject.h"
 #include "GameWorld.h"
 #include "GLSL.h"
+#include "Light.h"
 #include "Program.h"
+#include "ProgramBinaryCache.h"
 #include "ResourceManager.h"
 
-#define MAX_DIRECTIONAL_LIGHTS 10
-
-enum class LightType { POINT, DIRECTIONAL, AREA };
-
 /**
- * Data structure that represents a prescence of light
+ * Compile time features of a mesh shader program. Variants of a program are compiled from it's fragment shader
+ * source with the features injected as #defines, so the shader doesn't branch on them per fragment
  *
- * position 	- Represents the position of the light
- * color 		- Represents the color of the light
- * orientation  - Represents the orientation of the light
- * Type 		- The type of light represented
+ * TEXTURED 		- Multiplies in "textureMap", only for sub shapes with a texture
+ * SHADOWED 		- Samples the shadow map with |pcfTaps| taps
+ * INSTANCED 		- Built on the program's instanced (debris) vertex shader
+ * VARIANCE_SHADOWS - Shadowed variants read the EVSM moments instead of taking PCF taps
+ * numDirLights 	- Number of directional lights the shader loops over
  */
-typedef struct Light {
-	glm::vec3 position;
-	glm::vec3 color;
-	glm::vec3 orientation;
-	LightType type;
-} Light;
+struct ShaderVariant {
+	static constexpr unsigned int TEXTURED = 1 << 0;
+	static constexpr unsigned int SHADOWED = 1 << 1;
+	static constexpr unsigned int INSTANCED = 1 << 2;
+	static constexpr unsigned int VARIANCE_SHADOWS = 1 << 3;
+
+	unsigned int features;
+	int pcfTaps;
+	int numDirLights;
+
+	// Returns a key that's unique among the variants of a program
+	unsigned int getKey() const;
+
+	// Returns the #define lines injected into the fragment shader
+	std::string getDefines() const;
+};
 
 // Manages shaders used by the geometry of the world
 class ShaderManager {
@@ -67,23 +79,76 @@ public:
 	// Throws an |out_of_range| exception if no shader program with that name is found
 	std::shared_ptr<Program> getShaderProgram(const std::string& shaderProgramName);
 
-	// Creates a vertex shader from the passed source string with the given name.
-	// Returns the vertex handle on success, 0 on failure
-	GLuint createVertexShader(const std::string& vertexShaderName, std::shared_ptr<std::string> shaderSource);
+	// Adds a vertex shader from the passed source string with the given name. It's only compiled once a program
+	// using it isn't found in the program binary cache.
+	// Returns false if there is no source
+	bool createVertexShader(const std::string& vertexShaderName, std::shared_ptr<std::string> shaderSource);
 
-	// Creates a fragment shader from the passed source string with the given name.
-	// Returns the fragment handle on success, 0 on failure
-	GLuint createFragmentShader(const std::string& fragmentShaderName, std::shared_ptr<std::string> shaderSource);
+	// Adds a fragment shader from the passed source string with the given name, compiled like vertex shaders.
+	// Returns false if there is no source
+	bool createFragmentShader(const std::string& fragmentShaderName, std::shared_ptr<std::string> shaderSource);
 
-	// Creates a shader program by linking a compiled vertex and fragment shader.
+	// Creates a shader program from a vertex and fragment shader, loading it from the program binary cache or
+	// compiling and linking them. With parallel shader compilation the link status is only checked once the program
+	// is first asked for (or by |finishShaderPrograms|), until then a failed link still returns the program ID.
 	// Returns the program ID on success, 0 on failure
 	GLuint createShaderProgram(const std::string& shaderProgramName, const std::string& vertexShaderName, const std::string& fragmentShaderName);
 
+	// Waits for all programs still being compiled and linked by the driver and adds the ones that linked.
+	// Returns false if any of them failed
+	bool finishShaderPrograms();
+
+	// Returns true if a shader program with the given name was created successfully
+	bool hasShaderProgram(const std::string& shaderProgramName);
+
+	// Sets the directory linked program binaries are cached in, no binaries are cached until it's set
+	void setProgramBinaryCacheDirectory(const std::string& directory);
+
 	// Builds a shader program under the assumption that all parts of the shader (vertex, fragment, program) will have the same name.
 	// Also, each shader resource file should have the same prefix (e.g. |shaderResourcePrefix| + "_frag.glsl").
 	// Returns the program ID on success, 0 on failure
 	GLuint createIsomorphicShader(ResourceManager& resourceManager, const std::string& shaderName, const std::string& shaderResourcePrefix);
 
+	// Builds the multi draw indirect variant of a mesh shader program, named |shaderName| + |IndirectShaderSuffix|.
+	// It pairs the shared "indirect_vert.glsl" with the program's fragment shader compiled with INDIRECT_DRAW defined.
+	// Returns the program ID on success, 0 on failure
+	GLuint createIndirectShader(ResourceManager& resourceManager, const std::string& shaderName, const std::string& shaderResourcePrefix);
+
+	// Builds a program drawing a fullscreen triangle, pairing the shared "fullscreen_vert.glsl" with the fragment
+	// shader |shaderName| + "_frag.glsl". Returns the program ID on success, 0 on failure
+	GLuint createFullscreenShader(ResourceManager& resourceManager, const std::string& shaderName);
+
+	// Returns the multi draw indirect variant of the given shader program (following the default shader),
+	// |nullptr| if it has none
+	std::shared_ptr<Program> getIndirectShaderProgram(const std::string& shaderProgramName);
+
+	// Builds the debris variant of a mesh shader program, named |shaderName| + |DebrisShaderSuffix|. It pairs the
+	// shared "debris_vert.glsl" with the program's already compiled fragment shader.
+	// Returns the program ID on success, 0 on failure
+	GLuint createDebrisShader(ResourceManager& resourceManager, const std::string& shaderName);
+
+	// Returns the debris variant of the given shader program (following the default shader), |nullptr| if it has none
+	std::shared_ptr<Program> getDebrisShaderProgram(const std::string& shaderProgramName);
+
+	// Returns the variant of the given shader program (following the default shader) with the given features,
+	// compiling it the first time it's asked for. If the variant can't be built the program itself is returned.
+	// Returns |nullptr| for INSTANCED variants of programs without a debris variant.
+	// Throws an |out_of_range| exception if no shader program with that name is found
+	std::shared_ptr<Program> getShaderVariant(const std::string& shaderProgramName, const ShaderVariant& variant);
+
+	// Sets the camera position and lights of the frame the following objects are drawn in
+	void beginFrame(const glm::vec3& eye, ClusteredLighting* lighting);
+
+	// Returns the features shared by everything drawn this frame: shadowed with the shadow map's current filter,
+	// with the current light count
+	ShaderVariant getFrameVariant();
+
+	// Returns the features to draw the given object with this frame, without TEXTURED (decided per sub shape)
+	ShaderVariant getObjectVariant(const RenderItem& item);
+
+	// Returns true if the context supports the multi draw indirect path (OpenGL 4.3)
+	static bool isIndirectDrawingSupported();
+
 	// Finds the shader program with the given name and binds it.
 	// Throws an |out_of_range| exception if no shader program with that name is found
 	const std::shared_ptr<Program> bindShader(const std::string& shaderProgramName);
@@ -91,23 +156,53 @@ public:
 	// Unbinds the current shader from use
 	void unbindShader();
 
+	// Uploads the uniforms shared by every object in a frame: projection, view, lights and the shadow map. Programs
+	// keep their uniforms, so each program only gets them once per frame (and the view again if it changed)
+	void bindFrameUniforms(const std::shared_ptr<Program> shaderProgram, const MatrixStack& P, const MatrixStack& V);
+
+	// Returns the fraction of the viewport height covered by the item's bounding sphere as seen by the camera
+	float calculateScreenSize(const RenderItem& item);
+
 	// Renders the given object
-	void renderObject(std::shared_ptr<GameObject> objToRender, const std::string& shaderName, const std::shared_ptr<Shape> shape,
- 	 const std::shared_ptr<Material> material, std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> V, std::shared_ptr<MatrixStack> M);
+	void renderObject(const RenderItem& item, const MatrixStack& P, const MatrixStack& V);
 
-	// Renders the given object as a billboard
-	void renderBillboard(std::shared_ptr<GameObject> objToRender, const std::string& shaderName, const std::shared_ptr<Shape> shape,
-		const std::shared_ptr<Material> material, const std::shared_ptr<Texture> billboardTexture, std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> V,
-		std::shared_ptr<MatrixStack> M);
+	// Renders the sky with it's cubemap, centered on the camera and behind everything drawn before
+	void renderSkybox(const RenderItem& item, const MatrixStack& P, const MatrixStack& V);
+
+	// Binds the shadow pass program and uploads the light matrices of the current frame, which are also used by
+	// the following color passes. Must be called before any objects are rendered with |renderShadowPass|
+	void beginShadowPass(const glm::mat4& lightProjection, const glm::mat4& lightView);
+
+	// Unbinds the shadow pass program
+	void endShadowPass();
+
+	// Binds the shadow pass program to render depth as seen by the camera instead, so that the following color
+	// pass only shades the nearest surface of every pixel. Objects are rendered with |renderShadowPass| at the
+	// level of detail the color pass picks, until |endDepthPrePass|
+	void beginDepthPrePass(const glm::mat4& P, const glm::mat4& V);
+
+	// Unbinds the shadow pass program
+	void endDepthPrePass();
+
+	// Render the given object to the shadowmap (or depth pre-pass). Only valid between |beginShadowPass| and
+	// |endShadowPass|
+	void renderShadowPass(const RenderItem& item);
 
-	// Render the given object to the shadowmap
-	void renderShadowPass(std::shared_ptr<GameObject> objToRender, const std::shared_ptr<Shape> shape,
-						  std::shared_ptr<MatrixStack> M);
 	// Returns an actual LightType enum value of the given string
 	static LightType stringToLightType(std::string type);
 
     static constexpr const char* shadowPassShaderName = "shadowPass";
 
+    // Fullscreen programs rendering and blurring the EVSM moments of the shadow map
+    static constexpr const char* shadowMomentsShaderName = "shadowMoments";
+    static constexpr const char* shadowBlurShaderName = "shadowBlur";
+
+    // Appended to the name of a shader program to get it's multi draw indirect variant
+    static constexpr const char* IndirectShaderSuffix = "Indirect";
+
+    // Appended to the name of a shader program to get it's debris variant
+    static constexpr const char* DebrisShaderSuffix = "Debris";
+
 private:
 
 	// Special program ID that represents a no/null program shader
@@ -119,31 +214,90 @@ private:
 	// A hash map of the currently compiled vertex shaders. The key is the shader name and the value is the handle
 	std::unordered_map<std::string, GLuint> vertexShaderHandles;
 
+	// Sources of the vertex shaders, compiled on demand. The key is the shader name
+	std::unordered_map<std::string, std::shared_ptr<std::string>> vertexShaderSources;
+
 	// A hash map of the currently compiled fragment shaders. The key is the shader name and the value is the handle
 	std::unordered_map<std::string, GLuint> fragmentShaderHandles;
 
 	// A hash map of the currently linked shader programs. The key is the shader program name and the value is a pointer to the Program
 	std::unordered_map<std::string, std::shared_ptr<Program>> shaderPrograms;
 
-	// Calculate the View Matrix for the given light (for Shadow Mapping)
-	glm::mat4 calculateLightView(std::shared_ptr<Light> light);
+	// Sources of the fragment shaders, compiled on demand and kept to compile variants from. The key is the shader name
+	std::unordered_map<std::string, std::shared_ptr<std::string>> fragmentShaderSources;
+
+	// A program the driver may still be compiling and linking
+	struct PendingProgram {
+		std::string name;
+		std::string vertexShaderName;
+		std::string fragmentShaderName;
+		GLuint pid;
+
+		// Key to store the binary under once linked, empty if binaries aren't cached
+		std::string cacheKey;
+	};
+
+	// Programs linked since the last |finishShaderPrograms|
+	std::vector<PendingProgram> pendingPrograms;
 
-	// Calculate the Projection Matrix for the given light (for Shadow Mapping)
-	glm::mat4 calculateLightProjection(std::shared_ptr<Light> light);
+	// Linked program binaries from previous launches
+	ProgramBinaryCache programBinaryCache;
 
-    // calculate the "middle" of the shoadow map in world sapce
-    glm::vec3 calculateShadowMapMid();
+	// Whether the driver compiles and links in the background (GL_KHR_parallel_shader_compile)
+	bool parallelShaderCompile;
 
-    // calculate the light position as used for shadow mapping
-    glm::vec3 calculateShadowMapLightPos(std::shared_ptr<Light> light);
+	// Variants built so far for each program, keyed by |ShaderVariant::getKey|
+	std::unordered_map<const Program*, std::unordered_map<unsigned int, std::shared_ptr<Program>>> shaderVariants;
 
-	float getViewFrustumMaxDiagonal();
+	// Shadow pass program bound between |beginShadowPass| and |endShadowPass|
+	std::shared_ptr<Program> shadowPassProgram;
+
+	// Scales the screen size objects pick their level of detail by in the current shadow pass or depth pre-pass
+	float depthPassLodBias;
+
+	// Light matrices used for shadow mapping, set once per frame by |beginShadowPass|
+	glm::mat4 lightP;
+	glm::mat4 lightV;
+
+	// Camera position and lights of the current frame, set by |beginFrame|
+	glm::vec3 frameEye;
+	ClusteredLighting* frameLighting;
+
+	// Incremented by |beginFrame|
+	unsigned long frameNumber;
+
+	// Whether the shadow map and light buffers are bound to their texture units this frame
+	bool frameTexturesBound;
+
+	// Frame a program last got the frame uniforms in and the matrices it got
+	struct ProgramFrameState {
+		unsigned long frameNumber;
+		glm::mat4 P;
+		glm::mat4 V;
+	};
+	std::unordered_map<const Program*, ProgramFrameState> programFrameStates;
+
+	// Scales the projected screen size objects pick their level of detail by in the shadow pass.
+	// Shadows are blurred and seen indirectly, so they get away with coarser meshes than the main pass
+	static constexpr float shadowLodBias = 0.5f;
+
+	// Returns the handle of the named shader, compiling it from it's source the first time
+	GLuint getShaderHandle(const std::string& shaderName, GLenum shaderType);
+
+	// Wraps the linked program in a Program and adds it to |shaderPrograms|
+	void addShaderProgram(const std::string& shaderProgramName, const std::string& vertexShaderName, const std::string& fragmentShaderName, GLuint pid);
+
+	// Compiles and links the given variant of |baseProgram|, returns |baseProgram| on failure
+	std::shared_ptr<Program> createShaderVariant(std::shared_ptr<Program> baseProgram, const ShaderVariant& variant);
 
 	ShaderManager();
 
 };
 
-// Helper function for shared code used to compile new shaders
+// Helper function for shared code used to compile new shaders, doesn't wait for the compilation to finish
 GLuint createAndCompileShader(const std::string& shaderName, std::shared_ptr<std::string> shaderSource, GLenum shaderType);
 
+// Prints the compile log of the shader if compiling it failed. Returns false in that case
+bool checkShaderCompiled(const std::string& shaderName, GLuint shaderHandle, GLenum shaderType);
+
 #endif
@@ -1,45 +1,99 @@
 #include "ShadowMap.h"
-#include "WindowManager.h"
+#include "ShaderManager.h"
 
-ShadowMap::ShadowMap() {
+ShadowMap::ShadowMap()
+    : staticCaching(true),
+    staticCacheValid(false),
+    filter(Filter::PCF9),
+    momentsFBO(0),
+    momentsMap(0),
+    blurFBO(0),
+    blurMap(0),
+    fullscreenVAO(0) {
     //generate the FBO for the shadow depth
     glGenFramebuffers(1, &shadowMapFBO);
+    createDepthTarget(shadowMapFBO, shadowMap);
 
+    //generate the FBO for the cached static depth
+    glGenFramebuffers(1, &staticCacheFBO);
+    createDepthTarget(staticCacheFBO, staticCache);
+}
+
+ShadowMap::~ShadowMap() {
+
+}
+
+void ShadowMap::createDepthTarget(GLuint fbo, GLuint& depthTexture) {
     //generate the texture
-    glGenTextures(1, &shadowMap);
-    glBindTexture(GL_TEXTURE_2D, shadowMap);
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SM_WIDTH, SM_HEIGHT,
                  0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    //compared by the hardware, linear filtering blends the results of the 2x2 nearest texels.
+    //Lookups outside of the map compare against the far plane and are lit
+    GLfloat border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
     //bind with framebuffer's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowMap, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-ShadowMap::~ShadowMap() {
+void ShadowMap::createMomentsTarget(GLuint fbo, GLuint& momentsTexture, bool mipmapped) {
+    glGenTextures(1, &momentsTexture);
+    glBindTexture(GL_TEXTURE_2D, momentsTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, MOMENTS_SIZE, MOMENTS_SIZE, 0, GL_RGBA, GL_FLOAT, NULL);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
+    //allocate the whole chain so the texture is complete before the first moments are rendered
+    if (mipmapped) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, momentsTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void ShadowMap::bindForShadowPass() {
     glViewport(0, 0, SM_WIDTH, SM_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+
+    if (staticCaching && staticCacheValid) {
+        //start from the static depth instead of an empty depth buffer
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, staticCacheFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadowMapFBO);
+        glBlitFramebuffer(0, 0, SM_WIDTH, SM_HEIGHT, 0, 0, SM_WIDTH, SM_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+}
+
+void ShadowMap::bindForStaticCachePass() {
+    glViewport(0, 0, SM_WIDTH, SM_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, staticCacheFBO);
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
-void ShadowMap::bindForDraw() {
+void ShadowMap::bindForDraw(int viewWidth, int viewHeight) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    WindowManager& windowManager = WindowManager::instance();
-
-    glViewport(0, 0, windowManager.getViewWidth(), windowManager.getViewHeight());
+    glViewport(0, 0, viewWidth, viewHeight);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glCullFace(GL_BACK);
@@ -51,4 +105,130 @@ void ShadowMap::bindForDraw() {
 
 GLuint ShadowMap::getShadowMap() {
     return shadowMap;
-}
\ No newline at end of file
+}
+
+void ShadowMap::setStaticCaching(bool enabled) {
+    staticCaching = enabled;
+    staticCacheValid = false;
+}
+
+bool ShadowMap::isStaticCaching() {
+    return staticCaching;
+}
+
+bool ShadowMap::isStaticCacheValid() {
+    return staticCacheValid;
+}
+
+void ShadowMap::validateStaticCache() {
+    staticCacheValid = true;
+}
+
+void ShadowMap::invalidateStaticCache() {
+    staticCacheValid = false;
+}
+
+void ShadowMap::setFilter(Filter filter) {
+    this->filter = filter;
+}
+
+ShadowMap::Filter ShadowMap::getFilter() {
+    return filter;
+}
+
+int ShadowMap::getPcfTaps() {
+    switch (filter) {
+    case Filter::PCF1:
+        return 1;
+    case Filter::PCF4:
+        return 4;
+    case Filter::PCF9:
+        return 9;
+    case Filter::PCF16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+const char* ShadowMap::getFilterName(Filter filter) {
+    switch (filter) {
+    case Filter::PCF1:
+        return "PCF 1 tap";
+    case Filter::PCF4:
+        return "PCF 4 taps";
+    case Filter::PCF9:
+        return "PCF 9 taps";
+    case Filter::PCF16:
+        return "PCF 16 taps";
+    case Filter::EVSM:
+        return "EVSM";
+    default:
+        return "unknown";
+    }
+}
+
+void ShadowMap::updateMoments() {
+    if (filter != Filter::EVSM) {
+        return;
+    }
+
+    if (momentsMap == 0) {
+        glGenFramebuffers(1, &momentsFBO);
+        createMomentsTarget(momentsFBO, momentsMap, true);
+
+        glGenFramebuffers(1, &blurFBO);
+        createMomentsTarget(blurFBO, blurMap, false);
+
+        glGenVertexArrays(1, &fullscreenVAO);
+    }
+
+    ShaderManager& shaderManager = ShaderManager::instance();
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, MOMENTS_SIZE, MOMENTS_SIZE);
+    glBindVertexArray(fullscreenVAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    //render the moments, the depth is read without comparison meanwhile
+    std::shared_ptr<Program> program = shaderManager.bindShader(ShaderManager::shadowMomentsShaderName);
+    glUniform1i(program->getUniform("shadowDepthTex"), 0);
+    glUniform1i(program->getUniform("momentsDownsample"), SM_WIDTH / MOMENTS_SIZE);
+
+    glBindTexture(GL_TEXTURE_2D, shadowMap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+
+    //separable blur, horizontally into the blur texture and vertically back into the moments
+    program = shaderManager.bindShader(ShaderManager::shadowBlurShaderName);
+    glUniform1i(program->getUniform("blurSource"), 0);
+
+    glUniform2f(program->getUniform("blurDirection"), 1.0f / MOMENTS_SIZE, 0.0f);
+    glBindTexture(GL_TEXTURE_2D, momentsMap);
+    glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glUniform2f(program->getUniform("blurDirection"), 0.0f, 1.0f / MOMENTS_SIZE);
+    glBindTexture(GL_TEXTURE_2D, blurMap);
+    glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    //distant receivers read the prefiltered levels
+    glBindTexture(GL_TEXTURE_2D, momentsMap);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glBindVertexArray(0);
+    shaderManager.unbindShader();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+GLuint ShadowMap::getMomentsMap() {
+    return momentsMap;
+}
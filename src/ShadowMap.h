@@ -15,24 +15,104 @@ class ShadowMap {
 
 public:
 
+    // How the mesh shaders filter the shadow map: percentage closer filtering with 1, 4, 9 or 16 hardware
+    // compared taps, or exponential variance shadow maps read from blurred and mipmapped moments
+    enum class Filter { PCF1, PCF4, PCF9, PCF16, EVSM };
+
+    static constexpr int NUM_FILTERS = 5;
+
     ShadowMap();
 
     ~ShadowMap();
 
+    // Binds the shadow map for the shadow pass. When static caching is enabled the cached static
+    // depth is copied in instead of clearing, so only dynamic objects have to be drawn afterwards
     void bindForShadowPass();
 
-    void bindForDraw();
+    // Binds and clears the persistent static depth texture so the static casters can be re-rendered into it
+    void bindForStaticCachePass();
+
+    // Binds and clears the default framebuffer of the given size, with the shadow map bound for sampling
+    void bindForDraw(int viewWidth, int viewHeight);
 
     GLuint getShadowMap();
 
+    // Enables or disables caching of the static geometry's depth between frames
+    void setStaticCaching(bool enabled);
+
+    bool isStaticCaching();
+
+    // Returns true if the static depth cache holds valid data for the current light matrices
+    bool isStaticCacheValid();
+
+    // Marks the static depth cache as up to date after the static casters were rendered into it
+    void validateStaticCache();
+
+    // Forces the static casters to be re-rendered on the next shadow pass (e.g. the shadow window moved
+    // or a static object changed)
+    void invalidateStaticCache();
+
+    void setFilter(Filter filter);
+
+    Filter getFilter();
+
+    // Returns the number of PCF taps of the current filter, 0 for EVSM
+    int getPcfTaps();
+
+    // Returns a printable name of the filter
+    static const char* getFilterName(Filter filter);
+
+    // Renders the moments of the finished shadow map, blurs and mipmaps them. Only does anything with the EVSM
+    // filter, must be called after every shadow pass
+    void updateMoments();
+
+    // Returns the moments texture read by EVSM filtering, 0 until the filter was first used
+    GLuint getMomentsMap();
+
     //static constexpr GLuint SM_WIDTH = 4096, SM_WIDTH = 4096;
     static constexpr GLuint SM_WIDTH = 8192, SM_HEIGHT = 8192;
     //static constexpr GLuint SM_WIDTH = 16384, SM_WIDTH = 16384;
 
+    // Size of the EVSM moments, every texel averages the moments of SM_WIDTH / MOMENTS_SIZE squared depths
+    static constexpr GLuint MOMENTS_SIZE = 2048;
+
+    // Texture unit the moments are bound to while drawing
+    static constexpr GLuint MOMENTS_TEXTURE_UNIT = 2;
+
 private:
     GLuint shadowMapFBO;
 
     GLuint shadowMap;
 
+    // FBO and depth texture holding only the static casters, persistent between frames
+    GLuint staticCacheFBO;
+
+    GLuint staticCache;
+
+    bool staticCaching;
+
+    bool staticCacheValid;
+
+    Filter filter;
+
+    // FBOs and RGBA32F textures of the moments and the intermediate result of the separable blur, created the
+    // first time EVSM filtering is used
+    GLuint momentsFBO;
+
+    GLuint momentsMap;
+
+    GLuint blurFBO;
+
+    GLuint blurMap;
+
+    // Empty vertex array the fullscreen passes are drawn with
+    GLuint fullscreenVAO;
+
+    // Creates a depth texture of the shadow map's size and attaches it to the given FBO
+    void createDepthTarget(GLuint fbo, GLuint& depthTexture);
+
+    // Creates a moments texture of |MOMENTS_SIZE| and attaches it to the given FBO
+    void createMomentsTarget(GLuint fbo, GLuint& momentsTexture, bool mipmapped);
+
 };
 #endif
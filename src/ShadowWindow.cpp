@@ -0,0 +1,62 @@
+#include "ShadowWindow.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GameManager.h"
+#include "ShadowMap.h"
+
+ShadowWindow::ShadowWindow()
+   : mid_(0.0f),
+   valid_(false),
+   lightP_(1.0f),
+   lightV_(1.0f) {}
+
+bool ShadowWindow::update(const Light& light, const glm::vec3& eye, const glm::vec3& viewDirection,
+   bool staticCaching) {
+   float halfDiagonal = getViewFrustumMaxDiagonal() / 2.0f;
+   float halfSize = staticCaching ? halfDiagonal + MARGIN : halfDiagonal;
+
+   glm::vec3 viewDirectionNoY = glm::normalize(glm::vec3(viewDirection.x, 0.0f, viewDirection.z));
+   glm::vec3 desiredMid = eye + viewDirectionNoY * halfDiagonal;
+
+   bool moved = true;
+   if (!staticCaching) {
+      mid_ = desiredMid;
+      valid_ = false;
+   } else if (valid_ && glm::length(desiredMid - mid_) <= MARGIN) {
+      moved = false;
+   } else {
+      // Snap the new center to the shadow map's texel grid in light space so that static depth
+      // rendered at different window positions always lines up with the same texels
+      glm::mat3 lightRotation = glm::mat3(glm::lookAt(glm::vec3(0.0f), glm::normalize(light.orientation),
+         glm::vec3(0.0, 1.0, 0.0)));
+      float texelSize = (2.0f * halfSize) / ShadowMap::SM_WIDTH;
+
+      glm::vec3 lightSpaceMid = lightRotation * desiredMid;
+      lightSpaceMid = glm::floor(lightSpaceMid / texelSize + glm::vec3(0.5f)) * texelSize;
+
+      mid_ = glm::transpose(lightRotation) * lightSpaceMid;
+      valid_ = true;
+   }
+
+   // The light looks down at the middle of the window from high enough to see all of the view frustum
+   glm::vec3 lightDirection = glm::normalize(-light.orientation);
+   glm::vec3 lightPos = mid_ + lightDirection * (halfDiagonal / lightDirection.y);
+
+   lightV_ = glm::lookAt(lightPos, mid_, glm::vec3(0.0, 1.0, 0.0));
+   lightP_ = glm::ortho(-halfSize, halfSize, -halfSize, halfSize, 0.1f, glm::length(lightPos - mid_) * 2.0f);
+
+   return moved;
+}
+
+const glm::mat4& ShadowWindow::getLightProjection() const {
+   return lightP_;
+}
+
+const glm::mat4& ShadowWindow::getLightView() const {
+   return lightV_;
+}
+
+float ShadowWindow::getViewFrustumMaxDiagonal() {
+   return GameManager::cullFarPlane - GameManager::nearPlane;
+}
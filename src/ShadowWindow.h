@@ -0,0 +1,48 @@
+#ifndef SHADOW_WINDOW_H
+#define SHADOW_WINDOW_H
+
+#include "glm/glm.hpp"
+
+#include "Light.h"
+
+/*
+ * Area of the world covered by the shadow map and the light matrices rendering it. The window follows the camera,
+ * reaching ahead along the view direction. While static shadow caching is enabled it stays put (snapped to a
+ * shadow map texel) until the camera moved further than |MARGIN|, so that the cached static depth stays valid for
+ * as long as possible.
+ */
+class ShadowWindow {
+public:
+
+   // Distance (world units) the camera may drift from the cached shadow window before it's recentered.
+   // The window is enlarged by this amount so the view stays covered while it drifts
+   static constexpr float MARGIN = 8.0f;
+
+   ShadowWindow();
+
+   // Moves the window to follow the camera at |eye| looking along |viewDirection| and calculates the light matrices
+   // of the (directional) light. Returns true if the window moved, which invalidates cached static shadows
+   bool update(const Light& light, const glm::vec3& eye, const glm::vec3& viewDirection, bool staticCaching);
+
+   // Returns the light projection matrix calculated by the last |update|
+   const glm::mat4& getLightProjection() const;
+
+   // Returns the light view matrix calculated by the last |update|
+   const glm::mat4& getLightView() const;
+
+private:
+
+   // Center of the area covered by the shadow map
+   glm::vec3 mid_;
+
+   // Whether |mid_| is a cached, texel snapped position
+   bool valid_;
+
+   glm::mat4 lightP_;
+   glm::mat4 lightV_;
+
+   // Returns the length of the culled view frustum, which the window has to cover
+   static float getViewFrustumMaxDiagonal();
+};
+
+#endif
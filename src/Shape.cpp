@@ -1,19 +1,138 @@
 #include "Shape.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #include "GLSL.h"
 #include "Program.h"
-#include "GameObject.h"
-
-#include <glm/gtx/rotate_vector.hpp>
+#include "MeshSimplifier.h"
+#include "TextureManager.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
 using namespace std;
 
+namespace {
+
+    // Full precision interleaved vertex, 32 bytes
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+    // Compact interleaved vertex, 16 bytes. Positions are snorm16 (|Shape::resize| fits them into [-1, 1],
+    // the 4th component is padding), normals snorm 10:10:10:2 and texcoords half floats
+    struct CompactVertex {
+        int16_t position[4];
+        uint32_t normal;
+        uint16_t texCoord[2];
+    };
+
+    int16_t packSnorm16(float value) {
+        value = std::max(-1.0f, std::min(1.0f, value));
+        return (int16_t) std::round(value * 32767.0f);
+    }
+
+    // Packs xyz into the 10 bit fields of a GL_INT_2_10_10_10_REV value (x in the lowest bits), w is 0
+    uint32_t packSnorm1010102(const float* value) {
+        uint32_t packed = 0;
+        for (int i = 0; i < 3; i++) {
+            float clamped = std::max(-1.0f, std::min(1.0f, value[i]));
+            int32_t component = (int32_t) std::round(clamped * 511.0f);
+            packed |= ((uint32_t) component & 0x3FF) << (10 * i);
+        }
+        return packed;
+    }
+
+    // Converts to a IEEE half float, rounding to nearest
+    uint16_t packHalf(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exponent = (int32_t) ((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x7FFFFF;
+
+        // Infinity and NaN
+        if (((bits >> 23) & 0xFF) == 0xFF) {
+            return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+        }
+
+        // Too large, clamp to infinity
+        if (exponent >= 31) {
+            return sign | 0x7C00;
+        }
+
+        // Denormalized or too small
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return sign;
+            }
+
+            mantissa |= 0x800000;
+            int shift = 14 - exponent;
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1) {
+                half++;
+            }
+            return sign | half;
+        }
+
+        // A carry out of the mantissa correctly bumps the exponent
+        uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000) {
+            half++;
+        }
+        return half;
+    }
+
+    // Splits |triangles| into up to |numCells| Voronoi cells, assigning each to the nearest of that many randomly
+    // picked triangles by the distance between their |centroids|. Returns the cells that aren't empty
+    std::vector<std::vector<GLuint>> splitIntoCells(const std::vector<glm::vec3>& centroids,
+        const std::vector<GLuint>& triangles, int numCells) {
+        numCells = std::min(numCells, (int) triangles.size());
+
+        // Seeding the cells with triangles of the set makes every cell start out on the surface
+        std::vector<glm::vec3> seeds;
+        for (int c = 0; c < numCells; c++) {
+            seeds.push_back(centroids[triangles[rand() % triangles.size()]]);
+        }
+
+        std::vector<std::vector<GLuint>> cells(numCells);
+        for (GLuint t : triangles) {
+            int nearest = 0;
+            float closest = FLT_MAX;
+            for (int c = 0; c < numCells; c++) {
+                glm::vec3 offset = centroids[t] - seeds[c];
+                float distance = glm::dot(offset, offset);
+                if (distance < closest) {
+                    closest = distance;
+                    nearest = c;
+                }
+            }
+            cells[nearest].push_back(t);
+        }
+
+        cells.erase(std::remove_if(cells.begin(), cells.end(),
+            [](const std::vector<GLuint>& cell) { return cell.empty(); }), cells.end());
+        return cells;
+    }
+}
+
 Shape::Shape() :
+	vertexBufID(0),
+	indexBufID(0),
 	vaoID(0),
+	compactVertexFormat(false),
+	vertexBufferSize(0),
+	gpuMemoryUsage(0),
+	uncompressedGpuMemoryUsage(0),
+	debrisBuilt(false),
 	min(glm::vec3(0,0,0)),
 	max(glm::vec3(0, 0, 0))
 {
@@ -74,16 +193,6 @@ void Shape::loadMesh(const string &meshName) {
                 string shapeTextureName = objMaterials[shapeMaterialID].diffuse_texname;
 
                 textureNames.push_back(shapeTextureName);
-
-                //first check if there is a texture name
-                if(shapeTextureName != "") {
-
-                    if (textures.count(shapeTextureName) == 0) {
-                        Texture *texture = new Texture();
-                        texture->loadTexture("../resources/" + shapeTextureName, shapeTextureName);
-                        textures[shapeTextureName] = texture;
-                    }
-                }
             }
 
         }
@@ -237,249 +346,474 @@ void Shape::resize() {
 
 }
 
-void Shape::init() {
+void Shape::generateLods() {
+    lodEleBuf.clear();
 
     int bufNum = posBuf.size();
+    size_t numTriangles = 0;
+    for(int i = 0; i < bufNum; i++) {
+        numTriangles += eleBuf[i].size() / 3;
+    }
 
+    if (numTriangles < (size_t) MIN_LOD_TRIANGLES) {
+        return;
+    }
 
-    for(int i = 0; i < bufNum; i++) {
+    // Each level is simplified from the previous one, which is a lot faster than starting over every time
+    for (int lod = 1; lod < MAX_LODS; lod++) {
+        std::vector<std::vector<unsigned>> lodIndices;
+        size_t lodTriangles = 0;
 
-        glGenVertexArrays(1, &vaoID);
-        glBindVertexArray(vaoID);
+        for(int i = 0; i < bufNum; i++) {
+            const std::vector<unsigned>& prevIndices = lod == 1 ? eleBuf[i] : lodEleBuf[lod - 2][i];
+            unsigned int targetTriangles = (unsigned int) (prevIndices.size() / 3 * LOD_REDUCTION);
 
-        // Send the position array to the GPU
-        unsigned posBufIDRef;
-        glGenBuffers(1, &posBufIDRef);
-        posBufID.push_back(posBufIDRef);
-        glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-        glBufferData(GL_ARRAY_BUFFER, posBuf[i].size() * sizeof(float), &(posBuf[i][0]), GL_STATIC_DRAW);
+            lodIndices.push_back(MeshSimplifier::simplify(posBuf[i], prevIndices, targetTriangles));
+            lodTriangles += lodIndices.back().size() / 3;
+        }
 
-        // Send the normal array to the GPU
-        if (norBuf[i].empty()) {
-            norBufID.push_back(0);
-        } else {
-            unsigned norBufIDRef;
-            glGenBuffers(1, &norBufIDRef);
-            norBufID.push_back(norBufIDRef);
-            glBindBuffer(GL_ARRAY_BUFFER, norBufID[i]);
-            glBufferData(GL_ARRAY_BUFFER, norBuf[i].size() * sizeof(float), &(norBuf[i][0]), GL_STATIC_DRAW);
+        // Stop once the locked boundaries and seams keep the simplification from getting anywhere
+        if (lodTriangles > numTriangles * MIN_LOD_REDUCTION) {
+            break;
         }
 
-        // Send the texture array to the GPU
-        if (texBuf[i].empty()) {
-            texBufID.push_back(0);
-        } else {
-            unsigned texBufIDRef;
-            glGenBuffers(1, &texBufIDRef);
-            texBufID.push_back(texBufIDRef);
-            glBindBuffer(GL_ARRAY_BUFFER, texBufID[i]);
-            glBufferData(GL_ARRAY_BUFFER, texBuf[i].size() * sizeof(float), &(texBuf[i][0]), GL_STATIC_DRAW);
+        lodEleBuf.push_back(lodIndices);
+        numTriangles = lodTriangles;
+    }
+}
+
+void Shape::optimizeMesh(bool optimizeOverdraw, MeshOptimizer::CacheStatistics* before, MeshOptimizer::CacheStatistics* after) {
+    if (before) {
+        *before = { 0, 0, 0 };
+    }
+    if (after) {
+        *after = { 0, 0, 0 };
+    }
+
+    int bufNum = posBuf.size();
+    for(int i = 0; i < bufNum; i++) {
+        unsigned int numVerts = posBuf[i].size() / 3;
+
+        if (before) {
+            before->add(MeshOptimizer::simulateVertexCache(eleBuf[i], numVerts));
         }
 
-        // Send the element array to the GPU
-        unsigned eleBufIDRef;
-        glGenBuffers(1, &eleBufIDRef);
-        eleBufID.push_back(eleBufIDRef);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf[i].size() * sizeof(unsigned int), &(eleBuf[i][0]), GL_STATIC_DRAW);
+        // Only the full detail mesh is sorted for overdraw, distant levels of detail cover too few pixels to matter
+        if (optimizeOverdraw) {
+            std::vector<unsigned> clusters;
+            eleBuf[i] = MeshOptimizer::optimizeVertexCache(eleBuf[i], numVerts, MeshOptimizer::DEFAULT_CACHE_SIZE, &clusters);
+            eleBuf[i] = MeshOptimizer::optimizeOverdraw(posBuf[i], eleBuf[i], clusters);
+        } else {
+            eleBuf[i] = MeshOptimizer::optimizeVertexCache(eleBuf[i], numVerts);
+        }
 
-        // Unbind the arrays
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        for (size_t lod = 0; lod < lodEleBuf.size(); lod++) {
+            lodEleBuf[lod][i] = MeshOptimizer::optimizeVertexCache(lodEleBuf[lod][i], numVerts);
+        }
 
-        assert(glGetError() == GL_NO_ERROR);
+        // Vertices are ordered by first use in the full detail mesh, the coarser levels only use a subset of them
+        std::vector<unsigned> remap = MeshOptimizer::optimizeVertexFetch(eleBuf[i], numVerts);
+        MeshOptimizer::remapVertices(posBuf[i], 3, remap);
+        MeshOptimizer::remapVertices(norBuf[i], 3, remap);
+        MeshOptimizer::remapVertices(texBuf[i], 2, remap);
+        MeshOptimizer::remapIndices(eleBuf[i], remap);
+        for (size_t lod = 0; lod < lodEleBuf.size(); lod++) {
+            MeshOptimizer::remapIndices(lodEleBuf[lod][i], remap);
+        }
 
+        if (after) {
+            after->add(MeshOptimizer::simulateVertexCache(eleBuf[i], numVerts));
+        }
     }
+}
+
+int Shape::getNumLods() {
+    return lodSubMeshes.size();
+}
 
+int Shape::selectLod(float screenSize) {
+    int lod = 0;
+    float lodScreenSize = LOD_SCREEN_SIZE;
 
+    while (lod + 1 < getNumLods() && screenSize < lodScreenSize) {
+        lod++;
+        lodScreenSize *= 0.5f;
+    }
+
+    return lod;
 }
 
-void Shape::draw(const shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl) {
-	int h_pos, h_nor, h_tex;
-	h_pos = h_nor = h_tex = -1;
+void Shape::init(bool compactVertexFormat) {
+    // textures are requested here rather than in |loadMesh|, which may run on a worker thread. They are shared with
+    // every other shape using the same file
+    for (const std::string& textureName : textureNames) {
+        if (textureName != "" && textures.count(textureName) == 0) {
+            textures[textureName] = TextureManager::instance().getTexture("../resources/" + textureName);
+        }
+    }
+
+    size_t vertexSize = compactVertexFormat ? sizeof(CompactVertex) : sizeof(Vertex);
 
-    glBindVertexArray(vaoID);
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned char> indices;
+    size_t numIndices = 0;
+
+    lodSubMeshes.assign(1 + lodEleBuf.size(), std::vector<SubMesh>());
 
     int bufNum = posBuf.size();
-    // Send the position array to the GPU
     for(int i = 0; i < bufNum; i++) {
+        int numVerts = posBuf[i].size() / 3;
+
+        SubMesh subMesh;
+        subMesh.indexCount = eleBuf[i].size();
+        subMesh.indexType = compactVertexFormat && numVerts <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        subMesh.indexOffset = appendIndices(indices, eleBuf[i], subMesh.indexType);
+        subMesh.baseVertex = vertices.size() / vertexSize;
+        lodSubMeshes[0].push_back(subMesh);
+        numIndices += eleBuf[i].size();
+
+        // Interleave the sub shape's attributes, missing texcoords are left at zero
+        for (int v = 0; v < numVerts; v++) {
+            float position[3] = { posBuf[i][3 * v + 0], posBuf[i][3 * v + 1], posBuf[i][3 * v + 2] };
+
+            float normal[3] = { 0.0f, 0.0f, 0.0f };
+            if (norBuf[i].size() >= 3 * (size_t) (v + 1)) {
+                normal[0] = norBuf[i][3 * v + 0];
+                normal[1] = norBuf[i][3 * v + 1];
+                normal[2] = norBuf[i][3 * v + 2];
+            }
 
-        // Bind position buffer
-        h_pos = prog->getAttribute("vertPos");
-        GLSL::enableVertexAttribArray(h_pos);
-        glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-        glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
-
-        // Bind normal buffer
-        h_nor = prog->getAttribute("vertNor");
-        if (h_nor != -1 && norBufID[i] != 0) {
-            GLSL::enableVertexAttribArray(h_nor);
-            glBindBuffer(GL_ARRAY_BUFFER, norBufID[i]);
-            glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
-        }
+            float texCoord[2] = { 0.0f, 0.0f };
+            if (texBuf[i].size() >= 2 * (size_t) (v + 1)) {
+                texCoord[0] = texBuf[i][2 * v + 0];
+                texCoord[1] = texBuf[i][2 * v + 1];
+            }
 
-        if (texBufID[i] != 0) {
-            // Bind texcoords buffer
-            h_tex = prog->getAttribute("vertTex");
-            if (h_tex != -1 && texBufID[i] != 0) {
-                GLSL::enableVertexAttribArray(h_tex);
-                glBindBuffer(GL_ARRAY_BUFFER, texBufID[i]);
-                glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
+            size_t offset = vertices.size();
+            vertices.resize(offset + vertexSize);
+
+            if (compactVertexFormat) {
+                CompactVertex vertex;
+                vertex.position[0] = packSnorm16(position[0]);
+                vertex.position[1] = packSnorm16(position[1]);
+                vertex.position[2] = packSnorm16(position[2]);
+                vertex.position[3] = 0;
+                vertex.normal = packSnorm1010102(normal);
+                vertex.texCoord[0] = packHalf(texCoord[0]);
+                vertex.texCoord[1] = packHalf(texCoord[1]);
+                memcpy(&vertices[offset], &vertex, sizeof(vertex));
+            } else {
+                Vertex vertex = { { position[0], position[1], position[2] }, { normal[0], normal[1], normal[2] },
+                    { texCoord[0], texCoord[1] } };
+                memcpy(&vertices[offset], &vertex, sizeof(vertex));
             }
         }
+    }
 
-        // Bind element buffer
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
+    // The coarser levels of detail follow in the same index buffer and share the vertices of LOD 0
+    for (size_t lod = 1; lod < lodSubMeshes.size(); lod++) {
+        for(int i = 0; i < bufNum; i++) {
+            const std::vector<unsigned>& lodIndices = lodEleBuf[lod - 1][i];
+
+            SubMesh subMesh;
+            subMesh.indexCount = lodIndices.size();
+            subMesh.indexType = lodSubMeshes[0][i].indexType;
+            subMesh.indexOffset = appendIndices(indices, lodIndices, subMesh.indexType);
+            subMesh.baseVertex = lodSubMeshes[0][i].baseVertex;
+            lodSubMeshes[lod].push_back(subMesh);
+            numIndices += lodIndices.size();
+        }
+    }
 
-        if(materialPresent[i]) {
-           bindMtl(prog, materials[i]);
-        } else {
-           bindMtl(prog, defaultMtl);
+    this->compactVertexFormat = compactVertexFormat;
+    vertexBufferSize = vertices.size();
+    gpuMemoryUsage = vertices.size() + indices.size();
+    uncompressedGpuMemoryUsage = vertices.size() / vertexSize * sizeof(Vertex) + numIndices * sizeof(unsigned int);
+
+    if (vertices.empty() || indices.empty()) {
+        return;
+    }
+
+    glGenVertexArrays(1, &vaoID);
+    glBindVertexArray(vaoID);
+
+    // Send the interleaved vertex array to the GPU
+    glGenBuffers(1, &vertexBufID);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufID);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size(), &(vertices[0]), GL_STATIC_DRAW);
+
+    // Send the element array to the GPU, the binding is stored in the VAO
+    glGenBuffers(1, &indexBufID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), &(indices[0]), GL_STATIC_DRAW);
+
+    // Bake the attribute layout into the VAO
+    setupVertexAttributes(compactVertexFormat);
+
+    // Unbind the VAO before the buffers so the element buffer binding is kept
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    assert(glGetError() == GL_NO_ERROR);
+}
+
+void Shape::setupVertexAttributes(bool compactVertexFormat) {
+    GLSL::enableVertexAttribArray(POSITION_ATTRIBUTE);
+    GLSL::enableVertexAttribArray(NORMAL_ATTRIBUTE);
+    GLSL::enableVertexAttribArray(TEXCOORD_ATTRIBUTE);
+
+    // The compact attributes are decoded by the vertex fetch, so the shaders receive the same floats either way
+    // (positions as normalized shorts, w defaults to 1)
+    if (compactVertexFormat) {
+        GLsizei stride = sizeof(CompactVertex);
+        glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_SHORT, GL_TRUE, stride, (const void *) offsetof(CompactVertex, position));
+        glVertexAttribPointer(NORMAL_ATTRIBUTE, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (const void *) offsetof(CompactVertex, normal));
+        glVertexAttribPointer(TEXCOORD_ATTRIBUTE, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void *) offsetof(CompactVertex, texCoord));
+    } else {
+        GLsizei stride = sizeof(Vertex);
+        glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, stride, (const void *) offsetof(Vertex, position));
+        glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, stride, (const void *) offsetof(Vertex, normal));
+        glVertexAttribPointer(TEXCOORD_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, stride, (const void *) offsetof(Vertex, texCoord));
+    }
+}
+
+size_t Shape::getGpuMemoryUsage() {
+    return gpuMemoryUsage;
+}
+
+size_t Shape::getUncompressedGpuMemoryUsage() {
+    return uncompressedGpuMemoryUsage;
+}
+
+void Shape::draw(const shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int lod, SubShapes subShapes) {
+    glBindVertexArray(vaoID);
+
+    int bufNum = getNumSubShapes();
+    for(int i = 0; i < bufNum; i++) {
+        if (!isSubShapeIncluded(i, subShapes)) {
+            continue;
         }
 
-        // check if texture for shape
+        bindSubMeshMaterial(prog, defaultMtl, i);
+
+        drawSubMesh(i, lod);
+
         if(textureNames[i] != "") {
-            textures[textureNames[i]]->bind(0, prog);
-            glUniform1i(prog->getUniform("textureActive"), 1);
+            textures[textureNames[i]]->unbind();
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+void Shape::drawDepth(const shared_ptr<Program> prog, int lod) {
+    glBindVertexArray(vaoID);
+
+    int bufNum = getNumSubShapes();
+    for(int i = 0; i < bufNum; i++) {
+        drawSubMesh(i, lod);
+    }
+
+    glBindVertexArray(0);
+}
+
+void Shape::bindSubMeshMaterial(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int i) {
+    if(materialPresent[i]) {
+        bindMtl(prog, materials[i]);
+    } else {
+        bindMtl(prog, defaultMtl);
+    }
+
+    // check if texture for shape
+    if(textureNames[i] != "") {
+        textures[textureNames[i]]->bind(0, prog);
+        glUniform1i(prog->getUniform("textureActive"), 1);
+    } else {
+        glUniform1i(prog->getUniform("textureActive"), 0);
+    }
+}
+
+size_t Shape::appendIndices(std::vector<unsigned char>& buffer, const std::vector<unsigned>& indices, unsigned indexType) {
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // Keep every range aligned to it's index size
+    size_t offset = (buffer.size() + indexSize - 1) / indexSize * indexSize;
+    buffer.resize(offset + indices.size() * indexSize);
+
+    for (size_t j = 0; j < indices.size(); j++) {
+        if (indexType == GL_UNSIGNED_SHORT) {
+            uint16_t index = (uint16_t) indices[j];
+            memcpy(&buffer[offset + j * indexSize], &index, indexSize);
         } else {
-            glUniform1i(prog->getUniform("textureActive"), 0);
+            uint32_t index = indices[j];
+            memcpy(&buffer[offset + j * indexSize], &index, indexSize);
+        }
+    }
+
+    return offset;
+}
+
+void Shape::drawSubMesh(int i, int lod) {
+    const SubMesh& subMesh = lodSubMeshes[lod][i];
+    glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.indexCount, subMesh.indexType, (const void *) subMesh.indexOffset, subMesh.baseVertex);
+}
+
+void Shape::initDebris(int cellsPerSubShape, int cellsPerChunk) {
+    if (debrisBuilt) {
+        return;
+    }
+    debrisBuilt = true;
+
+    const int floatsPerVertex = sizeof(Vertex) / sizeof(float);
+
+    int bufNum = posBuf.size();
+    for (int i = 0; i < bufNum; i++) {
+        int numTris = eleBuf[i].size() / 3;
+
+        // Triangles belong to the cell their centroid is in
+        std::vector<glm::vec3> centroids(numTris, glm::vec3(0.0f));
+        std::vector<GLuint> triangles(numTris);
+        for (int t = 0; t < numTris; t++) {
+            for (int k = 0; k < 3; k++) {
+                unsigned v = eleBuf[i][3 * t + k];
+                centroids[t] += glm::vec3(posBuf[i][3 * v + 0], posBuf[i][3 * v + 1], posBuf[i][3 * v + 2]) / 3.0f;
+            }
+            triangles[t] = t;
         }
 
-        // Draw
-        glDrawElements(GL_TRIANGLES, (int) eleBuf[i].size(), GL_UNSIGNED_INT, (const void *) 0);
+        SubMesh subMeshes[NUM_DEBRIS_LEVELS];
+        for (int level = 0; level < NUM_DEBRIS_LEVELS; level++) {
+            subMeshes[level].indexType = GL_UNSIGNED_INT;
+            subMeshes[level].indexOffset = debrisMeshes[level].indices.size() * sizeof(GLuint);
+            subMeshes[level].baseVertex = debrisMeshes[level].vertices.size() / floatsPerVertex;
+        }
 
+        // Every cell becomes a chunk and is split again into the chunks of the fine level, so that those can take
+        // it's place when it breaks further
+        for (const std::vector<GLuint>& cell : splitIntoCells(centroids, triangles, cellsPerSubShape)) {
+            int parent = debrisMeshes[DEBRIS_COARSE].chunks.size();
+            addDebrisChunk(debrisMeshes[DEBRIS_COARSE], i, cell, -1, subMeshes[DEBRIS_COARSE].baseVertex);
 
-        if(textureNames[i] != "") {
-            textures[textureNames[i]]->unbind();
+            for (const std::vector<GLuint>& fineCell : splitIntoCells(centroids, cell, cellsPerChunk)) {
+                addDebrisChunk(debrisMeshes[DEBRIS_FINE], i, fineCell, parent, subMeshes[DEBRIS_FINE].baseVertex);
+            }
         }
 
+        for (int level = 0; level < NUM_DEBRIS_LEVELS; level++) {
+            DebrisMesh& mesh = debrisMeshes[level];
+            subMeshes[level].indexCount = mesh.indices.size() - subMeshes[level].indexOffset / sizeof(GLuint);
+            mesh.subMeshes.push_back(subMeshes[level]);
+        }
     }
-    // Disable and unbind
-    if (h_tex != -1) {
-        GLSL::disableVertexAttribArray(h_tex);
+}
+
+void Shape::addDebrisChunk(DebrisMesh& mesh, int subShape, const std::vector<GLuint>& triangles, int parent,
+    int baseVertex) {
+    const int floatsPerVertex = sizeof(Vertex) / sizeof(float);
+
+    DebrisChunk chunk = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), parent };
+    GLuint chunkIndex = mesh.chunks.size();
+
+    // Vertices on the border between cells are duplicated into each of them
+    std::vector<int> remap(posBuf[subShape].size() / 3, -1);
+    for (GLuint t : triangles) {
+        for (int k = 0; k < 3; k++) {
+            unsigned v = eleBuf[subShape][3 * t + k];
+            if (remap[v] < 0) {
+                remap[v] = mesh.vertices.size() / floatsPerVertex - baseVertex;
+
+                Vertex vertex = { { posBuf[subShape][3 * v + 0], posBuf[subShape][3 * v + 1],
+                    posBuf[subShape][3 * v + 2] }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } };
+                if (norBuf[subShape].size() >= 3 * (size_t) (v + 1)) {
+                    memcpy(vertex.normal, &norBuf[subShape][3 * v], sizeof(vertex.normal));
+                }
+                if (texBuf[subShape].size() >= 2 * (size_t) (v + 1)) {
+                    memcpy(vertex.texCoord, &texBuf[subShape][2 * v], sizeof(vertex.texCoord));
+                }
+
+                // Kept as plain floats until the drawing thread uploads them
+                const float* vertexData = reinterpret_cast<const float*>(&vertex);
+                mesh.vertices.insert(mesh.vertices.end(), vertexData, vertexData + floatsPerVertex);
+                mesh.chunkIndices.push_back(chunkIndex);
+
+                glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+                chunk.min = glm::min(chunk.min, position);
+                chunk.max = glm::max(chunk.max, position);
+            }
+
+            mesh.indices.push_back(remap[v]);
+        }
     }
-    if (h_nor != -1) {
-        GLSL::disableVertexAttribArray(h_nor);
+
+    mesh.chunks.push_back(chunk);
+}
+
+void Shape::uploadDebris(DebrisMesh& mesh) {
+    if (mesh.vertices.empty() || mesh.indices.empty()) {
+        return;
     }
 
-    GLSL::disableVertexAttribArray(h_pos);
+    glGenVertexArrays(1, &mesh.vaoID);
+    glBindVertexArray(mesh.vaoID);
+
+    glGenBuffers(1, &mesh.vertexBufID);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBufID);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), &mesh.vertices[0], GL_STATIC_DRAW);
+    setupVertexAttributes(false);
+
+    glGenBuffers(1, &mesh.chunkBufID);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.chunkBufID);
+    glBufferData(GL_ARRAY_BUFFER, mesh.chunkIndices.size() * sizeof(GLuint), &mesh.chunkIndices[0], GL_STATIC_DRAW);
+    GLSL::enableVertexAttribArray(DEBRIS_CHUNK_ATTRIBUTE);
+    glVertexAttribIPointer(DEBRIS_CHUNK_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (const void *) 0);
+
+    glGenBuffers(1, &mesh.indexBufID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), &mesh.indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    assert(glGetError() == GL_NO_ERROR);
+
+    std::vector<float>().swap(mesh.vertices);
+    std::vector<GLuint>().swap(mesh.chunkIndices);
+    std::vector<GLuint>().swap(mesh.indices);
+}
+
+const std::vector<Shape::DebrisChunk>& Shape::getDebrisChunks(DebrisLevel level) {
+    return debrisMeshes[level].chunks;
 }
 
-float Shape::randFloat(float a, float b) {
-   float randNum = ((float)rand()) / (float)RAND_MAX;
-   float diff = b - a;
-   float off = randNum * diff;
-
-   return a + off;
-}
-
-std::shared_ptr<std::vector<glm::vec3>> Shape::calcFragmentDir(glm::vec3 direction) {
-   std::shared_ptr<std::vector<glm::vec3>> eleDir = std::make_shared<std::vector<glm::vec3>>();
-
-   // Calculate the axis to randomize the direction of the objects about.
-   glm::vec3 vertRotAxis = glm::vec3(0.0, 1.0, 0.0);
-   glm::vec3 horRotAxis = glm::cross(direction, vertRotAxis);
-
-   int bufNum = posBuf.size();
-   for (int i = 0; i < bufNum; i++) {
-      // Calculate a random direction to translate the point on.
-      glm::vec3 dirHor = glm::rotate(direction, randFloat(-M_PI / 4.0f, M_PI / 4.0f), vertRotAxis);
-      glm::vec3 dirVert = glm::rotate(direction, randFloat(-M_PI / 12.0f, M_PI / 6.0f), horRotAxis);
-      glm::vec3 dir = glm::normalize((dirHor + dirVert) * 0.5f);
-
-      eleDir->push_back(dir);
-   }
-
-   return eleDir;
-}
-
-void Shape::fracture(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl,
-   std::shared_ptr<MatrixStack> M, std::shared_ptr<GameObject> obj) {
-	int h_pos, h_nor, h_tex;
-	h_pos = h_nor = h_tex = -1;
-
-   glBindVertexArray(vaoID);
-
-   int bufNum = posBuf.size();
-   // Send the position array to the GPU
-   for (int i = 0; i < bufNum; i++) {
-      M->pushMatrix();
-      M->loadIdentity();
-
-      /* Load in a new model transform per shape within the larger Shape obj.
-       * For fracturing we are just going to translate the shape. */ 
-      M->translate(obj->getFragmentPos()->at(i));
-      M->scale(obj->getScale());
-      glm::mat4 rotation = obj->transform.getRotate();
-      M->rotateMat4(rotation);
-      glUniformMatrix4fv(prog->getUniform("M"), 1, GL_FALSE, glm::value_ptr(M->topMatrix()));
-      glm::mat4 tiM = glm::transpose(glm::inverse(M->topMatrix()));
-      glUniformMatrix4fv(prog->getUniform("tiM"), 1, GL_FALSE, glm::value_ptr(tiM));
-
-       // Bind position buffer
-      h_pos = prog->getAttribute("vertPos");
-      GLSL::enableVertexAttribArray(h_pos);
-      glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-      glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
-
-      // Bind normal buffer
-      h_nor = prog->getAttribute("vertNor");
-      if (h_nor != -1 && norBufID[i] != 0) {
-         GLSL::enableVertexAttribArray(h_nor);
-         glBindBuffer(GL_ARRAY_BUFFER, norBufID[i]);
-         glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
-      }
-
-      if (texBufID[i] != 0) {
-         // Bind texcoords buffer
-         h_tex = prog->getAttribute("vertTex");
-         if (h_tex != -1 && texBufID[i] != 0) {
-            GLSL::enableVertexAttribArray(h_tex);
-            glBindBuffer(GL_ARRAY_BUFFER, texBufID[i]);
-            glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *) 0);
-         }
-      }
-
-      // Bind element buffer
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
-
-      if(materialPresent[i]) {
-         bindMtl(prog, materials[i]);
-      } else {
-         bindMtl(prog, defaultMtl);
-      }
-
-      // check if texture for shape
-      if(textureNames[i] != "") {
-         textures[textureNames[i]]->bind(0, prog);
-         glUniform1i(prog->getUniform("textureActive"), 1);
-      } else {
-         glUniform1i(prog->getUniform("textureActive"), 0);
-      }
-
-      // Draw
-      glDrawElements(GL_TRIANGLES, (int) eleBuf[i].size(), GL_UNSIGNED_INT, (const void *) 0);
-
-
-      if(textureNames[i] != "") {
-         textures[textureNames[i]]->unbind();
-      }
-
-      M->popMatrix();
-   }
-   // Disable and unbind
-   if (h_tex != -1) {
-      GLSL::disableVertexAttribArray(h_tex);
-   }
-   if (h_nor != -1) {
-      GLSL::disableVertexAttribArray(h_nor);
-   }
-
-   GLSL::disableVertexAttribArray(h_pos);
-   glBindBuffer(GL_ARRAY_BUFFER, 0);
-   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Shape::drawDebris(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int numInstances,
+    DebrisLevel level, SubShapes subShapes) {
+    DebrisMesh& mesh = debrisMeshes[level];
+    if (mesh.vaoID == 0) {
+        uploadDebris(mesh);
+    }
+
+    glBindVertexArray(mesh.vaoID);
+
+    int bufNum = mesh.subMeshes.size();
+    for (int i = 0; i < bufNum; i++) {
+        const SubMesh& subMesh = mesh.subMeshes[i];
+        if (subMesh.indexCount == 0 || !isSubShapeIncluded(i, subShapes)) {
+            continue;
+        }
+
+        bindSubMeshMaterial(prog, defaultMtl, i);
+
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, subMesh.indexCount, subMesh.indexType,
+            (const void *) subMesh.indexOffset, numInstances, subMesh.baseVertex);
+
+        if(textureNames[i] != "") {
+            textures[textureNames[i]]->unbind();
+        }
+    }
+
+    glBindVertexArray(0);
 }
 
 void Shape::bindMtl(const std::shared_ptr<Program> prog, std::shared_ptr<Material> material) const {
@@ -492,6 +826,61 @@ void Shape::bindMtl(const std::shared_ptr<Program> prog, std::shared_ptr<Materia
 
 }
 
+int Shape::getNumSubShapes() {
+	return posBuf.size();
+}
+
+const std::vector<float>& Shape::getPositions(int subShape) {
+	return posBuf[subShape];
+}
+
+const std::vector<unsigned>& Shape::getIndices(int subShape, int lod) {
+	return lod == 0 ? eleBuf[subShape] : lodEleBuf[lod - 1][subShape];
+}
+
+unsigned Shape::getVertexBufferID() {
+	return vertexBufID;
+}
+
+size_t Shape::getVertexBufferSize() {
+	return vertexBufferSize;
+}
+
+bool Shape::isCompactVertexFormat() {
+	return compactVertexFormat;
+}
+
+size_t Shape::getVertexSize() {
+	return compactVertexFormat ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+int Shape::getBaseVertex(int subShape) {
+	return lodSubMeshes[0][subShape].baseVertex;
+}
+
+std::shared_ptr<Material> Shape::getMaterial(int subShape) {
+	return materialPresent[subShape] ? materials[subShape] : nullptr;
+}
+
+Texture* Shape::getTexture(int subShape) {
+	return textureNames[subShape] != "" ? textures[textureNames[subShape]].get() : nullptr;
+}
+
+int Shape::getNumTexturedSubShapes() {
+	return std::count_if(textureNames.begin(), textureNames.end(), [](const std::string& name) { return name != ""; });
+}
+
+bool Shape::isSubShapeIncluded(int i, SubShapes subShapes) const {
+	switch (subShapes) {
+		case SubShapes::TEXTURED:
+			return textureNames[i] != "";
+		case SubShapes::UNTEXTURED:
+			return textureNames[i] == "";
+		default:
+			return true;
+	}
+}
+
 glm::vec3& Shape::getMin() {
 	return this->min;
 }
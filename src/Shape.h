@@ -15,46 +15,200 @@
 
 #include "Texture.h"
 #include "MaterialManager.h"
+#include "MeshOptimizer.h"
 
 class Program;
-class GameObject;
 
 class Shape
 {
 public:
+	// Attribute locations used by all mesh shaders (see "layout(location = ...)" in the *_vert.glsl files)
+	static constexpr unsigned POSITION_ATTRIBUTE = 0;
+	static constexpr unsigned NORMAL_ATTRIBUTE = 1;
+	static constexpr unsigned TEXCOORD_ATTRIBUTE = 2;
+
+	// Attribute location of the per vertex chunk index of the debris mesh (see "debris_vert.glsl")
+	static constexpr unsigned DEBRIS_CHUNK_ATTRIBUTE = 3;
+
+	// Maximum number of levels of detail per shape, including the full detail mesh (LOD 0)
+	static constexpr int MAX_LODS = 4;
+
+	// Fraction of the previous level's triangles each level of detail aims for
+	static constexpr float LOD_REDUCTION = 0.5f;
+
+	// Levels that don't get below this fraction of the previous level's triangles are dropped
+	static constexpr float MIN_LOD_REDUCTION = 0.8f;
+
+	// Shapes with fewer triangles don't get levels of detail
+	static constexpr int MIN_LOD_TRIANGLES = 512;
+
+	// Projected screen size (fraction of the viewport height) below which LOD 1 is used.
+	// Every further level of detail halves it
+	static constexpr float LOD_SCREEN_SIZE = 0.25f;
+
 	Shape();
 	virtual ~Shape();
+	// Reads the mesh and it's materials. Makes no GL calls, so it can run on a worker thread
 	void loadMesh(const std::string &meshName);
 	void calculateNormals(int i);
-	void init();
+	// Uploads the mesh and all of it's levels of detail and requests it's textures. The compact vertex format halves the vertex size (snorm16
+	// positions, 10:10:10:2 normals, half float texcoords) and uses 16 bit indices for sub shapes that allow it
+	void init(bool compactVertexFormat = false);
 	void resize();
-	void draw(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl);
-   std::shared_ptr<std::vector<glm::vec3>> calcFragmentDir(glm::vec3 direction);
-   void fracture(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl,
-      std::shared_ptr<MatrixStack> M, std::shared_ptr<GameObject> obj);
+	// Simplifies the loaded mesh into a chain of coarser levels of detail, must be called before |init|
+	void generateLods();
+	// Reorders the triangles of every level of detail for the vertex cache (and optionally to reduce overdraw) and
+	// the vertices for fetch locality, must be called before |init|. Fills in the simulated vertex cache statistics
+	// of the full detail mesh before and after if given
+	void optimizeMesh(bool optimizeOverdraw, MeshOptimizer::CacheStatistics* before = nullptr,
+		MeshOptimizer::CacheStatistics* after = nullptr);
+	// Returns the number of levels of detail, including the full detail mesh
+	int getNumLods();
+	// Returns the level of detail to draw the shape with at the given projected screen size
+	int selectLod(float screenSize);
+	// Which sub shapes |draw| and |drawDebris| draw, so that textured and untextured sub shapes can be drawn with
+	// different shader variants
+	enum class SubShapes { ALL, TEXTURED, UNTEXTURED };
+	void draw(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int lod = 0,
+		SubShapes subShapes = SubShapes::ALL);
+	// Draws only the positions of the shape, skipping all material and texture state (used for depth only passes)
+	void drawDepth(const std::shared_ptr<Program> prog, int lod = 0);
+	// Levels of the debris mesh, every chunk of the fine level is a piece of one chunk of the coarse level
+	enum DebrisLevel { DEBRIS_COARSE, DEBRIS_FINE, NUM_DEBRIS_LEVELS };
+	// Bounds of a piece of the debris mesh in model space
+	struct DebrisChunk {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		// Chunk of the coarse level this one was split from, -1 on the coarse level
+		int parent;
+	};
+	// Breaks every sub shape into up to |cellsPerSubShape| chunks, assigning each triangle to the nearest of that many
+	// randomly picked triangles (a Voronoi partition of the surface), and builds the pieces as a separate mesh with a
+	// chunk index per vertex. Each of these chunks is split the same way into up to |cellsPerChunk| smaller ones for
+	// the fine level. Doesn't touch GL, the meshes are uploaded by the first |drawDebris|. Does nothing if the debris
+	// meshes already exist
+	void initDebris(int cellsPerSubShape, int cellsPerChunk);
+	// Returns the chunks of the given level of the debris mesh, empty before |initDebris|
+	const std::vector<DebrisChunk>& getDebrisChunks(DebrisLevel level);
+	// Draws |numInstances| copies of the given level of the debris mesh with one instanced draw per sub shape,
+	// uploading it first if needed. The bound program places the chunks (see "debris_vert.glsl")
+	void drawDebris(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int numInstances,
+		DebrisLevel level, SubShapes subShapes = SubShapes::ALL);
 	glm::vec3& getMin();
 	glm::vec3& getMax();
 	void findAndSetMinAndMax(glm::mat4 orientTransform = glm::mat4(1.0f));
+
+	// Returns the bytes of GPU memory used by the vertex and index buffers
+	size_t getGpuMemoryUsage();
+	// Returns the bytes of GPU memory the buffers would use with full precision vertices and 32 bit indices
+	size_t getUncompressedGpuMemoryUsage();
+
+	// CPU side geometry of each sub shape, positions are xyz triplets
+	int getNumSubShapes();
+	const std::vector<float>& getPositions(int subShape);
+	const std::vector<unsigned>& getIndices(int subShape, int lod = 0);
+
+	// GPU side layout, used to copy the shape into shared buffers. Each sub shape's indices refer to the
+	// vertex buffer starting at it's base vertex
+	unsigned getVertexBufferID();
+	size_t getVertexBufferSize();
+	bool isCompactVertexFormat();
+	size_t getVertexSize();
+	int getBaseVertex(int subShape);
+
+	// Returns the material of the given sub shape, |nullptr| if it uses the material of the object
+	std::shared_ptr<Material> getMaterial(int subShape);
+
+	// Returns the texture of the given sub shape, |nullptr| if it has none
+	Texture* getTexture(int subShape);
+
+	// Returns the number of sub shapes with a texture
+	int getNumTexturedSubShapes();
+
+	// Sets up the attribute layout of the interleaved vertex buffer bound to GL_ARRAY_BUFFER in the bound VAO
+	static void setupVertexAttributes(bool compactVertexFormat);
 	
 private:
 
     void bindMtl(const std::shared_ptr<Program> prog, std::shared_ptr<Material> mtl) const;
 
+    // Returns true if the given sub shape is one of |subShapes|
+    bool isSubShapeIncluded(int i, SubShapes subShapes) const;
+
+	// Range of a sub shape within the shared vertex and index buffers
+	struct SubMesh {
+		int indexCount;
+
+		// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		unsigned indexType;
+
+		// Offset in bytes of the sub shape's first index in the index buffer
+		size_t indexOffset;
+
+		// Index of the sub shape's first vertex, added to each of it's indices when drawn
+		int baseVertex;
+	};
+
 	std::vector<std::vector<unsigned>> eleBuf = std::vector<std::vector<unsigned>>();
 	std::vector<std::vector<float>> posBuf = std::vector<std::vector<float>>();
 	std::vector<std::vector<float>> norBuf = std::vector<std::vector<float>>();
 	std::vector<std::vector<float>> texBuf = std::vector<std::vector<float>>();
-	std::vector<unsigned> eleBufID = std::vector<unsigned>();
-	std::vector<unsigned> posBufID = std::vector<unsigned>();
-	std::vector<unsigned> norBufID = std::vector<unsigned>();
-	std::vector<unsigned> texBufID = std::vector<unsigned>();
+
+	// Indices of each level of detail above 0 per sub shape (LOD 0 is |eleBuf|), referring to the same vertices
+	std::vector<std::vector<std::vector<unsigned>>> lodEleBuf = std::vector<std::vector<std::vector<unsigned>>>();
+
+	// All sub shapes are packed into one interleaved vertex buffer (position, normal, texcoord)
+	// and one index buffer holding every level of detail, both bound to |vaoID| along with the attribute layout.
+	// Indexed by level of detail, then sub shape
+	std::vector<std::vector<SubMesh>> lodSubMeshes = std::vector<std::vector<SubMesh>>();
+	unsigned vertexBufID;
+	unsigned indexBufID;
 	unsigned vaoID;
 
-   // For fracturing objects
-   float randFloat(float a, float b);
+	bool compactVertexFormat;
+	size_t vertexBufferSize;
+
+	size_t gpuMemoryUsage;
+	size_t uncompressedGpuMemoryUsage;
+
+	// Appends the indices to |buffer| as the given type and returns their offset in bytes
+	static size_t appendIndices(std::vector<unsigned char>& buffer, const std::vector<unsigned>& indices, unsigned indexType);
+
+	// Binds the material and texture of the given sub shape
+	void bindSubMeshMaterial(const std::shared_ptr<Program> prog, std::shared_ptr<Material> defaultMtl, int i);
+
+	// Issues the draw call for the given sub shape and level of detail, expects |vaoID| to be bound
+	void drawSubMesh(int i, int lod = 0);
+
+	// One level of the debris mesh created by |initDebris|, a sub mesh per sub shape holding all of it's chunks
+	struct DebrisMesh {
+		std::vector<DebrisChunk> chunks;
+		std::vector<SubMesh> subMeshes;
+
+		// Interleaved full precision vertices, chunk index per vertex and indices until the mesh is uploaded
+		std::vector<float> vertices;
+		std::vector<GLuint> chunkIndices;
+		std::vector<GLuint> indices;
+
+		unsigned vertexBufID = 0;
+		unsigned chunkBufID = 0;
+		unsigned indexBufID = 0;
+		unsigned vaoID = 0;
+	};
+	DebrisMesh debrisMeshes[NUM_DEBRIS_LEVELS];
+	bool debrisBuilt;
+
+	// Appends the given triangles of the sub shape to |mesh| as one chunk. |baseVertex| is the first vertex of the
+	// sub shape's sub mesh
+	void addDebrisChunk(DebrisMesh& mesh, int subShape, const std::vector<GLuint>& triangles, int parent,
+		int baseVertex);
+
+	// Uploads a debris mesh built by |initDebris| and drops the CPU side copy
+	void uploadDebris(DebrisMesh& mesh);
 
     std::vector<std::string> textureNames = std::vector<std::string>();
-    std::map<std::string, Texture*> textures;
+    std::map<std::string, std::shared_ptr<Texture>> textures;
     std::vector<bool> materialPresent = std::vector<bool>();
     std::vector<std::shared_ptr<Material>> materials;
 
@@ -25,6 +25,21 @@ int ShapeManager::createShape(ResourceManager& resourceManager,
    return 0;
 }
 
+int ShapeManager::createShapes(ResourceManager& resourceManager, const std::vector<std::string>& names,
+   const std::vector<std::string>& filenames) {
+   std::vector<std::shared_ptr<Shape>> loaded = resourceManager.loadShapes(filenames);
+
+   for (size_t i = 0; i < loaded.size(); ++i) {
+      if (loaded[i] == nullptr) {
+         return 1;
+      }
+
+      shapes.insert(std::make_pair(names[i], loaded[i]));
+   }
+
+   return 0;
+}
+
 std::shared_ptr<Shape> ShapeManager::getShape(const std::string shapeName) {
    return shapes.at(shapeName);
 }
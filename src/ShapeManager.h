@@ -5,6 +5,7 @@
 #include "Shape.h"
 
 #include <unordered_map>
+#include <vector>
 
 class ShapeManager {
 public:
@@ -16,6 +17,11 @@ public:
    int createShape(ResourceManager& resourceManager, std::string name,
       std::string filename);
 
+   // Loads all shapes in parallel using the ResourceManager and adds them to the map. |names| and |filenames|
+   // correspond by index
+   int createShapes(ResourceManager& resourceManager, const std::vector<std::string>& names,
+      const std::vector<std::string>& filenames);
+
    std::shared_ptr<Shape> getShape(const std::string shapeName);
 private:
    ShapeManager();
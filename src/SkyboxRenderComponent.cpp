@@ -4,6 +4,8 @@
 
 SkyboxRenderComponent::SkyboxRenderComponent(std::shared_ptr<Shape> shape, const std::string& shaderName, std::shared_ptr<Material> material, std::string path, std::string fileExtension)
         : RenderComponent(shape, shaderName, material) {
+    castsShadow_ = false;
+    isSkybox_ = true;
     cubemap = new Cubemap(path, fileExtension);
     cubemap->loadCubemap();
 }
@@ -12,13 +14,6 @@ SkyboxRenderComponent::~SkyboxRenderComponent() {
 
 }
 
-void SkyboxRenderComponent::draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V) {
-    ShaderManager& shaderManager = ShaderManager::instance();
-    cubemap->bind();
-    shaderManager.renderObject(holder_, shaderName_, shape_, material_, P, V, M);
-    cubemap->unbind();
+Cubemap* SkyboxRenderComponent::getCubemap() {
+    return cubemap;
 }
-
-void SkyboxRenderComponent::renderShadow(std::shared_ptr <MatrixStack> M) {
-    // don't do anything, there is no shadow on the skybox
-}
\ No newline at end of file
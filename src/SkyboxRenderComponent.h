@@ -10,9 +10,7 @@ public:
 
     ~SkyboxRenderComponent();
 
-    void draw(std::shared_ptr<MatrixStack> P, std::shared_ptr<MatrixStack> M, std::shared_ptr<MatrixStack> V);
-
-    void renderShadow(std::shared_ptr<MatrixStack> M);
+    Cubemap* getCubemap();
 
 private:
     Cubemap* cubemap;
@@ -0,0 +1,311 @@
+#include "StaticBatchRenderer.h"
+
+#include "ShaderManager.h"
+
+StaticBatchRenderer::StaticBatchRenderer()
+   : vaoID_(0),
+   vertexBufID_(0),
+   indexBufID_(0),
+   drawIDBufID_(0),
+   drawBufID_(0),
+   materialBufID_(0),
+   commandBufID_(0),
+   compactVertexFormat_(false),
+   materialsDirty_(false) {
+}
+
+StaticBatchRenderer::~StaticBatchRenderer() {
+}
+
+void StaticBatchRenderer::release() {
+   if (vaoID_ != 0) {
+      glDeleteVertexArrays(1, &vaoID_);
+      glDeleteBuffers(1, &vertexBufID_);
+      glDeleteBuffers(1, &indexBufID_);
+      glDeleteBuffers(1, &drawIDBufID_);
+      glDeleteBuffers(1, &drawBufID_);
+      glDeleteBuffers(1, &materialBufID_);
+      glDeleteBuffers(1, &commandBufID_);
+   }
+
+   vaoID_ = vertexBufID_ = indexBufID_ = drawIDBufID_ = drawBufID_ = materialBufID_ = commandBufID_ = 0;
+
+   shapeRanges_.clear();
+   materialIndices_.clear();
+   materials_.clear();
+}
+
+void StaticBatchRenderer::build(const std::vector<RenderItem>& staticItems) {
+   release();
+
+   if (!ShaderManager::isIndirectDrawingSupported()) {
+      return;
+   }
+
+   // Find the distinct shapes of the objects that can be drawn from the shared buffers. All shapes must share the
+   // vertex format of the first one
+   std::vector<std::shared_ptr<Shape>> shapes;
+   size_t vertexBufferSize = 0;
+   size_t numIndices = 0;
+   GLuint maxDraws = 0;
+
+   for (const RenderItem& item : staticItems) {
+      if (item.shape == nullptr || item.shape->getVertexBufferID() == 0) {
+         continue;
+      }
+
+      const std::shared_ptr<Shape>& shape = item.shape;
+      if (shapes.empty()) {
+         compactVertexFormat_ = shape->isCompactVertexFormat();
+      } else if (shape->isCompactVertexFormat() != compactVertexFormat_) {
+         continue;
+      }
+
+      if (shapeRanges_.count(shape.get()) == 0) {
+         ShapeRange& range = shapeRanges_[shape.get()];
+         range.baseVertex = vertexBufferSize / shape->getVertexSize();
+         shapes.push_back(shape);
+
+         vertexBufferSize += shape->getVertexBufferSize();
+         for (int lod = 0; lod < shape->getNumLods(); ++lod) {
+            for (int i = 0; i < shape->getNumSubShapes(); ++i) {
+               numIndices += shape->getIndices(i, lod).size();
+            }
+         }
+      }
+
+      maxDraws += shape->getNumSubShapes();
+   }
+
+   if (shapes.empty() || vertexBufferSize == 0 || numIndices == 0) {
+      shapeRanges_.clear();
+      return;
+   }
+
+   glGenVertexArrays(1, &vaoID_);
+   glBindVertexArray(vaoID_);
+
+   // Copy each shape's vertices on the GPU, the indices are rebuilt from the CPU side copies as 32 bit
+   // indices since a multi draw can only use a single index type
+   glGenBuffers(1, &vertexBufID_);
+   glBindBuffer(GL_ARRAY_BUFFER, vertexBufID_);
+   glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, NULL, GL_STATIC_DRAW);
+
+   std::vector<GLuint> indices;
+   indices.reserve(numIndices);
+
+   size_t vertexOffset = 0;
+   for (std::shared_ptr<Shape>& shape : shapes) {
+      glBindBuffer(GL_COPY_READ_BUFFER, shape->getVertexBufferID());
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, vertexOffset, shape->getVertexBufferSize());
+      vertexOffset += shape->getVertexBufferSize();
+
+      ShapeRange& range = shapeRanges_[shape.get()];
+      range.firstIndex.assign(shape->getNumLods(), std::vector<GLuint>());
+      range.indexCount.assign(shape->getNumLods(), std::vector<GLuint>());
+
+      for (int lod = 0; lod < shape->getNumLods(); ++lod) {
+         for (int i = 0; i < shape->getNumSubShapes(); ++i) {
+            const std::vector<unsigned>& subShapeIndices = shape->getIndices(i, lod);
+
+            range.firstIndex[lod].push_back(indices.size());
+            range.indexCount[lod].push_back(subShapeIndices.size());
+            indices.insert(indices.end(), subShapeIndices.begin(), subShapeIndices.end());
+         }
+      }
+   }
+   glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+   Shape::setupVertexAttributes(compactVertexFormat_);
+
+   glGenBuffers(1, &indexBufID_);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufID_);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+
+   // Instanced attribute holding 0, 1, 2, ... Each command's base instance offsets it to the command's draw index,
+   // which works without gl_DrawID (GL 4.6)
+   std::vector<GLuint> drawIDs(maxDraws);
+   for (GLuint i = 0; i < maxDraws; ++i) {
+      drawIDs[i] = i;
+   }
+
+   glGenBuffers(1, &drawIDBufID_);
+   glBindBuffer(GL_ARRAY_BUFFER, drawIDBufID_);
+   glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLuint), &drawIDs[0], GL_STATIC_DRAW);
+   GLSL::enableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+   glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (const void *) 0);
+   glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+
+   glBindVertexArray(0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+   glGenBuffers(1, &drawBufID_);
+   glGenBuffers(1, &materialBufID_);
+   glGenBuffers(1, &commandBufID_);
+
+   assert(glGetError() == GL_NO_ERROR);
+}
+
+bool StaticBatchRenderer::canDraw(const RenderItem& item) {
+   if (vaoID_ == 0 || item.staticIndex < 0 || shapeRanges_.count(item.shape.get()) == 0) {
+      return false;
+   }
+
+   // Shaders without an indirect variant (e.g. the skybox) are drawn the regular way
+   return ShaderManager::instance().getIndirectShaderProgram(item.shaderName) != nullptr;
+}
+
+void StaticBatchRenderer::draw(const std::vector<const RenderItem*>& items, const MatrixStack& P,
+   const MatrixStack& V) {
+   if (items.empty()) {
+      return;
+   }
+
+   ShaderManager& shaderManager = ShaderManager::instance();
+
+   for (Batch& batch : batches_) {
+      batch.commands.clear();
+   }
+   draws_.clear();
+
+   // Turn every sub shape of every object into a command, the draw index is passed on as the base instance
+   for (const RenderItem* item : items) {
+      const std::shared_ptr<Shape>& shape = item->shape;
+      std::shared_ptr<Program> program = shaderManager.getIndirectShaderProgram(item->shaderName);
+
+      // Sub shapes with and without a texture go into batches of different variants
+      ShaderVariant variant = shaderManager.getObjectVariant(*item);
+      std::shared_ptr<Program> untexturedProgram = shaderManager.getShaderVariant(program->name, variant);
+      std::shared_ptr<Program> texturedProgram = untexturedProgram;
+      if (shape->getNumTexturedSubShapes() > 0) {
+         variant.features |= ShaderVariant::TEXTURED;
+         texturedProgram = shaderManager.getShaderVariant(program->name, variant);
+      }
+
+      const ShapeRange& range = shapeRanges_.at(shape.get());
+      int lod = shape->selectLod(shaderManager.calculateScreenSize(*item));
+
+      for (int i = 0; i < shape->getNumSubShapes(); ++i) {
+         std::shared_ptr<Material> material = shape->getMaterial(i);
+         if (material == nullptr) {
+            material = item->material;
+         }
+
+         // Nothing to shade the sub shape with
+         if (material == nullptr) {
+            continue;
+         }
+
+         DrawData drawData;
+         drawData.M = item->M;
+         drawData.tiM = item->tiM;
+         drawData.materialIndex = getMaterialIndex(material.get());
+
+         DrawElementsIndirectCommand command;
+         command.count = range.indexCount[lod][i];
+         command.instanceCount = 1;
+         command.firstIndex = range.firstIndex[lod][i];
+         command.baseVertex = range.baseVertex + shape->getBaseVertex(i);
+         command.baseInstance = draws_.size();
+
+         draws_.push_back(drawData);
+         Texture* texture = shape->getTexture(i);
+         getBatch(texture != nullptr ? texturedProgram : untexturedProgram, texture).commands.push_back(command);
+      }
+   }
+
+   if (draws_.empty()) {
+      return;
+   }
+
+   // Lay out the commands of all batches back to back in a single buffer
+   commands_.clear();
+   for (Batch& batch : batches_) {
+      batch.commandOffset = commands_.size() * sizeof(DrawElementsIndirectCommand);
+      commands_.insert(commands_.end(), batch.commands.begin(), batch.commands.end());
+   }
+
+   // Orphan and refill the per frame buffers
+   glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBufID_);
+   glBufferData(GL_SHADER_STORAGE_BUFFER, draws_.size() * sizeof(DrawData), &draws_[0], GL_STREAM_DRAW);
+
+   if (materialsDirty_) {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBufID_);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, materials_.size() * sizeof(MaterialData), &materials_[0], GL_STATIC_DRAW);
+      materialsDirty_ = false;
+   }
+   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+   glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBufID_);
+   glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawElementsIndirectCommand), &commands_[0], GL_STREAM_DRAW);
+
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, drawBufID_);
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, materialBufID_);
+   glBindVertexArray(vaoID_);
+
+   for (Batch& batch : batches_) {
+      if (batch.commands.empty()) {
+         continue;
+      }
+
+      shaderManager.bindShader(batch.program->name);
+      shaderManager.bindFrameUniforms(batch.program, P, V);
+
+      if (batch.texture != nullptr) {
+         batch.texture->bind(0, batch.program);
+         glUniform1i(batch.program->getUniform("textureActive"), 1);
+      } else {
+         glUniform1i(batch.program->getUniform("textureActive"), 0);
+      }
+
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *) batch.commandOffset,
+         batch.commands.size(), 0);
+
+      if (batch.texture != nullptr) {
+         batch.texture->unbind();
+      }
+   }
+
+   glBindVertexArray(0);
+   glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, 0);
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, 0);
+
+   shaderManager.unbindShader();
+}
+
+GLuint StaticBatchRenderer::getMaterialIndex(const Material* material) {
+   std::unordered_map<const Material*, GLuint>::iterator found = materialIndices_.find(material);
+   if (found != materialIndices_.end()) {
+      return found->second;
+   }
+
+   MaterialData data;
+   data.ambient = glm::vec4(material->rAmb, material->gAmb, material->bAmb, 1.0f);
+   data.diffuse = glm::vec4(material->rDif, material->gDif, material->bDif, 1.0f);
+   data.specular = glm::vec4(material->rSpc, material->gSpc, material->bSpc, material->shininess);
+
+   GLuint index = materials_.size();
+   materials_.push_back(data);
+   materialIndices_[material] = index;
+   materialsDirty_ = true;
+
+   return index;
+}
+
+StaticBatchRenderer::Batch& StaticBatchRenderer::getBatch(std::shared_ptr<Program> program, Texture* texture) {
+   for (Batch& batch : batches_) {
+      if (batch.program == program && batch.texture == texture) {
+         return batch;
+      }
+   }
+
+   Batch batch;
+   batch.program = program;
+   batch.texture = texture;
+   batch.commandOffset = 0;
+   batches_.push_back(batch);
+
+   return batches_.back();
+}
@@ -0,0 +1,127 @@
+#ifndef STATIC_BATCH_RENDERER_H
+#define STATIC_BATCH_RENDERER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "FrameSnapshot.h"
+#include "MatrixStack.h"
+#include "Program.h"
+#include "Shape.h"
+#include "Texture.h"
+
+/*
+ * GPU driven rendering of static objects. The shapes of all static objects are copied into one shared vertex
+ * and index buffer, and every frame the visible objects are turned into indirect draw commands submitted with a
+ * single glMultiDrawElementsIndirect per shader program and texture. Model matrices and materials are read from
+ * shader storage buffers, indexed by the base instance of each command (see "indirect_vert.glsl").
+ *
+ * Requires OpenGL 4.3, see |ShaderManager::isIndirectDrawingSupported|.
+ */
+class StaticBatchRenderer {
+public:
+
+   // Attribute location of the per draw index in "indirect_vert.glsl"
+   static constexpr unsigned DRAW_ID_ATTRIBUTE = 3;
+
+   // Shader storage buffer bindings in "indirect_vert.glsl"
+   static constexpr unsigned DRAW_BUFFER_BINDING = 0;
+   static constexpr unsigned MATERIAL_BUFFER_BINDING = 1;
+
+   StaticBatchRenderer();
+
+   ~StaticBatchRenderer();
+
+   // Copies the shapes of the given static objects (see |FrameSnapshot::staticItems|) into the shared buffers,
+   // replacing any previous contents
+   void build(const std::vector<RenderItem>& staticItems);
+
+   // Returns true if the item's object was part of the last |build| and can currently be drawn by |draw|
+   bool canDraw(const RenderItem& item);
+
+   // Draws all given items, which must pass |canDraw|
+   void draw(const std::vector<const RenderItem*>& items, const MatrixStack& P, const MatrixStack& V);
+
+private:
+
+   // Layout matches "DrawCommand" of the OpenGL specification
+   struct DrawElementsIndirectCommand {
+      GLuint count;
+      GLuint instanceCount;
+      GLuint firstIndex;
+      GLint baseVertex;
+      GLuint baseInstance;
+   };
+
+   // std430 layouts matching "indirect_vert.glsl"
+   struct DrawData {
+      glm::mat4 M;
+      glm::mat4 tiM;
+      GLuint materialIndex;
+      GLuint padding[3];
+   };
+
+   struct MaterialData {
+      glm::vec4 ambient;
+      glm::vec4 diffuse;
+      glm::vec4 specular;
+   };
+
+   // Location of a shape in the shared buffers
+   struct ShapeRange {
+      GLint baseVertex;
+
+      // First index and index count of each level of detail, then sub shape
+      std::vector<std::vector<GLuint>> firstIndex;
+      std::vector<std::vector<GLuint>> indexCount;
+   };
+
+   // Commands drawn with the same program and texture
+   struct Batch {
+      std::shared_ptr<Program> program;
+      Texture* texture;
+      std::vector<DrawElementsIndirectCommand> commands;
+
+      // Offset in bytes of the first command in |commandBufID|
+      size_t commandOffset;
+   };
+
+   GLuint vaoID_;
+   GLuint vertexBufID_;
+   GLuint indexBufID_;
+   GLuint drawIDBufID_;
+   GLuint drawBufID_;
+   GLuint materialBufID_;
+   GLuint commandBufID_;
+
+   bool compactVertexFormat_;
+
+   std::unordered_map<Shape*, ShapeRange> shapeRanges_;
+
+   // Materials uploaded to |materialBufID_|, new materials are appended as they show up
+   std::unordered_map<const Material*, GLuint> materialIndices_;
+   std::vector<MaterialData> materials_;
+   bool materialsDirty_;
+
+   // Per frame storage, kept as members so that it's reused between frames
+   std::vector<Batch> batches_;
+   std::vector<DrawData> draws_;
+   std::vector<DrawElementsIndirectCommand> commands_;
+
+   // Deletes all GL objects
+   void release();
+
+   // Returns the index of the material in |materials_|, adding it if needed
+   GLuint getMaterialIndex(const Material* material);
+
+   // Returns the batch for the given program and texture, creating it if needed
+   Batch& getBatch(std::shared_ptr<Program> program, Texture* texture);
+};
+
+#endif
@@ -1,46 +1,155 @@
 #include "Texture.h"
 #include "GLSL.h"
+#include "TextureManager.h"
+#include <algorithm>
 #include <iostream>
 
 
 
-Texture::Texture() {}
+Texture::Texture() :
+    tid(0),
+    memoryUsage(0),
+    compressed(false),
+    lastUsed(0),
+    loading(false) {}
 
-Texture::~Texture() {}
+Texture::~Texture() {
+    unload();
+}
 
 void Texture::loadTexture(std::string path, std::string newName) {
 
     name = newName;
 
-    image = new Image(path);
+    std::unique_ptr<TextureData> data = decode(path);
+    if (data) {
+        upload(*data);
+    } else {
+        std::cerr << "Could not load texture " << path << std::endl;
+    }
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &tid);
-    glBindTexture(GL_TEXTURE_2D, tid);
+std::unique_ptr<TextureData> Texture::decode(const std::string& path) {
+    std::unique_ptr<TextureData> data(new TextureData());
 
-    if(image->components == 3) {
-        // RGB texture
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image->width, image->height, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
-    } else if (image->components == 4) {
-        // RBGA texture
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLubyte*) image->getImageData());
+    // prefer the cooked version of the texture, it's already compressed and has all it's mip levels
+    if (isCompressionSupported() && data->cooked.load(DDSImage::getCookedPath(path))) {
+        return data;
     }
 
-    // generate MipMap and set minification ang magnification filter
-    glGenerateMipmap(GL_TEXTURE_2D);
+    data->image.reset(new Image(path));
+    if (data->image->getImageData() == nullptr) {
+        return nullptr;
+    }
+
+    return data;
+}
+
+void Texture::upload(const TextureData& data, bool usePixelBuffer, size_t pixelBufferOffset) {
+
+    bindForUpload();
+
+    // offsets into the pixel buffer take the place of the pointers
+    const unsigned char* base = usePixelBuffer ? reinterpret_cast<const unsigned char*>(pixelBufferOffset) : nullptr;
+
+    if (data.isCooked()) {
+        GLenum format = getCompressedFormat(data.cooked.format);
+        size_t offset = 0;
+
+        for (size_t level = 0; level < data.cooked.mipLevels.size(); ++level) {
+            const DDSImage::MipLevel& mip = data.cooked.mipLevels[level];
+            const GLvoid* pixels = usePixelBuffer ? base + offset : mip.data.data();
+
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, format, mip.width, mip.height, 0, mip.data.size(), pixels);
+            offset += mip.data.size();
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.cooked.mipLevels.size() - 1);
+
+        memoryUsage = data.cooked.getDataSize();
+        compressed = true;
+    } else {
+        Image& image = *data.image;
+        const GLvoid* pixels = usePixelBuffer ? base : image.getImageData();
+
+        // rows of RGB images aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        if(image.components == 3) {
+            // RGB texture
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        } else if (image.components == 4) {
+            // RBGA texture
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // generate MipMap, which adds another third to the size
+        glGenerateMipmap(GL_TEXTURE_2D);
+        // the placeholder may have limited the levels, 1000 is the GL default
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+
+        memoryUsage = image.width * image.height * 4;
+        memoryUsage += memoryUsage / 3;
+        compressed = false;
+    }
+
+    // set minification ang magnification filter
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    loading = false;
+}
+
+void Texture::createPlaceholder() {
+    static const GLubyte grey[4] = { 128, 128, 128, 255 };
+
+    bindForUpload();
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    memoryUsage = 0;
+    loading = true;
+}
+
+bool Texture::isLoading() const {
+    return loading;
+}
+
+void Texture::bindForUpload() {
+    // Evicted textures are reloaded in the middle of a frame, so uploads stay off unit 0 where the shadow map is
+    // bound once per frame. Unit 1 is rebound by every |bind|
+    glActiveTexture(GL_TEXTURE1);
+    if (tid == 0) {
+        glGenTextures(1, &tid);
+    }
+    glBindTexture(GL_TEXTURE_2D, tid);
+}
+
+bool Texture::isCompressionSupported() {
+    return GLEW_EXT_texture_compression_s3tc;
+}
+
+GLenum Texture::getCompressedFormat(TextureCompressor::Format format) {
+    return format == TextureCompressor::Format::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 }
 
 void Texture::bind(int newUnit, const std::shared_ptr<Program> prog)
 {
     unit = newUnit;
+
+    // reloads the texture if it was evicted
+    TextureManager::instance().useTexture(*this);
+
     glActiveTexture(GL_TEXTURE1 + unit);
     glBindTexture(GL_TEXTURE_2D, tid);
     GLint texPos = prog->getUniform("textureMap");
@@ -58,4 +167,61 @@ void Texture::setHandle(GLint h) {
 
 GLint Texture::getHandle() {
     return handle;
-}
\ No newline at end of file
+}
+size_t Texture::getMemoryUsage() const {
+    return memoryUsage;
+}
+
+bool Texture::isCompressed() const {
+    return compressed;
+}
+
+void Texture::unload() {
+    if (tid != 0) {
+        glDeleteTextures(1, &tid);
+        tid = 0;
+    }
+}
+
+bool Texture::isResident() const {
+    return tid != 0;
+}
+
+void Texture::setPath(const std::string& newPath) {
+    path = newPath;
+}
+
+const std::string& Texture::getPath() const {
+    return path;
+}
+
+void Texture::setLastUsed(unsigned long use) {
+    lastUsed = use;
+}
+
+unsigned long Texture::getLastUsed() const {
+    return lastUsed;
+}
+
+bool TextureData::isCooked() const {
+    return !cooked.mipLevels.empty();
+}
+
+size_t TextureData::getSize() const {
+    if (isCooked()) {
+        return cooked.getDataSize();
+    }
+
+    return static_cast<size_t>(image->width) * image->height * image->components;
+}
+
+void TextureData::copyTo(unsigned char* destination) const {
+    if (isCooked()) {
+        for (const DDSImage::MipLevel& mip : cooked.mipLevels) {
+            std::copy(mip.data.begin(), mip.data.end(), destination);
+            destination += mip.data.size();
+        }
+    } else {
+        std::copy(image->getImageData(), image->getImageData() + getSize(), destination);
+    }
+}
@@ -9,8 +9,23 @@
 
 #include "Program.h"
 #include "Image.h"
+#include "DDSImage.h"
 
 
+// CPU side contents of a texture file, either a cooked compressed image or a decoded source image
+struct TextureData {
+    DDSImage cooked;
+    std::unique_ptr<Image> image;
+
+    bool isCooked() const;
+
+    // returns the number of bytes uploaded, i.e. the size |copyTo| writes
+    size_t getSize() const;
+
+    // copies all levels of the texture to |destination|, in the layout |Texture::upload| expects in a pixel buffer
+    void copyTo(unsigned char* destination) const;
+};
+
 class Texture
 {
 public:
@@ -19,20 +34,68 @@ public:
 
     std::string name;
 
-    // loads the texture under the specified path. channels = channels per pixel, 3 for RGB, 4 for RGBA
+    // loads the texture under the specified path. If a cooked ".dds" version of it exists (see "tools/TextureCooker.cpp")
+    // and the GPU supports S3TC, the compressed texture and it's mip levels are loaded instead
     void loadTexture(std::string path, std::string newName);
+
+    // reads the texture under the specified path (preferring the cooked version like |loadTexture|) without any GL
+    // calls, so it can run on any thread. Returns |nullptr| if the file couldn't be read
+    static std::unique_ptr<TextureData> decode(const std::string& path);
+
+    // uploads decoded texture data. If |usePixelBuffer| is set the data is read from the bound GL_PIXEL_UNPACK_BUFFER,
+    // starting at |pixelBufferOffset| in the layout of |TextureData::copyTo|
+    void upload(const TextureData& data, bool usePixelBuffer = false, size_t pixelBufferOffset = 0);
+
+    // makes the texture a single grey texel until the real data is uploaded, see |AsyncLoader|
+    void createPlaceholder();
+
+    // true from |createPlaceholder| until the next |upload|
+    bool isLoading() const;
     void bind(int newUnit, const std::shared_ptr<Program> prog);
     void unbind();
     void setHandle(GLint h);
     GLint getHandle();
 
+    // returns the (estimated) size of the texture and it's mip levels in video memory
+    size_t getMemoryUsage() const;
+
+    // returns true if the texture was loaded from a cooked, block compressed file
+    bool isCompressed() const;
+
+    // deletes the texture from video memory, |isResident| is false afterwards. Size and path are kept so that
+    // the |TextureManager| can load it again
+    void unload();
+
+    bool isResident() const;
+
+    // path the texture is loaded from, set by the |TextureManager|
+    void setPath(const std::string& newPath);
+    const std::string& getPath() const;
+
+    // position of the last use in the |TextureManager|'s least recently used order
+    void setLastUsed(unsigned long use);
+    unsigned long getLastUsed() const;
+
+    // returns true if the GPU can sample the S3TC formats of cooked textures
+    static bool isCompressionSupported();
+
+    // returns the GL internal format of a block compressed format
+    static GLenum getCompressedFormat(TextureCompressor::Format format);
+
 
 private:
 
 	GLuint tid;
-	Image* image;
     int unit;
     GLint handle;
+    size_t memoryUsage;
+    bool compressed;
+    std::string path;
+    unsigned long lastUsed;
+    bool loading;
+
+    // generates the GL texture if needed and binds it to the first unit
+    void bindForUpload();
 
 };
 
@@ -0,0 +1,346 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+   // Iterations used to find the principal axis of a block's colors
+   const int POWER_ITERATIONS = 8;
+
+   inline uint16_t packRgb565(const float* color) {
+      int r = std::min(31, std::max(0, static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f)));
+      int g = std::min(63, std::max(0, static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f)));
+      int b = std::min(31, std::max(0, static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f)));
+
+      return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+   }
+
+   // Expands a 565 color the same way the hardware does
+   inline void unpackRgb565(uint16_t packed, int* color) {
+      int r = (packed >> 11) & 31;
+      int g = (packed >> 5) & 63;
+      int b = packed & 31;
+
+      color[0] = (r << 3) | (r >> 2);
+      color[1] = (g << 2) | (g >> 4);
+      color[2] = (b << 3) | (b >> 2);
+   }
+
+   // Copies the 4x4 block at the given block coordinates, clamping at the image edges
+   void fetchBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, unsigned char* block) {
+      for (int y = 0; y < 4; ++y) {
+         int sy = std::min(blockY * 4 + y, height - 1);
+
+         for (int x = 0; x < 4; ++x) {
+            int sx = std::min(blockX * 4 + x, width - 1);
+            const unsigned char* pixel = &rgba[4 * (sy * width + sx)];
+
+            std::copy(pixel, pixel + 4, &block[4 * (y * 4 + x)]);
+         }
+      }
+   }
+
+   // Picks the closest palette entry for every pixel, returns the packed indices and the total squared error
+   uint32_t selectColorIndices(const unsigned char* block, uint16_t c0, uint16_t c1, int& error) {
+      int palette[4][3];
+      unpackRgb565(c0, palette[0]);
+      unpackRgb565(c1, palette[1]);
+      for (int k = 0; k < 3; ++k) {
+         palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+         palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+      }
+
+      uint32_t indices = 0;
+      error = 0;
+
+      for (int i = 0; i < 16; ++i) {
+         const unsigned char* pixel = &block[4 * i];
+         int bestIndex = 0;
+         int bestDistance = 0x7FFFFFFF;
+
+         for (int p = 0; p < 4; ++p) {
+            int dr = pixel[0] - palette[p][0];
+            int dg = pixel[1] - palette[p][1];
+            int db = pixel[2] - palette[p][2];
+            int distance = dr * dr + dg * dg + db * db;
+
+            if (distance < bestDistance) {
+               bestDistance = distance;
+               bestIndex = p;
+            }
+         }
+
+         indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+         error += bestDistance;
+      }
+
+      return indices;
+   }
+
+   // Packs the endpoints in four color mode (c0 > c1) and selects the indices
+   uint32_t packColorEndpoints(const unsigned char* block, const float* e0, const float* e1, uint16_t& c0,
+      uint16_t& c1, int& error) {
+      c0 = packRgb565(e0);
+      c1 = packRgb565(e1);
+
+      if (c0 < c1) {
+         std::swap(c0, c1);
+      }
+
+      // Equal endpoints would select the three color mode, but all pixels use the first entry anyway
+      if (c0 == c1) {
+         int color[3];
+         unpackRgb565(c0, color);
+
+         error = 0;
+         for (int i = 0; i < 16; ++i) {
+            for (int k = 0; k < 3; ++k) {
+               int d = block[4 * i + k] - color[k];
+               error += d * d;
+            }
+         }
+         return 0;
+      }
+
+      return selectColorIndices(block, c0, c1, error);
+   }
+
+   // Solves for the endpoints that minimize the squared error of the given indices. Returns false if the
+   // indices don't determine the endpoints (e.g. all pixels use the same one)
+   bool refineColorEndpoints(const unsigned char* block, uint32_t indices, float* e0, float* e1) {
+      static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+      float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+      float ax[3] = { 0.0f, 0.0f, 0.0f };
+      float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+      for (int i = 0; i < 16; ++i) {
+         float a = weights[(indices >> (2 * i)) & 3];
+         float b = 1.0f - a;
+
+         aa += a * a;
+         bb += b * b;
+         ab += a * b;
+         for (int k = 0; k < 3; ++k) {
+            ax[k] += a * block[4 * i + k];
+            bx[k] += b * block[4 * i + k];
+         }
+      }
+
+      float det = aa * bb - ab * ab;
+      if (std::fabs(det) < 1e-6f) {
+         return false;
+      }
+
+      for (int k = 0; k < 3; ++k) {
+         e0[k] = (ax[k] * bb - bx[k] * ab) / det;
+         e1[k] = (bx[k] * aa - ax[k] * ab) / det;
+      }
+
+      return true;
+   }
+
+   // Fits the colors of the block along their principal axis, then refines the endpoints once
+   void compressColorBlock(const unsigned char* block, unsigned char* out) {
+      float mean[3] = { 0.0f, 0.0f, 0.0f };
+      for (int i = 0; i < 16; ++i) {
+         for (int k = 0; k < 3; ++k) {
+            mean[k] += block[4 * i + k] / 16.0f;
+         }
+      }
+
+      // Covariance xx xy xz yy yz zz
+      float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+      float minColor[3] = { 255.0f, 255.0f, 255.0f };
+      float maxColor[3] = { 0.0f, 0.0f, 0.0f };
+      for (int i = 0; i < 16; ++i) {
+         float d[3];
+         for (int k = 0; k < 3; ++k) {
+            d[k] = block[4 * i + k] - mean[k];
+            minColor[k] = std::min(minColor[k], static_cast<float>(block[4 * i + k]));
+            maxColor[k] = std::max(maxColor[k], static_cast<float>(block[4 * i + k]));
+         }
+
+         cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+         cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2];
+         cov[5] += d[2] * d[2];
+      }
+
+      // Start along the bounding box diagonal, which is already close for most blocks
+      float axis[3] = { maxColor[0] - minColor[0], maxColor[1] - minColor[1], maxColor[2] - minColor[2] };
+      for (int iteration = 0; iteration < POWER_ITERATIONS; ++iteration) {
+         float next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+         };
+
+         float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+         if (length <= 0.0f) {
+            break;
+         }
+
+         for (int k = 0; k < 3; ++k) {
+            axis[k] = next[k] / length;
+         }
+      }
+
+      float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+      float minT = 0.0f, maxT = 0.0f;
+      if (axisLength > 0.0f) {
+         for (int k = 0; k < 3; ++k) {
+            axis[k] /= axisLength;
+         }
+
+         for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+               t += (block[4 * i + k] - mean[k]) * axis[k];
+            }
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+         }
+      }
+
+      // Pull the endpoints in slightly, the extremes are usually outliers
+      float inset = (maxT - minT) / 16.0f;
+      float e0[3], e1[3];
+      for (int k = 0; k < 3; ++k) {
+         e0[k] = mean[k] + axis[k] * (maxT - inset);
+         e1[k] = mean[k] + axis[k] * (minT + inset);
+      }
+
+      uint16_t c0, c1;
+      int error;
+      uint32_t indices = packColorEndpoints(block, e0, e1, c0, c1, error);
+
+      if (error > 0 && refineColorEndpoints(block, indices, e0, e1)) {
+         uint16_t refinedC0, refinedC1;
+         int refinedError;
+         uint32_t refinedIndices = packColorEndpoints(block, e0, e1, refinedC0, refinedC1, refinedError);
+
+         if (refinedError < error) {
+            c0 = refinedC0;
+            c1 = refinedC1;
+            indices = refinedIndices;
+         }
+      }
+
+      out[0] = c0 & 0xFF;
+      out[1] = c0 >> 8;
+      out[2] = c1 & 0xFF;
+      out[3] = c1 >> 8;
+      for (int i = 0; i < 4; ++i) {
+         out[4 + i] = (indices >> (8 * i)) & 0xFF;
+      }
+   }
+
+   // Uses the alpha range of the block as the endpoints, in the eight value mode (a0 > a1)
+   void compressAlphaBlock(const unsigned char* block, unsigned char* out) {
+      int a0 = 0, a1 = 255;
+      for (int i = 0; i < 16; ++i) {
+         a0 = std::max(a0, static_cast<int>(block[4 * i + 3]));
+         a1 = std::min(a1, static_cast<int>(block[4 * i + 3]));
+      }
+
+      out[0] = static_cast<unsigned char>(a0);
+      out[1] = static_cast<unsigned char>(a1);
+
+      uint64_t indices = 0;
+      if (a0 > a1) {
+         int palette[8] = { a0, a1 };
+         for (int k = 1; k < 7; ++k) {
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+         }
+
+         for (int i = 0; i < 16; ++i) {
+            int alpha = block[4 * i + 3];
+            int bestIndex = 0;
+            int bestDistance = 256;
+
+            for (int p = 0; p < 8; ++p) {
+               int distance = std::abs(alpha - palette[p]);
+               if (distance < bestDistance) {
+                  bestDistance = distance;
+                  bestIndex = p;
+               }
+            }
+
+            indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+         }
+      }
+
+      for (int i = 0; i < 6; ++i) {
+         out[2 + i] = (indices >> (8 * i)) & 0xFF;
+      }
+   }
+}
+
+unsigned int TextureCompressor::getBlockSize(Format format) {
+   return format == Format::BC1 ? 8 : 16;
+}
+
+unsigned int TextureCompressor::getCompressedSize(Format format, int width, int height) {
+   return ((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+bool TextureCompressor::hasAlpha(const unsigned char* rgba, int width, int height) {
+   for (int i = 0; i < width * height; ++i) {
+      if (rgba[4 * i + 3] != 255) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+std::vector<unsigned char> TextureCompressor::downsample(const unsigned char* rgba, int width, int height) {
+   int halfWidth = std::max(1, width / 2);
+   int halfHeight = std::max(1, height / 2);
+
+   std::vector<unsigned char> half(4 * halfWidth * halfHeight);
+   for (int y = 0; y < halfHeight; ++y) {
+      int y0 = std::min(2 * y, height - 1);
+      int y1 = std::min(2 * y + 1, height - 1);
+
+      for (int x = 0; x < halfWidth; ++x) {
+         int x0 = std::min(2 * x, width - 1);
+         int x1 = std::min(2 * x + 1, width - 1);
+
+         for (int k = 0; k < 4; ++k) {
+            int sum = rgba[4 * (y0 * width + x0) + k] + rgba[4 * (y0 * width + x1) + k]
+                    + rgba[4 * (y1 * width + x0) + k] + rgba[4 * (y1 * width + x1) + k];
+            half[4 * (y * halfWidth + x) + k] = static_cast<unsigned char>((sum + 2) / 4);
+         }
+      }
+   }
+
+   return half;
+}
+
+std::vector<unsigned char> TextureCompressor::compress(const unsigned char* rgba, int width, int height,
+   Format format) {
+   int blocksX = (width + 3) / 4;
+   int blocksY = (height + 3) / 4;
+   unsigned int blockSize = getBlockSize(format);
+
+   std::vector<unsigned char> compressed(blocksX * blocksY * blockSize);
+   unsigned char block[64];
+
+   for (int by = 0; by < blocksY; ++by) {
+      for (int bx = 0; bx < blocksX; ++bx) {
+         fetchBlock(rgba, width, height, bx, by, block);
+         unsigned char* out = &compressed[(by * blocksX + bx) * blockSize];
+
+         if (format == Format::BC3) {
+            compressAlphaBlock(block, out);
+            out += 8;
+         }
+         compressColorBlock(block, out);
+      }
+   }
+
+   return compressed;
+}
@@ -0,0 +1,44 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <vector>
+
+/*
+ * Block compression of RGBA8 images into the S3TC formats every desktop GPU samples natively. Each 4x4 block
+ * of pixels becomes 8 bytes (BC1, opaque) or 16 bytes (BC3, with alpha), compared to the 48 or 64 bytes the
+ * uncompressed texture takes in video memory.
+ *
+ * Only used when cooking textures offline, see "tools/TextureCooker.cpp". The game loads the results with
+ * |DDSImage|.
+ *
+ * Design influenced and informed by: van Waveren, "Real-Time DXT Compression" and the S3TC sections of the
+ * OpenGL EXT_texture_compression_s3tc specification
+ */
+namespace TextureCompressor {
+
+   enum class Format {
+      // DXT1, RGB with 565 endpoints and 2 bit indices
+      BC1,
+
+      // DXT5, BC1 colors plus 8 bit alpha endpoints with 3 bit indices
+      BC3
+   };
+
+   // Returns the size in bytes of one 4x4 block
+   unsigned int getBlockSize(Format format);
+
+   // Returns the size in bytes of a compressed image of the given size
+   unsigned int getCompressedSize(Format format, int width, int height);
+
+   // Returns true if any pixel of the RGBA image is not fully opaque
+   bool hasAlpha(const unsigned char* rgba, int width, int height);
+
+   // Returns the RGBA image at half it's size (rounded down, at least 1), averaging 2x2 pixels
+   std::vector<unsigned char> downsample(const unsigned char* rgba, int width, int height);
+
+   // Returns the RGBA image compressed into the given format. Blocks are stored in rows starting with the first
+   // row of pixels, edges that don't fill a whole block are padded by repeating the last pixel
+   std::vector<unsigned char> compress(const unsigned char* rgba, int width, int height, Format format);
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "TextureManager.h"
+
+#include "AsyncLoader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+TextureManager& TextureManager::instance() {
+   static TextureManager *instance = new TextureManager();
+   return *instance;
+}
+
+TextureManager::TextureManager()
+   : memoryBudget_(DEFAULT_MEMORY_BUDGET),
+   residentMemory_(0),
+   useCounter_(0),
+   hits_(0),
+   loads_(0),
+   evictions_(0) {
+}
+
+TextureManager::~TextureManager() {}
+
+std::shared_ptr<Texture> TextureManager::getTexture(const std::string& path) {
+   std::string key = canonicalizePath(path);
+
+   std::unordered_map<std::string, std::shared_ptr<Texture>>::iterator entry = textures_.find(key);
+   if (entry != textures_.end()) {
+      ++hits_;
+      return entry->second;
+   }
+
+   std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+   texture->setPath(key);
+   textures_[key] = texture;
+
+   load(texture);
+
+   return texture;
+}
+
+void TextureManager::setMemoryBudget(size_t bytes) {
+   memoryBudget_ = bytes;
+   evictToBudget(nullptr);
+}
+
+size_t TextureManager::getMemoryBudget() const {
+   return memoryBudget_;
+}
+
+void TextureManager::useTexture(Texture& texture) {
+   texture.setLastUsed(++useCounter_);
+
+   if (texture.isResident() || texture.getPath().empty()) {
+      return;
+   }
+
+   std::unordered_map<std::string, std::shared_ptr<Texture>>::iterator entry = textures_.find(texture.getPath());
+   if (entry != textures_.end()) {
+      load(entry->second);
+   }
+}
+
+void TextureManager::releaseUnused() {
+   for (std::unordered_map<std::string, std::shared_ptr<Texture>>::iterator entry = textures_.begin();
+        entry != textures_.end();) {
+      if (entry->second.use_count() == 1) {
+         if (entry->second->isResident()) {
+            residentMemory_ -= entry->second->getMemoryUsage();
+         }
+         entry = textures_.erase(entry);
+      } else {
+         ++entry;
+      }
+   }
+}
+
+TextureManager::ResidencyStats TextureManager::getResidencyStats() const {
+   ResidencyStats stats = { static_cast<unsigned int>(textures_.size()), 0, 0, 0, residentMemory_, memoryBudget_,
+      hits_, loads_, evictions_ };
+
+   for (const std::pair<const std::string, std::shared_ptr<Texture>>& entry : textures_) {
+      if (entry.second->isResident()) {
+         stats.numResident++;
+      }
+      if (entry.second.use_count() > 1) {
+         stats.numReferenced++;
+      }
+      if (entry.second->isLoading()) {
+         stats.numLoading++;
+      }
+   }
+
+   return stats;
+}
+
+void TextureManager::printResidencyReport() const {
+   ResidencyStats stats = getResidencyStats();
+
+   std::cout << "Textures: " << stats.numResident << "/" << stats.numTextures << " resident ("
+      << stats.numReferenced << " referenced, " << stats.numLoading << " loading), "
+      << stats.residentMemory / 1024 << " KB of " << stats.memoryBudget / 1024 << " KB budget, "
+      << stats.loads << " loads, " << stats.hits << " hits, " << stats.evictions << " evictions" << std::endl;
+}
+
+std::string TextureManager::canonicalizePath(const std::string& path) {
+   std::string unified = path;
+   std::replace(unified.begin(), unified.end(), '\\', '/');
+
+   bool absolute = !unified.empty() && unified[0] == '/';
+
+   std::vector<std::string> segments;
+   size_t start = 0;
+   while (start <= unified.size()) {
+      size_t end = unified.find('/', start);
+      if (end == std::string::npos) {
+         end = unified.size();
+      }
+
+      std::string segment = unified.substr(start, end - start);
+      if (segment == "..") {
+         // Leading ".." of relative paths can't be resolved without the working directory
+         if (!segments.empty() && segments.back() != "..") {
+            segments.pop_back();
+         } else if (!absolute) {
+            segments.push_back(segment);
+         }
+      } else if (!segment.empty() && segment != ".") {
+         segments.push_back(segment);
+      }
+
+      start = end + 1;
+   }
+
+   std::string canonical = absolute ? "/" : "";
+   for (size_t i = 0; i < segments.size(); ++i) {
+      canonical += (i > 0 ? "/" : "") + segments[i];
+   }
+
+   return canonical;
+}
+
+void TextureManager::load(std::shared_ptr<Texture> texture) {
+   if (texture->name.empty()) {
+      texture->name = texture->getPath();
+   }
+
+   texture->setLastUsed(++useCounter_);
+   AsyncLoader::instance().loadTexture(texture);
+}
+
+void TextureManager::onTextureLoaded(Texture& texture) {
+   residentMemory_ += texture.getMemoryUsage();
+   ++loads_;
+
+   evictToBudget(&texture);
+
+#ifdef DEBUG
+   std::cout << "Loaded texture " << texture.getPath() << " (" << texture.getMemoryUsage() / 1024 << " KB"
+      << (texture.isCompressed() ? ", compressed" : "") << ")" << std::endl;
+#endif
+}
+
+void TextureManager::evictToBudget(const Texture* keep) {
+   if (residentMemory_ <= memoryBudget_) {
+      return;
+   }
+
+   std::vector<std::shared_ptr<Texture>> candidates;
+   for (const std::pair<const std::string, std::shared_ptr<Texture>>& entry : textures_) {
+      if (entry.second.get() != keep && entry.second->isResident() && !entry.second->isLoading()) {
+         candidates.push_back(entry.second);
+      }
+   }
+
+   // Unreferenced textures go first, then the least recently used ones. The manager's own pointer and the one in
+   // |candidates| account for two references
+   std::sort(candidates.begin(), candidates.end(),
+      [](const std::shared_ptr<Texture>& a, const std::shared_ptr<Texture>& b) {
+         bool aReferenced = a.use_count() > 2;
+         bool bReferenced = b.use_count() > 2;
+         if (aReferenced != bReferenced) {
+            return bReferenced;
+         }
+         return a->getLastUsed() < b->getLastUsed();
+      });
+
+   for (size_t i = 0; i < candidates.size() && residentMemory_ > memoryBudget_; ++i) {
+      residentMemory_ -= candidates[i]->getMemoryUsage();
+      candidates[i]->unload();
+      ++evictions_;
+   }
+}
@@ -0,0 +1,97 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Texture.h"
+
+/*
+ * Owns all 2D textures, keyed by their canonical path so every file is loaded once no matter how many shapes or
+ * effects use it. Users hold the returned shared pointers, which act as the reference count.
+ *
+ * Textures are loaded by the |AsyncLoader| and show a placeholder until their upload. Whenever the textures
+ * resident in video memory exceed the budget, the least recently bound ones are evicted, unreferenced textures
+ * first. Evicted textures that are still referenced are loaded again the next time they are bound (see
+ * |Texture::bind|).
+ */
+class TextureManager {
+public:
+
+   // Budget used until |setMemoryBudget| is called
+   static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+   struct ResidencyStats {
+      // Textures known to the manager, and how many of them are currently in video memory
+      unsigned int numTextures;
+      unsigned int numResident;
+
+      // Textures that are held by at least one user
+      unsigned int numReferenced;
+
+      // Textures still showing their placeholder
+      unsigned int numLoading;
+
+      size_t residentMemory;
+      size_t memoryBudget;
+
+      // Requests served from the cache, loads from disk (including reloads after eviction) and evictions
+      unsigned int hits;
+      unsigned int loads;
+      unsigned int evictions;
+   };
+
+   static TextureManager& instance();
+
+   ~TextureManager();
+
+   // Returns the texture stored at the given path, starting to load it if needed
+   std::shared_ptr<Texture> getTexture(const std::string& path);
+
+   // Sets the maximum size of all resident textures in bytes and evicts textures until they fit
+   void setMemoryBudget(size_t bytes);
+
+   size_t getMemoryBudget() const;
+
+   // Marks the texture as used and starts loading it again if it was evicted. Called by |Texture::bind|
+   void useTexture(Texture& texture);
+
+   // Accounts for the memory of a texture the |AsyncLoader| just uploaded
+   void onTextureLoaded(Texture& texture);
+
+   // Removes all unreferenced textures, resident or not
+   void releaseUnused();
+
+   ResidencyStats getResidencyStats() const;
+
+   void printResidencyReport() const;
+
+   // Returns the path with separators unified and "." and ".." segments resolved, e.g.
+   // "../resources/./textures/../a.tga" becomes "../resources/a.tga"
+   static std::string canonicalizePath(const std::string& path);
+
+private:
+   TextureManager();
+
+   // Key is the canonical path
+   std::unordered_map<std::string, std::shared_ptr<Texture>> textures_;
+
+   size_t memoryBudget_;
+   size_t residentMemory_;
+
+   // Increased on every use, the last value is stored in each texture for the LRU order
+   unsigned long useCounter_;
+
+   unsigned int hits_;
+   unsigned int loads_;
+   unsigned int evictions_;
+
+   // Queues the texture to be loaded from it's path
+   void load(std::shared_ptr<Texture> texture);
+
+   // Evicts the least recently used textures other than |keep| until the resident ones fit into the budget
+   void evictToBudget(const Texture* keep);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/*
+ * Hands values from one writing thread to one reading thread without either of them waiting on the other. The
+ * writer fills the back buffer and publishes it, the reader picks up the latest published buffer as it's front
+ * buffer. Buffers are swapped through a shared middle slot, so the writer can always start on the next value while
+ * the reader still uses the last one, and values published faster than they're read are skipped.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+
+   TripleBuffer()
+      : back_(0),
+      middle_(1),
+      front_(2) {}
+
+   // Returns the buffer for the writer to fill
+   T& getBack() {
+      return buffers_[back_];
+   }
+
+   // Makes the back buffer the latest value and hands the writer a new one
+   void publish() {
+      back_ = middle_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+   }
+
+   // Makes the latest published value the front buffer. Returns false if nothing was published since the last call
+   bool update() {
+      if (!(middle_.load(std::memory_order_acquire) & FRESH_BIT)) {
+         return false;
+      }
+
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+      return true;
+   }
+
+   // Returns the buffer the reader picked up with the last successful |update|
+   const T& getFront() const {
+      return buffers_[front_];
+   }
+
+private:
+
+   // The middle slot holds a buffer index and whether the writer published it since the reader last took it
+   static constexpr unsigned int INDEX_MASK = 3;
+   static constexpr unsigned int FRESH_BIT = 4;
+
+   T buffers_[3];
+
+   // Only touched by the writer
+   unsigned int back_;
+
+   std::atomic<unsigned int> middle_;
+
+   // Only touched by the reader
+   unsigned int front_;
+};
+
+#endif
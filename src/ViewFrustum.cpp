@@ -3,7 +3,8 @@
 
 using namespace glm;
 
-ViewFrustum::ViewFrustum() {}
+ViewFrustum::ViewFrustum(CullCacheSlot cacheSlot)
+   : cacheSlot_(cacheSlot) {}
 
 ViewFrustum::~ViewFrustum() {}
 
@@ -70,8 +71,7 @@ void ViewFrustum::extractPlanes(glm::mat4 P, glm::mat4 V) {
 	planes[5] = planes[5] / length;
 }
 
-// See 'www.txutxi.com/?p=584' for detailed algorithm explanation
-bool ViewFrustum::cull(std::shared_ptr<GameObject> obj) {
+bool ViewFrustum::cull(std::shared_ptr<GameObject> obj, unsigned int planeMask) {
    /* Every object needs to have a bounding box in order to cull.
     * If an object doesn't have a bounding box, cull it so we don't create
     * unseen problems with culling. */
@@ -79,25 +79,62 @@ bool ViewFrustum::cull(std::shared_ptr<GameObject> obj) {
    if (objBox == NULL) {
       return false;
    }
-   vec3 box[] = {objBox->min_, objBox->max_};
+
+   return cullBox(*objBox, planeMask);
+}
+
+bool ViewFrustum::cullBox(BoundingBox& box, unsigned int& planeMask) {
+   return testBox(box.min_, box.max_, planeMask, box.lastCulledPlane_[cacheSlot_]);
+}
+
+bool ViewFrustum::cullBox(const glm::vec3& min, const glm::vec3& max) {
+   unsigned int planeMask = ALL_PLANES;
+   int lastCulledPlane = 0;
+
+   return testBox(min, max, planeMask, lastCulledPlane);
+}
+
+// See 'www.txutxi.com/?p=584' for detailed algorithm explanation.
+// The plane masking and last culled plane caching follow Assarsson and Moeller,
+// "Optimized View Frustum Culling Algorithms for Bounding Boxes"
+bool ViewFrustum::testBox(const glm::vec3& min, const glm::vec3& max, unsigned int& planeMask, int& lastCulledPlane) {
+   const vec3 box[] = {min, max};
 
    vec4 plane;
    int px, py, pz;
    float dotProduct;
-   for (unsigned int i = 0; i < planes.size(); ++i) {
+   for (int j = -1; j < static_cast<int>(planes.size()); ++j) {
+
+      // The plane that culled the box last time is the most likely to do it again, so it's tested first
+      int i = j < 0 ? lastCulledPlane : j;
+      if ((j >= 0 && i == lastCulledPlane) || !(planeMask & (1u << i))) {
+         continue;
+      }
+
       plane = planes[i];
 
       px = static_cast<int>(plane.x > 0.0f);
       py = static_cast<int>(plane.y > 0.0f);
       pz = static_cast<int>(plane.z > 0.0f);
 
+      // Positive vertex (furthest along the plane normal) outside means the whole box is outside
       dotProduct = (plane.x * box[px].x) +
                    (plane.y * box[py].y) +
                    (plane.z * box[pz].z);
 
       if (dotProduct < -plane.w) {
+         lastCulledPlane = i;
          return true;
       }
+
+      // Negative vertex inside means the whole box is inside, so boxes within it can skip this plane
+      dotProduct = (plane.x * box[1 - px].x) +
+                   (plane.y * box[1 - py].y) +
+                   (plane.z * box[1 - pz].z);
+
+      if (dotProduct >= -plane.w) {
+         planeMask &= ~(1u << i);
+      }
    }
 
    return false;
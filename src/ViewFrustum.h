@@ -6,16 +6,41 @@
 
 class ViewFrustum {
 public:
-   ViewFrustum();
+
+   // Which of the per BoundingBox culling caches a frustum uses, so that frusta culling the same
+   // objects every frame (e.g. camera and light) don't overwrite each other's cached planes
+   enum CullCacheSlot { VIEW_CULL_CACHE = 0, SHADOW_CULL_CACHE = 1 };
+
+   // Plane mask with every plane of the frustum set. A cleared bit means the tested box (or the
+   // box it's enclosed in) lies completely inside of that plane so the plane can be skipped
+   static constexpr unsigned int ALL_PLANES = 0x3F;
+
+   ViewFrustum(CullCacheSlot cacheSlot = VIEW_CULL_CACHE);
 
    ~ViewFrustum();
 
    void extractPlanes(glm::mat4 P, glm::mat4 V);
 
-   bool cull(std::shared_ptr<GameObject> obj);
+   // Returns true if the object's bounding box lies completely outside of the frustum.
+   // Only the planes set in |planeMask| are tested
+   bool cull(std::shared_ptr<GameObject> obj, unsigned int planeMask = ALL_PLANES);
+
+   // Returns true if |box| lies completely outside of the frustum. Only the planes set in |planeMask|
+   // are tested, and on return the planes |box| is completely inside of are cleared from it
+   bool cullBox(BoundingBox& box, unsigned int& planeMask);
+
+   // Returns true if the axis-aligned box given by |min| and |max| lies completely outside of the frustum
+   bool cullBox(const glm::vec3& min, const glm::vec3& max);
 
 private:
    std::array<glm::vec4, 6> planes;
+
+   // The culling cache used in each tested BoundingBox
+   CullCacheSlot cacheSlot_;
+
+   // Tests the box against the planes in |planeMask|, starting with |lastCulledPlane|.
+   // Updates |planeMask| and |lastCulledPlane| as described in |cullBox|
+   bool testBox(const glm::vec3& min, const glm::vec3& max, unsigned int& planeMask, int& lastCulledPlane);
 };
 
 #endif
@@ -1,4 +1,5 @@
 #include "WindowManager.h"
+#include "DebugDraw.h"
 
 WindowManager::~WindowManager() {
 	glfwDestroyWindow(window_);
@@ -39,22 +40,24 @@ void WindowManager::update() {
 void WindowManager::checkForUserChanges() {
     ShaderManager& shaderManager = ShaderManager::instance();
 
+    // The renderer switches the default shader with the next frame
+    RenderSettings& renderSettings = GameManager::instance().getGameWorld().getRenderSettings();
+    const std::string previousDefaultShader = renderSettings.defaultShader;
+
     // Check for shader setting changes
     if (isKeyPressed(GLFW_KEY_P)) {
         // Use the "Phong" shader as the current default
-        shaderManager.setDefaultShader(shaderManager.PhongShader);
-
-        std::cout << "Switched to " << shaderManager.PhongShader << " shader!" << std::endl;
+        renderSettings.defaultShader = shaderManager.PhongShader;
     } else if (isKeyPressed(GLFW_KEY_C)) {
         // Use the "CookTorrance" shader as the current default
-        shaderManager.setDefaultShader(shaderManager.CookTorranceShader);
-
-        std::cout << "Switched to " << shaderManager.CookTorranceShader << " shader!" << std::endl;
+        renderSettings.defaultShader = shaderManager.CookTorranceShader;
     } else if (isKeyPressed(GLFW_KEY_T)) {
         // Use the "Toon" shader as the current default
-        shaderManager.setDefaultShader(shaderManager.ToonShader);
+        renderSettings.defaultShader = shaderManager.ToonShader;
+    }
 
-        std::cout << "Switched to " << shaderManager.ToonShader << " shader!" << std::endl;
+    if (renderSettings.defaultShader != previousDefaultShader) {
+        std::cout << "Switched to " << renderSettings.defaultShader << " shader!" << std::endl;
     }
 
     if (isKeyPressed(GLFW_KEY_ESCAPE)) {
@@ -67,6 +70,14 @@ void WindowManager::swapBuffers() {
 	glfwSwapBuffers(window_);
 }
 
+void WindowManager::makeContextCurrent() {
+	glfwMakeContextCurrent(window_);
+}
+
+void WindowManager::releaseContext() {
+	glfwMakeContextCurrent(NULL);
+}
+
 bool WindowManager::isClosed() {;
 	return glfwWindowShouldClose(window_);
 }
@@ -118,11 +129,7 @@ void WindowManager::updateFramebuffer() {
 	// Get current frame buffer size
 	int newWidth, newHeight;
 	glfwGetFramebufferSize(window_, &newWidth, &newHeight);
-	glViewport(0, 0, newWidth, newHeight);
 	updateViewSize(newWidth, newHeight);
-
-	// Clear the framebuffer
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 // Various callbacks that are set within |initializeGLFW| to be called upon user action
@@ -195,7 +202,59 @@ int WindowManager::initializeGLFW() {
 }
 
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    // Nothing here for now
+    if (action != GLFW_PRESS) {
+        return;
+    }
+
+    // Render setting toggles, the renderer picks them up with the next frame
+    GameWorld& world = GameManager::instance().getGameWorld();
+    RenderSettings& renderSettings = world.getRenderSettings();
+
+    if (key == GLFW_KEY_F1) {
+        renderSettings.staticShadowCaching = !renderSettings.staticShadowCaching;
+
+        std::cout << "Static shadow caching " << (renderSettings.staticShadowCaching ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F2) {
+        world.setOcclusionCulling(!world.isOcclusionCulling());
+
+        std::cout << "Occlusion culling " << (world.isOcclusionCulling() ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F3) {
+        renderSettings.indirectStatics = !renderSettings.indirectStatics;
+
+        std::cout << "Indirect static drawing " << (renderSettings.indirectStatics ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F4) {
+        renderSettings.shadowFilter = static_cast<ShadowMap::Filter>(
+            (static_cast<int>(renderSettings.shadowFilter) + 1) % ShadowMap::NUM_FILTERS);
+
+        std::cout << "Shadow filter " << ShadowMap::getFilterName(renderSettings.shadowFilter) << std::endl;
+    } else if (key == GLFW_KEY_F5) {
+        renderSettings.depthPrePass = !renderSettings.depthPrePass;
+
+        std::cout << "Depth pre-pass " << (renderSettings.depthPrePass ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F6) {
+        renderSettings.overdrawCounter = !renderSettings.overdrawCounter;
+
+        std::cout << "Overdraw counter " << (renderSettings.overdrawCounter ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F7) {
+        // The overlay shows the profiler's times, so it goes away with them
+        renderSettings.profiling = !renderSettings.profiling;
+        renderSettings.profilerOverlay = renderSettings.profilerOverlay && renderSettings.profiling;
+
+        std::cout << "Render profiling " << (renderSettings.profiling ? "enabled" : "disabled") << std::endl;
+    } else if (key == GLFW_KEY_F8) {
+        renderSettings.profilerOverlay = !renderSettings.profilerOverlay;
+        renderSettings.profiling = renderSettings.profiling || renderSettings.profilerOverlay;
+
+        std::cout << "Render profiler overlay " << (renderSettings.profilerOverlay ? "enabled" : "disabled") << std::endl;
+    } else if (key >= GLFW_KEY_F9 && key <= GLFW_KEY_F12) {
+        // F9 to F12 toggle bounding boxes, octree nodes, frusta and contact normals
+        DebugDraw::Category category = static_cast<DebugDraw::Category>(1 << (key - GLFW_KEY_F9));
+        DebugDraw& debugDraw = DebugDraw::instance();
+        debugDraw.setEnabled(category, !debugDraw.isEnabled(category));
+
+        std::cout << DebugDraw::getCategoryName(category) << " lines "
+            << (debugDraw.isEnabled(category) ? "enabled" : "disabled") << std::endl;
+    }
 }
 
 static void mouseCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -228,8 +287,6 @@ static void cursorPositionCallback(GLFWwindow* window, double posX, double posY)
 static void resizeCallback(GLFWwindow* window, int width, int height) {
 	WindowManager& windowManager = WindowManager::instance();
 	windowManager.updateViewSize(width, height);
-
-    glViewport(0, 0, width, height);
 }
 
 static void errorCallback(int error, const char* description) {
@@ -34,6 +34,12 @@ public:
 	// Swap front and back buffers
 	void swapBuffers();
 
+	// Makes the window's GL context current on the calling thread
+	void makeContextCurrent();
+
+	// Releases the window's GL context from the calling thread, so that another thread can make it current
+	void releaseContext();
+
 	// Checks whether or not the window was closed by the user
 	bool isClosed();
 
@@ -79,6 +85,7 @@ private:
 
 	WindowManager();
 
+	// Reads the current framebuffer size, the renderer sets the viewport from it
 	void updateFramebuffer();
 
 	// Initializes general boiler-plate GLFW code
@@ -0,0 +1,279 @@
+#include "WorldRenderer.h"
+
+#include <algorithm>
+
+#include "DebugDraw.h"
+#include "GameManager.h"
+#include "RenderProfiler.h"
+#include "ShaderManager.h"
+
+WorldRenderer::WorldRenderer()
+   : settingsApplied_(false),
+   shadowWindowVersion_(0) {}
+
+void WorldRenderer::render(const FrameSnapshot& snapshot) {
+   applySettings(snapshot.settings);
+   updateStaticState(snapshot);
+
+   // Nothing lit is drawn past the cull distance, so the slices only need to reach that far
+   clusteredLighting_.update(snapshot.pointLights, snapshot.directionalLights, snapshot.P, snapshot.V,
+      snapshot.cullFarPlane);
+   ShaderManager::instance().beginFrame(snapshot.eye, &clusteredLighting_);
+
+   renderShadowMap(snapshot);
+
+   MatrixStack P(snapshot.P);
+   MatrixStack V(snapshot.V);
+
+   renderMainPass(snapshot, P, V);
+
+   // Blended, so after everything opaque
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+   renderProfiler.beginPass(RenderPass::PARTICLES);
+   particleRenderer_.draw(snapshot.particles, P, V);
+   renderProfiler.endPass(RenderPass::PARTICLES);
+
+   DebugDraw& debugDraw = DebugDraw::instance();
+   debugDraw.upload(snapshot.debugLines);
+   debugDraw.draw(snapshot.P, snapshot.V);
+
+   if (snapshot.vfcViewport) {
+      renderVFCViewport(snapshot);
+   }
+}
+
+OverdrawCounter& WorldRenderer::getOverdrawCounter() {
+   return overdrawCounter_;
+}
+
+void WorldRenderer::applySettings(const RenderSettings& settings) {
+   ShadowMap* shadowMap = GameManager::instance().getShadowMap();
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+
+   // Each of these resets some state, so they're only called when the setting actually changed
+   if (!settingsApplied_ || settings.staticShadowCaching != appliedSettings_.staticShadowCaching) {
+      shadowMap->setStaticCaching(settings.staticShadowCaching);
+   }
+
+   if (!settingsApplied_ || settings.shadowFilter != appliedSettings_.shadowFilter) {
+      shadowMap->setFilter(settings.shadowFilter);
+   }
+
+   if (!settingsApplied_ || settings.overdrawCounter != appliedSettings_.overdrawCounter) {
+      overdrawCounter_.setEnabled(settings.overdrawCounter);
+   }
+
+   if (!settingsApplied_ || settings.profiling != appliedSettings_.profiling) {
+      renderProfiler.setEnabled(settings.profiling);
+   }
+
+   if (!settingsApplied_ || settings.profilerOverlay != appliedSettings_.profilerOverlay) {
+      renderProfiler.setOverlay(settings.profilerOverlay);
+   }
+
+   if (!settings.defaultShader.empty() && settings.defaultShader != appliedSettings_.defaultShader) {
+      ShaderManager::instance().setDefaultShader(settings.defaultShader);
+   }
+
+   appliedSettings_ = settings;
+   settingsApplied_ = true;
+}
+
+void WorldRenderer::updateStaticState(const FrameSnapshot& snapshot) {
+   ShadowMap* shadowMap = GameManager::instance().getShadowMap();
+
+   // Cached static shadows no longer match the static geometry
+   if (snapshot.staticItems != staticItems_) {
+      staticItems_ = snapshot.staticItems;
+      staticBatchRenderer_.build(staticItems_ != nullptr ? *staticItems_ : std::vector<RenderItem>());
+      shadowMap->invalidateStaticCache();
+   }
+
+   // Cached static shadows no longer cover the shadow window
+   if (snapshot.shadowWindowVersion != shadowWindowVersion_) {
+      shadowWindowVersion_ = snapshot.shadowWindowVersion;
+      shadowMap->invalidateStaticCache();
+   }
+}
+
+void WorldRenderer::renderShadowMap(const FrameSnapshot& snapshot) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+   ShadowMap* shadowMap = GameManager::instance().getShadowMap();
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+
+   renderProfiler.beginPass(RenderPass::SHADOW);
+
+   // Binds the shadow program and uploads the light matrices once for the whole pass
+   shaderManager.beginShadowPass(snapshot.lightP, snapshot.lightV);
+
+   // With caching enabled the static casters are only rendered when the cached static depth is out of date
+   if (shadowMap->isStaticCaching() && !shadowMap->isStaticCacheValid()) {
+      shadowCasters_.clear();
+      for (unsigned int index : snapshot.staticShadowCasters) {
+         shadowCasters_.push_back(&(*staticItems_)[index]);
+      }
+
+      shadowMap->bindForStaticCachePass();
+      renderShadowCasters(shadowCasters_);
+      shadowMap->validateStaticCache();
+   }
+
+   // Copies in the static depth when cached, otherwise clears it
+   shadowMap->bindForShadowPass();
+
+   shadowCasters_.clear();
+   if (!shadowMap->isStaticCaching()) {
+      for (unsigned int index : snapshot.staticShadowCasters) {
+         shadowCasters_.push_back(&(*staticItems_)[index]);
+      }
+   }
+   for (const RenderItem& item : snapshot.dynamicShadowCasters) {
+      shadowCasters_.push_back(&item);
+   }
+
+   renderShadowCasters(shadowCasters_);
+
+   shaderManager.endShadowPass();
+
+   // Filters the finished map for EVSM
+   shadowMap->updateMoments();
+
+   renderProfiler.endPass(RenderPass::SHADOW);
+}
+
+void WorldRenderer::renderShadowCasters(std::vector<const RenderItem*>& casters) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+
+   // Group casters sharing the same mesh so consecutive draws reuse the same buffers
+   std::sort(casters.begin(), casters.end(), [](const RenderItem* a, const RenderItem* b) {
+      return a->shape < b->shape;
+   });
+
+   for (const RenderItem* item : casters) {
+      shaderManager.renderShadowPass(*item);
+   }
+}
+
+void WorldRenderer::renderMainPass(const FrameSnapshot& snapshot, const MatrixStack& P, const MatrixStack& V) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+   RenderProfiler& renderProfiler = RenderProfiler::instance();
+   const RenderSettings& settings = snapshot.settings;
+
+   renderProfiler.beginPass(RenderPass::MAIN);
+
+   GameManager::instance().getShadowMap()->bindForDraw(snapshot.viewWidth, snapshot.viewHeight);
+
+   sortVisibleItems(snapshot);
+
+   overdrawCounter_.begin(snapshot.viewWidth * snapshot.viewHeight);
+
+   // Only the nearest surface of each pixel passes the equal test after the pre-pass, so nothing is shaded twice
+   if (settings.depthPrePass) {
+      renderDepthPrePass(snapshot.P, snapshot.V);
+
+      glDepthFunc(GL_EQUAL);
+      glDepthMask(GL_FALSE);
+   }
+
+   // Static objects the batch can handle are collected and drawn with a few multi draws, the rest one by one
+   batchedItems_.clear();
+   unsortedItems_.clear();
+   for (const RenderItem* item : sortedItems_) {
+      if (settings.depthPrePass && !item->castsShadow) {
+         unsortedItems_.push_back(item);
+      } else if (settings.indirectStatics && staticBatchRenderer_.canDraw(*item)) {
+         batchedItems_.push_back(item);
+      } else {
+         shaderManager.renderObject(*item, P, V);
+      }
+   }
+
+   staticBatchRenderer_.draw(batchedItems_, P, V);
+
+   if (settings.depthPrePass) {
+      glDepthFunc(GL_LESS);
+      glDepthMask(GL_TRUE);
+   }
+
+   for (const RenderItem* item : unsortedItems_) {
+      shaderManager.renderObject(*item, P, V);
+   }
+
+   // Markers aren't part of the pre-pass
+   for (const RenderItem& item : snapshot.markerItems) {
+      shaderManager.renderObject(item, P, V);
+   }
+
+   debrisRenderer_.draw(snapshot.debrisBatches, snapshot.debrisData, P, V);
+
+   // Last of the opaque passes, so that only the sky pixels nothing covered are shaded
+   if (snapshot.hasSkybox) {
+      renderProfiler.beginPass(RenderPass::SKYBOX);
+      shaderManager.renderSkybox(snapshot.skybox, P, V);
+      renderProfiler.endPass(RenderPass::SKYBOX);
+   }
+
+   overdrawCounter_.end();
+   renderProfiler.endPass(RenderPass::MAIN);
+}
+
+void WorldRenderer::sortVisibleItems(const FrameSnapshot& snapshot) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+
+   drawOrder_.clear();
+   for (const RenderItem& item : snapshot.visibleItems) {
+      DrawOrderEntry entry;
+      entry.program = shaderManager.getShaderProgram(item.shaderName).get();
+      entry.depth = glm::dot(item.position - snapshot.eye, snapshot.viewDirection);
+      entry.item = &item;
+      drawOrder_.push_back(entry);
+   }
+
+   std::sort(drawOrder_.begin(), drawOrder_.end(), [](const DrawOrderEntry& a, const DrawOrderEntry& b) {
+      return a.program != b.program ? a.program < b.program : a.depth < b.depth;
+   });
+
+   sortedItems_.clear();
+   for (const DrawOrderEntry& entry : drawOrder_) {
+      sortedItems_.push_back(entry.item);
+   }
+}
+
+void WorldRenderer::renderDepthPrePass(const glm::mat4& P, const glm::mat4& V) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+
+   RenderProfiler::instance().beginPass(RenderPass::DEPTH_PRE_PASS);
+   shaderManager.beginDepthPrePass(P, V);
+   glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+   // Visible items are already sorted front to back
+   for (const RenderItem* item : sortedItems_) {
+      if (item->castsShadow) {
+         shaderManager.renderShadowPass(*item);
+      }
+   }
+
+   glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+   shaderManager.endDepthPrePass();
+   RenderProfiler::instance().endPass(RenderPass::DEPTH_PRE_PASS);
+}
+
+void WorldRenderer::renderVFCViewport(const FrameSnapshot& snapshot) {
+   ShaderManager& shaderManager = ShaderManager::instance();
+   MatrixStack P(snapshot.vfcP);
+   MatrixStack V(snapshot.vfcV);
+
+   glClear(GL_DEPTH_BUFFER_BIT);
+   glViewport(0, 0, snapshot.viewHeight / 3.0, snapshot.viewHeight / 3.0);
+
+   // Draw what the main view found visible this frame
+   RenderProfiler::instance().beginPass(RenderPass::VFC_VIEWPORT);
+   for (const RenderItem& item : snapshot.visibleItems) {
+      shaderManager.renderObject(item, P, V);
+   }
+   DebugDraw::instance().draw(snapshot.vfcP, snapshot.vfcV);
+   RenderProfiler::instance().endPass(RenderPass::VFC_VIEWPORT);
+
+   // Later overlays are drawn over the whole window again
+   glViewport(0, 0, snapshot.viewWidth, snapshot.viewHeight);
+}
@@ -0,0 +1,106 @@
+#ifndef WORLD_RENDERER_H
+#define WORLD_RENDERER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "ClusteredLighting.h"
+#include "DebrisRenderer.h"
+#include "FrameSnapshot.h"
+#include "MatrixStack.h"
+#include "OverdrawCounter.h"
+#include "ParticleRenderer.h"
+#include "Program.h"
+#include "StaticBatchRenderer.h"
+
+/*
+ * Draws a |FrameSnapshot| into the default framebuffer: the shadow map first, then the opaque objects sorted by
+ * program and depth, the sky, particles and debug lines. Everything it draws comes out of the snapshot, so it can
+ * run on a different thread than the simulation building the snapshots, as long as it owns the GL context.
+ *
+ * GL objects derived from the snapshots (the static batch, cached static shadows, lights binned into clusters) are
+ * kept here and only rebuilt when the snapshot says what they were built from changed. So are the buffers particles
+ * and debris are streamed into, the simulation only hands over what to draw.
+ */
+class WorldRenderer {
+public:
+
+   WorldRenderer();
+
+   // Renders the frame. Doesn't swap buffers
+   void render(const FrameSnapshot& snapshot);
+
+   // Returns the counter measuring the overdraw of the main pass
+   OverdrawCounter& getOverdrawCounter();
+
+private:
+
+   // Visible item with the program it's drawn with and it's distance along the view direction
+   struct DrawOrderEntry {
+      const Program* program;
+      float depth;
+      const RenderItem* item;
+   };
+
+   // Draws visible static objects from shared buffers with one multi draw per shader and texture
+   StaticBatchRenderer staticBatchRenderer_;
+
+   // Counts the fragments shaded by the opaque part of the main pass
+   OverdrawCounter overdrawCounter_;
+
+   // Point lights binned into clusters of the camera's frustum once per frame
+   ClusteredLighting clusteredLighting_;
+
+   // Draw the particles and debris collected into the snapshot
+   ParticleRenderer particleRenderer_;
+   DebrisRenderer debrisRenderer_;
+
+   // Settings of the last frame, changes are applied to the render systems before drawing
+   RenderSettings appliedSettings_;
+   bool settingsApplied_;
+
+   // Static items |staticBatchRenderer_| and the cached static shadows were built from
+   std::shared_ptr<const std::vector<RenderItem>> staticItems_;
+
+   // Shadow window the cached static shadows were rendered for
+   unsigned long shadowWindowVersion_;
+
+   // Per frame storage, kept as members so that it's reused between frames
+   std::vector<DrawOrderEntry> drawOrder_;
+   std::vector<const RenderItem*> sortedItems_;
+   std::vector<const RenderItem*> batchedItems_;
+   std::vector<const RenderItem*> unsortedItems_;
+   std::vector<const RenderItem*> shadowCasters_;
+
+   // Applies render settings that changed since the last frame
+   void applySettings(const RenderSettings& settings);
+
+   // Rebuilds what depends on the static objects or the shadow window if the snapshot's differ
+   void updateStaticState(const FrameSnapshot& snapshot);
+
+   // Renders the shadow casters into the shadow map, from the static cache if possible
+   void renderShadowMap(const FrameSnapshot& snapshot);
+
+   // Renders the given casters into the currently bound shadow map target
+   void renderShadowCasters(std::vector<const RenderItem*>& casters);
+
+   // Draws the visible objects, the markers, debris and sky into the default framebuffer
+   void renderMainPass(const FrameSnapshot& snapshot, const MatrixStack& P, const MatrixStack& V);
+
+   // Fills |sortedItems_| with the visible items by program and then front to back, so that each program's objects
+   // are drawn together and hidden fragments fail the depth test before they're shaded
+   void sortVisibleItems(const FrameSnapshot& snapshot);
+
+   // Renders the depth of the visible shadow casters (everything opaque that's drawn with the mesh shaders)
+   void renderDepthPrePass(const glm::mat4& P, const glm::mat4& V);
+
+   // Draws a small top down view port to see view frustum culling, along with the debug lines
+   void renderVFCViewport(const FrameSnapshot& snapshot);
+};
+
+#endif
@@ -4,6 +4,7 @@
  * Application code for "Granny Gauntlet"
  */
 
+#include "AsyncLoader.h"
 #include "LevelLoader.h"
 #include "GameWorld.h"
 #include "GameManager.h"
@@ -13,8 +14,12 @@
 #include "ShaderManager.h"
 #include "ShapeManager.h"
 #include "MaterialManager.h"
+#include "MatrixStackBenchmark.h"
+#include "RenderProfiler.h"
+#include "RenderThread.h"
 #include "WindowManager.h"
 #include "ShadowMap.h"
+#include "WorldRenderer.h"
 
 #include "WallPhysicsComponent.h"
 #include "WallRenderComponent.h"
@@ -28,6 +33,16 @@
 // Where the resources are loaded from
 std::string resourceDirectory = "../resources/";
 
+// Where linked shader programs are cached between launches
+std::string shaderCacheDirectory = "../shadercache/";
+
+// Level rendered by the shadow filter benchmark ("--shadow-benchmark")
+std::string shadowBenchmarkLevel = "../levels/shadow-benchmark.json";
+
+// Frames timed per shadow filter by the benchmark, after some untimed frames to let the camera settle
+constexpr int shadowBenchmarkFrames = 300;
+constexpr int shadowBenchmarkWarmupFrames = 60;
+
 // TODO(rgarmsen2295): Move into GLSL Graphics API Manager class
 static void initMisc() {
     GLSL::checkVersion();
@@ -42,7 +57,53 @@ static void initMisc() {
     std::srand(std::time(NULL));
 }
 
+// Renders the loaded level from the player's point of view with every shadow filter and prints the average
+// time (including waiting for the GPU) a frame took with each. Renders on the main thread so that each frame is
+// timed on it's own
+static void runShadowBenchmark(GameWorld& world, Camera& camera) {
+    WindowManager& windowManager = WindowManager::instance();
+    WorldRenderer renderer;
+    FrameSnapshot snapshot;
+    constexpr double dt = 1.0 / 60.0;
+
+    for (int i = 0; i < ShadowMap::NUM_FILTERS; ++i) {
+        ShadowMap::Filter filter = static_cast<ShadowMap::Filter>(i);
+        world.getRenderSettings().shadowFilter = filter;
+
+        double totalTime = 0.0;
+        for (int frame = 0; frame < shadowBenchmarkWarmupFrames + shadowBenchmarkFrames; ++frame) {
+            windowManager.pollEvents();
+            camera.update(dt);
+            AsyncLoader::instance().update();
+
+            double startTime = glfwGetTime();
+
+            world.buildFrameSnapshot(snapshot);
+            renderer.render(snapshot);
+            glFinish();
+
+            if (frame >= shadowBenchmarkWarmupFrames) {
+                totalTime += glfwGetTime() - startTime;
+            }
+
+            windowManager.swapBuffers();
+        }
+
+        std::cout << ShadowMap::getFilterName(filter) << ": " << totalTime / shadowBenchmarkFrames * 1000.0
+            << " ms per frame" << std::endl;
+    }
+}
+
 int main(int argc, char **argv) {
+    // Times the matrix stack against it's previous implementation, no window needed
+    if (argc > 1 && std::string(argv[1]) == "--matrix-benchmark") {
+        runMatrixStackBenchmark(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    // Renders a shadow heavy level with every shadow filter instead of playing
+    bool shadowBenchmark = argc > 1 && std::string(argv[1]) == "--shadow-benchmark";
+
 	// Initialize boilerplate glfw, etc. code and check for failure
     WindowManager& windowManager = WindowManager::instance();    
     if (windowManager.initialize() == -1) {
@@ -53,10 +114,16 @@ int main(int argc, char **argv) {
 	// Initialize scene data
 	initMisc();
 
+    // Show the window right away, textures finish loading once the game is running
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    windowManager.swapBuffers();
+
 	 // Initialize the ResourceManager and get its instance
 	 ResourceManager& resourceManager = ResourceManager::instance();
 	 resourceManager.setResourceDirectory(resourceDirectory);
 
+    ShaderManager::instance().setProgramBinaryCacheDirectory(shaderCacheDirectory);
+
     // Initialize the AudioManager and get its instance
     AudioManager& audioManager = AudioManager::instance();
 
@@ -69,7 +136,9 @@ int main(int argc, char **argv) {
     std::shared_ptr<GameObject> player;
 
     LevelLoader& levelLoader = LevelLoader::instance();
-    if (levelLoader.loadLevel(world, player)) {
+    int levelError = shadowBenchmark ? levelLoader.loadLevel(world, player, shadowBenchmarkLevel)
+        : levelLoader.loadLevel(world, player);
+    if (levelError) {
         std::cerr << "Error loading level." << std::endl;
         return EXIT_FAILURE;
     }
@@ -95,14 +164,21 @@ int main(int argc, char **argv) {
 
     gameManager.setTime(1500.0);
 
+    if (shadowBenchmark) {
+        runShadowBenchmark(world, camera);
+        return EXIT_SUCCESS;
+    }
+
     // Loop until the user closes the window
-    int numFramesInSecond = 0;
     constexpr double dt = 1.0 / 60.0;
     double totalTime = 0.0;
-    double secondClock = 0.0;
     double startTime = glfwGetTime();
     double previousTime = startTime;
 
+    // Draws the snapshots of the world built at the end of every tick, from here on it owns the GL context
+    RenderThread renderThread;
+    renderThread.start();
+
     audioManager.startSoundtrack();
 
     while (!windowManager.isClosed()) {
@@ -123,6 +199,7 @@ int main(int argc, char **argv) {
             gameManager.decreaseTime(deltaTime);
 
             if(gameManager.gameOver_) {
+                renderThread.stop();
                 gameManager.showScore();
                 return EXIT_SUCCESS;
             }
@@ -130,36 +207,21 @@ int main(int argc, char **argv) {
 
             elapsedTime -= deltaTime;
             totalTime += deltaTime;
-            secondClock += deltaTime;
         }
 
         // Update the window in-case of resizing, etc.
         windowManager.update();
 
-        // Render all objects to shadow map
-        world.renderShadowMap();
-
-        // Draw all objects in the world
-        world.drawGameObjects();
-
-        // Swap front and back buffers
-        windowManager.swapBuffers();
-
-        // Print info roughly every second
-        numFramesInSecond++;
-        if (secondClock >= 1.0) {
-
-            // TODO(rgarmsen2295): Currently acting kinda funky on linux and not 
-            // really necessary so disabling for now
-            // gameManager.printInfoToConsole(numFramesInSecond / secondClock);
-
-            secondClock = 0.0;
-            numFramesInSecond = 0;
-        }
+        // Stay at most one frame ahead of the renderer, then hand it the new state of the world
+        renderThread.waitForRenderer();
+        world.buildFrameSnapshot(renderThread.getBackSnapshot());
+        renderThread.publish();
 
         // All audio updating occurs here.
         audioManager.update();
     }
 
+    renderThread.stop();
+
     return EXIT_SUCCESS;
 }
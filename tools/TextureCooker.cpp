@@ -0,0 +1,65 @@
+/*
+ * Cooks source images (TGA, JPG, PNG, ...) into block compressed DDS files with a full mip chain, stored next to
+ * the source with a ".dds" extension. |Texture| and |Cubemap| load the cooked files when they exist, so this only
+ * has to be run again when a source image changes.
+ */
+
+// Usage: texturecooker <image>...
+// e.g.   texturecooker ../resources/textures/*.tga ../resources/skybox/bluesky/*.png
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <iostream>
+
+#include "DDSImage.h"
+
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      std::cerr << "Usage: " << argv[0] << " <image>..." << std::endl;
+      return 1;
+   }
+
+   int failures = 0;
+   size_t totalUncompressed = 0;
+   size_t totalCompressed = 0;
+
+   for (int i = 1; i < argc; ++i) {
+      std::string sourcePath = argv[i];
+
+      int width, height, components;
+      unsigned char* rgba = stbi_load(sourcePath.c_str(), &width, &height, &components, STBI_rgb_alpha);
+      if (!rgba) {
+         std::cerr << "Skipping " << sourcePath << ": " << stbi_failure_reason() << std::endl;
+         ++failures;
+         continue;
+      }
+
+      DDSImage image = DDSImage::compress(rgba, width, height);
+      stbi_image_free(rgba);
+
+      std::string cookedPath = DDSImage::getCookedPath(sourcePath);
+      if (!image.save(cookedPath)) {
+         std::cerr << "Could not write " << cookedPath << std::endl;
+         ++failures;
+         continue;
+      }
+
+      // Drivers store uncompressed textures as RGBA8, plus a third for the generated mipmaps
+      size_t uncompressed = static_cast<size_t>(width) * height * 4 * 4 / 3;
+      totalUncompressed += uncompressed;
+      totalCompressed += image.getDataSize();
+
+      std::cout << cookedPath << ": " << width << "x" << height << " "
+         << (image.format == TextureCompressor::Format::BC1 ? "BC1" : "BC3") << ", "
+         << image.mipLevels.size() << " mips, " << image.getDataSize() / 1024 << " KB" << std::endl;
+   }
+
+   if (totalCompressed > 0) {
+      std::cout << "Cooked " << (argc - 1 - failures) << " textures into " << totalCompressed / 1024 << " KB ("
+         << totalUncompressed / 1024 << " KB uncompressed, "
+         << static_cast<float>(totalUncompressed) / totalCompressed << "x smaller)" << std::endl;
+   }
+
+   return failures > 0 ? 1 : 0;
+}